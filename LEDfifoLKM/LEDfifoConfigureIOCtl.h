@@ -17,6 +17,87 @@ typedef struct _configure
     int periodTRESETCount;
 } configure_arg_t;
 
+// screen byte order of every frame handed to the driver (write(), queued, program, read())
+//   SEQUENTIAL:  lane 0 LEDs 0-255, then lane 1 LEDs 0-255, then lane 2 ...   (each LED GRB)
+//   INTERLEAVED: LED 0 of lanes 0,1,2, then LED 1 of lanes 0,1,2, ...         (each LED GRB)
+//     interleaved is the order the transmitter consumes, it walks the frame once front to back
+#define FIFO_FORMAT_LANE_SEQUENTIAL 0
+#define FIFO_FORMAT_LANE_INTERLEAVED 1
+
+#define FIFO_MAX_QUEUED_FRAMES 8
+
+typedef struct _timedFrame
+{
+    const unsigned char *frameData;     // user address of screen bytes (same layout as write())
+    unsigned int frameLength;           // bytes at frameData, max one screen
+    unsigned long long presentAtNsec;   // absolute CLOCK_MONOTONIC deadline (0 = as soon as possible)
+} timed_frame_arg_t;
+
+#define FIFO_FADE_NONE 0
+#define FIFO_FADE_LINEAR 1      // blend the byte values directly
+#define FIFO_FADE_GAMMA 2       // blend in linear light (gamma 2.0 approximation)
+#define FIFO_MAX_FADE_FRAMES 1024
+
+typedef struct _fadeFrame
+{
+    timed_frame_arg_t frame;            // crossfade starts at frame.presentAtNsec
+    unsigned short fadeType;            // FIFO_FADE_* value
+    unsigned short fadeFrameCount;      // from shown screen to frame over N output frames [1-FIFO_MAX_FADE_FRAMES]
+    unsigned int fadeFramePeriodNsec;   // time between output frames
+} fade_frame_arg_t;
+
+// display program: ops run by the driver against frames loaded into its resident slots
+#define FIFO_MAX_PROGRAM_FRAMES 8
+#define FIFO_MAX_PROGRAM_OPS 64
+#define FIFO_MAX_PROGRAM_DELAY_MSEC 60000
+
+enum eDisplayOpCodes {
+    FIFO_OP_END=0,      // stop program (implied after last op)
+    FIFO_OP_SHOW,       // frameIdx: copy resident frame to working frame and send it
+    FIFO_OP_DELAY,      // value: wait N mSec [1-FIFO_MAX_PROGRAM_DELAY_MSEC]
+    FIFO_OP_LOOP,       // value: back to op index (must be earlier), count: N more times (0 = forever)
+    FIFO_OP_SCROLL      // value: move working frame N columns (+left, -right) with wrap and send it
+                        //   (each lane must be one 32x8 column-wired serpentine panel, LED 0 bottom right)
+};
+
+typedef struct _displayOp
+{
+    unsigned char opCode;       // FIFO_OP_* value
+    unsigned char frameIdx;     // FIFO_OP_SHOW [0-(FIFO_MAX_PROGRAM_FRAMES-1)]
+    unsigned short count;       // FIFO_OP_LOOP
+    int value;                  // FIFO_OP_DELAY, FIFO_OP_LOOP, FIFO_OP_SCROLL
+} display_op_t;
+
+typedef struct _programFrame
+{
+    unsigned char frameIdx;     // resident slot [0-(FIFO_MAX_PROGRAM_FRAMES-1)]
+    const unsigned char *frameData;
+    unsigned int frameLength;   // short frames are zero-filled
+} program_frame_arg_t;
+
+typedef struct _displayProgram
+{
+    const display_op_t *ops;
+    unsigned int opCount;       // [1-FIFO_MAX_PROGRAM_OPS]
+} display_program_arg_t;
+
+typedef struct _shownFrame
+{
+    unsigned char *frameData;           // receives copy of last fully transmitted frame
+    unsigned int frameLength;           // size of frameData (copies at most one screen)
+    unsigned int frameSequence;         // OUT: counts frames sent, 0 = nothing sent yet
+    unsigned long long transmitNsec;    // OUT: CLOCK_MONOTONIC when transmit completed
+} shown_frame_arg_t;
+
+typedef struct _frameStats
+{
+    unsigned int framesOnTime;      // sent within lateToleranceNsec of deadline
+    unsigned int framesLate;        // sent, but after deadline + lateToleranceNsec
+    unsigned int framesSkipped;     // dropped as a newer frame was already due
+    unsigned int framesPending;     // currently queued, not yet sent
+    unsigned int lateToleranceNsec;
+} frame_stats_arg_t;
+
 #define LED_FIFO_IOC_MAGIC 'e'
 
 #define CMD_GET_VARIABLES _IOR(LED_FIFO_IOC_MAGIC, 1, configure_arg_t *)
@@ -28,7 +109,17 @@ typedef struct _configure
 #define CMD_CLEAR_SCREEN _IO(LED_FIFO_IOC_MAGIC, 7)
 #define CMD_SET_SCREEN_COLOR _IO(LED_FIFO_IOC_MAGIC, 8) // ARG: 24bit color RGB!!!
 #define CMD_SET_IO_BASE_ADDRESS _IO(LED_FIFO_IOC_MAGIC, 9) // ARG: 32bit I/O Base Addr!!!
+#define CMD_QUEUE_TIMED_FRAME _IOW(LED_FIFO_IOC_MAGIC, 10, timed_frame_arg_t *) // -EBUSY when queue full
+#define CMD_GET_FRAME_STATS _IOR(LED_FIFO_IOC_MAGIC, 11, frame_stats_arg_t *)
+#define CMD_RESET_FRAME_STATS _IO(LED_FIFO_IOC_MAGIC, 12)
+#define CMD_QUEUE_FADE_FRAME _IOW(LED_FIFO_IOC_MAGIC, 13, fade_frame_arg_t *) // -EBUSY when queue full
+#define CMD_LOAD_PROGRAM_FRAME _IOW(LED_FIFO_IOC_MAGIC, 14, program_frame_arg_t *) // -EBUSY when program running
+#define CMD_RUN_PROGRAM _IOW(LED_FIFO_IOC_MAGIC, 15, display_program_arg_t *) // replaces running program, -EBUSY when frames queued
+#define CMD_STOP_PROGRAM _IO(LED_FIFO_IOC_MAGIC, 16)
+#define CMD_GET_SHOWN_FRAME _IOWR(LED_FIFO_IOC_MAGIC, 17, shown_frame_arg_t *) // never blocks
+#define CMD_SET_FRAME_FORMAT _IO(LED_FIFO_IOC_MAGIC, 18) // ARG: FIFO_FORMAT_* value, -EBUSY when frames queued or program running
+#define CMD_GET_FRAME_FORMAT _IO(LED_FIFO_IOC_MAGIC, 19) // FIFO_FORMAT_* value is returned!
 
-#define LED_FIFO_IOC_MAXNR 9
+#define LED_FIFO_IOC_MAXNR 19
 
 #endif  // LED_FIFO_CONFIGURE_IOCTL_H
@@ -38,6 +38,11 @@
 //#include <mach/platform.h>
 //#include <linux/delay.h>
 #include <linux/interrupt.h>    // for tasklets
+#include <linux/hrtimer.h>      // for timed frame presentation
+#include <linux/ktime.h>
+#include <linux/wait.h>         // for blocking read() of shown frame
+#include <linux/poll.h>
+#include <linux/mutex.h>        // per open() snapshot
 
 
 #include "LEDfifoConfigureIOCtl.h"
@@ -69,11 +74,19 @@ MODULE_PARM_DESC(name, "The name to display in /var/log/kern.log");  ///< parame
 #define DEFAULT_T1H_COUNT 17
 #define DEFAULT_TRESET_COUNT 1020
 #define DEFAULT_LOOP_ENABLE 0
+#define DEFAULT_LATE_TOLERANCE_NSEC 500000  // 0.5 mSec past deadline counts as late
 
 // our LED Matrix dimensions
 #define HARDWARE_MAX_PANELS 3
 #define HARDWARE_MAX_LEDS_PER_PANEL 256
 #define HARDWARE_MAX_COLOR_BYTES_PER_LED 3
+#define HARDWARE_PANEL_COLUMNS 32
+#define HARDWARE_PANEL_ROWS 8
+
+// GPIO pins are in two banks of 32 (GPSET[0]/[1], GPCLR[0]/[1])
+#define GPIO_BANK_COUNT 2
+#define GPIO_MAX_PIN_BCM2835 53     // RPi 1-3
+#define GPIO_MAX_PIN_BCM2711 57     // RPi 4
 
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,10,0))
@@ -105,6 +118,24 @@ int interrupts(int bDisableRequest);
 void taskletTestWrites(unsigned long data);
 void taskletScreenFill(unsigned long data);
 void taskletScreenWrite(unsigned long data);
+void taskletPresentFrame(unsigned long data);
+static void xmitScreenBuffer(const uint8_t *pScreenBuffer);
+static void recordShownFrame(const uint8_t *pScreenBuffer, const uint8_t *pFillColor);
+static int initFrameQueue(void);
+static void releaseFrameQueue(void);
+static long queueTimedFrame(const timed_frame_arg_t *pTimedFrame, const fade_frame_arg_t *pFade);
+static void blendFadeStep(uint8_t *pOutBuffer, const uint8_t *pFromBuffer, const uint8_t *pToBuffer, uint16_t nStep, uint16_t nSteps, uint8_t fadeType);
+static enum hrtimer_restart presentTimerExpired(struct hrtimer *pTimer);
+static int initDisplayProgram(void);
+static void releaseDisplayProgram(void);
+static long loadProgramFrame(const program_frame_arg_t *pProgramFrame);
+static long runDisplayProgram(const display_program_arg_t *pProgram);
+static void stopDisplayProgram(void);
+static enum hrtimer_restart programTimerExpired(struct hrtimer *pTimer);
+void taskletRunProgram(unsigned long data);
+static void scrollScreenColumns(uint8_t *pDstBuffer, const uint8_t *pSrcBuffer, int nColumns);
+static size_t ledByteOffset(uint8_t nPanelIdx, uint16_t nLedIdx);
+static int isOutputOwned(void);
 
 void nSecDelay(int nSecDuration);
 #define ndelay nSecDelay
@@ -136,36 +167,152 @@ static int periodT0HCount = DEFAULT_T0H_COUNT;
 static int periodT1HCount = DEFAULT_T1H_COUNT;
 static int periodTRESETCount = DEFAULT_TRESET_COUNT;
 static int loopEnabled = DEFAULT_LOOP_ENABLE;
+static int s_frameFormat = FIFO_FORMAT_LANE_SEQUENTIAL;
 
 static struct tasklet_struct tasklet;
 
+// timed frame queue (ring, presented in deadline order)
+enum eQueueSlotState {
+    SLOT_FREE=0,
+    SLOT_FILLING,   // reserved, copy_from_user() in progress
+    SLOT_READY
+};
+
+typedef struct _queuedFrame
+{
+    uint8_t *buffer;        // one screen: s_screenBufferSizeInBytes
+    ktime_t presentAt;      // absolute CLOCK_MONOTONIC deadline
+    uint8_t slotState;      // eQueueSlotState value
+    uint8_t fadeType;       // FIFO_FADE_* value
+    uint16_t nFadeSteps;    // output frames in crossfade
+    uint16_t nFadeStepsDone;
+    uint32_t nFadePeriodNsec;
+} queuedFrame_t;
+
+static queuedFrame_t s_frameQueue[FIFO_MAX_QUEUED_FRAMES];
+static uint8_t s_nQueueHeadIdx;     // oldest frame (next to present)
+static uint8_t s_nQueueCount;
+static DEFINE_SPINLOCK(s_frameQueueLock);
+static struct hrtimer s_presentTimer;
+static struct tasklet_struct s_presentTasklet;
+
+// every path that drives the GPIO pins (write, fill, test, timed queue, program)
+//   holds this for the whole burst, so two senders never interleave bits on the strings
+static DEFINE_SPINLOCK(s_xmitLock);
+
+// last fully transmitted screen (for read() and crossfades)
+static uint8_t *s_lastShownBuffer;
+static uint32_t s_nLastShownSeq;        // 0 = nothing sent yet
+static ktime_t s_lastShownAt;
+static DEFINE_SPINLOCK(s_lastShownLock);
+static DECLARE_WAIT_QUEUE_HEAD(s_lastShownWaitQ);
+
+// per open() state
+typedef struct _openFile
+{
+    uint32_t nLastReadSeq;  // last shown frame returned by read()
+    uint8_t *snapshot;      // copy of shown frame taken under lock, then sent to user
+    struct mutex snapshotMutex; // read() and CMD_GET_SHOWN_FRAME on same open() share snapshot, held across fill and copy_to_user()
+} openFile_t;
+
+// staging for crossfades: fade start screen, and blended output
+static uint8_t *s_fadeFromBuffer;
+static uint8_t *s_stagingBuffer;
+
+static uint32_t s_nFramesOnTime;
+static uint32_t s_nFramesLate;
+static uint32_t s_nFramesSkipped;
+static int lateToleranceNsec = DEFAULT_LATE_TOLERANCE_NSEC;
+
+// display program (runs with no help from userspace)
+static uint8_t *s_programFrames[FIFO_MAX_PROGRAM_FRAMES];   // resident frames, alloc'd on first load
+static uint8_t *s_programWorkBuffer;     // frame last sent by program
+static uint8_t *s_programScrollBuffer;   // scroll output, swapped with work buffer
+static display_op_t s_programOps[FIFO_MAX_PROGRAM_OPS];
+static uint16_t s_programLoopsLeft[FIFO_MAX_PROGRAM_OPS];  // per LOOP op, reloaded when exhausted
+static uint8_t s_nProgramOpCount;
+static uint8_t s_nProgramPC;            // next op to run
+static volatile int s_bProgramRunning;
+static struct hrtimer s_programTimer;
+static struct tasklet_struct s_programTasklet;
+
 // ----------------------------------------------------------------------------
 //  SECTION: file-I/O handlers
 //
 static int LEDfifo_open(struct inode *i, struct file *f)
 {
-    // alloc our single screen buffer the user will write to...
-    if((kernel_buffer = kmalloc(s_screenBufferSizeInBytes , GFP_KERNEL)) == 0){
-        printk(KERN_ERR "LEDfifo: open() Cannot allocate Screen Buffer(s) in kernel\n");
-        return -1;
+    openFile_t *pOpenFile;
+
+    // write() screen buffer is shared (alloc'd at init), we only need our read() state
+    if((pOpenFile = kzalloc(sizeof(openFile_t), GFP_KERNEL)) == NULL) {
+        printk(KERN_ERR "LEDfifo: open() Cannot allocate open file state in kernel\n");
+        return -ENOMEM;
     }
-    printk(KERN_INFO "LEDfifo: open() w/Alloc Screen Buffer(s)\n");
+    if((pOpenFile->snapshot = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL)) == NULL) {
+        printk(KERN_ERR "LEDfifo: open() Cannot allocate Screen snapshot in kernel\n");
+        kfree(pOpenFile);
+        return -ENOMEM;
+    }
+    mutex_init(&pOpenFile->snapshotMutex);
+    f->private_data = pOpenFile;
+    printk(KERN_INFO "LEDfifo: open()\n");
     return 0;
 }
 
 
 static int LEDfifo_close(struct inode *i, struct file *f)
 {
-    kfree(kernel_buffer);
-    printk(KERN_INFO "LEDfifo: close() released Screen Buffer(s)\n");
+    openFile_t *pOpenFile = f->private_data;
+
+    kfree(pOpenFile->snapshot);
+    kfree(pOpenFile);
+    printk(KERN_INFO "LEDfifo: close()\n");
     return 0;
 }
 
 
+//  read(): each call returns one whole screen, the last fully transmitted frame this file hasn't yet read
+//    blocks until the next frame is sent, or -EAGAIN if O_NONBLOCK
+//
 static ssize_t LEDfifo_read(struct file *f, char __user *buf, size_t len, loff_t *off)
 {
-    printk(KERN_INFO "LEDfifo: read()\n");
-    return 0;
+    openFile_t *pOpenFile = f->private_data;
+    unsigned long flags;
+    ssize_t nBytesToCopy;   // or -EFAULT
+
+    if(READ_ONCE(s_nLastShownSeq) == pOpenFile->nLastReadSeq) {
+        if(f->f_flags & O_NONBLOCK) {
+            return -EAGAIN;
+        }
+        if(wait_event_interruptible(s_lastShownWaitQ, READ_ONCE(s_nLastShownSeq) != pOpenFile->nLastReadSeq)) {
+            return -ERESTARTSYS;
+        }
+    }
+
+    // copy under lock then to user outside of it (may sleep)
+    if(mutex_lock_interruptible(&pOpenFile->snapshotMutex)) {
+        return -ERESTARTSYS;
+    }
+    spin_lock_irqsave(&s_lastShownLock, flags);
+    memcpy(pOpenFile->snapshot, s_lastShownBuffer, s_screenBufferSizeInBytes);
+    pOpenFile->nLastReadSeq = s_nLastShownSeq;
+    spin_unlock_irqrestore(&s_lastShownLock, flags);
+
+    nBytesToCopy = min_t(size_t, len, s_screenBufferSizeInBytes);
+    if(copy_to_user(buf, pOpenFile->snapshot, nBytesToCopy)) {
+        nBytesToCopy = -EFAULT;
+    }
+    mutex_unlock(&pOpenFile->snapshotMutex);
+    return nBytesToCopy;
+}
+
+
+static unsigned int LEDfifo_poll(struct file *f, poll_table *wait)
+{
+    openFile_t *pOpenFile = f->private_data;
+
+    poll_wait(f, &s_lastShownWaitQ, wait);
+    return (READ_ONCE(s_nLastShownSeq) != pOpenFile->nLastReadSeq) ? (POLLIN | POLLRDNORM) : 0;
 }
 
 
@@ -180,6 +327,10 @@ static ssize_t LEDfifo_write(struct file *f, const char __user *buf, size_t len,
     if(s_ePiType == NOTSET) {
         printk(KERN_ERR "LEDfifo: write() Abort, RPi Model not yet identified! (IO not configured!)\n");
     }
+    else if(isOutputOwned()) {
+        printk(KERN_ERR "LEDfifo: write() Abort, timed frames or display program own the output\n");
+        return -EBUSY;
+    }
     else {
         if(len > s_screenBufferSizeInBytes) {
             printk(KERN_ERR "LEDfifo: write() Abort, too long (%ld bytes) [> max %d]\n", bytesNotCopied, s_screenBufferSizeInBytes);
@@ -222,6 +373,7 @@ static struct file_operations LEDfifoLKM_fops =
     .open = LEDfifo_open,
     .read = LEDfifo_read,
     .write = LEDfifo_write,
+    .poll = LEDfifo_poll,
 //    .readv = LEDfifo_readv,
 //    .writev = LEDfifo_writev,
      .release = LEDfifo_close,
@@ -235,6 +387,14 @@ static struct file_operations LEDfifoLKM_fops =
 static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
     configure_arg_t cfg;
+    timed_frame_arg_t timedFrame;
+    fade_frame_arg_t fadeFrame;
+    program_frame_arg_t programFrame;
+    display_program_arg_t displayProgram;
+    shown_frame_arg_t shownFrame;
+    openFile_t *pOpenFile = f->private_data;
+    frame_stats_arg_t frameStats;
+    unsigned long flags;
     long retval = 0;  // default to returning success
     int err = 0;
     int pinIndex;
@@ -287,6 +447,11 @@ static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
             break;
         case CMD_SET_VARIABLES:
             printk(KERN_INFO "LEDfifo: ioctl() set variables\n");
+            // pin limit depends on board, which is only known once IO base address is set
+            if(s_ePiType == NOTSET) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
+                return -ENODEV;
+            }
             // if any prior pins selected reset them to INPUT
             resetCurrentPins();
 
@@ -294,6 +459,12 @@ static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
             if (copy_from_user(&cfg, (configure_arg_t *)arg, sizeof(configure_arg_t))) {
                 return -EACCES;
             }
+            for(pinIndex = 0; pinIndex < FIFO_MAX_PIN_COUNT; pinIndex++) {
+                if(cfg.gpioPins[pinIndex] < 0 || cfg.gpioPins[pinIndex] > ((s_ePiType == PI4) ? GPIO_MAX_PIN_BCM2711 : GPIO_MAX_PIN_BCM2835)) {
+                    printk(KERN_ERR "LEDfifo: ioctl() Abort, GPIO %d out-of-range [0-%d]\n", cfg.gpioPins[pinIndex], (s_ePiType == PI4) ? GPIO_MAX_PIN_BCM2711 : GPIO_MAX_PIN_BCM2835);
+                    return -EINVAL;
+                }
+            }
             memset(ledType, 0, FIFO_MAX_STR_LEN+1);
             strncpy(ledType, cfg.ledType, FIFO_MAX_STR_LEN);
             for(pinIndex = 0; pinIndex < FIFO_MAX_PIN_COUNT; pinIndex++) {
@@ -332,11 +503,35 @@ static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
             printk(KERN_INFO "LEDfifo: ioctl() get loop enable: return (%d)\n", loopEnabled);
             retval = loopEnabled;
             break;
+        case CMD_SET_FRAME_FORMAT:
+            printk(KERN_INFO "LEDfifo: ioctl() set frame format=%ld\n", arg);
+            if(arg != FIFO_FORMAT_LANE_SEQUENTIAL && arg != FIFO_FORMAT_LANE_INTERLEAVED) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, frame format %ld unknown\n", arg);
+                return -EINVAL;
+            }
+            // frames already queued or resident were laid out for the current format
+            spin_lock_irqsave(&s_frameQueueLock, flags);
+            if(s_nQueueCount > 0 || s_bProgramRunning) {
+                retval = -EBUSY;
+            }
+            else {
+                s_frameFormat = arg;
+            }
+            spin_unlock_irqrestore(&s_frameQueueLock, flags);
+            break;
+        case CMD_GET_FRAME_FORMAT:
+            printk(KERN_INFO "LEDfifo: ioctl() get frame format: return (%d)\n", s_frameFormat);
+            retval = s_frameFormat;
+            break;
         case CMD_TEST_BIT_WRITES:
             printk(KERN_INFO "LEDfifo: ioctl() test bit writes w/(%ld's)\n", arg);
             if(s_ePiType == NOTSET) {
                 printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
             }
+            else if(isOutputOwned()) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, timed frames or display program own the output\n");
+                retval = -EBUSY;
+            }
             else {
                 if(arg == 0) {
                     //testXmitZeros(1000);
@@ -355,6 +550,10 @@ static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
             if(s_ePiType == NOTSET) {
                 printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
             }
+            else if(isOutputOwned()) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, timed frames or display program own the output\n");
+                retval = -EBUSY;
+            }
             else {
                 tasklet_init(&tasklet, taskletScreenFill, 0);
                 tasklet_hi_schedule(&tasklet);
@@ -365,6 +564,10 @@ static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
             if(s_ePiType == NOTSET) {
                 printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
             }
+            else if(isOutputOwned()) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, timed frames or display program own the output\n");
+                retval = -EBUSY;
+            }
             else {
                 tasklet_init(&tasklet, taskletScreenFill, arg);
                 tasklet_hi_schedule(&tasklet);
@@ -375,6 +578,85 @@ static long LEDfifo_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
             s_pRPiModelIOBaseAddress = arg;
             configureDriverIO(arg);
             break;
+        case CMD_QUEUE_TIMED_FRAME:
+            if(s_ePiType == NOTSET) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
+                return -ENODEV;
+            }
+            if (copy_from_user(&timedFrame, (timed_frame_arg_t *)arg, sizeof(timed_frame_arg_t))) {
+                return -EACCES;
+            }
+            retval = queueTimedFrame(&timedFrame, NULL);
+            break;
+        case CMD_QUEUE_FADE_FRAME:
+            if(s_ePiType == NOTSET) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
+                return -ENODEV;
+            }
+            if (copy_from_user(&fadeFrame, (fade_frame_arg_t *)arg, sizeof(fade_frame_arg_t))) {
+                return -EACCES;
+            }
+            retval = queueTimedFrame(&fadeFrame.frame, &fadeFrame);
+            break;
+        case CMD_LOAD_PROGRAM_FRAME:
+            if (copy_from_user(&programFrame, (program_frame_arg_t *)arg, sizeof(program_frame_arg_t))) {
+                return -EACCES;
+            }
+            retval = loadProgramFrame(&programFrame);
+            break;
+        case CMD_RUN_PROGRAM:
+            if(s_ePiType == NOTSET) {
+                printk(KERN_ERR "LEDfifo: ioctl() Abort, RPi Model not yet identified! (IO not configured!)\n");
+                return -ENODEV;
+            }
+            if (copy_from_user(&displayProgram, (display_program_arg_t *)arg, sizeof(display_program_arg_t))) {
+                return -EACCES;
+            }
+            retval = runDisplayProgram(&displayProgram);
+            break;
+        case CMD_STOP_PROGRAM:
+            printk(KERN_INFO "LEDfifo: ioctl() stop display program\n");
+            stopDisplayProgram();
+            break;
+        case CMD_GET_SHOWN_FRAME:
+            if (copy_from_user(&shownFrame, (shown_frame_arg_t *)arg, sizeof(shown_frame_arg_t))) {
+                return -EACCES;
+            }
+            if(mutex_lock_interruptible(&pOpenFile->snapshotMutex)) {
+                return -ERESTARTSYS;
+            }
+            spin_lock_irqsave(&s_lastShownLock, flags);
+            memcpy(pOpenFile->snapshot, s_lastShownBuffer, s_screenBufferSizeInBytes);
+            shownFrame.frameSequence = s_nLastShownSeq;
+            shownFrame.transmitNsec = ktime_to_ns(s_lastShownAt);
+            spin_unlock_irqrestore(&s_lastShownLock, flags);
+            shownFrame.frameLength = min_t(unsigned int, shownFrame.frameLength, s_screenBufferSizeInBytes);
+            if (copy_to_user(shownFrame.frameData, pOpenFile->snapshot, shownFrame.frameLength) ||
+                copy_to_user((shown_frame_arg_t *)arg, &shownFrame, sizeof(shown_frame_arg_t))) {
+                retval = -EACCES;
+            }
+            mutex_unlock(&pOpenFile->snapshotMutex);
+            break;
+        case CMD_GET_FRAME_STATS:
+            spin_lock_irqsave(&s_frameQueueLock, flags);
+            frameStats.framesOnTime = s_nFramesOnTime;
+            frameStats.framesLate = s_nFramesLate;
+            frameStats.framesSkipped = s_nFramesSkipped;
+            frameStats.framesPending = s_nQueueCount;
+            frameStats.lateToleranceNsec = lateToleranceNsec;
+            spin_unlock_irqrestore(&s_frameQueueLock, flags);
+            if (copy_to_user((frame_stats_arg_t *)arg, &frameStats, sizeof(frame_stats_arg_t))) {
+                return -EACCES;
+            }
+            break;
+        case CMD_RESET_FRAME_STATS:
+            printk(KERN_INFO "LEDfifo: ioctl() reset frame stats\n");
+            spin_lock_irqsave(&s_frameQueueLock, flags);
+            s_nFramesOnTime = 0;
+            s_nFramesLate = 0;
+            s_nFramesSkipped = 0;
+            spin_unlock_irqrestore(&s_frameQueueLock, flags);
+            break;
         default:
             printk(KERN_WARNING "LEDfifo: ioctl() unknown command (%d) !!\n", cmd);
             return -EINVAL; // unknown command?  How'd this happen?
@@ -412,6 +694,14 @@ static int config_read(struct seq_file *m, void *v)
     STR_PRINTF_RET(len, "\n");
     loopStatus = (loopEnabled) ? "YES" : "no";
     STR_PRINTF_RET(len, "  Looping Enabled: %s\n", loopStatus);
+    loopStatus = (s_frameFormat == FIFO_FORMAT_LANE_INTERLEAVED) ? "lane-interleaved" : "lane-sequential";
+    STR_PRINTF_RET(len, "     Frame Format: %s\n", loopStatus);
+    STR_PRINTF_RET(len, "\n");
+    STR_PRINTF_RET(len, "Timed Frames: %u on-time, %u late, %u skipped (%d of %d queued)\n", s_nFramesOnTime, s_nFramesLate, s_nFramesSkipped, s_nQueueCount, FIFO_MAX_QUEUED_FRAMES);
+    STR_PRINTF_RET(len, "   Late when: > %d nSec past deadline\n", lateToleranceNsec);
+    STR_PRINTF_RET(len, "  Frames Sent: %u\n", s_nLastShownSeq);
+    loopStatus = (s_bProgramRunning) ? "RUNNING" : "stopped";
+    STR_PRINTF_RET(len, "Display Program: %s (%d ops, at op %d)\n", loopStatus, s_nProgramOpCount, s_nProgramPC);
     STR_PRINTF_RET(len, "\n");
 
     return len;
@@ -487,6 +777,34 @@ static int __init LEDfifoLKM_init(void){
         return -1;
     }
 
+    // our single screen buffer write() fills (shared by all opens)
+    if ((kernel_buffer = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL)) == NULL)
+    {
+        printk(KERN_ERR "LEDfifo: init() Cannot allocate Screen Buffer in kernel\n");
+        remove_proc_entry("config", parent);
+        remove_proc_entry("driver/ledfifo", NULL);
+        return -ENOMEM;
+    }
+
+    printk(KERN_INFO "LEDfifo: timed frame queue setup\n");
+    if ((ret = initFrameQueue()) < 0)
+    {
+        kfree(kernel_buffer);
+        remove_proc_entry("config", parent);
+        remove_proc_entry("driver/ledfifo", NULL);
+        return ret;
+    }
+
+    printk(KERN_INFO "LEDfifo: display program setup\n");
+    if ((ret = initDisplayProgram()) < 0)
+    {
+        releaseFrameQueue();
+        kfree(kernel_buffer);
+        remove_proc_entry("config", parent);
+        remove_proc_entry("driver/ledfifo", NULL);
+        return ret;
+    }
+
     printk(KERN_INFO "LEDfifo: init EXIT\n");
 
     return 0;
@@ -499,6 +817,11 @@ static int __init LEDfifoLKM_init(void){
 static void __exit LEDfifoLKM_exit(void){
     printk(KERN_INFO "LEDfifo: Exit(%s)\n", name);
 
+    // stop presenting queued frames and any program
+    releaseDisplayProgram();
+    releaseFrameQueue();
+    kfree(kernel_buffer);
+
     /* release the mapping */
     printk(KERN_INFO "LEDfifo: : release gpio io-remap\n");
     iounmap((void *)gpio);
@@ -956,7 +1279,7 @@ enum eGpioOperationType {
 
 typedef struct _gpioCrontrolWord
 {
-    uint32_t gpioPinBits;   // 1 placed in each bit location
+    uint32_t gpioPinBits[GPIO_BANK_COUNT];   // 1 placed in each bit location, GPIO 0-31 then 32-57
     uint16_t durationToNext;
     uint8_t gpioOperation;  // eGpioOperationType value SET/CLR
     uint8_t entryOccupied;
@@ -971,13 +1294,17 @@ typedef struct _gpioCrontrolEntry
 } gpioCrontrolEntry_t;
 
 static gpioCrontrolEntry_t gpioBitControlEntries[MAX_GPIO_CONTROL_ENTRIES];
-static uint32_t pinsAllActive;
+static uint32_t pinsAllActive[GPIO_BANK_COUNT];
+static uint8_t s_bBank0HasPins;     // only write the banks our pins are in
+static uint8_t s_bBank1HasPins;
 
 // ---------------------
 // TABLE SETUP CODE
 //
 
 #define PIN_PRESENT(pinIdx) ((gpioPins[pinIdx] != 0) ? 1 : 0)
+// mask for pin within given bank (0 if pin not set or in other bank)
+#define PIN_BANK_MASK(pinIdx, bank) ((gpioPins[pinIdx] != 0 && gpioPins[pinIdx] / 32 == (bank)) ? 1u << (gpioPins[pinIdx] % 32) : 0)
 //#define PIN_VALUE_IF_SELECTED(index, ) ((gpioPins[pinIdx] != 0) ? 1 : 0)
 
 
@@ -990,11 +1317,12 @@ static void initBitTableForCurrentPins(void)
     //  bit masks are present in the table entry for each set and clear.
     //  table entries will be 1 set followed by 1 or 2 clears.
     //
-    uint32_t pinValueIdx0;
-    uint32_t pinValueIdx1;
-    uint32_t pinValueIdx2;
-    uint32_t pinsActiveHigh;
-    uint32_t pinsActiveLow;
+    uint32_t pinValueIdx0[GPIO_BANK_COUNT];
+    uint32_t pinValueIdx1[GPIO_BANK_COUNT];
+    uint32_t pinValueIdx2[GPIO_BANK_COUNT];
+    uint32_t pinsActiveHigh[GPIO_BANK_COUNT];
+    uint32_t pinsActiveLow[GPIO_BANK_COUNT];
+    uint8_t nBankIdx;
     uint8_t nTableIdx;
     uint8_t nWordIdx;
     uint8_t nPinCount;
@@ -1030,17 +1358,24 @@ static void initBitTableForCurrentPins(void)
 
     // zero fill our structure
     memset(gpioBitControlEntries, 0, sizeof(gpioBitControlEntries));
+    memset(pinsAllActive, 0, sizeof(pinsAllActive));
+    s_bBank0HasPins = 0;
+    s_bBank1HasPins = 0;
 
     // if we have table entries to populate...
     printk(KERN_INFO "LEDfifo: initBitTableForCurrentPins() loading %d entries\n", nMaxTableEntries);
     if(nMaxTableEntries > 0) {
 
-        // set our pins
-        pinValueIdx0 = (gpioPins[0] != 0) ? 1<<gpioPins[0] : 0;
-        pinValueIdx1 = (gpioPins[1] != 0) ? 1<<gpioPins[1] : 0;
-        pinValueIdx2 = (gpioPins[2] != 0) ? 1<<gpioPins[2] : 0;
+        // set our pins (each bank's masks computed here, not in the send loop)
+        for(nBankIdx = 0; nBankIdx < GPIO_BANK_COUNT; nBankIdx++) {
+            pinValueIdx0[nBankIdx] = PIN_BANK_MASK(0, nBankIdx);
+            pinValueIdx1[nBankIdx] = PIN_BANK_MASK(1, nBankIdx);
+            pinValueIdx2[nBankIdx] = PIN_BANK_MASK(2, nBankIdx);
 
-        pinsAllActive = pinValueIdx0 | pinValueIdx1 | pinValueIdx2;
+            pinsAllActive[nBankIdx] = pinValueIdx0[nBankIdx] | pinValueIdx1[nBankIdx] | pinValueIdx2[nBankIdx];
+        }
+        s_bBank0HasPins = (pinsAllActive[0] != 0);
+        s_bBank1HasPins = (pinsAllActive[1] != 0);
 
         n0IsShorterThan1 = (periodT0HCount < periodT1HCount);
 
@@ -1055,7 +1390,8 @@ static void initBitTableForCurrentPins(void)
                 // if we have all pins 0 or all pins 1 then...
                 // do our only set (0 bits -or- 1 bits)
                 nOnlyHighPeriodLength = (nTableIdx == 0) ? periodT0HCount : periodT1HCount;
-                gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioPinBits = pinsAllActive;
+                gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioPinBits[0] = pinsAllActive[0];
+                gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioPinBits[1] = pinsAllActive[1];
                 gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioOperation = OP_GPIO_SET;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx].durationToNext = nOnlyHighPeriodLength * periodDurationNsec;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx].entryOccupied = 1;
@@ -1063,7 +1399,8 @@ static void initBitTableForCurrentPins(void)
                 // if we have all pins 0 or all pins 1 then...
                 // do our only clear (0 bits -or- 1 bits)
                 nOnlyRemainingPeriodLength = periodCount - nOnlyHighPeriodLength - CODE_LENGTH_IN_PERIODS;
-                gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioPinBits = pinsAllActive;
+                gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioPinBits[0] = pinsAllActive[0];
+                gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioPinBits[1] = pinsAllActive[1];
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioOperation = OP_GPIO_CLR;
 		// this is our last time value (reduce this amount to account for CPU time to next byte)
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+1].durationToNext = (nOnlyRemainingPeriodLength * periodDurationNsec) - CODE_CORRECTION_LITERAL;
@@ -1071,25 +1408,29 @@ static void initBitTableForCurrentPins(void)
             }
             else {
                 // do our min-duration set for all active pins
-                gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioPinBits = pinsAllActive;
+                gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioPinBits[0] = pinsAllActive[0];
+                gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioPinBits[1] = pinsAllActive[1];
                 gpioBitControlEntries[nTableIdx].word[nWordIdx].gpioOperation = OP_GPIO_SET;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx].durationToNext = nMinHighPeriodLength * periodDurationNsec;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx].entryOccupied = 1;
 
                 // calculate masks for early then late clears
-                pinsActiveLow = ((nTableIdx & 0x01) == 0x01) ? 0 : pinValueIdx0;
-                pinsActiveLow |= ((nTableIdx & 0x02) == 0x02) ? 0 : pinValueIdx1;
-                pinsActiveLow |= ((nTableIdx & 0x04) == 0x04) ? 0 : pinValueIdx2;
-                pinsActiveHigh = ((nTableIdx & 0x01) == 0x00) ? 0 : pinValueIdx0;
-                pinsActiveHigh |= ((nTableIdx & 0x02) == 0x00) ? 0 : pinValueIdx1;
-                pinsActiveHigh |= ((nTableIdx & 0x04) == 0x00) ? 0 : pinValueIdx2;
+                for(nBankIdx = 0; nBankIdx < GPIO_BANK_COUNT; nBankIdx++) {
+                    pinsActiveLow[nBankIdx] = ((nTableIdx & 0x01) == 0x01) ? 0 : pinValueIdx0[nBankIdx];
+                    pinsActiveLow[nBankIdx] |= ((nTableIdx & 0x02) == 0x02) ? 0 : pinValueIdx1[nBankIdx];
+                    pinsActiveLow[nBankIdx] |= ((nTableIdx & 0x04) == 0x04) ? 0 : pinValueIdx2[nBankIdx];
+                    pinsActiveHigh[nBankIdx] = ((nTableIdx & 0x01) == 0x00) ? 0 : pinValueIdx0[nBankIdx];
+                    pinsActiveHigh[nBankIdx] |= ((nTableIdx & 0x02) == 0x00) ? 0 : pinValueIdx1[nBankIdx];
+                    pinsActiveHigh[nBankIdx] |= ((nTableIdx & 0x04) == 0x00) ? 0 : pinValueIdx2[nBankIdx];
+                    // shorter clear (0or1 bits) then longer clear (1or0 bits)
+                    gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioPinBits[nBankIdx] = (n0IsShorterThan1) ? pinsActiveLow[nBankIdx] : pinsActiveHigh[nBankIdx];
+                    gpioBitControlEntries[nTableIdx].word[nWordIdx+2].gpioPinBits[nBankIdx] = (n0IsShorterThan1) ? pinsActiveHigh[nBankIdx] : pinsActiveLow[nBankIdx];
+                }
                 // do our shorter clear (0or1 bits)
-                gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioPinBits = (n0IsShorterThan1) ? pinsActiveLow : pinsActiveHigh;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+1].gpioOperation = OP_GPIO_CLR;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+1].durationToNext = nRemainingHighPeriodLength * periodDurationNsec;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+1].entryOccupied = 1;
                 // do our longer clear (1or0 bits)
-                gpioBitControlEntries[nTableIdx].word[nWordIdx+2].gpioPinBits = (n0IsShorterThan1) ? pinsActiveHigh : pinsActiveLow;
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+2].gpioOperation = OP_GPIO_CLR;
 		// this is our last time value (reduce this amount to account for CPU time to next byte)
                 gpioBitControlEntries[nTableIdx].word[nWordIdx+2].durationToNext = (nRemainingLowPeriodLength * periodDurationNsec) - CODE_CORRECTION_LITERAL;
@@ -1181,7 +1522,7 @@ static void dumpPinTable(void)
             }
             validText = (selectedWord->entryOccupied == 1) ? "YES" : "no";
             if(selectedWord->entryOccupied) {
-                printk(KERN_INFO "LEDfifo:   - word %d -- bits %8X op:[%s] duration:%04d valid:%s\n", nWordIdx, selectedWord->gpioPinBits, opText, selectedWord->durationToNext, validText);
+                printk(KERN_INFO "LEDfifo:   - word %d -- bits %8X:%8X op:[%s] duration:%04d valid:%s\n", nWordIdx, selectedWord->gpioPinBits[1], selectedWord->gpioPinBits[0], opText, selectedWord->durationToNext, validText);
 	    }
 	    else {
                 printk(KERN_INFO "LEDfifo:   - word %d -- empty --\n", nWordIdx);
@@ -1217,7 +1558,7 @@ static void showCounts(void)
 // ============================================================================
 // ---------------------
 // GPIO execution code
-//   NOTE: RESTRICTION: All GPIO pins are in 0-31 range!
+//   NOTE: pins may be in either GPIO bank, we only write the bank(s) with active pins
 //
 //
 
@@ -1253,10 +1594,20 @@ static void xmitBitValuesToAllChannels(uint8_t bitsIndex)
             if(selectedWord->entryOccupied) {
                 // yes, valid, do what it says...
                 if(selectedWord->gpioOperation == OP_GPIO_SET) {
-                    s_pGpioRegisters->GPSET[0] = selectedWord->gpioPinBits;
+                    if(s_bBank0HasPins) {
+                        s_pGpioRegisters->GPSET[0] = selectedWord->gpioPinBits[0];
+                    }
+                    if(s_bBank1HasPins) {
+                        s_pGpioRegisters->GPSET[1] = selectedWord->gpioPinBits[1];
+                    }
                 }
                 else if(selectedWord->gpioOperation == OP_GPIO_CLR) {
-                    s_pGpioRegisters->GPCLR[0] = selectedWord->gpioPinBits;
+                    if(s_bBank0HasPins) {
+                        s_pGpioRegisters->GPCLR[0] = selectedWord->gpioPinBits[0];
+                    }
+                    if(s_bBank1HasPins) {
+                        s_pGpioRegisters->GPCLR[1] = selectedWord->gpioPinBits[1];
+                    }
                }
                 else {
                     printk(KERN_ERR "LEDfifo: [CODE] xmitBitValuesToAllChannels(%d) INVALID gpioOperation Entry (%d) word[%d]\n", bitsIndex, selectedWord->gpioOperation, nWordIdx);
@@ -1278,7 +1629,12 @@ static void xmitBitValuesToAllChannels(uint8_t bitsIndex)
 static void xmitResetToAllChannels(void)
 {
     printk(KERN_INFO "LEDfifo: xmitResetToAllChannels()\n");
-    s_pGpioRegisters->GPCLR[0] = pinsAllActive;
+    if(s_bBank0HasPins) {
+        s_pGpioRegisters->GPCLR[0] = pinsAllActive[0];
+    }
+    if(s_bBank1HasPins) {
+        s_pGpioRegisters->GPCLR[1] = pinsAllActive[1];
+    }
     // lessee if RPi has working ndelay()...
     ndelay((periodTRESETCount * periodDurationNsec) / 2);
 }
@@ -1291,7 +1647,6 @@ static void xmitResetToAllChannels(void)
 //
 void taskletTestWrites(unsigned long data)
 {
-    DEFINE_SPINLOCK(mr_lock);
     unsigned long flags;
 
     printk(KERN_INFO "LEDfifo: taskletTestWrites(%ld) ENTRY\n", data);
@@ -1299,7 +1654,7 @@ void taskletTestWrites(unsigned long data)
 	// ============= BEGIN CRITICAL SECTION ==================
 	//
 	// let's prevent interrupts for this burst of LED writes
-	spin_lock_irqsave(&mr_lock, flags);
+	spin_lock_irqsave(&s_xmitLock, flags);
 	interrupts(0);   // disable
 
     // data is [0,1] for directing write of 0's or 1's test pattern
@@ -1312,7 +1667,7 @@ void taskletTestWrites(unsigned long data)
 
 	// and then allow interrupts once again...
 	interrupts(1);   // re-enable
-	spin_unlock_irqrestore(&mr_lock, flags);
+	spin_unlock_irqrestore(&s_xmitLock, flags);
 	//
 	// ============== END CRITICAL SECTION ===================
 
@@ -1438,7 +1793,6 @@ void taskletScreenFill(unsigned long data)
     uint8_t nBitShiftCount;  // [0-7]
     uint8_t nAllBits;
 
-    DEFINE_SPINLOCK(mr_lock);
     unsigned long flags;
 
     clearCounts();
@@ -1461,7 +1815,7 @@ void taskletScreenFill(unsigned long data)
 	// ============= BEGIN CRITICAL SECTION ==================
 	//
 	// let's prevent interrupts for this burst of LED writes
-	spin_lock_irqsave(&mr_lock, flags);
+	spin_lock_irqsave(&s_xmitLock, flags);
 	interrupts(0);   // disable
 
    // for each LED in a panel
@@ -1489,12 +1843,14 @@ void taskletScreenFill(unsigned long data)
     }
 
 	interrupts(1);   // re-enable
+	// latch before releasing the pins to the next sender
+    xmitResetToAllChannels();
 	// and then allow interrupts once again...
-	spin_unlock_irqrestore(&mr_lock, flags);
+	spin_unlock_irqrestore(&s_xmitLock, flags);
 	//
 	// ============== END CRITICAL SECTION ===================
 
-    xmitResetToAllChannels();
+    recordShownFrame(NULL, buffer);
 
     printk(KERN_INFO "LEDfifo: -------------------------\n");
     printk(KERN_INFO "LEDfifo: %d bytes written\n", nBytesWritten);
@@ -1504,51 +1860,59 @@ void taskletScreenFill(unsigned long data)
 
 void taskletScreenWrite(unsigned long data)
 {
-    // no data?!  just write our single buffer to screen via GPIO?
-    // data is 24-bit RGB value to be written
-    uint8_t *pPanelByte[3];
-    uint16_t nPanelOffsetInBytes[3];
-    uint16_t nBytesWritten;
+    clearCounts();
+
+    printk(KERN_INFO "LEDfifo: taskletScreenWrite(0x%p) ENTRY\n", (void *)data);
+
+    // for this form, taskletScreenWrite(), we translate the current contents of kernel_buffer writing results to our GPIO's
+    xmitScreenBuffer(kernel_buffer);
+
+    printk(KERN_INFO "LEDfifo: -------------------------\n");
+    printk(KERN_INFO "LEDfifo: %d bytes written\n", s_screenBufferSizeInBytes);
+    showCounts();
+    printk(KERN_INFO "LEDfifo: taskletScreenWrite() EXIT\n");
+
+}
 
+static void xmitScreenBuffer(const uint8_t *pScreenBuffer)
+{
+    const uint8_t *pPanelByte[3];
+    uint16_t nPanelOffsetInBytes[3];
+    const uint8_t *pLedBytes;
+    uint8_t nLedStrideInBytes;
 
     uint16_t nLedIdx;   // [0-255]
-    uint16_t nLEDOffset;  // [0-765]
     uint8_t nColorOffset;  // [0-2]
 
     uint8_t nPanelIdx;  // [0-2]
     uint8_t nBitShiftCount;  // [0-7]
     uint8_t nAllBits;
 
-    DEFINE_SPINLOCK(mr_wr_lock);
     unsigned long flags;
 
-    clearCounts();
-    nBytesWritten = 0;
-
-    printk(KERN_INFO "LEDfifo: taskletScreenWrite(0x%p) ENTRY\n", (void *)data);
-
     // in memory the colors for the LED String are ordered as GRB!!!!
-    // for this form, taskletScreenWrite(), we translate the current contents of kernel_buffer writing results to our GPIO's
 
-    nPanelOffsetInBytes[0] = 0;
-    nPanelOffsetInBytes[1] = 1 * (HARDWARE_MAX_LEDS_PER_PANEL * HARDWARE_MAX_COLOR_BYTES_PER_LED);
-    nPanelOffsetInBytes[2] = 2 * (HARDWARE_MAX_LEDS_PER_PANEL * HARDWARE_MAX_COLOR_BYTES_PER_LED);
+    //  sequential: panels are 768 bytes apart, step 3 bytes per LED
+    //  interleaved: panels are 3 bytes apart, step 9 bytes per LED (one pass front to back)
+    for(nPanelIdx = 0; nPanelIdx < HARDWARE_MAX_PANELS; nPanelIdx++) {
+        nPanelOffsetInBytes[nPanelIdx] = ledByteOffset(nPanelIdx, 0);
+    }
+    nLedStrideInBytes = ledByteOffset(0, 1);
+    pLedBytes = pScreenBuffer;
 
 	// ============= BEGIN CRITICAL SECTION ==================
 	//
 	// let's prevent interrupts for this burst of LED writes
-	spin_lock_irqsave(&mr_wr_lock, flags);
+	spin_lock_irqsave(&s_xmitLock, flags);
 	interrupts(0);   // disable
 
    // for each LED in a panel
-    for(nLedIdx = 0; nLedIdx < HARDWARE_MAX_LEDS_PER_PANEL; nLedIdx++) {
-        // calc offset to LED 3-bytes within panel
-        nLEDOffset = (nLedIdx * HARDWARE_MAX_COLOR_BYTES_PER_LED);
+    for(nLedIdx = 0; nLedIdx < HARDWARE_MAX_LEDS_PER_PANEL; nLedIdx++, pLedBytes += nLedStrideInBytes) {
         // for each COLOR of an LED (24 bit, 3 bytes)
         for(nColorOffset = 0; nColorOffset < HARDWARE_MAX_COLOR_BYTES_PER_LED; nColorOffset++) {
             // set pointer to next byte for each of our three panels
             for(nPanelIdx = 0; nPanelIdx < HARDWARE_MAX_PANELS; nPanelIdx++) {
-                pPanelByte[nPanelIdx] = &kernel_buffer[nPanelOffsetInBytes[nPanelIdx] + nLEDOffset + nColorOffset];
+                pPanelByte[nPanelIdx] = &pLedBytes[nPanelOffsetInBytes[nPanelIdx] + nColorOffset];
             }
 
             // for ea. bit MSBit to LSBit... [OR-in each of the three panel bits 0b00000321] then write all 3 gpio pins
@@ -1560,24 +1924,588 @@ void taskletScreenWrite(unsigned long data)
                 }
                 xmitBitValuesToAllChannels(nAllBits);
             }
-
-    	    // count this a 1 byte written - will be three per LED!
-            nBytesWritten++;
         }
     }
 
 	// and then allow interrupts once again...
 	interrupts(1);   // re-enable
-	spin_unlock_irqrestore(&mr_wr_lock, flags);
+	// latch before releasing the pins to the next sender
+    xmitResetToAllChannels();
+	spin_unlock_irqrestore(&s_xmitLock, flags);
 	//
 	// ============== END CRITICAL SECTION ===================
 
-    xmitResetToAllChannels();
+    recordShownFrame(pScreenBuffer, NULL);
+}
 
-    printk(KERN_INFO "LEDfifo: -------------------------\n");
-    printk(KERN_INFO "LEDfifo: %d bytes written\n", nBytesWritten);
-    showCounts();
-    printk(KERN_INFO "LEDfifo: taskletScreenWrite() EXIT\n");
+//  remember what is now on the screen (crossfades start from here, read() returns it)
+//    pFillColor (GRB) used when the whole screen was filled with one color
+//
+static void recordShownFrame(const uint8_t *pScreenBuffer, const uint8_t *pFillColor)
+{
+    unsigned long flags;
+    uint16_t nByteIdx;
+
+    if(s_lastShownBuffer == NULL) {
+        return;
+    }
+    spin_lock_irqsave(&s_lastShownLock, flags);
+    if(pScreenBuffer != NULL) {
+        memcpy(s_lastShownBuffer, pScreenBuffer, s_screenBufferSizeInBytes);
+    }
+    else {
+        for(nByteIdx = 0; nByteIdx < s_screenBufferSizeInBytes; nByteIdx++) {
+            s_lastShownBuffer[nByteIdx] = pFillColor[nByteIdx % HARDWARE_MAX_COLOR_BYTES_PER_LED];
+        }
+    }
+    s_nLastShownSeq++;
+    if(s_nLastShownSeq == 0) {
+        s_nLastShownSeq = 1;    // 0 means nothing sent
+    }
+    s_lastShownAt = ktime_get();
+    spin_unlock_irqrestore(&s_lastShownLock, flags);
+    wake_up_interruptible(&s_lastShownWaitQ);
+}
+
+
+// ============================================================================
+//  Timed frame queue: frames are held in our ring until their CLOCK_MONOTONIC
+//    deadline, then sent by s_presentTasklet.  s_presentTimer is armed for the
+//    deadline of the frame at the head of the queue.
+//
+static int initFrameQueue(void)
+{
+    uint8_t nSlotIdx;
+
+    for(nSlotIdx = 0; nSlotIdx < FIFO_MAX_QUEUED_FRAMES; nSlotIdx++) {
+        s_frameQueue[nSlotIdx].buffer = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+        if(s_frameQueue[nSlotIdx].buffer == NULL) {
+            printk(KERN_ERR "LEDfifo: initFrameQueue() Cannot allocate frame slot %d\n", nSlotIdx);
+            releaseFrameQueue();
+            return -ENOMEM;
+        }
+        s_frameQueue[nSlotIdx].slotState = SLOT_FREE;
+    }
+    s_nQueueHeadIdx = 0;
+    s_nQueueCount = 0;
+
+    // zeroed: the screen is black until we send something
+    s_lastShownBuffer = kzalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+    s_fadeFromBuffer = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+    s_stagingBuffer = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+    if(s_lastShownBuffer == NULL || s_fadeFromBuffer == NULL || s_stagingBuffer == NULL) {
+        printk(KERN_ERR "LEDfifo: initFrameQueue() Cannot allocate fade staging buffers\n");
+        releaseFrameQueue();
+        return -ENOMEM;
+    }
+
+    hrtimer_init(&s_presentTimer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    s_presentTimer.function = presentTimerExpired;
+    tasklet_init(&s_presentTasklet, taskletPresentFrame, 0);
+    return 0;
+}
+
+static void releaseFrameQueue(void)
+{
+    uint8_t nSlotIdx;
+
+    hrtimer_cancel(&s_presentTimer);
+    tasklet_kill(&s_presentTasklet);
+    for(nSlotIdx = 0; nSlotIdx < FIFO_MAX_QUEUED_FRAMES; nSlotIdx++) {
+        kfree(s_frameQueue[nSlotIdx].buffer);
+        s_frameQueue[nSlotIdx].buffer = NULL;
+    }
+    s_nQueueCount = 0;
+    kfree(s_lastShownBuffer);
+    kfree(s_fadeFromBuffer);
+    kfree(s_stagingBuffer);
+    s_lastShownBuffer = NULL;
+    s_fadeFromBuffer = NULL;
+    s_stagingBuffer = NULL;
+}
+
+static long queueTimedFrame(const timed_frame_arg_t *pTimedFrame, const fade_frame_arg_t *pFade)
+{
+    queuedFrame_t *pSlot;
+    queuedFrame_t *pNewestSlot;
+    ktime_t presentAt;
+    unsigned long flags;
+    uint8_t nSlotIdx;
+    int bIsHeadOfQueue;
+
+    if(pTimedFrame->frameLength > s_screenBufferSizeInBytes) {
+        printk(KERN_ERR "LEDfifo: queueTimedFrame() Abort, too long (%u bytes) [> max %d]\n", pTimedFrame->frameLength, s_screenBufferSizeInBytes);
+        return -EINVAL;
+    }
+    if(pFade != NULL && pFade->fadeType != FIFO_FADE_NONE) {
+        if(pFade->fadeType > FIFO_FADE_GAMMA || pFade->fadeFrameCount < 1 || pFade->fadeFrameCount > FIFO_MAX_FADE_FRAMES ||
+            (pFade->fadeFrameCount > 1 && pFade->fadeFramePeriodNsec == 0)) {
+            printk(KERN_ERR "LEDfifo: queueTimedFrame() Abort, bad fade (type %d, %d frames, %u nSec)\n", pFade->fadeType, pFade->fadeFrameCount, pFade->fadeFramePeriodNsec);
+            return -EINVAL;
+        }
+    }
+    presentAt = (pTimedFrame->presentAtNsec == 0) ? ktime_get() : ns_to_ktime(pTimedFrame->presentAtNsec);
+
+    // reserve the slot at the tail of our ring
+    spin_lock_irqsave(&s_frameQueueLock, flags);
+    if(s_nQueueCount >= FIFO_MAX_QUEUED_FRAMES || s_bProgramRunning) {
+        spin_unlock_irqrestore(&s_frameQueueLock, flags);
+        return -EBUSY;
+    }
+    if(s_nQueueCount > 0) {
+        // frames must be queued in presentation order
+        pNewestSlot = &s_frameQueue[(s_nQueueHeadIdx + s_nQueueCount - 1) % FIFO_MAX_QUEUED_FRAMES];
+        if(ktime_before(presentAt, pNewestSlot->presentAt)) {
+            spin_unlock_irqrestore(&s_frameQueueLock, flags);
+            printk(KERN_ERR "LEDfifo: queueTimedFrame() Abort, deadline earlier than last queued frame\n");
+            return -EINVAL;
+        }
+    }
+    nSlotIdx = (s_nQueueHeadIdx + s_nQueueCount) % FIFO_MAX_QUEUED_FRAMES;
+    pSlot = &s_frameQueue[nSlotIdx];
+    pSlot->slotState = SLOT_FILLING;
+    pSlot->presentAt = presentAt;
+    pSlot->fadeType = (pFade != NULL) ? pFade->fadeType : FIFO_FADE_NONE;
+    pSlot->nFadeSteps = (pFade != NULL) ? pFade->fadeFrameCount : 0;
+    pSlot->nFadeStepsDone = 0;
+    pSlot->nFadePeriodNsec = (pFade != NULL) ? pFade->fadeFramePeriodNsec : 0;
+    s_nQueueCount++;
+    spin_unlock_irqrestore(&s_frameQueueLock, flags);
+
+    // copy outside of lock (may sleep), short frames are zero-filled
+    if(copy_from_user(pSlot->buffer, pTimedFrame->frameData, pTimedFrame->frameLength)) {
+        // NOTE: only our caller can be filling the tail slot, so just un-reserve it
+        spin_lock_irqsave(&s_frameQueueLock, flags);
+        pSlot->slotState = SLOT_FREE;
+        s_nQueueCount--;
+        spin_unlock_irqrestore(&s_frameQueueLock, flags);
+        return -EACCES;
+    }
+    if(pTimedFrame->frameLength < s_screenBufferSizeInBytes) {
+        memset(&pSlot->buffer[pTimedFrame->frameLength], 0, s_screenBufferSizeInBytes - pTimedFrame->frameLength);
+    }
+
+    spin_lock_irqsave(&s_frameQueueLock, flags);
+    pSlot->slotState = SLOT_READY;
+    bIsHeadOfQueue = (nSlotIdx == s_nQueueHeadIdx);
+    spin_unlock_irqrestore(&s_frameQueueLock, flags);
+
+    // newly at head? then arm for its deadline (otherwise tasklet arms after sending current head)
+    if(bIsHeadOfQueue) {
+        hrtimer_start(&s_presentTimer, presentAt, HRTIMER_MODE_ABS);
+    }
+    return 0;
+}
+
+static enum hrtimer_restart presentTimerExpired(struct hrtimer *pTimer)
+{
+    // deadline reached: let our tasklet send the frame (keep hard-irq time short)
+    tasklet_hi_schedule(&s_presentTasklet);
+    return HRTIMER_NORESTART;
+}
+
+//  our tasklet: send the frame at head of queue (if due), dropping any frames a newer due frame replaces
+//    a crossfade frame stays at head of queue until all of its blended output frames are sent
+//
+void taskletPresentFrame(unsigned long data)
+{
+    queuedFrame_t *pSlot;
+    queuedFrame_t *pNextSlot;
+    ktime_t now;
+    s64 nLatenessNsec;
+    unsigned long flags;
+    int bFrameDone;
+
+    spin_lock_irqsave(&s_frameQueueLock, flags);
+    now = ktime_get();
+    if(s_nQueueCount == 0 || s_frameQueue[s_nQueueHeadIdx].slotState != SLOT_READY) {
+        spin_unlock_irqrestore(&s_frameQueueLock, flags);
+        return;
+    }
+    pSlot = &s_frameQueue[s_nQueueHeadIdx];
+    if(pSlot->nFadeStepsDone == 0) {
+        if(ktime_after(pSlot->presentAt, now)) {
+            // woke early, re-arm for head deadline
+            hrtimer_start(&s_presentTimer, pSlot->presentAt, HRTIMER_MODE_ABS);
+            spin_unlock_irqrestore(&s_frameQueueLock, flags);
+            return;
+        }
+        // skip frames whose successor is also already due
+        while(s_nQueueCount > 1) {
+            pNextSlot = &s_frameQueue[(s_nQueueHeadIdx + 1) % FIFO_MAX_QUEUED_FRAMES];
+            if(pNextSlot->slotState != SLOT_READY || ktime_after(pNextSlot->presentAt, now)) {
+                break;
+            }
+            s_frameQueue[s_nQueueHeadIdx].slotState = SLOT_FREE;
+            s_nQueueHeadIdx = (s_nQueueHeadIdx + 1) % FIFO_MAX_QUEUED_FRAMES;
+            s_nQueueCount--;
+            s_nFramesSkipped++;
+        }
+        pSlot = &s_frameQueue[s_nQueueHeadIdx];
+        nLatenessNsec = ktime_to_ns(ktime_sub(now, pSlot->presentAt));
+        if(nLatenessNsec > lateToleranceNsec) {
+            s_nFramesLate++;
+        }
+        else {
+            s_nFramesOnTime++;
+        }
+    }
+    else if(s_nQueueCount > 1) {
+        // mid-fade: a due successor cuts the fade short
+        pNextSlot = &s_frameQueue[(s_nQueueHeadIdx + 1) % FIFO_MAX_QUEUED_FRAMES];
+        if(pNextSlot->slotState == SLOT_READY && !ktime_after(pNextSlot->presentAt, now)) {
+            pSlot->slotState = SLOT_FREE;
+            s_nQueueHeadIdx = (s_nQueueHeadIdx + 1) % FIFO_MAX_QUEUED_FRAMES;
+            s_nQueueCount--;
+            spin_unlock_irqrestore(&s_frameQueueLock, flags);
+            tasklet_hi_schedule(&s_presentTasklet);
+            return;
+        }
+    }
+    spin_unlock_irqrestore(&s_frameQueueLock, flags);
+
+    // slot stays occupied while we send it so it can't be overwritten
+    if(pSlot->fadeType != FIFO_FADE_NONE) {
+        // staging pass: blend from the screen as it was when the fade started
+        if(pSlot->nFadeStepsDone == 0) {
+            spin_lock_irqsave(&s_lastShownLock, flags);
+            memcpy(s_fadeFromBuffer, s_lastShownBuffer, s_screenBufferSizeInBytes);
+            spin_unlock_irqrestore(&s_lastShownLock, flags);
+        }
+        pSlot->nFadeStepsDone++;
+        blendFadeStep(s_stagingBuffer, s_fadeFromBuffer, pSlot->buffer, pSlot->nFadeStepsDone, pSlot->nFadeSteps, pSlot->fadeType);
+        xmitScreenBuffer(s_stagingBuffer);
+        bFrameDone = (pSlot->nFadeStepsDone >= pSlot->nFadeSteps);
+    }
+    else {
+        xmitScreenBuffer(pSlot->buffer);
+        bFrameDone = 1;
+    }
+
+    spin_lock_irqsave(&s_frameQueueLock, flags);
+    if(bFrameDone) {
+        pSlot->slotState = SLOT_FREE;
+        s_nQueueHeadIdx = (s_nQueueHeadIdx + 1) % FIFO_MAX_QUEUED_FRAMES;
+        s_nQueueCount--;
+        if(s_nQueueCount > 0 && s_frameQueue[s_nQueueHeadIdx].slotState == SLOT_READY) {
+            hrtimer_start(&s_presentTimer, s_frameQueue[s_nQueueHeadIdx].presentAt, HRTIMER_MODE_ABS);
+        }
+    }
+    else {
+        // next blended frame, timed from fade start so we don't accumulate drift
+        hrtimer_start(&s_presentTimer, ktime_add_ns(pSlot->presentAt, (u64)pSlot->nFadeStepsDone * pSlot->nFadePeriodNsec), HRTIMER_MODE_ABS);
+    }
+    spin_unlock_irqrestore(&s_frameQueueLock, flags);
+}
+
+static void blendFadeStep(uint8_t *pOutBuffer, const uint8_t *pFromBuffer, const uint8_t *pToBuffer, uint16_t nStep, uint16_t nSteps, uint8_t fadeType)
+{
+    // fixed-point blend: weight of "to" frame is nStep/nSteps in 1/256ths
+    uint32_t nToWeight = ((uint32_t)nStep << 8) / nSteps;   // [0-256]
+    uint32_t nFromWeight = 256 - nToWeight;
+    uint32_t nLinear;
+    uint16_t nByteIdx;
+
+    if(fadeType == FIFO_FADE_GAMMA) {
+        // square to (approx.) linear light, blend, then take root back to byte value
+        for(nByteIdx = 0; nByteIdx < s_screenBufferSizeInBytes; nByteIdx++) {
+            nLinear = ((pFromBuffer[nByteIdx] * pFromBuffer[nByteIdx]) * nFromWeight + (pToBuffer[nByteIdx] * pToBuffer[nByteIdx]) * nToWeight) >> 8;
+            pOutBuffer[nByteIdx] = int_sqrt(nLinear);
+        }
+    }
+    else {
+        for(nByteIdx = 0; nByteIdx < s_screenBufferSizeInBytes; nByteIdx++) {
+            pOutBuffer[nByteIdx] = (pFromBuffer[nByteIdx] * nFromWeight + pToBuffer[nByteIdx] * nToWeight + 128) >> 8;
+        }
+    }
+}
+
+// ============================================================================
+//  Display program: a small validated op list (show, delay, loop, scroll) run
+//    against frames loaded into our resident slots.  s_programTimer wakes
+//    s_programTasklet which runs ops until it sends a frame or must delay.
+//
+static int initDisplayProgram(void)
+{
+    s_programWorkBuffer = kzalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+    s_programScrollBuffer = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+    if(s_programWorkBuffer == NULL || s_programScrollBuffer == NULL) {
+        printk(KERN_ERR "LEDfifo: initDisplayProgram() Cannot allocate program work buffers\n");
+        releaseDisplayProgram();
+        return -ENOMEM;
+    }
+    s_nProgramOpCount = 0;
+    s_bProgramRunning = 0;
+    hrtimer_init(&s_programTimer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    s_programTimer.function = programTimerExpired;
+    tasklet_init(&s_programTasklet, taskletRunProgram, 0);
+    return 0;
+}
+
+static void releaseDisplayProgram(void)
+{
+    uint8_t nFrameIdx;
+
+    if(s_programTimer.function != NULL) {
+        stopDisplayProgram();
+    }
+    for(nFrameIdx = 0; nFrameIdx < FIFO_MAX_PROGRAM_FRAMES; nFrameIdx++) {
+        kfree(s_programFrames[nFrameIdx]);
+        s_programFrames[nFrameIdx] = NULL;
+    }
+    kfree(s_programWorkBuffer);
+    kfree(s_programScrollBuffer);
+    s_programWorkBuffer = NULL;
+    s_programScrollBuffer = NULL;
+}
+
+static long loadProgramFrame(const program_frame_arg_t *pProgramFrame)
+{
+    uint8_t *pFrame;
+
+    if(pProgramFrame->frameIdx >= FIFO_MAX_PROGRAM_FRAMES) {
+        printk(KERN_ERR "LEDfifo: loadProgramFrame() Abort, bad slot %d [max %d]\n", pProgramFrame->frameIdx, FIFO_MAX_PROGRAM_FRAMES - 1);
+        return -EINVAL;
+    }
+    if(pProgramFrame->frameLength > s_screenBufferSizeInBytes) {
+        printk(KERN_ERR "LEDfifo: loadProgramFrame() Abort, too long (%u bytes) [> max %d]\n", pProgramFrame->frameLength, s_screenBufferSizeInBytes);
+        return -EINVAL;
+    }
+    // running program may be sending from any slot
+    if(s_bProgramRunning) {
+        return -EBUSY;
+    }
+    if(s_programFrames[pProgramFrame->frameIdx] == NULL) {
+        s_programFrames[pProgramFrame->frameIdx] = kmalloc(s_screenBufferSizeInBytes, GFP_KERNEL);
+        if(s_programFrames[pProgramFrame->frameIdx] == NULL) {
+            return -ENOMEM;
+        }
+    }
+    pFrame = s_programFrames[pProgramFrame->frameIdx];
+    if(copy_from_user(pFrame, pProgramFrame->frameData, pProgramFrame->frameLength)) {
+        return -EACCES;
+    }
+    if(pProgramFrame->frameLength < s_screenBufferSizeInBytes) {
+        memset(&pFrame[pProgramFrame->frameLength], 0, s_screenBufferSizeInBytes - pProgramFrame->frameLength);
+    }
+    return 0;
+}
+
+static long runDisplayProgram(const display_program_arg_t *pProgram)
+{
+    display_op_t newOps[FIFO_MAX_PROGRAM_OPS];
+    uint8_t nOpIdx;
+    uint8_t nBodyIdx;
+    int bBodyTakesTime;
+    unsigned long flags;
+    int bFramesQueued;
+
+    if(pProgram->opCount < 1 || pProgram->opCount > FIFO_MAX_PROGRAM_OPS) {
+        printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, bad op count %u [1-%d]\n", pProgram->opCount, FIFO_MAX_PROGRAM_OPS);
+        return -EINVAL;
+    }
+    if(copy_from_user(newOps, pProgram->ops, pProgram->opCount * sizeof(display_op_t))) {
+        return -EACCES;
+    }
+
+    // validate the whole program before we touch the running one
+    for(nOpIdx = 0; nOpIdx < pProgram->opCount; nOpIdx++) {
+        switch(newOps[nOpIdx].opCode) {
+            case FIFO_OP_END:
+                break;
+            case FIFO_OP_SHOW:
+                if(newOps[nOpIdx].frameIdx >= FIFO_MAX_PROGRAM_FRAMES || s_programFrames[newOps[nOpIdx].frameIdx] == NULL) {
+                    printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, op %d shows unloaded frame %d\n", nOpIdx, newOps[nOpIdx].frameIdx);
+                    return -EINVAL;
+                }
+                break;
+            case FIFO_OP_DELAY:
+                if(newOps[nOpIdx].value < 1 || newOps[nOpIdx].value > FIFO_MAX_PROGRAM_DELAY_MSEC) {
+                    printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, op %d bad delay %d mSec\n", nOpIdx, newOps[nOpIdx].value);
+                    return -EINVAL;
+                }
+                break;
+            case FIFO_OP_LOOP:
+                if(newOps[nOpIdx].value < 0 || newOps[nOpIdx].value >= nOpIdx) {
+                    printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, op %d must loop to earlier op (not %d)\n", nOpIdx, newOps[nOpIdx].value);
+                    return -EINVAL;
+                }
+                // a loop body that never sends or waits would spin in our tasklet
+                bBodyTakesTime = 0;
+                for(nBodyIdx = newOps[nOpIdx].value; nBodyIdx < nOpIdx; nBodyIdx++) {
+                    if(newOps[nBodyIdx].opCode == FIFO_OP_SHOW || newOps[nBodyIdx].opCode == FIFO_OP_DELAY || newOps[nBodyIdx].opCode == FIFO_OP_SCROLL) {
+                        bBodyTakesTime = 1;
+                    }
+                }
+                if(!bBodyTakesTime) {
+                    printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, op %d loop body has no show/scroll/delay\n", nOpIdx);
+                    return -EINVAL;
+                }
+                break;
+            case FIFO_OP_SCROLL:
+                if(newOps[nOpIdx].value <= -HARDWARE_PANEL_COLUMNS || newOps[nOpIdx].value >= HARDWARE_PANEL_COLUMNS) {
+                    printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, op %d bad scroll %d columns\n", nOpIdx, newOps[nOpIdx].value);
+                    return -EINVAL;
+                }
+                break;
+            default:
+                printk(KERN_ERR "LEDfifo: runDisplayProgram() Abort, op %d unknown opcode %d\n", nOpIdx, newOps[nOpIdx].opCode);
+                return -EINVAL;
+        }
+    }
+
+    // queue only accepts frames while no program runs, so with ours stopped it can't take any new ones
+    //  until we decide under its lock who drives the screen
+    stopDisplayProgram();
+    memcpy(s_programOps, newOps, pProgram->opCount * sizeof(display_op_t));
+    for(nOpIdx = 0; nOpIdx < pProgram->opCount; nOpIdx++) {
+        s_programLoopsLeft[nOpIdx] = s_programOps[nOpIdx].count;
+    }
+    s_nProgramOpCount = pProgram->opCount;
+    s_nProgramPC = 0;
+
+    // one of us drives the screen at a time
+    spin_lock_irqsave(&s_frameQueueLock, flags);
+    bFramesQueued = (s_nQueueCount > 0);
+    if(!bFramesQueued) {
+        s_bProgramRunning = 1;
+    }
+    spin_unlock_irqrestore(&s_frameQueueLock, flags);
+    if(bFramesQueued) {
+        return -EBUSY;
+    }
+    printk(KERN_INFO "LEDfifo: runDisplayProgram() %d ops\n", s_nProgramOpCount);
+    tasklet_hi_schedule(&s_programTasklet);
+    return 0;
+}
 
+static void stopDisplayProgram(void)
+{
+    s_bProgramRunning = 0;
+    hrtimer_cancel(&s_programTimer);
+    tasklet_kill(&s_programTasklet);
+    // tasklet may have re-armed our timer just before it was killed
+    hrtimer_cancel(&s_programTimer);
+}
+
+static enum hrtimer_restart programTimerExpired(struct hrtimer *pTimer)
+{
+    tasklet_hi_schedule(&s_programTasklet);
+    return HRTIMER_NORESTART;
 }
 
+//  our tasklet: run program ops until we send a frame or have to wait
+//
+void taskletRunProgram(unsigned long data)
+{
+    display_op_t *pOp;
+    uint8_t *pSwapBuffer;
+    uint16_t nOpsRun;
+
+    // validation guarantees every loop sends or waits, so this is only a safety net
+    for(nOpsRun = 0; s_bProgramRunning && nOpsRun < 2 * FIFO_MAX_PROGRAM_OPS; nOpsRun++) {
+        if(s_nProgramPC >= s_nProgramOpCount) {
+            s_bProgramRunning = 0;
+            printk(KERN_INFO "LEDfifo: display program ended\n");
+            return;
+        }
+        pOp = &s_programOps[s_nProgramPC++];
+        switch(pOp->opCode) {
+            case FIFO_OP_END:
+                s_bProgramRunning = 0;
+                printk(KERN_INFO "LEDfifo: display program ended\n");
+                return;
+            case FIFO_OP_SHOW:
+                memcpy(s_programWorkBuffer, s_programFrames[pOp->frameIdx], s_screenBufferSizeInBytes);
+                xmitScreenBuffer(s_programWorkBuffer);
+                // let next op run once the frame is out
+                hrtimer_start(&s_programTimer, ktime_get(), HRTIMER_MODE_ABS);
+                return;
+            case FIFO_OP_SCROLL:
+                scrollScreenColumns(s_programScrollBuffer, s_programWorkBuffer, pOp->value);
+                pSwapBuffer = s_programWorkBuffer;
+                s_programWorkBuffer = s_programScrollBuffer;
+                s_programScrollBuffer = pSwapBuffer;
+                xmitScreenBuffer(s_programWorkBuffer);
+                hrtimer_start(&s_programTimer, ktime_get(), HRTIMER_MODE_ABS);
+                return;
+            case FIFO_OP_DELAY:
+                hrtimer_start(&s_programTimer, ktime_add_ns(ktime_get(), (u64)pOp->value * 1000000), HRTIMER_MODE_ABS);
+                return;
+            case FIFO_OP_LOOP:
+                if(pOp->count == 0) {
+                    s_nProgramPC = pOp->value;  // forever
+                }
+                else if(s_programLoopsLeft[s_nProgramPC - 1] > 0) {
+                    s_programLoopsLeft[s_nProgramPC - 1]--;
+                    s_nProgramPC = pOp->value;
+                }
+                else {
+                    // done, reload for next time we reach this loop (nesting)
+                    s_programLoopsLeft[s_nProgramPC - 1] = pOp->count;
+                }
+                break;
+        }
+    }
+    if(s_bProgramRunning) {
+        hrtimer_start(&s_programTimer, ktime_get(), HRTIMER_MODE_ABS);
+    }
+}
+
+//  move screen N columns left (N > 0) or right (N < 0), columns wrap around
+//    each panel is 8 rows x 32 columns wired serpentine: column x is the 8 LEDs
+//    starting at LED (31-x)*8, running top-down for even x and bottom-up for odd x
+//    (interleaved frames hold a column of all panels together, so move all panels in one pass)
+//
+static void scrollScreenColumns(uint8_t *pDstBuffer, const uint8_t *pSrcBuffer, int nColumns)
+{
+    const int nPanelsPerPass = (s_frameFormat == FIFO_FORMAT_LANE_INTERLEAVED) ? HARDWARE_MAX_PANELS : 1;
+    const int nLedBytes = nPanelsPerPass * HARDWARE_MAX_COLOR_BYTES_PER_LED;
+    const int nColumnBytes = HARDWARE_PANEL_ROWS * nLedBytes;
+    const uint8_t *pSrcColumn;
+    uint8_t *pDstColumn;
+    int nPanel;
+    int nDstX;
+    int nSrcX;
+    int nRow;
+
+    for(nPanel = 0; nPanel < HARDWARE_MAX_PANELS; nPanel += nPanelsPerPass) {
+        for(nDstX = 0; nDstX < HARDWARE_PANEL_COLUMNS; nDstX++) {
+            nSrcX = (nDstX + nColumns + HARDWARE_PANEL_COLUMNS) % HARDWARE_PANEL_COLUMNS;
+            pDstColumn = pDstBuffer + ledByteOffset(nPanel, (HARDWARE_PANEL_COLUMNS - 1 - nDstX) * HARDWARE_PANEL_ROWS);
+            pSrcColumn = pSrcBuffer + ledByteOffset(nPanel, (HARDWARE_PANEL_COLUMNS - 1 - nSrcX) * HARDWARE_PANEL_ROWS);
+            if((nDstX & 1) == (nSrcX & 1)) {
+                // same direction, whole column at once
+                memcpy(pDstColumn, pSrcColumn, nColumnBytes);
+            }
+            else {
+                for(nRow = 0; nRow < HARDWARE_PANEL_ROWS; nRow++) {
+                    memcpy(&pDstColumn[nRow * nLedBytes], &pSrcColumn[(HARDWARE_PANEL_ROWS - 1 - nRow) * nLedBytes], nLedBytes);
+                }
+            }
+        }
+    }
+}
+
+//  byte offset of panel's LED within a frame laid out in the current frame format
+//
+static size_t ledByteOffset(uint8_t nPanelIdx, uint16_t nLedIdx)
+{
+    if(s_frameFormat == FIFO_FORMAT_LANE_INTERLEAVED) {
+        return ((nLedIdx * HARDWARE_MAX_PANELS) + nPanelIdx) * HARDWARE_MAX_COLOR_BYTES_PER_LED;
+    }
+    return ((nPanelIdx * HARDWARE_MAX_LEDS_PER_PANEL) + nLedIdx) * HARDWARE_MAX_COLOR_BYTES_PER_LED;
+}
+
+//  timed frames queued or a display program running own the GPIO output, write()/fill must wait
+//
+static int isOutputOwned(void)
+{
+    unsigned long flags;
+    int bOwned;
+
+    spin_lock_irqsave(&s_frameQueueLock, flags);
+    bOwned = (s_nQueueCount > 0 || s_bProgramRunning);
+    spin_unlock_irqrestore(&s_frameQueueLock, flags);
+    return bOwned;
+}
@@ -0,0 +1,794 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>     // qsort()
+#include <string.h>
+#include <libgen.h>     // basename()
+#include <pthread.h>    // layout cache freed as threads exit
+
+#include "bitmapFont.h"
+#include "charSet.h"
+#include "glyphCache.h"
+#include "pixelFill.h"
+#include "xmalloc.h"
+#include "debug.h"
+
+//  Fonts are loaded once (startup or 'font' command) into a compact form:
+//
+//    - one glyph table per font sorted by code point, with a direct index for
+//      code points below 256 so ASCII/Latin-1 lookups never search
+//    - all bitmaps of a font in one atlas, column by column the way our LED
+//      strings run, 1 bit per pixel
+//
+//  Laying out a string only adds up advance widths, so the cost does not depend on
+//  how big the font is.  Our ROM font keeps drawing through the glyph cache.
+//
+//  Strings are UTF-8.  The same text tends to be shown again and again (status lines,
+//  clock digits) so each thread keeps its last few laid-out strings, found by a hash
+//  of font + text: a hit skips decoding and glyph lookup entirely.
+//
+//  BDF:  glyph bounding boxes, DWIDTH advances (proportional fonts)
+//  PSF:  v1 and v2, fixed width, unicode table when present
+
+#define PSF1_MAGIC0 0x36
+#define PSF1_MAGIC1 0x04
+#define PSF1_MODE512 0x01
+#define PSF1_MODEHASTAB 0x02
+#define PSF1_MODEHASSEQ 0x04
+#define PSF2_MAGIC 0x864ab572
+#define PSF2_HAS_UNICODE_TABLE 0x01
+
+#define ROM_GLYPH_WIDTH 5
+#define ROM_GLYPH_HEIGHT 7
+#define ROM_SPACE_ADVANCE 3     // proportional ROM font
+
+#define LAYOUT_CACHE_ENTRIES 16    // power of 2
+
+static struct _Font s_fontAr[FONT_MAX_LOADED];
+static int s_nFonts = 0;
+static const struct _Font *s_pDefaultFont = NULL;
+static const struct _Font *s_pRomFont = NULL;   // drawn through glyph cache (honors MICR digits)
+
+static __thread struct _TextLayout s_layoutCacheAr[LAYOUT_CACHE_ENTRIES];
+static __thread uint32_t s_nLayoutHits;
+static __thread uint32_t s_nLayoutMisses;
+static pthread_key_t s_layoutCacheKey;     // value set once thread's cache holds heap arrays
+static pthread_once_t s_layoutCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+// capacities of font being built (fonts are built one at a time)
+static int s_nGlyphCapacity;
+static size_t s_nAtlasCapacity;
+
+// -----------------------
+// forward declarations
+//
+static struct _Font *beginFont(const char *name);
+static int addGlyph(struct _Font *pFont, uint32_t nCodePoint, int nWidth, int nHeight, int nOffsetX, int nOffsetY, int nAdvance, const uint32_t *pRowBits);
+static int addGlyphAlias(struct _Font *pFont, uint32_t nCodePoint, int nGlyphIdx);
+static void finishFont(struct _Font *pFont);
+static void discardFont(struct _Font *pFont);
+static int compareGlyphs(const void *pLeft, const void *pRight);
+static void addRomGlyphs(struct _Font *pFont, int bProportional);
+static int loadBdfFont(struct _Font *pFont, FILE *fpFont, const char *fileSpec);
+static int loadPsfFont(struct _Font *pFont, const uint8_t *pFileData, size_t nFileBytes, const char *fileSpec);
+static int decodeUtf8(const uint8_t *pBytes, size_t nBytes, uint32_t *pCodePoint);
+static void buildLayout(struct _TextLayout *pLayout, const struct _Font *pFont, const char *cString, int nBytes, uint32_t nHash);
+static void createLayoutCacheKey(void);
+static void freeLayoutCache(void *pCache);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+void initFonts(void)
+{
+    if(s_nFonts > 0) {
+        return;
+    }
+    struct _Font *pFont = beginFont("5x7");
+    addRomGlyphs(pFont, 0);
+    finishFont(pFont);
+    s_pRomFont = pFont;
+    s_pDefaultFont = pFont;
+
+    pFont = beginFont("5x7p");
+    addRomGlyphs(pFont, 1);
+    finishFont(pFont);
+}
+
+const struct _Font *loadFontFile(const char *fileSpec)
+{
+    // name font after file
+    char nameBuffer[FONT_MAX_NAME_LEN + 1];
+    char *pPathCopy = xstrdup((char *)fileSpec);
+    strncpy(nameBuffer, basename(pPathCopy), FONT_MAX_NAME_LEN);
+    nameBuffer[FONT_MAX_NAME_LEN] = 0x00;
+    free(pPathCopy);
+    char *pSuffix = strrchr(nameBuffer, '.');
+    if(pSuffix != NULL && pSuffix != nameBuffer) {
+        *pSuffix = 0x00;
+    }
+    if(findFont(nameBuffer) != NULL) {
+        warningMessage("font %s already loaded", nameBuffer);
+        return findFont(nameBuffer);
+    }
+
+    FILE *fpFont = fopen(fileSpec, "rb");
+    if(fpFont == NULL) {
+        perrorMessage("fopen() failed on %s", fileSpec);
+        return NULL;
+    }
+    struct _Font *pFont = beginFont(nameBuffer);
+    int loadStatus = -1;
+    if(pFont != NULL) {
+        uint8_t magicAr[4] = { 0 };
+        size_t nMagicBytes = fread(magicAr, 1, sizeof(magicAr), fpFont);
+        uint32_t nMagic = magicAr[0] | (magicAr[1] << 8) | (magicAr[2] << 16) | ((uint32_t)magicAr[3] << 24);
+        rewind(fpFont);
+        if(nMagicBytes >= 2 && ((magicAr[0] == PSF1_MAGIC0 && magicAr[1] == PSF1_MAGIC1) || nMagic == PSF2_MAGIC)) {
+            // PSF: binary, read it all
+            long nFileBytes = -1;
+            if(fseek(fpFont, 0, SEEK_END) == 0) {
+                nFileBytes = ftell(fpFont);
+            }
+            rewind(fpFont);
+            if(nFileBytes < 0) {
+                errorMessage("%s: failed to size font file", fileSpec);
+            }
+            else {
+                uint8_t *pFileData = xmalloc(nFileBytes);
+                if(fread(pFileData, 1, nFileBytes, fpFont) == (size_t)nFileBytes) {
+                    loadStatus = loadPsfFont(pFont, pFileData, nFileBytes, fileSpec);
+                }
+                else {
+                    errorMessage("%s: failed to read font", fileSpec);
+                }
+                free(pFileData);
+            }
+        }
+        else {
+            loadStatus = loadBdfFont(pFont, fpFont, fileSpec);
+        }
+    }
+    fclose(fpFont);
+
+    if(loadStatus != 0) {
+        if(pFont != NULL) {
+            discardFont(pFont);
+        }
+        return NULL;
+    }
+    finishFont(pFont);
+    infoMessage("Font %s loaded: %d glyphs, %d pixels high, %s, %lu byte atlas", pFont->name, pFont->nGlyphs, pFont->nHeight,
+        (pFont->bFixedWidth) ? "fixed width" : "proportional", (unsigned long)pFont->nAtlasBytes);
+    return pFont;
+}
+
+const struct _Font *findFont(const char *name)
+{
+    for(int nFontIdx = 0; nFontIdx < s_nFonts; nFontIdx++) {
+        if(strcasecmp(s_fontAr[nFontIdx].name, name) == 0) {
+            return &s_fontAr[nFontIdx];
+        }
+    }
+    return NULL;
+}
+
+const struct _Font *getDefaultFont(void)
+{
+    return s_pDefaultFont;
+}
+
+int setDefaultFont(const char *name)
+{
+    const struct _Font *pFont = findFont(name);
+    if(pFont == NULL) {
+        errorMessage("font %s not loaded", name);
+        return -1;  // FAILURE
+    }
+    s_pDefaultFont = pFont;
+    return 0;   // SUCCESS
+}
+
+void showFonts(void)
+{
+    for(int nFontIdx = 0; nFontIdx < s_nFonts; nFontIdx++) {
+        const struct _Font *pFont = &s_fontAr[nFontIdx];
+        infoMessage("%c %-12s %2d pixels high, %4d glyphs, %s, %lu byte atlas", (pFont == s_pDefaultFont) ? '*' : ' ',
+            pFont->name, pFont->nHeight, pFont->nGlyphs, (pFont->bFixedWidth) ? "fixed width " : "proportional", (unsigned long)pFont->nAtlasBytes);
+    }
+}
+
+const struct _FontGlyph *glyphForCodePoint(const struct _Font *pFont, uint32_t nCodePoint)
+{
+    if(nCodePoint < 256) {
+        uint16_t nGlyphIdxPlus1 = pFont->nLatinGlyphIdxAr[nCodePoint];
+        return &pFont->pGlyphs[(nGlyphIdxPlus1 != 0) ? nGlyphIdxPlus1 - 1 : pFont->nMissingGlyphIdx];
+    }
+    // binary search rest of table
+    int nLow = 0;
+    int nHigh = pFont->nGlyphs - 1;
+    while(nLow <= nHigh) {
+        int nMid = (nLow + nHigh) / 2;
+        uint32_t nMidCodePoint = pFont->pGlyphs[nMid].nCodePoint;
+        if(nMidCodePoint == nCodePoint) {
+            return &pFont->pGlyphs[nMid];
+        }
+        if(nMidCodePoint < nCodePoint) {
+            nLow = nMid + 1;
+        }
+        else {
+            nHigh = nMid - 1;
+        }
+    }
+    return &pFont->pGlyphs[pFont->nMissingGlyphIdx];
+}
+
+const struct _TextLayout *layoutString(const struct _Font *pFont, const char *cString, int nBytes)
+{
+    if(nBytes < 0) {
+        nBytes = strlen(cString);
+    }
+    // FNV-1a of font and text
+    uint32_t nHash = 2166136261u ^ (uint32_t)(uintptr_t)pFont;
+    for(int nByteIdx = 0; nByteIdx < nBytes; nByteIdx++) {
+        nHash = (nHash ^ (uint8_t)cString[nByteIdx]) * 16777619u;
+    }
+    struct _TextLayout *pLayout = &s_layoutCacheAr[nHash & (LAYOUT_CACHE_ENTRIES - 1)];
+
+    if(pLayout->nHash == nHash && pLayout->pFont == pFont && pLayout->nBytes == nBytes && memcmp(pLayout->pText, cString, nBytes) == 0) {
+        s_nLayoutHits++;
+    }
+    else {
+        // miss (or slot holds another string), rebuild in place
+        s_nLayoutMisses++;
+        buildLayout(pLayout, pFont, cString, nBytes, nHash);
+    }
+    return pLayout;
+}
+
+void getLayoutCacheStats(uint32_t *pHits, uint32_t *pMisses)
+{
+    *pHits = s_nLayoutHits;
+    *pMisses = s_nLayoutMisses;
+}
+
+int stringWidthInFont(const struct _Font *pFont, const char *cString)
+{
+    return layoutString(pFont, cString, -1)->nWidth;
+}
+
+int bytesFittingWidth(const struct _Font *pFont, const char *cString, int nMaxWidth)
+{
+    const struct _TextLayout *pLayout = layoutString(pFont, cString, -1);
+    int nFittingBytes = 0;
+    for(int nGlyphIdx = 0; nGlyphIdx < pLayout->nGlyphs; nGlyphIdx++) {
+        const struct _FontGlyph *pGlyph = pLayout->pGlyphs[nGlyphIdx];
+        if(pGlyph->nWidth > 0 && pLayout->pPenX[nGlyphIdx] + pGlyph->nOffsetX + pGlyph->nWidth > nMaxWidth) {
+            break;
+        }
+        nFittingBytes = pLayout->pByteEnd[nGlyphIdx];
+    }
+    return nFittingBytes;
+}
+
+int drawStringInBuffer(struct _LedPixel *pBuffer, const struct _Font *pFont, const char *cString, int nBytes, int locX, int locY, uint32_t nColorRGB)
+{
+    const struct _TextLayout *pLayout = layoutString(pFont, cString, nBytes);
+    for(int nGlyphIdx = 0; nGlyphIdx < pLayout->nGlyphs; nGlyphIdx++) {
+        const struct _FontGlyph *pGlyph = pLayout->pGlyphs[nGlyphIdx];
+        int nPenX = locX + pLayout->pPenX[nGlyphIdx];
+        if(pFont == s_pRomFont) {
+            // pre-colored, LED ordered copy
+            drawGlyphInBuffer(pBuffer, pGlyph->nCodePoint, nPenX, locY, nColorRGB);
+        }
+        else {
+            // opaque cell then the on bits
+            fillRectInBuffer(pBuffer, nPenX, locY, pGlyph->nAdvance, pFont->nHeight, 0x000000);
+            int nBytesPerColumn = (pGlyph->nHeight + 7) / 8;
+            const uint8_t *pColumn = &pFont->pAtlas[pGlyph->nAtlasOffset];
+            for(int nCol = 0; nCol < pGlyph->nWidth; nCol++, pColumn += nBytesPerColumn) {
+                int nX = nPenX + pGlyph->nOffsetX + nCol;
+                for(int nRow = 0; nRow < pGlyph->nHeight; nRow++) {
+                    int nY = locY + pGlyph->nOffsetY + nRow;
+                    if((pColumn[nRow / 8] & (1 << (nRow % 8))) != 0 && IS_ON_SCREEN(nX, nY)) {
+                        setLEDColorInBuffer(pBuffer, nColorRGB, nX, nY);
+                    }
+                }
+            }
+        }
+    }
+    return locX + pLayout->nAdvance;
+}
+
+// -----------------------
+//  PRIVATE Methods
+//
+static struct _Font *beginFont(const char *name)
+{
+    if(s_nFonts >= FONT_MAX_LOADED) {
+        errorMessage("font %s not loaded: MAX %d fonts supported", name, FONT_MAX_LOADED);
+        return NULL;
+    }
+    struct _Font *pFont = &s_fontAr[s_nFonts];
+    memset(pFont, 0, sizeof(struct _Font));
+    strncpy(pFont->name, name, FONT_MAX_NAME_LEN);
+    s_nGlyphCapacity = 128;
+    s_nAtlasCapacity = 1024;
+    pFont->pGlyphs = xmalloc(s_nGlyphCapacity * sizeof(struct _FontGlyph));
+    pFont->pAtlas = xmalloc(s_nAtlasCapacity);
+    return pFont;
+}
+
+static int addGlyph(struct _Font *pFont, uint32_t nCodePoint, int nWidth, int nHeight, int nOffsetX, int nOffsetY, int nAdvance, const uint32_t *pRowBits)
+{
+    // pRowBits[nHeight]: bit N is column N
+    if(nWidth < 0 || nWidth > FONT_MAX_GLYPH_PIXELS || nHeight < 0 || nHeight > FONT_MAX_GLYPH_PIXELS ||
+       nOffsetX < INT8_MIN || nOffsetX > INT8_MAX || nOffsetY < INT8_MIN || nOffsetY > INT8_MAX || nAdvance < 0 || nAdvance > UINT8_MAX) {
+        return -1;  // FAILURE, glyph too big
+    }
+    int nBytesPerColumn = (nHeight + 7) / 8;
+    size_t nGlyphBytes = nWidth * nBytesPerColumn;
+    if(pFont->nGlyphs >= UINT16_MAX) {
+        return -1;  // FAILURE
+    }
+    if(pFont->nGlyphs >= s_nGlyphCapacity) {
+        s_nGlyphCapacity *= 2;
+        pFont->pGlyphs = xrealloc(pFont->pGlyphs, s_nGlyphCapacity * sizeof(struct _FontGlyph));
+    }
+    while(pFont->nAtlasBytes + nGlyphBytes > s_nAtlasCapacity) {
+        s_nAtlasCapacity *= 2;
+        pFont->pAtlas = xrealloc(pFont->pAtlas, s_nAtlasCapacity);
+    }
+    struct _FontGlyph *pGlyph = &pFont->pGlyphs[pFont->nGlyphs++];
+    pGlyph->nCodePoint = nCodePoint;
+    pGlyph->nWidth = nWidth;
+    pGlyph->nHeight = nHeight;
+    pGlyph->nOffsetX = nOffsetX;
+    pGlyph->nOffsetY = nOffsetY;
+    pGlyph->nAdvance = nAdvance;
+    pGlyph->nAtlasOffset = pFont->nAtlasBytes;
+
+    uint8_t *pColumn = &pFont->pAtlas[pFont->nAtlasBytes];
+    memset(pColumn, 0, nGlyphBytes);
+    for(int nCol = 0; nCol < nWidth; nCol++, pColumn += nBytesPerColumn) {
+        for(int nRow = 0; nRow < nHeight; nRow++) {
+            if((pRowBits[nRow] & (1UL << nCol)) != 0) {
+                pColumn[nRow / 8] |= (1 << (nRow % 8));
+            }
+        }
+    }
+    pFont->nAtlasBytes += nGlyphBytes;
+    return pFont->nGlyphs - 1;
+}
+
+static int addGlyphAlias(struct _Font *pFont, uint32_t nCodePoint, int nGlyphIdx)
+{
+    // another code point drawn with same bitmap
+    if(pFont->nGlyphs >= UINT16_MAX) {
+        return -1;  // FAILURE
+    }
+    if(pFont->nGlyphs >= s_nGlyphCapacity) {
+        s_nGlyphCapacity *= 2;
+        pFont->pGlyphs = xrealloc(pFont->pGlyphs, s_nGlyphCapacity * sizeof(struct _FontGlyph));
+    }
+    pFont->pGlyphs[pFont->nGlyphs] = pFont->pGlyphs[nGlyphIdx];
+    pFont->pGlyphs[pFont->nGlyphs].nCodePoint = nCodePoint;
+    pFont->nGlyphs++;
+    return 0;   // SUCCESS
+}
+
+static void finishFont(struct _Font *pFont)
+{
+    // sort, drop duplicate code points (first one wins)
+    qsort(pFont->pGlyphs, pFont->nGlyphs, sizeof(struct _FontGlyph), compareGlyphs);
+    int nKeptGlyphs = 0;
+    for(int nGlyphIdx = 0; nGlyphIdx < pFont->nGlyphs; nGlyphIdx++) {
+        if(nKeptGlyphs == 0 || pFont->pGlyphs[nGlyphIdx].nCodePoint != pFont->pGlyphs[nKeptGlyphs - 1].nCodePoint) {
+            pFont->pGlyphs[nKeptGlyphs++] = pFont->pGlyphs[nGlyphIdx];
+        }
+    }
+    pFont->nGlyphs = nKeptGlyphs;
+    pFont->pGlyphs = xrealloc(pFont->pGlyphs, pFont->nGlyphs * sizeof(struct _FontGlyph));
+    pFont->pAtlas = xrealloc(pFont->pAtlas, (pFont->nAtlasBytes > 0) ? pFont->nAtlasBytes : 1);
+
+    memset(pFont->nLatinGlyphIdxAr, 0, sizeof(pFont->nLatinGlyphIdxAr));
+    pFont->bFixedWidth = 1;
+    pFont->nMissingGlyphIdx = 0;
+    for(int nGlyphIdx = 0; nGlyphIdx < pFont->nGlyphs; nGlyphIdx++) {
+        const struct _FontGlyph *pGlyph = &pFont->pGlyphs[nGlyphIdx];
+        if(pGlyph->nCodePoint < 256) {
+            pFont->nLatinGlyphIdxAr[pGlyph->nCodePoint] = nGlyphIdx + 1;
+        }
+        if(pGlyph->nAdvance != pFont->pGlyphs[0].nAdvance) {
+            pFont->bFixedWidth = 0;
+        }
+    }
+    // missing glyph: replacement char, else '?'
+    const struct _FontGlyph *pMissing = glyphForCodePoint(pFont, 0xFFFD);
+    if(pMissing->nCodePoint != 0xFFFD && pFont->nLatinGlyphIdxAr['?'] != 0) {
+        pMissing = &pFont->pGlyphs[pFont->nLatinGlyphIdxAr['?'] - 1];
+    }
+    pFont->nMissingGlyphIdx = pMissing - pFont->pGlyphs;
+    s_nFonts++;
+}
+
+static void discardFont(struct _Font *pFont)
+{
+    free(pFont->pGlyphs);
+    free(pFont->pAtlas);
+    memset(pFont, 0, sizeof(struct _Font));
+}
+
+static int compareGlyphs(const void *pLeft, const void *pRight)
+{
+    uint32_t nLeft = ((const struct _FontGlyph *)pLeft)->nCodePoint;
+    uint32_t nRight = ((const struct _FontGlyph *)pRight)->nCodePoint;
+    return (nLeft > nRight) - (nLeft < nRight);
+}
+
+static void addRomGlyphs(struct _Font *pFont, int bProportional)
+{
+    uint32_t rowBitsAr[ROM_GLYPH_HEIGHT];
+
+    pFont->nHeight = ROM_GLYPH_HEIGHT;
+    pFont->nAscent = ROM_GLYPH_HEIGHT;
+    // 0x20-0x7f, charSet's extended chars, then "no such char" box as the replacement char
+    int nExtendedChars = numberExtendedChars();
+    for(int nCharIdx = 0; nCharIdx < 0x60 + nExtendedChars + 1; nCharIdx++) {
+        uint32_t nCodePoint = 0xFFFD;
+        if(nCharIdx < 0x60) {
+            nCodePoint = 0x20 + nCharIdx;
+        }
+        else if(nCharIdx - 0x60 < nExtendedChars) {
+            nCodePoint = extendedCharCodePoint(nCharIdx - 0x60);
+        }
+        const uint8_t *charRom5Bytes = getCodePointBitsAddr(nCodePoint);
+        int nFirstCol = 0;
+        int nLastCol = ROM_GLYPH_WIDTH - 1;
+        if(bProportional) {
+            while(nFirstCol <= nLastCol && charRom5Bytes[nFirstCol] == 0x00) {
+                nFirstCol++;
+            }
+            while(nLastCol >= nFirstCol && charRom5Bytes[nLastCol] == 0x00) {
+                nLastCol--;
+            }
+        }
+        int nWidth = (nLastCol - nFirstCol) + 1;
+        for(int nRow = 0; nRow < ROM_GLYPH_HEIGHT; nRow++) {
+            rowBitsAr[nRow] = 0;
+            for(int nCol = 0; nCol < nWidth; nCol++) {
+                if((charRom5Bytes[nFirstCol + nCol] & (1 << nRow)) != 0) {
+                    rowBitsAr[nRow] |= (1UL << nCol);
+                }
+            }
+        }
+        int nAdvance = (nWidth > 0) ? nWidth + 1 : ROM_SPACE_ADVANCE;
+        addGlyph(pFont, nCodePoint, nWidth, ROM_GLYPH_HEIGHT, 0, 0, nAdvance, rowBitsAr);
+    }
+}
+
+static int loadBdfFont(struct _Font *pFont, FILE *fpFont, const char *fileSpec)
+{
+    char lineBuffer[256];
+    int nLineNumber = 0;
+    int nFontAscent = -1;
+    int nFontDescent = -1;
+    int nBoxHeight = 0;
+    int nBoxOffsetY = 0;
+    int bInChar = 0;
+    int nEncoding = -1;
+    int nAdvance = -1;
+    int nWidth = 0;
+    int nHeight = 0;
+    int nOffsetX = 0;
+    int nOffsetY = 0;
+    int nSkippedGlyphs = 0;
+    uint32_t rowBitsAr[FONT_MAX_GLYPH_PIXELS];
+
+    while(fgets(lineBuffer, sizeof(lineBuffer), fpFont) != NULL) {
+        nLineNumber++;
+        if(nLineNumber == 1 && strncmp(lineBuffer, "STARTFONT", 9) != 0) {
+            errorMessage("%s: not a BDF or PSF font", fileSpec);
+            return -1;  // FAILURE
+        }
+        int nBoxWidth;
+        int nBoxOffsetX;
+        if(sscanf(lineBuffer, "FONTBOUNDINGBOX %d %d %d %d", &nBoxWidth, &nBoxHeight, &nBoxOffsetX, &nBoxOffsetY) == 4) {
+            continue;
+        }
+        if(sscanf(lineBuffer, "FONT_ASCENT %d", &nFontAscent) == 1 || sscanf(lineBuffer, "FONT_DESCENT %d", &nFontDescent) == 1) {
+            continue;
+        }
+        if(strncmp(lineBuffer, "STARTCHAR", 9) == 0) {
+            if(nFontAscent < 0 || nFontDescent < 0) {
+                // no properties, use bounding box
+                nFontAscent = nBoxHeight + nBoxOffsetY;
+                nFontDescent = -nBoxOffsetY;
+            }
+            bInChar = 1;
+            nEncoding = -1;
+            nAdvance = -1;
+            nWidth = 0;
+            nHeight = 0;
+            nOffsetX = 0;
+            nOffsetY = 0;
+            continue;
+        }
+        if(!bInChar) {
+            continue;
+        }
+        if(sscanf(lineBuffer, "ENCODING %d", &nEncoding) == 1 || sscanf(lineBuffer, "DWIDTH %d", &nAdvance) == 1) {
+            continue;
+        }
+        if(sscanf(lineBuffer, "BBX %d %d %d %d", &nWidth, &nHeight, &nOffsetX, &nOffsetY) == 4) {
+            continue;
+        }
+        if(strncmp(lineBuffer, "BITMAP", 6) == 0) {
+            if(nWidth < 0 || nWidth > FONT_MAX_GLYPH_PIXELS || nHeight < 0 || nHeight > FONT_MAX_GLYPH_PIXELS) {
+                nSkippedGlyphs++;
+                bInChar = 0;
+                continue;
+            }
+            // one hex line per row, MSB is leftmost pixel
+            for(int nRow = 0; nRow < nHeight; nRow++) {
+                if(fgets(lineBuffer, sizeof(lineBuffer), fpFont) == NULL) {
+                    errorMessage("%s: truncated BITMAP near line %d", fileSpec, nLineNumber);
+                    return -1;  // FAILURE
+                }
+                nLineNumber++;
+                rowBitsAr[nRow] = 0;
+                for(int nCol = 0; nCol < nWidth; nCol++) {
+                    char hexDigit[2] = { lineBuffer[nCol / 4], 0x00 };
+                    int nNibble = (int)strtol(hexDigit, NULL, 16);
+                    if((nNibble & (0x08 >> (nCol % 4))) != 0) {
+                        rowBitsAr[nRow] |= (1UL << nCol);
+                    }
+                }
+            }
+            continue;
+        }
+        if(strncmp(lineBuffer, "ENDCHAR", 7) == 0) {
+            bInChar = 0;
+            if(nEncoding < 0) {
+                continue;   // unencoded glyph
+            }
+            if(nAdvance < 0) {
+                nAdvance = nWidth;
+            }
+            // BBX Y offset is baseline to glyph bottom, we want line top to glyph top
+            if(addGlyph(pFont, nEncoding, nWidth, nHeight, nOffsetX, nFontAscent - (nOffsetY + nHeight), nAdvance, rowBitsAr) < 0) {
+                nSkippedGlyphs++;
+            }
+        }
+    }
+    if(nSkippedGlyphs > 0) {
+        warningMessage("%s: %d glyphs too large for us, skipped", fileSpec, nSkippedGlyphs);
+    }
+    if(pFont->nGlyphs == 0 || nFontAscent + nFontDescent <= 0 || nFontAscent + nFontDescent > FONT_MAX_GLYPH_PIXELS) {
+        errorMessage("%s: no usable glyphs (or bad ascent/descent)", fileSpec);
+        return -1;  // FAILURE
+    }
+    pFont->nAscent = nFontAscent;
+    pFont->nHeight = nFontAscent + nFontDescent;
+    return 0;   // SUCCESS
+}
+
+static int loadPsfFont(struct _Font *pFont, const uint8_t *pFileData, size_t nFileBytes, const char *fileSpec)
+{
+    uint32_t nGlyphCount;
+    uint32_t nBytesPerGlyph;
+    uint32_t nWidth;
+    uint32_t nHeight;
+    size_t nHeaderBytes;
+    int bHasUnicodeTable;
+    int bIsVersion2 = (pFileData[0] != PSF1_MAGIC0);
+    uint32_t rowBitsAr[FONT_MAX_GLYPH_PIXELS];
+
+    if(!bIsVersion2) {
+        // magic[2], mode, charsize
+        if(nFileBytes < 4) {
+            errorMessage("%s: truncated PSF header", fileSpec);
+            return -1;  // FAILURE
+        }
+        nGlyphCount = (pFileData[2] & PSF1_MODE512) ? 512 : 256;
+        bHasUnicodeTable = (pFileData[2] & (PSF1_MODEHASTAB | PSF1_MODEHASSEQ)) != 0;
+        nHeight = pFileData[3];
+        nWidth = 8;
+        nBytesPerGlyph = nHeight;
+        nHeaderBytes = 4;
+    }
+    else {
+        // magic, version, headersize, flags, length, charsize, height, width (all 32-bit LE)
+        uint32_t headerAr[8];
+        if(nFileBytes < sizeof(headerAr)) {
+            errorMessage("%s: truncated PSF header", fileSpec);
+            return -1;  // FAILURE
+        }
+        for(int nFieldIdx = 0; nFieldIdx < 8; nFieldIdx++) {
+            const uint8_t *pField = &pFileData[nFieldIdx * 4];
+            headerAr[nFieldIdx] = pField[0] | (pField[1] << 8) | (pField[2] << 16) | ((uint32_t)pField[3] << 24);
+        }
+        nHeaderBytes = headerAr[2];
+        bHasUnicodeTable = (headerAr[3] & PSF2_HAS_UNICODE_TABLE) != 0;
+        nGlyphCount = headerAr[4];
+        nBytesPerGlyph = headerAr[5];
+        nHeight = headerAr[6];
+        nWidth = headerAr[7];
+    }
+    size_t nBytesPerRow = (nWidth + 7) / 8;
+    if(nWidth == 0 || nWidth > FONT_MAX_GLYPH_PIXELS || nHeight == 0 || nHeight > FONT_MAX_GLYPH_PIXELS) {
+        errorMessage("%s: %dx%d glyphs not supported (max %dx%d)", fileSpec, nWidth, nHeight, FONT_MAX_GLYPH_PIXELS, FONT_MAX_GLYPH_PIXELS);
+        return -1;  // FAILURE
+    }
+    // each check on its own so no sum or product can wrap a 32-bit size_t (nBytesPerGlyph is >= 1 once first passes)
+    if(nBytesPerGlyph < nBytesPerRow * nHeight || nHeaderBytes > nFileBytes || nGlyphCount > (nFileBytes - nHeaderBytes) / nBytesPerGlyph) {
+        errorMessage("%s: truncated or inconsistent PSF font", fileSpec);
+        return -1;  // FAILURE
+    }
+
+    // glyph bitmaps in file order, our glyph N is file glyph N until unicode table says otherwise
+    for(uint32_t nGlyphIdx = 0; nGlyphIdx < nGlyphCount; nGlyphIdx++) {
+        const uint8_t *pRows = &pFileData[nHeaderBytes + (nGlyphIdx * nBytesPerGlyph)];
+        for(uint32_t nRow = 0; nRow < nHeight; nRow++) {
+            rowBitsAr[nRow] = 0;
+            for(uint32_t nCol = 0; nCol < nWidth; nCol++) {
+                if((pRows[(nRow * nBytesPerRow) + (nCol / 8)] & (0x80 >> (nCol % 8))) != 0) {
+                    rowBitsAr[nRow] |= (1UL << nCol);
+                }
+            }
+        }
+        addGlyph(pFont, nGlyphIdx, nWidth, nHeight, 0, 0, nWidth, rowBitsAr);
+    }
+
+    if(bHasUnicodeTable) {
+        // each glyph: code points it draws, then terminator (sequences are skipped)
+        const uint8_t *pEntry = &pFileData[nHeaderBytes + ((size_t)nGlyphCount * nBytesPerGlyph)];
+        const uint8_t *pEnd = &pFileData[nFileBytes];
+        for(uint32_t nGlyphIdx = 0; nGlyphIdx < nGlyphCount && pEntry < pEnd; nGlyphIdx++) {
+            int bInSequence = 0;
+            while(pEntry < pEnd) {
+                uint32_t nCodePoint;
+                if(!bIsVersion2) {
+                    if(pEntry + 1 >= pEnd) {
+                        pEntry = pEnd;
+                        break;
+                    }
+                    nCodePoint = pEntry[0] | (pEntry[1] << 8);
+                    pEntry += 2;
+                    if(nCodePoint == 0xFFFF) {
+                        break;
+                    }
+                    if(nCodePoint == 0xFFFE) {
+                        bInSequence = 1;
+                        continue;
+                    }
+                }
+                else {
+                    if(*pEntry == 0xFF) {
+                        pEntry++;
+                        break;
+                    }
+                    if(*pEntry == 0xFE) {
+                        pEntry++;
+                        bInSequence = 1;
+                        continue;
+                    }
+                    pEntry += decodeUtf8(pEntry, pEnd - pEntry, &nCodePoint);
+                }
+                if(!bInSequence) {
+                    addGlyphAlias(pFont, nCodePoint, nGlyphIdx);
+                }
+            }
+        }
+        // glyph indices were only placeholders, the table says what each glyph is
+        int nKeptGlyphs = 0;
+        for(int nGlyphIdx = nGlyphCount; nGlyphIdx < pFont->nGlyphs; nGlyphIdx++) {
+            pFont->pGlyphs[nKeptGlyphs++] = pFont->pGlyphs[nGlyphIdx];
+        }
+        pFont->nGlyphs = nKeptGlyphs;
+    }
+    pFont->nHeight = nHeight;
+    pFont->nAscent = nHeight;
+    return (pFont->nGlyphs > 0) ? 0 : -1;
+}
+
+static void buildLayout(struct _TextLayout *pLayout, const struct _Font *pFont, const char *cString, int nBytes, uint32_t nHash)
+{
+    // entry arrays only grow, so a slot stops allocating once it has held its longest string
+    if(nBytes > pLayout->nCapacity) {
+        // ticker threads come and go, have their arrays freed when they exit
+        pthread_once(&s_layoutCacheKeyOnce, createLayoutCacheKey);
+        if(pthread_getspecific(s_layoutCacheKey) == NULL) {
+            pthread_setspecific(s_layoutCacheKey, s_layoutCacheAr);
+        }
+        pLayout->nCapacity = nBytes + 16;
+        pLayout->pText = xrealloc(pLayout->pText, pLayout->nCapacity);
+        pLayout->pGlyphs = xrealloc(pLayout->pGlyphs, pLayout->nCapacity * sizeof(const struct _FontGlyph *));
+        pLayout->pPenX = xrealloc(pLayout->pPenX, pLayout->nCapacity * sizeof(int32_t));
+        pLayout->pByteEnd = xrealloc(pLayout->pByteEnd, pLayout->nCapacity * sizeof(uint32_t));
+    }
+    memcpy(pLayout->pText, cString, nBytes);
+    pLayout->nHash = nHash;
+    pLayout->pFont = pFont;
+    pLayout->nBytes = nBytes;
+
+    const uint8_t *pBytes = (const uint8_t *)cString;
+    int nPenX = 0;
+    int nRightX = 0;
+    int nGlyphs = 0;
+    for(int nByteIdx = 0; nByteIdx < nBytes; nGlyphs++) {
+        uint32_t nCodePoint;
+        nByteIdx += decodeUtf8(&pBytes[nByteIdx], nBytes - nByteIdx, &nCodePoint);
+        const struct _FontGlyph *pGlyph = glyphForCodePoint(pFont, nCodePoint);
+        pLayout->pGlyphs[nGlyphs] = pGlyph;
+        pLayout->pPenX[nGlyphs] = nPenX;
+        pLayout->pByteEnd[nGlyphs] = nByteIdx;
+        if(pGlyph->nWidth > 0 && nPenX + pGlyph->nOffsetX + pGlyph->nWidth > nRightX) {
+            nRightX = nPenX + pGlyph->nOffsetX + pGlyph->nWidth;
+        }
+        nPenX += pGlyph->nAdvance;
+    }
+    pLayout->nGlyphs = nGlyphs;
+    pLayout->nWidth = nRightX;
+    pLayout->nAdvance = nPenX;
+}
+
+static void createLayoutCacheKey(void)
+{
+    if(pthread_key_create(&s_layoutCacheKey, freeLayoutCache) != 0) {
+        errorMessage("[CODE] pthread_key_create() failed, layout cache arrays leak at thread exit");
+    }
+}
+
+static void freeLayoutCache(void *pCache)
+{
+    // runs as a thread exits: pCache is that thread's s_layoutCacheAr
+    struct _TextLayout *pLayoutAr = pCache;
+    for(int nEntryIdx = 0; nEntryIdx < LAYOUT_CACHE_ENTRIES; nEntryIdx++) {
+        free(pLayoutAr[nEntryIdx].pText);
+        free(pLayoutAr[nEntryIdx].pGlyphs);
+        free(pLayoutAr[nEntryIdx].pPenX);
+        free(pLayoutAr[nEntryIdx].pByteEnd);
+        memset(&pLayoutAr[nEntryIdx], 0, sizeof(struct _TextLayout));
+    }
+}
+
+static int decodeUtf8(const uint8_t *pBytes, size_t nBytes, uint32_t *pCodePoint)
+{
+    // returns bytes used (at least 1), malformed bytes decode as U+FFFD
+    int nLength = (pBytes[0] < 0x80) ? 1 : ((pBytes[0] & 0xE0) == 0xC0) ? 2 : ((pBytes[0] & 0xF0) == 0xE0) ? 3 : ((pBytes[0] & 0xF8) == 0xF0) ? 4 : 0;
+    if(nLength == 0 || (size_t)nLength > nBytes) {
+        *pCodePoint = 0xFFFD;
+        return 1;
+    }
+    uint32_t nCodePoint = (nLength == 1) ? pBytes[0] : pBytes[0] & (0x7F >> nLength);
+    for(int nByteIdx = 1; nByteIdx < nLength; nByteIdx++) {
+        if((pBytes[nByteIdx] & 0xC0) != 0x80) {
+            *pCodePoint = 0xFFFD;
+            return 1;
+        }
+        nCodePoint = (nCodePoint << 6) | (pBytes[nByteIdx] & 0x3F);
+    }
+    *pCodePoint = nCodePoint;
+    return nLength;
+}
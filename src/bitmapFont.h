@@ -0,0 +1,102 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef BITMAP_FONT_H
+#define BITMAP_FONT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+#define FONT_MAX_LOADED 8
+#define FONT_MAX_NAME_LEN 31
+#define FONT_MAX_GLYPH_PIXELS 32    // widest/tallest glyph we accept
+
+struct _FontGlyph {
+    uint32_t nCodePoint;
+    uint8_t nWidth;         // bitmap columns
+    uint8_t nHeight;        // bitmap rows
+    int8_t nOffsetX;        // bitmap left edge relative to pen X
+    int8_t nOffsetY;        // bitmap top relative to top of line
+    uint8_t nAdvance;       // pen moves this far right after glyph
+    uint32_t nAtlasOffset;  // first byte of glyph in font atlas
+};
+
+// glyph bitmaps are packed into one atlas: column by column, (nHeight + 7) / 8 bytes per column, bit 0 = top
+struct _Font {
+    char name[FONT_MAX_NAME_LEN + 1];
+    uint8_t nHeight;        // line height in pixels (ascent + descent)
+    uint8_t nAscent;        // top of line to baseline
+    uint8_t bFixedWidth;    // T/F every glyph has same advance
+    uint16_t nGlyphs;
+    struct _FontGlyph *pGlyphs;     // sorted by code point
+    uint16_t nLatinGlyphIdxAr[256]; // glyph index + 1 for code points < 256, 0 = not in font
+    uint16_t nMissingGlyphIdx;      // drawn for code points font does not have
+    uint8_t *pAtlas;
+    size_t nAtlasBytes;
+};
+
+// string laid out in a font: glyph and pen X for each code point (cached per thread, valid until next layoutString() on thread)
+struct _TextLayout {
+    uint32_t nHash;         // of font + text
+    const struct _Font *pFont;  // NULL = empty
+    int nBytes;
+    char *pText;            // copy of text, confirms a hash hit
+    int nGlyphs;
+    const struct _FontGlyph **pGlyphs;
+    int32_t *pPenX;         // pen X of each glyph, from 0
+    uint32_t *pByteEnd;     // bytes of text used through each glyph
+    int nWidth;             // left of first glyph to right of last (no trailing gap)
+    int nAdvance;           // pen X after last glyph
+    int nCapacity;          // bytes/glyphs arrays can hold
+};
+
+// set up our built-in fonts: "5x7" (our ROM font) and "5x7p" (same glyphs, proportional)
+void initFonts(void);
+
+// load .bdf or .psf (v1/v2) font, named after file (w/o path and suffix), NULL on error
+const struct _Font *loadFontFile(const char *fileSpec);
+
+const struct _Font *findFont(const char *name);     // NULL if not loaded
+const struct _Font *getDefaultFont(void);           // font used by string/text commands
+int setDefaultFont(const char *name);               // 0 on success
+void showFonts(void);
+
+// glyph for code point, font's missing-glyph if it has none
+const struct _FontGlyph *glyphForCodePoint(const struct _Font *pFont, uint32_t nCodePoint);
+
+// all strings are UTF-8, malformed bytes show as font's missing-glyph
+const struct _TextLayout *layoutString(const struct _Font *pFont, const char *cString, int nBytes);  // nBytes -1 = all
+// lookups since thread started: hits are strings we did not have to lay out again
+void getLayoutCacheStats(uint32_t *pHits, uint32_t *pMisses);
+
+// pixels from left of first glyph to right of last (no trailing gap), for centering
+int stringWidthInFont(const struct _Font *pFont, const char *cString);
+
+// length in bytes (not characters) of the leading code points of UTF-8 string which fit within nMaxWidth pixels
+int bytesFittingWidth(const struct _Font *pFont, const char *cString, int nMaxWidth);
+
+// draw nBytes (-1 = all) of string with top-left of line at X,Y, clipped to screen, returns pen X after
+//  glyph cells (advance x line height) are opaque: off pixels are set to black
+int drawStringInBuffer(struct _LedPixel *pBuffer, const struct _Font *pFont, const char *cString, int nBytes, int locX, int locY, uint32_t nColorRGB);
+
+#endif /* BITMAP_FONT_H */
@@ -0,0 +1,240 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdlib.h>     // free()
+#include <string.h>
+
+#include "canvas.h"
+#include "xmalloc.h"
+#include "pixelFill.h"
+#include "debug.h"
+
+//  Canvases hold content bigger than the screen (long dashboards, big images) so it is
+//  drawn once and only a window of it is copied out each frame.
+//
+//  Pixels are kept in 8x8 tiles, each tile column by column.  A screen column of the
+//  window then comes out of the canvas as runs of up to 8 contiguous pixels, and LEDs
+//  in our panels run up/down columns, so most runs go to the frame with one memcpy:
+//
+//    LEDs run down the column  -> memcpy
+//    LEDs run up the column    -> reversed copy
+//    LEDs N apart (interleaved lanes) -> strided copy
+//    run ends early (panel edge, gap) -> copy up to there, carry on from next pixel
+//
+//  Tiles also keep a 2D neighborhood in a few cache lines, so drawing into the
+//  canvas (rectangles, text) touches little memory whichever direction it goes.
+
+#define PIXELS_PER_TILE (CANVAS_TILE_SIZE * CANVAS_TILE_SIZE)
+
+#define MIN(a,b) ((a < b) ? a : b)
+#define MAX(a,b) ((a > b) ? a : b)
+
+static struct _Canvas s_canvasAr[CANVAS_MAX_CANVASES];
+
+// -----------------------
+// forward declarations
+//
+static int copyColumnRun(struct _LedPixel *pBuffer, const uint16_t *pEntry, int nCount, const struct _LedPixel *pSource);
+static void setCanvasPixel(struct _Canvas *pCanvas, int locX, int locY, uint32_t nColorRGB);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+struct _Canvas *createCanvas(uint8_t nCanvasNumber, int nWidth, int nHeight)
+{
+    if(nCanvasNumber < 1 || nCanvasNumber > CANVAS_MAX_CANVASES) {
+        errorMessage("Canvas (%d) out-of-range: [must be 1 >= N <= %d]", nCanvasNumber, CANVAS_MAX_CANVASES);
+        return NULL;
+    }
+    if(nWidth < 1 || nWidth > CANVAS_MAX_SIZE || nHeight < 1 || nHeight > CANVAS_MAX_SIZE) {
+        errorMessage("Canvas size %dx%d out-of-range: [must be 1 >= N <= %d]", nWidth, nHeight, CANVAS_MAX_SIZE);
+        return NULL;
+    }
+    freeCanvas(nCanvasNumber);
+    struct _Canvas *pCanvas = &s_canvasAr[nCanvasNumber - 1];
+    pCanvas->nWidth = nWidth;
+    pCanvas->nHeight = nHeight;
+    pCanvas->nTilesAcross = (nWidth + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE;
+    pCanvas->nTilesDown = (nHeight + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE;
+    size_t nTileBytes = (size_t)pCanvas->nTilesAcross * pCanvas->nTilesDown * PIXELS_PER_TILE * sizeof(struct _LedPixel);
+    pCanvas->pTiles = xcalloc(1, nTileBytes);
+    debugMessage("- Allocated canvas %d@%p: %dx%d (%d bytes)", nCanvasNumber, pCanvas->pTiles, nWidth, nHeight, nTileBytes);
+    return pCanvas;
+}
+
+void freeCanvas(uint8_t nCanvasNumber)
+{
+    if(nCanvasNumber >= 1 && nCanvasNumber <= CANVAS_MAX_CANVASES) {
+        struct _Canvas *pCanvas = &s_canvasAr[nCanvasNumber - 1];
+        free(pCanvas->pTiles);
+        memset(pCanvas, 0, sizeof(struct _Canvas));
+    }
+}
+
+struct _Canvas *ptrCanvas(uint8_t nCanvasNumber)
+{
+    if(nCanvasNumber < 1 || nCanvasNumber > CANVAS_MAX_CANVASES || s_canvasAr[nCanvasNumber - 1].pTiles == NULL) {
+        return NULL;
+    }
+    return &s_canvasAr[nCanvasNumber - 1];
+}
+
+void showCanvases(void)
+{
+    int nCanvases = 0;
+    for(int nCanvasIdx = 0; nCanvasIdx < CANVAS_MAX_CANVASES; nCanvasIdx++) {
+        const struct _Canvas *pCanvas = &s_canvasAr[nCanvasIdx];
+        if(pCanvas->pTiles != NULL) {
+            infoMessage("Canvas %d: %dx%d pixels, %dx%d tiles, %lu bytes", nCanvasIdx + 1, pCanvas->nWidth, pCanvas->nHeight, pCanvas->nTilesAcross, pCanvas->nTilesDown,
+                (unsigned long)pCanvas->nTilesAcross * pCanvas->nTilesDown * PIXELS_PER_TILE * sizeof(struct _LedPixel));
+            nCanvases++;
+        }
+    }
+    if(nCanvases == 0) {
+        infoMessage("No canvases");
+    }
+}
+
+void fillCanvasRect(struct _Canvas *pCanvas, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB)
+{
+    int nMinX = MAX(locX, 0);
+    int nMinY = MAX(locY, 0);
+    int nMaxX = MIN(locX + nWidth, pCanvas->nWidth) - 1;
+    int nMaxY = MIN(locY + nHeight, pCanvas->nHeight) - 1;
+    for(int nX = nMinX; nX <= nMaxX; nX++) {
+        // each tile column of the rect is one run
+        for(int nY = nMinY; nY <= nMaxY; ) {
+            int nRunLength = MIN(CANVAS_TILE_SIZE - (nY % CANVAS_TILE_SIZE), (nMaxY - nY) + 1);
+            fillLedRun(ptrPixelInCanvas(pCanvas, nX, nY), nRunLength, nColorRGB);
+            nY += nRunLength;
+        }
+    }
+}
+
+int drawStringInCanvas(struct _Canvas *pCanvas, const struct _Font *pFont, const char *cString, int locX, int locY, uint32_t nColorRGB)
+{
+    const struct _TextLayout *pLayout = layoutString(pFont, cString, -1);
+    for(int nGlyphIdx = 0; nGlyphIdx < pLayout->nGlyphs; nGlyphIdx++) {
+        const struct _FontGlyph *pGlyph = pLayout->pGlyphs[nGlyphIdx];
+        int nPenX = locX + pLayout->pPenX[nGlyphIdx];
+        // opaque cell then the on bits
+        fillCanvasRect(pCanvas, nPenX, locY, pGlyph->nAdvance, pFont->nHeight, 0x000000);
+        int nBytesPerColumn = (pGlyph->nHeight + 7) / 8;
+        const uint8_t *pColumn = &pFont->pAtlas[pGlyph->nAtlasOffset];
+        for(int nCol = 0; nCol < pGlyph->nWidth; nCol++, pColumn += nBytesPerColumn) {
+            for(int nRow = 0; nRow < pGlyph->nHeight; nRow++) {
+                if((pColumn[nRow / 8] & (1 << (nRow % 8))) != 0) {
+                    setCanvasPixel(pCanvas, nPenX + pGlyph->nOffsetX + nCol, locY + pGlyph->nOffsetY + nRow, nColorRGB);
+                }
+            }
+        }
+    }
+    return locX + pLayout->nAdvance;
+}
+
+void pasteBufferIntoCanvas(struct _Canvas *pCanvas, uint16_t nBufferNumber, int locX, int locY)
+{
+    const struct _LedPixel *pBuffer = ptrBuffer(nBufferNumber);
+    if(pBuffer == NULL) {
+        errorMessage("pasteBufferIntoCanvas() No Buffer at #%d", nBufferNumber);
+        return;
+    }
+    for(int nY = 0; nY < SCREEN_HEIGHT; nY++) {
+        for(int nX = 0; nX < SCREEN_WIDTH; nX++) {
+            int nCanvasX = locX + nX;
+            int nCanvasY = locY + nY;
+            if(nCanvasX >= 0 && nCanvasX < pCanvas->nWidth && nCanvasY >= 0 && nCanvasY < pCanvas->nHeight) {
+                *ptrPixelInCanvas(pCanvas, nCanvasX, nCanvasY) = pBuffer[ledIndexForXY(nX, nY)];
+            }
+        }
+    }
+}
+
+void copyCanvasToBuffer(const struct _Canvas *pCanvas, int nOriginX, int nOriginY, uint16_t nBufferNumber)
+{
+    struct _LedPixel *pBuffer = ptrBuffer(nBufferNumber);
+    if(pBuffer == NULL) {
+        errorMessage("copyCanvasToBuffer() No Buffer at #%d", nBufferNumber);
+        return;
+    }
+    const uint16_t *pTable = screenLayout.pXlateTable;
+    struct _LedPixel blackLED = { 0, 0, 0 };
+
+    for(int nX = 0; nX < SCREEN_WIDTH; nX++) {
+        int nCanvasX = nOriginX + nX;
+        for(int nY = 0; nY < SCREEN_HEIGHT; ) {
+            int nCanvasY = nOriginY + nY;
+            const uint16_t *pEntry = &pTable[(nY * SCREEN_WIDTH) + nX];
+            if(nCanvasX < 0 || nCanvasX >= pCanvas->nWidth || nCanvasY < 0 || nCanvasY >= pCanvas->nHeight) {
+                pBuffer[*pEntry] = blackLED;
+                nY++;
+                continue;
+            }
+            // contiguous canvas pixels: rest of this tile column, screen and canvas permitting
+            int nRunLength = MIN(CANVAS_TILE_SIZE - (nCanvasY % CANVAS_TILE_SIZE), SCREEN_HEIGHT - nY);
+            nRunLength = MIN(nRunLength, pCanvas->nHeight - nCanvasY);
+            nY += copyColumnRun(pBuffer, pEntry, nRunLength, ptrPixelInCanvas(pCanvas, nCanvasX, nCanvasY));
+        }
+    }
+    markBufferAllDirty(nBufferNumber);
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static int copyColumnRun(struct _LedPixel *pBuffer, const uint16_t *pEntry, int nCount, const struct _LedPixel *pSource)
+{
+    // pEntry: layout table entry of first pixel, next pixel down is SCREEN_WIDTH entries on
+    //  copies leading pixels which are one run of LEDs (at least 1), returns pixels copied
+    uint16_t nFirstLedIdx = pEntry[0];
+    int nStep = (nCount > 1) ? pEntry[SCREEN_WIDTH] - nFirstLedIdx : 0;
+    int nRunLength = 1;
+    if(nStep != 0 && nFirstLedIdx != LAYOUT_NO_LED_IDX) {
+        while(nRunLength < nCount && pEntry[nRunLength * SCREEN_WIDTH] - pEntry[(nRunLength - 1) * SCREEN_WIDTH] == nStep) {
+            nRunLength++;
+        }
+    }
+    if(nRunLength == 1) {
+        // gap pixels land on the spare LED
+        pBuffer[nFirstLedIdx] = pSource[0];
+    }
+    else if(nStep == 1) {
+        memcpy(&pBuffer[nFirstLedIdx], pSource, nRunLength * sizeof(struct _LedPixel));
+    }
+    else {
+        for(int nPixelIdx = 0; nPixelIdx < nRunLength; nPixelIdx++) {
+            pBuffer[nFirstLedIdx + (nPixelIdx * nStep)] = pSource[nPixelIdx];
+        }
+    }
+    return nRunLength;
+}
+
+static void setCanvasPixel(struct _Canvas *pCanvas, int locX, int locY, uint32_t nColorRGB)
+{
+    if(locX >= 0 && locX < pCanvas->nWidth && locY >= 0 && locY < pCanvas->nHeight) {
+        struct _LedPixel *pPixel = ptrPixelInCanvas(pCanvas, locX, locY);
+        pPixel->red = (nColorRGB >> 16) & 0xff;
+        pPixel->green = (nColorRGB >> 8) & 0xff;
+        pPixel->blue = nColorRGB & 0xff;
+    }
+}
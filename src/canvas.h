@@ -0,0 +1,67 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+#include "bitmapFont.h"
+
+#define CANVAS_MAX_CANVASES 8
+#define CANVAS_MAX_SIZE 4096        // widest/tallest canvas in pixels
+#define CANVAS_TILE_SIZE 8          // tiles are 8x8 pixels
+
+// off-screen image of any size, drawn once then shown a screen-sized window at a time
+//  stored as 8x8 tiles (row of tiles after row of tiles), each tile column by column top to bottom,
+//  so 8 pixels down a column are one contiguous run (the way our LED strings run)
+struct _Canvas {
+    uint16_t nWidth;
+    uint16_t nHeight;
+    uint16_t nTilesAcross;
+    uint16_t nTilesDown;
+    struct _LedPixel *pTiles;
+};
+
+// canvas pixel X,Y - NO checks, X,Y must be within canvas
+static inline struct _LedPixel *ptrPixelInCanvas(const struct _Canvas *pCanvas, int locX, int locY)
+{
+    int nTileIdx = ((locY / CANVAS_TILE_SIZE) * pCanvas->nTilesAcross) + (locX / CANVAS_TILE_SIZE);
+    int nPixelIdx = ((locX % CANVAS_TILE_SIZE) * CANVAS_TILE_SIZE) + (locY % CANVAS_TILE_SIZE);
+    return &pCanvas->pTiles[(nTileIdx * CANVAS_TILE_SIZE * CANVAS_TILE_SIZE) + nPixelIdx];
+}
+
+// canvases are numbered [1 - CANVAS_MAX_CANVASES], create replaces any existing canvas (new one is black), NULL on error
+struct _Canvas *createCanvas(uint8_t nCanvasNumber, int nWidth, int nHeight);
+void freeCanvas(uint8_t nCanvasNumber);
+struct _Canvas *ptrCanvas(uint8_t nCanvasNumber);   // NULL if no such canvas
+void showCanvases(void);
+
+// drawing into canvas, clipped to canvas
+void fillCanvasRect(struct _Canvas *pCanvas, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB);
+int drawStringInCanvas(struct _Canvas *pCanvas, const struct _Font *pFont, const char *cString, int locX, int locY, uint32_t nColorRGB);  // returns pen X after
+void pasteBufferIntoCanvas(struct _Canvas *pCanvas, uint16_t nBufferNumber, int locX, int locY);    // whole screen of buffer at canvas X,Y
+
+// viewport: screen-sized window with top-left at canvas X,Y into buffer (area outside canvas is black)
+void copyCanvasToBuffer(const struct _Canvas *pCanvas, int nOriginX, int nOriginY, uint16_t nBufferNumber);
+
+#endif /* CANVAS_H */
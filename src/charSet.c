@@ -27,6 +27,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 │  - Returns address of [] char when out-of-range                                             │
 │  - Supports selection of alternate Micr-like number-set                                     │
 │  - Supports query to see if alternate Micr-like number-set is selected                      │
+│  - Looks up Latin-1 accented letters, currency, degree sign and arrows by code point        │
 │                                                                                             │
 │ LAYOUT OF CHARS:                                                                            │
 │                                       (Example Encoding)                                    │
@@ -225,3 +226,120 @@ const uint8_t *getCharBitsAddr(uint8_t cCharacter)
     return desiredAddr;
 }
 
+// Beyond ASCII: sparse index of the code points we have glyphs for, sorted by code point.
+//  Accented letters are the ROM letter with accent in the top two rows (capitals squeezed to 5 rows).
+static const struct _ExtendedChar {
+    uint16_t nCodePoint;
+    uint8_t bits[BYTES_PER_CHAR];
+} s_extendedChars[] = {
+    { 0x00a1, { 0x00, 0x00, 0x7d, 0x00, 0x00 } },   // ¡ inverted exclamation mark
+    { 0x00a2, { 0x1c, 0x22, 0x7f, 0x22, 0x00 } },   // ¢ cent sign
+    { 0x00a3, { 0x48, 0x3e, 0x49, 0x41, 0x22 } },   // £ pound sign
+    { 0x00a5, { 0x29, 0x2a, 0x7c, 0x2a, 0x29 } },   // ¥ yen sign
+    { 0x00ab, { 0x08, 0x14, 0x2a, 0x14, 0x22 } },   // « left-pointing double angle quotation mark
+    { 0x00b0, { 0x02, 0x05, 0x05, 0x02, 0x00 } },   // ° degree sign
+    { 0x00b1, { 0x44, 0x44, 0x5f, 0x44, 0x44 } },   // ± plus-minus sign
+    { 0x00b5, { 0x7c, 0x20, 0x20, 0x1c, 0x20 } },   // µ micro sign
+    { 0x00b7, { 0x00, 0x00, 0x08, 0x00, 0x00 } },   // · middle dot
+    { 0x00bb, { 0x22, 0x14, 0x2a, 0x14, 0x08 } },   // » right-pointing double angle quotation mark
+    { 0x00bf, { 0x20, 0x40, 0x45, 0x48, 0x30 } },   // ¿ inverted question mark
+    { 0x00c0, { 0x78, 0x15, 0x16, 0x14, 0x78 } },   // À latin capital letter a with grave
+    { 0x00c1, { 0x78, 0x14, 0x16, 0x15, 0x78 } },   // Á latin capital letter a with acute
+    { 0x00c2, { 0x78, 0x16, 0x15, 0x16, 0x78 } },   // Â latin capital letter a with circumflex
+    { 0x00c3, { 0x7a, 0x15, 0x16, 0x15, 0x78 } },   // Ã latin capital letter a with tilde
+    { 0x00c4, { 0x78, 0x15, 0x14, 0x15, 0x78 } },   // Ä latin capital letter a with diaeresis
+    { 0x00c5, { 0x78, 0x17, 0x15, 0x17, 0x78 } },   // Å latin capital letter a with ring above
+    { 0x00c7, { 0x0e, 0x51, 0x71, 0x11, 0x0a } },   // Ç latin capital letter c with cedilla
+    { 0x00c8, { 0x7c, 0x55, 0x56, 0x54, 0x44 } },   // È latin capital letter e with grave
+    { 0x00c9, { 0x7c, 0x54, 0x56, 0x55, 0x44 } },   // É latin capital letter e with acute
+    { 0x00ca, { 0x7c, 0x56, 0x55, 0x56, 0x44 } },   // Ê latin capital letter e with circumflex
+    { 0x00cb, { 0x7c, 0x55, 0x54, 0x55, 0x44 } },   // Ë latin capital letter e with diaeresis
+    { 0x00cc, { 0x00, 0x45, 0x7e, 0x44, 0x00 } },   // Ì latin capital letter i with grave
+    { 0x00cd, { 0x00, 0x44, 0x7e, 0x45, 0x00 } },   // Í latin capital letter i with acute
+    { 0x00ce, { 0x00, 0x46, 0x7d, 0x46, 0x00 } },   // Î latin capital letter i with circumflex
+    { 0x00cf, { 0x00, 0x45, 0x7c, 0x45, 0x00 } },   // Ï latin capital letter i with diaeresis
+    { 0x00d1, { 0x7e, 0x09, 0x12, 0x21, 0x7c } },   // Ñ latin capital letter n with tilde
+    { 0x00d2, { 0x38, 0x45, 0x46, 0x44, 0x38 } },   // Ò latin capital letter o with grave
+    { 0x00d3, { 0x38, 0x44, 0x46, 0x45, 0x38 } },   // Ó latin capital letter o with acute
+    { 0x00d4, { 0x38, 0x46, 0x45, 0x46, 0x38 } },   // Ô latin capital letter o with circumflex
+    { 0x00d5, { 0x3a, 0x45, 0x46, 0x45, 0x38 } },   // Õ latin capital letter o with tilde
+    { 0x00d6, { 0x38, 0x45, 0x44, 0x45, 0x38 } },   // Ö latin capital letter o with diaeresis
+    { 0x00d7, { 0x22, 0x14, 0x08, 0x14, 0x22 } },   // × multiplication sign
+    { 0x00d8, { 0x3e, 0x61, 0x5d, 0x43, 0x3e } },   // Ø latin capital letter o with stroke
+    { 0x00d9, { 0x3c, 0x41, 0x42, 0x40, 0x3c } },   // Ù latin capital letter u with grave
+    { 0x00da, { 0x3c, 0x40, 0x42, 0x41, 0x3c } },   // Ú latin capital letter u with acute
+    { 0x00db, { 0x3c, 0x42, 0x41, 0x42, 0x3c } },   // Û latin capital letter u with circumflex
+    { 0x00dc, { 0x3c, 0x41, 0x40, 0x41, 0x3c } },   // Ü latin capital letter u with diaeresis
+    { 0x00dd, { 0x0c, 0x10, 0x62, 0x11, 0x0c } },   // Ý latin capital letter y with acute
+    { 0x00df, { 0x7e, 0x01, 0x49, 0x56, 0x20 } },   // ß latin small letter sharp s
+    { 0x00e0, { 0x20, 0x55, 0x56, 0x54, 0x78 } },   // à latin small letter a with grave
+    { 0x00e1, { 0x20, 0x54, 0x56, 0x55, 0x78 } },   // á latin small letter a with acute
+    { 0x00e2, { 0x20, 0x56, 0x55, 0x56, 0x78 } },   // â latin small letter a with circumflex
+    { 0x00e3, { 0x22, 0x55, 0x56, 0x55, 0x78 } },   // ã latin small letter a with tilde
+    { 0x00e4, { 0x20, 0x55, 0x54, 0x55, 0x78 } },   // ä latin small letter a with diaeresis
+    { 0x00e5, { 0x20, 0x57, 0x55, 0x57, 0x78 } },   // å latin small letter a with ring above
+    { 0x00e7, { 0x1c, 0x42, 0x62, 0x02, 0x10 } },   // ç latin small letter c with cedilla
+    { 0x00e8, { 0x38, 0x55, 0x56, 0x54, 0x18 } },   // è latin small letter e with grave
+    { 0x00e9, { 0x38, 0x54, 0x56, 0x55, 0x18 } },   // é latin small letter e with acute
+    { 0x00ea, { 0x38, 0x56, 0x55, 0x56, 0x18 } },   // ê latin small letter e with circumflex
+    { 0x00eb, { 0x38, 0x55, 0x54, 0x55, 0x18 } },   // ë latin small letter e with diaeresis
+    { 0x00ec, { 0x00, 0x45, 0x7e, 0x40, 0x00 } },   // ì latin small letter i with grave
+    { 0x00ed, { 0x00, 0x44, 0x7e, 0x41, 0x00 } },   // í latin small letter i with acute
+    { 0x00ee, { 0x00, 0x46, 0x7d, 0x42, 0x00 } },   // î latin small letter i with circumflex
+    { 0x00ef, { 0x00, 0x45, 0x7c, 0x41, 0x00 } },   // ï latin small letter i with diaeresis
+    { 0x00f1, { 0x7e, 0x09, 0x06, 0x05, 0x78 } },   // ñ latin small letter n with tilde
+    { 0x00f2, { 0x38, 0x45, 0x46, 0x44, 0x38 } },   // ò latin small letter o with grave
+    { 0x00f3, { 0x38, 0x44, 0x46, 0x45, 0x38 } },   // ó latin small letter o with acute
+    { 0x00f4, { 0x38, 0x46, 0x45, 0x46, 0x38 } },   // ô latin small letter o with circumflex
+    { 0x00f5, { 0x3a, 0x45, 0x46, 0x45, 0x38 } },   // õ latin small letter o with tilde
+    { 0x00f6, { 0x38, 0x45, 0x44, 0x45, 0x38 } },   // ö latin small letter o with diaeresis
+    { 0x00f7, { 0x08, 0x08, 0x2a, 0x08, 0x08 } },   // ÷ division sign
+    { 0x00f8, { 0x38, 0x64, 0x54, 0x4c, 0x38 } },   // ø latin small letter o with stroke
+    { 0x00f9, { 0x3c, 0x41, 0x42, 0x20, 0x7c } },   // ù latin small letter u with grave
+    { 0x00fa, { 0x3c, 0x40, 0x42, 0x21, 0x7c } },   // ú latin small letter u with acute
+    { 0x00fb, { 0x3c, 0x42, 0x41, 0x22, 0x7c } },   // û latin small letter u with circumflex
+    { 0x00fc, { 0x3c, 0x41, 0x40, 0x21, 0x7c } },   // ü latin small letter u with diaeresis
+    { 0x00fd, { 0x0c, 0x50, 0x52, 0x51, 0x3c } },   // ý latin small letter y with acute
+    { 0x00ff, { 0x0c, 0x51, 0x50, 0x51, 0x3c } },   // ÿ latin small letter y with diaeresis
+    { 0x20ac, { 0x14, 0x3e, 0x55, 0x55, 0x41 } },   // € euro sign
+    { 0x2103, { 0x3d, 0x42, 0x42, 0x42, 0x24 } },   // ℃ degree celsius
+    { 0x2190, { 0x08, 0x1c, 0x2a, 0x08, 0x08 } },   // ← leftwards arrow
+    { 0x2191, { 0x04, 0x02, 0x7f, 0x02, 0x04 } },   // ↑ upwards arrow
+    { 0x2192, { 0x08, 0x08, 0x2a, 0x1c, 0x08 } },   // → rightwards arrow
+    { 0x2193, { 0x10, 0x20, 0x7f, 0x20, 0x10 } },   // ↓ downwards arrow
+};
+
+#define NUMBER_EXTENDED_CHARS (sizeof(s_extendedChars) / sizeof(s_extendedChars[0]))
+
+int numberExtendedChars(void)
+{
+    return NUMBER_EXTENDED_CHARS;
+}
+
+uint32_t extendedCharCodePoint(int nCharIdx)
+{
+    return s_extendedChars[nCharIdx].nCodePoint;
+}
+
+const uint8_t *getCodePointBitsAddr(uint32_t nCodePoint)
+{
+    if(nCodePoint < 0x80) {
+        return getCharBitsAddr(nCodePoint);
+    }
+    // binary search our sparse table
+    int nLow = 0;
+    int nHigh = NUMBER_EXTENDED_CHARS - 1;
+    while(nLow <= nHigh) {
+        int nMid = (nLow + nHigh) / 2;
+        if(s_extendedChars[nMid].nCodePoint == nCodePoint) {
+            return s_extendedChars[nMid].bits;
+        }
+        if(s_extendedChars[nMid].nCodePoint < nCodePoint) {
+            nLow = nMid + 1;
+        }
+        else {
+            nHigh = nMid - 1;
+        }
+    }
+    return &s_nRomChars[OFFSET_NO_SUCH_CHAR_BOX];
+}
@@ -27,5 +27,8 @@
 void useMicrNumbers(int bEnable); // Enable/Disable use of special Micr-like digits
 int isUsingMicrNumbers(void);     // Return T/F where T means we are using Micr-like digits
 const uint8_t *getCharBitsAddr(uint8_t cCharacter); // Return addr of bits for char[0x20-0x7f] (ptr to 5-bytes)
+const uint8_t *getCodePointBitsAddr(uint32_t nCodePoint); // Same for any code point: ASCII, Latin-1 accents/symbols, arrows, euro ([] if none)
+int numberExtendedChars(void);                      // Return count of code points above 0x7f we have bits for
+uint32_t extendedCharCodePoint(int nCharIdx);      // Return Nth (ascending) of those code points
 
 #endif /* CHAR_SET_H */
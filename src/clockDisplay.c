@@ -26,6 +26,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "clockDisplay.h"
 #include "frameBuffer.h"
 #include "matrixDriver.h"
+#include "compositor.h"
 #include "debug.h"
 
 
@@ -38,8 +39,8 @@ typedef enum _eTimeUnits {
 
 
 // forward declarations
-void showCurrDigitalFace(uint32_t nFaceColor);
-void showCurrBinaryFace(uint32_t nFaceColor);
+void showDigitalFaceAt(time_t secs, uint32_t nFaceColor, uint64_t presentAtNsec);
+void showBinaryFaceAt(time_t secs, uint32_t nFaceColor, uint64_t presentAtNsec);
 void updateBinaryFace(eTimeUnits tmUnits, int tmValue, uint32_t nFaceColor);
 void placeTensUnits(int nValue, uint8_t locX, uint8_t locY, uint32_t nFaceColor);
 void placeBit(uint8_t bValue, uint8_t locX, uint8_t locY, uint32_t nFaceColor);
@@ -49,6 +50,7 @@ void destroy_timer(void);
 
 
 static pthread_t s_clockThread;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;   // held while a face is drawn
 static int s_bClockRunning;
 static uint32_t s_nFaceColor;
 static int s_nClockBufferNumber;
@@ -86,7 +88,10 @@ void stopClock(void)
 
     if(s_bClockRunning) {
         destroy_timer();
+        // a handler already started finishes its face before we return, any later one sees we stopped
+        pthread_mutex_lock(&mutex);
         s_bClockRunning = 0;  // show NOT running
+        pthread_mutex_unlock(&mutex);
     }
     else {
         warningMessage("stopClock() no clock running!");
@@ -98,26 +103,40 @@ int isClockRunning(void)
     return s_bClockRunning;
 }
 
+int clockBufferNumber(void)
+{
+    return (s_bClockRunning) ? s_nClockBufferNumber : 0;
+}
+
 // ============================================================================
 //
 
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-
 void handleTimerExpiration(union sigval arg)
 {
     int status;
+    struct timespec tsWallNow;
+
+    // we wake mid-second: render the face for the coming second and let the driver
+    //  present it exactly at that second boundary
+    clock_gettime(CLOCK_REALTIME, &tsWallNow);
+    uint64_t nNsecToNextSecond = 1000000000ULL - tsWallNow.tv_nsec;
+    uint64_t presentAtNsec = monotonicTimeNsec() + nNsecToNextSecond;
+    time_t nextSecond = tsWallNow.tv_sec + 1;
 
     status = pthread_mutex_lock(&mutex);
     if (status != 0) {
         errorMessage("handleTimerExpiration(): failed to Lock mutex error(%d)", status);
     }
 
-    // task code run on timer expire...
-    if(s_nClockType == CFT_BINARY) {
-        showCurrBinaryFace(s_nFaceColor);
+    // task code run on timer expire... (unless stopClock() beat us to the lock)
+    if(!s_bClockRunning) {
+        // stopped, draw nothing
+    }
+    else if(s_nClockType == CFT_BINARY) {
+        showBinaryFaceAt(nextSecond, s_nFaceColor, presentAtNsec);
     }
     else if(s_nClockType == CFT_DIGITAL) {
-        showCurrDigitalFace(s_nFaceColor);
+        showDigitalFaceAt(nextSecond, s_nFaceColor, presentAtNsec);
     }
 
     status = pthread_mutex_unlock(&mutex);
@@ -144,17 +163,20 @@ void create_timer(long mSeconds)
     se.sigev_notify_function = handleTimerExpiration;
     se.sigev_notify_attributes = NULL;
 
-    ts.it_value.tv_sec = nanosecs / 1000000000;
-    ts.it_value.tv_nsec = nanosecs % 1000000000;
-    ts.it_interval.tv_sec = ts.it_value.tv_sec;
-    ts.it_interval.tv_nsec = ts.it_value.tv_nsec;
+    ts.it_interval.tv_sec = nanosecs / 1000000000;
+    ts.it_interval.tv_nsec = nanosecs % 1000000000;
+
+    // first expiration at the next half-second so each face is queued well ahead of its second
+    clock_gettime(CLOCK_REALTIME, &ts.it_value);
+    ts.it_value.tv_sec += (ts.it_value.tv_nsec < 500000000) ? 0 : 1;
+    ts.it_value.tv_nsec = 500000000;
 
     status = timer_create(CLOCK_REALTIME, &se, &timer_id);
     if (status == -1) {
         perrorMessage("create_timer(): timer_create() failed");
     }
 
-    status = timer_settime(timer_id, 0, &ts, 0);
+    status = timer_settime(timer_id, TIMER_ABSTIME, &ts, 0);
     if (status == -1) {
         perrorMessage("create_timer(): timer_settime() failed");
     }
@@ -169,14 +191,8 @@ void destroy_timer(void)
 // ---------------------------------------------------------------------------
 // Clock Display Functions
 //
-void showCurrDigitalFace(uint32_t nFaceColor)
+void showDigitalFaceAt(time_t secs, uint32_t nFaceColor, uint64_t presentAtNsec)
 {
-    //
-    // get current time to the second
-    //
-    // get seconds since the Epoch
-    time_t secs = time(0);
-
     // convert to localtime
     struct tm *local = localtime(&secs);
 
@@ -191,10 +207,9 @@ void showCurrDigitalFace(uint32_t nFaceColor)
 
     writeStringToBufferPanelWithColorRGB(s_nClockBufferNumber, clockDigits, s_nClockPanelNumber, nFaceColor);
 
-    // now write buffer N contents to matrix itself
-    int nBufferSize = frameBufferSizeInBytes();
-    uint8_t *pCurrBuffer = (uint8_t *)ptrBuffer(s_nClockBufferNumber);
-    showBuffer(pCurrBuffer, nBufferSize);
+    // now queue buffer N contents for display at the top of its second
+    //  (when buffer N is a layer its composited output is shown instead)
+    showLayerBufferAt(s_nClockBufferNumber, presentAtNsec);
 }
 
 
@@ -241,14 +256,8 @@ struct _objLocnXY {
 
 static int bBarLight = 0;
 
-void showCurrBinaryFace(uint32_t nFaceColor)
+void showBinaryFaceAt(time_t secs, uint32_t nFaceColor, uint64_t presentAtNsec)
 {
-    //
-    // get current time to the second
-    //
-    // get seconds since the Epoch
-    time_t secs = time(0);
-
     // convert to localtime
     struct tm *local = localtime(&secs);
 
@@ -275,10 +284,9 @@ void showCurrBinaryFace(uint32_t nFaceColor)
     placeVertBar(locTable[OI_Bar_Left].X, locTable[OI_Bar_Left].Y);
     placeVertBar(locTable[OI_Bar_Right].X, locTable[OI_Bar_Right].Y);
 
-    // now write buffer N contents to matrix itself
-    int nBufferSize = frameBufferSizeInBytes();
-    uint8_t *pCurrBuffer = (uint8_t *)ptrBuffer(s_nClockBufferNumber);
-    showBuffer(pCurrBuffer, nBufferSize);
+    // now queue buffer N contents for display at the top of its second
+    //  (when buffer N is a layer its composited output is shown instead)
+    showLayerBufferAt(s_nClockBufferNumber, presentAtNsec);
 }
 
 
@@ -328,15 +336,24 @@ void placeTensUnits(int nValue, uint8_t locX, uint8_t locY, uint32_t nFaceColor)
 void placeBit(uint8_t bValue, uint8_t locX, uint8_t locY, uint32_t nFaceColor)
 {
     uint32_t nColor = (bValue == 0) ? 0x010101 : nFaceColor;
-    // set 4 LEDs 2x2 to same color (faceColor -OR- off)
-    setBufferLEDColor(s_nClockBufferNumber, nColor, locX, locY);
-    setBufferLEDColor(s_nClockBufferNumber, nColor, locX+1, locY);
-    setBufferLEDColor(s_nClockBufferNumber, nColor, locX, locY+1);
-    setBufferLEDColor(s_nClockBufferNumber, nColor, locX+1, locY+1);
+    struct _LedPixel *pClockBuffer = ptrBuffer(s_nClockBufferNumber);
+    if(pClockBuffer == NULL) {
+        return;
+    }
 #ifdef TWObyTHREE
-    setBufferLEDColor(s_nClockBufferNumber, nColor, locX, locY+2);
-    setBufferLEDColor(s_nClockBufferNumber, nColor, locX+1, locY+2);
+    int nRows = 3;
+#else
+    int nRows = 2;
 #endif
+    // set 4 LEDs 2x2 to same color (faceColor -OR- off) - layout may be smaller than face, clip
+    for(int nRow = 0; nRow < nRows; nRow++) {
+        for(int nColumn = 0; nColumn < 2; nColumn++) {
+            if(IS_ON_SCREEN(locX + nColumn, locY + nRow)) {
+                setLEDColorInBuffer(pClockBuffer, nColor, locX + nColumn, locY + nRow);
+            }
+        }
+    }
+    markBufferDirtyRect(s_nClockBufferNumber, locX, locY, 2, nRows);
 }
 
 
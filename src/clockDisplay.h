@@ -35,5 +35,7 @@ void runClock(eClockFaceTypes clockType, uint32_t nFaceColor, int nBufferNumber,
 
 void stopClock(void);
 int isClockRunning(void);
+// buffer clock draws into, 0 when not running
+int clockBufferNumber(void);
 
 #endif /* CLOCK_DISPLAY_H */
@@ -24,6 +24,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include <string.h> // strtok(), strxxxx()
 #include <ctype.h> // tolower(), isxdigit()
 #include <errno.h>
+#include <time.h> // clock_nanosleep()
 
 #include "commandProcessor.h"
 #include "debug.h"
@@ -32,6 +33,16 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "frameBuffer.h"
 #include "matrixDriver.h"
 #include "clockDisplay.h"
+#include "ticker.h"
+#include "frameArena.h"
+#include "drawContext.h"
+#include "bitmapFont.h"
+#include "glyphCache.h"
+#include "canvas.h"
+#include "paletteBuffer.h"
+#include "deepBuffer.h"
+#include "compositor.h"
+#include "present.h"
 
 
 // forward declarations
@@ -52,11 +63,13 @@ int stringHasPrefix(const char *str, const char *prefix);
 struct _bufferSpec *getBufferNumbersFromBufferSpec(const char *bufferSpec);
 int getValueOfColorSpec(const char *colorSpec);
 int getPanelNumberFromPanelSpec(const char *panelSpec);
+struct _DrawContext *drawContextForCurrentBuffer(void);
 int stringIsHexValue(const char *colorSpec);
 int isHexDigitsString(const char *posHexDigits);
 void combineTokens(char **tokens, int ltIdx, int rtIdx);
 char *strconcat(char *str1, char *str2);
 char *trimAndUncomment(char *strWithWhite);
+void stopLayoutRenderers(void);
 
 
 // ----------------------------------------------------------------------------
@@ -64,6 +77,8 @@ char *trimAndUncomment(char *strWithWhite);
 //
 static int s_nCurrentBufferIdx = 0;
 static FILE *s_fpCommandFile = NULL;
+static struct _DrawContext s_drawContext;
+static int s_bDrawContextReady = 0;
 
 int getlineIgnoringComments(char **lineptr, size_t *n, FILE *stream);
 
@@ -203,6 +218,7 @@ int commandHelp(int argc, const char *argv[]);
 int commandQuit(int argc, const char *argv[]);
 int commandLoadBmpFile(int argc, const char *argv[]);
 int commandAllocBuffers(int argc, const char *argv[]);
+int commandFreeBuffers(int argc, const char *argv[]);
 int commandSelectBuffer(int argc, const char *argv[]);
 int commandFillBuffer(int argc, const char *argv[]);
 int commandWriteBuffer(int argc, const char *argv[]);
@@ -212,6 +228,31 @@ int commandSetBorder(int argc, const char *argv[]);
 int commandColorToScreen(int argc, const char *argv[]);
 int commandStringToScreen(int argc, const char *argv[]);
 int commandLoadCmdFile(int argc, const char *argv[]);
+int commandFrameStats(int argc, const char *argv[]);
+int commandDirty(int argc, const char *argv[]);
+int commandShape(int argc, const char *argv[]);
+int commandCopyBuffer(int argc, const char *argv[]);
+int commandDefaultColor(int argc, const char *argv[]);
+int commandMoveTo(int argc, const char *argv[]);
+int commandLineTo(int argc, const char *argv[]);
+int commandFadeToBuffer(int argc, const char *argv[]);
+int commandMarquee(int argc, const char *argv[]);
+int commandScene(int argc, const char *argv[]);
+int commandStopProgram(int argc, const char *argv[]);
+int commandScreenshot(int argc, const char *argv[]);
+int commandLayout(int argc, const char *argv[]);
+int commandFont(int argc, const char *argv[]);
+int commandTicker(int argc, const char *argv[]);
+int commandCanvas(int argc, const char *argv[]);
+int commandCanvasDraw(int argc, const char *argv[]);
+int commandViewport(int argc, const char *argv[]);
+int commandIndexedBuffers(int argc, const char *argv[]);
+int commandPalette(int argc, const char *argv[]);
+int commandDeepBuffers(int argc, const char *argv[]);
+int commandLayer(int argc, const char *argv[]);
+int commandComposite(int argc, const char *argv[]);
+int commandPower(int argc, const char *argv[]);
+int commandCalibrate(int argc, const char *argv[]);
 
 struct _commandEntry {
     char *name;
@@ -220,27 +261,55 @@ struct _commandEntry {
     int   maxParamCount;
     int (*pCommandFunction)(int argc, const char *argv[]);
 } commands[] = {
-    { "buffers",     "buffers {numberOfBuffers} - allocate N buffers", 1, 1, &commandAllocBuffers },
+    { "buffers",     "buffers {numberOfBuffers|show} [lock|unlock] - allocate N buffers (lock: keep all in RAM)", 1, 2, &commandAllocBuffers },
     { "buffer",      "buffer {bufferNumber} - select buffer for next actions", 1, 1, &commandSelectBuffer },
     { "clear",       "clear {selectedBuffers} - where selected is [N, N-M, ., all]", 1, 1, &commandClearBuffer },
-    { "freebuffers", "freebuffers - release all buffers", 0, 0 },
+    { "freebuffers", "freebuffers - release all buffers but buffer 1 (which is cleared)", 0, 0, &commandFreeBuffers },
     // huh!  p[1-3|12,23], screen as new buffer types? which use current buffer and write directly to screen!
     { "screen",      "screen {fillcolor|clear} [{panelSpec}]  - clear(or fill) single panel or entire screen", 1, 2, &commandColorToScreen },
     { "string",      "string {selectedBuffers} {string} {lineColor} [{panelSpec}] - write string to screen w/wrap (or just single panel)", 3, 4, &commandStringToScreen },
     { "fill",        "fill {selectedBuffers} {fillColor} - where selected is [N, N-M, ., all] and color is [red, 0xffffff, all]", 2, 2, &commandFillBuffer },
     { "border",      "border {width} {borderColor} {panelSpec} [{indent}] - draw border of color", 3, 4, &commandSetBorder },
     { "clock",       "clock {clockType} [{faceColor} {panelNumber-digiOnly}]  - where type is [digital, binary, stop] and color is [red, 0xffffff]", 1, 3, &commandShowClock },
+    { "ticker",      "ticker {message|stop} [{lineColor} {columnsPerSec} {panelSpec} {effect}] - scroll message through current buffer, effect is [none, rainbow, fade]", 1, 5, &commandTicker },
     { "write",       "write {selectedBuffers} [{loopYN} {rate}] - where selected is [N, N-M, ., all]", 1, 3, &commandWriteBuffer },
-    { "square",      "square {boarderWidth} {height} {borderColor} {fillColor}", 3, 4 },
-    { "circle",      "circle {boarderWidth} {radius}  {borderColor} {fillColor}", 3, 4 },
-    { "triangle",    "triangle  {boarderWidth} {baseWidth-odd!}  {borderColor} {fillColor}", 3, 4 },
-    { "copy",        "copy {srcBufferNumber} {destBufferNumber} {shiftUpDownPix} {shiftLeftRightPix}", 4, 4 },
-    { "default",     "default [fill|line] {color} - set default colors for subsequent draw commands", 2, 2 },
-    { "moveto",      "moveto x y - move (pen) to X, Y", 2, 2 },
-    { "lineto",      "lineto x y [{lineColor}] - draw line from curr X,Y to new X,Y", 2, 3 },
+    { "square",      "square {borderWidth} {height} {borderColor} [{fillColor}] - square, top-left at pen (moveto)", 3, 4, &commandShape },
+    { "circle",      "circle {borderWidth} {radius} {borderColor} [{fillColor}] - circle, centered on pen (moveto)", 3, 4, &commandShape },
+    { "triangle",    "triangle {borderWidth} {baseWidth-odd!} {borderColor} [{fillColor}] - triangle, apex at pen (moveto)", 3, 4, &commandShape },
+    { "copy",        "copy {srcBufferNumber} {destBufferNumber} {shiftUpDownPix} {shiftLeftRightPix} [wrap|{fillColor}] - copy with shift (+down, +right), default wrap", 4, 5, &commandCopyBuffer },
+    { "default",     "default [fill|line] {color} - set default colors for subsequent draw commands", 2, 2, &commandDefaultColor },
+    { "moveto",      "moveto x y - move (pen) to X, Y", 2, 2, &commandMoveTo },
+    { "lineto",      "lineto x y [{lineColor}] [aa] - draw line from curr X,Y to new X,Y (aa: anti-aliased)", 2, 4, &commandLineTo },
     { "loadbmpfile", "loadbmpfile {bmpFileName} - load 24-bit bitmap into current buffer", 1, 1, &commandLoadBmpFile },
     { "loadscreensfile", "loadscreensfile {screenSetFileName} - sets NbrScreensLoaded, ensures sufficient buffers allocated, starting from current buffer", 1, 1 },
     { "loadcmdfile", "loadcmdfile {commandsFileName} - iterates over commands read from file, once.", 1, 1, &commandLoadCmdFile },
+    { "layout",      "layout {default|show|layoutFileName} - set panel layout (size, rotation, wiring, lanes) of screen", 1, 1, &commandLayout },
+    { "font",        "font {fontName|fontFileName|list|stats} - select font for strings (load .bdf/.psf font file first if given), stats: glyph/layout cache hits", 1, 1, &commandFont },
+    { "canvas",      "canvas {canvasNumber|show} [{width} {height}|free|{bmpFileName} [{x} {y}]] - create/free off-screen canvas, or load bitmap into it", 1, 4, &commandCanvas },
+    { "canvasstring", "canvasstring {canvasNumber} {x} {y} {string} {lineColor} - write string into canvas", 5, 5, &commandCanvasDraw },
+    { "canvaspaste", "canvaspaste {canvasNumber} {x} {y} - copy current buffer into canvas at X,Y", 3, 3, &commandCanvasDraw },
+    { "viewport",    "viewport {canvasNumber} {x} {y} [{toX} {toY} {durationMsec}] - show canvas window at X,Y (or pan to toX,toY)", 3, 6, &commandViewport },
+    { "ibuffers",    "ibuffers {numberOfIndexedBuffers|show} - allocate N indexed (palette) buffers", 1, 1, &commandIndexedBuffers },
+    { "iconvert",    "iconvert {bufferNumber} {indexedBufferNumber} - index colors of buffer (max 256) into indexed buffer", 2, 2, &commandIndexedBuffers },
+    { "iwrite",      "iwrite {indexedBufferNumber} - show indexed buffer through its palette", 1, 1, &commandIndexedBuffers },
+    { "palette",     "palette {indexedBufferNumber} {entry|cycle} {color|{firstEntry} {lastEntry} {stepMsec} {steps}} - set palette entry, or cycle entries showing each step", 3, 6, &commandPalette },
+    { "dbuffers",    "dbuffers {numberOfDeepBuffers|show} - allocate N deep (16 bit per channel) buffers", 1, 1, &commandDeepBuffers },
+    { "dload",       "dload {bufferNumber} {deepBufferNumber} - copy buffer into deep buffer", 2, 2, &commandDeepBuffers },
+    { "dwrite",      "dwrite {deepBufferNumber} [{dither}] - show deep buffer, dither is [none, ordered, temporal] (default temporal)", 1, 2, &commandDeepBuffers },
+    { "dfade",       "dfade {deepBufferNumber} {fromPercent} {toPercent} {durationMsec} [{dither}] - show deep buffer fading in brightness", 4, 5, &commandDeepBuffers },
+    { "dfill",       "dfill {deepBufferNumber} {fillColor} [{x} {y} {width} {height}] - fill deep buffer (or rect), color is [red, 0xffffff, 0xRRRRGGGGBBBB]", 2, 6, &commandDeepBuffers },
+    { "dmix",        "dmix {destDeepBufferNumber} {fromDeepBufferNumber} {toDeepBufferNumber} {percent} - dest = from blended toward to by percent", 4, 4, &commandDeepBuffers },
+    { "layer",       "layer {outputBufferNumber} {layerBufferNumber|show|clear} [{blend|remove} {opacityPercent} {maskBufferNumber|self}] - stack layer on output (bottom first), blend is [over, add, multiply]", 2, 5, &commandLayer },
+    { "composite",   "composite {outputBufferNumber} - rebuild changed parts of output from its layers and show it", 1, 1, &commandComposite },
+    { "fade",        "fade {bufferNumber} {durationMsec} [linear|gamma] - crossfade from screen to buffer (default gamma)", 2, 3, &commandFadeToBuffer },
+    { "marquee",     "marquee {bufferNumber} {stepMsec} [{columnsPerStep}] - driver scrolls buffer forever (+left, -right, default 1)", 2, 3, &commandMarquee },
+    { "scene",       "scene {selectedBuffers} {frameMsec} - driver loops buffers N-M (max 8) forever", 2, 2, &commandScene },
+    { "stopprogram", "stopprogram - stop driver marquee/scene", 0, 0, &commandStopProgram },
+    { "screenshot",  "screenshot {bufferNumber} - copy frame currently on screen into buffer", 1, 1, &commandScreenshot },
+    { "power",       "power {budgetMilliAmps|off|show|reset} [{milliAmpsPerChannel} {idleMicroAmpsPerLed} {volts}] - dim frames drawing more than budget, show estimated watts", 1, 4, &commandPower },
+    { "calibrate",   "calibrate {laneNumber|all|gamma|show} [{calibrationFileName|reset|gammaValue}] - per lane color calibration (LUTs, white balance, matrix) as frames are sent", 1, 2, &commandCalibrate },
+    { "framestats",  "framestats - show driver on-time/late/skipped counts for timed (queued) frames", 0, 0, &commandFrameStats },
+    { "dirty",       "dirty {selectedBuffers} [reset] - show area of buffers changed since last reset (or, for layers, last composite)", 1, 2, &commandDirty },
     { "helpcommands", "helpcommands - display list of available commands", 0, 0, &commandHelp },
     { "quit",         "quit - exit command processor", 0, 0, &commandQuit },
     { "exit",         "exit - exit command processor", 0, 0, &commandQuit },
@@ -492,6 +561,10 @@ int commandSetBorder(int argc, const char *argv[])
             int nBorderWidth = 32 - (2 * nIndentInPix);
             int nBorderHeight = 24 - (2 * nIndentInPix);
             drawSquareInBuffer(s_nCurrentBufferIdx+1, nOffsetX, nOffsetY, nPanelNumber, nBorderWidth, nBorderHeight, nLineWidthInPix, nLineColor);
+            // leave pen at top-left of border (of panel when one given)
+            int nPenPanel = (nPanelNumber == 12) ? 1 : (nPanelNumber == 23) ? 2 : nPanelNumber;
+            int nPenY = (nPenPanel != 0) ? (nPenPanel - 1) * ROWS_PER_PANEL : nOffsetY;
+            moveToInContext(drawContextForCurrentBuffer(), nOffsetX, nPenY);
         }
         else {
             errorMessage("[CODE]: bad param(s) - line width too small! (%d not in range [1-12])", nLineWidthInPix);
@@ -500,71 +573,1166 @@ int commandSetBorder(int argc, const char *argv[])
     return CMD_RET_SUCCESS;   // no errors
 }
 
+int commandShape(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   square {borderWidth} {height} {borderColor} [{fillColor}] - square, top-left at pen (moveto)
+    //   circle {borderWidth} {radius} {borderColor} [{fillColor}] - circle, centered on pen (moveto)
+    //   triangle {borderWidth} {baseWidth-odd!} {borderColor} [{fillColor}] - triangle, apex at pen (moveto)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandShape with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 3 || (argc - 1) > 4) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nBorderWidth = atoi(argv[1]);
+        int nSize = atoi(argv[2]);
+        uint32_t nBorderColor = getValueOfColorSpec(argv[3]);
+        int bFill = ((argc - 1) == 4);
+        uint32_t nFillColor = (bFill) ? getValueOfColorSpec(argv[4]) : 0x000000;
+        struct _DrawContext *pContext = drawContextForCurrentBuffer();
+        int nPenX = pContext->nPenX;
+        int nPenY = pContext->nPenY;
+        if(nBorderWidth < 0 || nBorderWidth > 12) {
+            errorMessage("Border width (%d) out-of-range: [0-12]", nBorderWidth);
+        }
+        else if(nSize < 1 || nSize > LAYOUT_MAX_WIDTH) {
+            errorMessage("Size (%d) out-of-range: [1-%d]", nSize, LAYOUT_MAX_WIDTH);
+        }
+        else if(nBorderWidth == 0 && !bFill) {
+            warningMessage("%s: no border and no fill color, nothing to draw", argv[0]);
+        }
+        else if(stricmp(argv[0], "square") == 0) {
+            drawRectInBuffer(s_nCurrentBufferIdx+1, nPenX, nPenY, nSize, nSize, nBorderWidth, nBorderColor, bFill, nFillColor);
+        }
+        else if(stricmp(argv[0], "circle") == 0) {
+            drawCircleInBuffer(s_nCurrentBufferIdx+1, nPenX, nPenY, nSize, nBorderWidth, nBorderColor, bFill, nFillColor);
+        }
+        else if((nSize & 0x01) == 0) {
+            errorMessage("Triangle base width (%d) must be odd", nSize);
+        }
+        else {
+            drawTriangleInBuffer(s_nCurrentBufferIdx+1, nPenX, nPenY, nSize, nBorderWidth, nBorderColor, bFill, nFillColor);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandCopyBuffer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   copy {srcBufferNumber} {destBufferNumber} {shiftUpDownPix} {shiftLeftRightPix} [wrap|{fillColor}] - copy with shift (+down, +right), default wrap
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandCopyBuffer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 4 || (argc - 1) > 5) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _bufferSpec *srcBufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        struct _bufferSpec *dstBufferSpec = getBufferNumbersFromBufferSpec(argv[2]);
+        int nShiftDown = atoi(argv[3]);
+        int nShiftRight = atoi(argv[4]);
+        eShiftEdge eEdge = SE_WRAP;
+        uint32_t nFillColor = 0x000000;
+        if((argc - 1) == 5 && stricmp(argv[5], "wrap") != 0) {
+            eEdge = SE_FILL;
+            nFillColor = getValueOfColorSpec(argv[5]);
+        }
+        if(srcBufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", srcBufferSpec->fmBufferNumber, srcBufferSpec->nMaxBuffers);
+        }
+        else if(dstBufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", dstBufferSpec->fmBufferNumber, dstBufferSpec->nMaxBuffers);
+        }
+        else {
+            copyBufferWithShift(srcBufferSpec->fmBufferNumber, dstBufferSpec->fmBufferNumber, nShiftDown, nShiftRight, eEdge, nFillColor);
+        }
+        free(srcBufferSpec);
+        free(dstBufferSpec);
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandDefaultColor(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   default [fill|line] {color} - set default colors for subsequent draw commands
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandDefaultColor with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 2) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _DrawContext *pContext = drawContextForCurrentBuffer();
+        uint32_t nColor = getValueOfColorSpec(argv[2]);
+        if(stricmp(argv[1], "line") == 0) {
+            pContext->nLineColor = nColor;
+        }
+        else if(stricmp(argv[1], "fill") == 0) {
+            pContext->nFillColor = nColor;
+        }
+        else {
+            errorMessage("bad param [%s] - expected fill or line", argv[1]);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandMoveTo(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   moveto x y - move (pen) to X, Y
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandMoveTo with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 2) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        moveToInContext(drawContextForCurrentBuffer(), atoi(argv[1]), atoi(argv[2]));
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandLineTo(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   lineto x y [{lineColor}] [aa] - draw line from curr X,Y to new X,Y (aa: anti-aliased)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandLineTo with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 < 2 || argc - 1 > 4) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _DrawContext *pContext = drawContextForCurrentBuffer();
+        uint32_t nDefaultLineColor = pContext->nLineColor;
+        // 'aa' is always last, color (if any) comes before it
+        int bAntiAliased = (argc - 1 > 2 && stricmp(argv[argc - 1], "aa") == 0);
+        int nColorArgs = (argc - 1) - 2 - bAntiAliased;
+        if(nColorArgs > 1) {
+            errorMessage("Expected [aa] after color, not [%s]", argv[argc - 1]);
+        }
+        else {
+            if(nColorArgs == 1) {
+                // color for just this line
+                pContext->nLineColor = getValueOfColorSpec(argv[3]);
+            }
+            if(bAntiAliased) {
+                lineToInContextAA(pContext, atoi(argv[1]), atoi(argv[2]));
+            }
+            else {
+                lineToInContext(pContext, atoi(argv[1]), atoi(argv[2]));
+            }
+            pContext->nLineColor = nDefaultLineColor;
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
 int commandShowClock(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   clock {clockType} [{faceColor} {panelNumber-digiOnly}]  - where type is [digital, binary, stop] and color is [red, 0xffffff]
+    //   clock {clockType} [{faceColor} {panelNumber-digiOnly}]  - where type is [digital, binary, stop] and color is [red, 0xffffff]
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandClearBuffer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 1 || (argc - 1) > 3) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        // which type of clock?
+        eClockFaceTypes clockType = CFT_Unknown;
+        if(stricmp(argv[1], "binary") == 0) {
+            clockType = CFT_BINARY;
+        }
+        else if(stricmp(argv[1], "digital") == 0) {
+             clockType = CFT_DIGITAL;
+        }
+        else if(stricmp(argv[1], "stop") == 0) {
+            clockType = CFT_NO_CLOCK;  // stop it if running
+        }
+        if(clockType == CFT_Unknown) {
+            errorMessage("Must specify type of clock face [digital|binary]");
+        }
+        else if(clockType == CFT_NO_CLOCK) {
+            // user just wants to stop the clock
+            if(isClockRunning()) {
+                stopClock();
+            }
+        }
+        else {
+            int nFaceColor = 0x808080;	// grey unless spec'd
+    	    if((argc - 1) > 1) {
+                nFaceColor = getValueOfColorSpec(argv[2]);
+    	    }
+            debugMessage("nFaceColor=(0x%.6X) clockType=[%s]",nFaceColor, argv[1]);
+            int nPanelNumber = 0;   // 0 = all panels
+            if((argc - 1) > 2) {
+                nPanelNumber = getPanelNumberFromPanelSpec(argv[3]);
+            }
+            debugMessage("nPanelNumber=(%d)",nPanelNumber);
+            // stop clock if already running
+            if(isClockRunning()) {
+                stopClock();
+            }
+            // run latest version selected
+            runClock(clockType, nFaceColor, s_nCurrentBufferIdx+1, nPanelNumber);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandTicker(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   ticker {message|stop} [{lineColor} {columnsPerSec} {panelSpec} {effect}] - scroll message through current buffer, effect is [none, rainbow, fade]
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandTicker with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 1 || (argc - 1) > 5) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        // stop ticker if already running
+        if(isTickerRunning()) {
+            stopTicker();
+        }
+        if(stricmp(argv[1], "stop") != 0) {
+            int nLineColor = 0x808080;	// grey unless spec'd
+            if((argc - 1) > 1) {
+                nLineColor = getValueOfColorSpec(argv[2]);
+            }
+            int nColumnsPerSec = 30;
+            if((argc - 1) > 2) {
+                nColumnsPerSec = atoi(argv[3]);
+            }
+            int nPanelNumber = 0;   // 0 = centered on screen
+            if((argc - 1) > 3) {
+                nPanelNumber = getPanelNumberFromPanelSpec(argv[4]);
+            }
+            eTickerEffect eEffect = TE_NONE;
+            if((argc - 1) > 4) {
+                if(stricmp(argv[5], "rainbow") == 0) {
+                    eEffect = TE_RAINBOW;
+                }
+                else if(stricmp(argv[5], "fade") == 0) {
+                    eEffect = TE_FADE_EDGES;
+                }
+                else if(stricmp(argv[5], "none") != 0) {
+                    errorMessage("ticker effect [%s] unknown: [must be none, rainbow or fade]", argv[5]);
+                    bValidCommand = 0;
+                }
+            }
+            debugMessage("nLineColor=(0x%.6X) nColumnsPerSec=(%d) nPanelNumber=(%d)", nLineColor, nColumnsPerSec, nPanelNumber);
+            if(nPanelNumber < 0) {
+               errorMessage("Panel (%d) out-of-range: [must be 1 >= N <= %d, 12, or 23]", nPanelNumber, NUMBER_OF_PANELS);
+            }
+            else if(bValidCommand) {
+                const char *cMessage = argv[1];
+                int nMessageLen = strlen(cMessage);
+                char *rwMessage = xstrdup((char *)cMessage);
+                if(nMessageLen > 2 && rwMessage[0] == '"' && rwMessage[nMessageLen-1] == '"') {
+                    rwMessage[nMessageLen-1] = 0x00;
+                    runTicker(&rwMessage[1], nLineColor, nColumnsPerSec, s_nCurrentBufferIdx+1, nPanelNumber, eEffect);
+                }
+                else {
+                    runTicker(rwMessage, nLineColor, nColumnsPerSec, s_nCurrentBufferIdx+1, nPanelNumber, eEffect);
+                }
+                free(rwMessage);
+            }
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandClearBuffer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   clear {selectedBuffers} - where selected is [N, N-M, ., all]
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandClearBuffer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 1) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        }
+        else {
+            int nFillColor = 0; // always clear to black
+            debugMessage("nFillColor=(0x%.6X)",nFillColor);
+            // now set fill color to selected buffers
+            for(int nBufferNumber = bufferSpec->fmBufferNumber; nBufferNumber <= bufferSpec->toBufferNumber; nBufferNumber++) {
+                fillBufferWithColorRGB(nBufferNumber, nFillColor);
+            }
+        }
+        free(bufferSpec);
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandWriteBuffer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   write {selectedBuffers} {loopYN} {rate} - where selected is [N, N-M, ., all]
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandWriteBuffer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc < 2 || argc > 4) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        // FIXME: UNDONE PARMS argv[2] and argv[3] are NOT YET IMPLEMENTED
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        }
+        else {
+            // now write buffer N contents to matrix itself
+            // FIXME: UNDONE - Handle range of buffers case
+            int nBufferSize = frameBufferSizeInBytes();
+            uint8_t *pCurrBuffer = (uint8_t *)ptrBuffer(bufferSpec->fmBufferNumber);
+            showBuffer(pCurrBuffer, nBufferSize);
+        }
+        free(bufferSpec);
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandFillBuffer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   fill {selectedBuffers} {fillColor} - where selected is [N, N-M, ., all] and color is [red, 0xffffff, all]
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandFillBuffer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 2) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        }
+        else {
+            int nFillColor = getValueOfColorSpec(argv[2]);
+            debugMessage("nFillColor=(0x%.6X)",nFillColor);
+            // now set fill color to selected buffers
+            for(int nBufferNumber = bufferSpec->fmBufferNumber; nBufferNumber <= bufferSpec->toBufferNumber; nBufferNumber++) {
+                fillBufferWithColorRGB(nBufferNumber, nFillColor);
+            }
+        }
+        free(bufferSpec);
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+
+int commandSelectBuffer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   buffer {bufferNumber} - select buffer for next actions
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandAllocBuffers with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 1) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nBufferNumber = atoi(argv[1]);
+        int nMaxBuffers = numberBuffers();
+        //debugMessage("alloc %d buffers...",nBuffers);
+        if(nBufferNumber < 1 || nBufferNumber > nMaxBuffers) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", nMaxBuffers);
+        }
+        else {
+            // set new current buffer for use by later commands
+            s_nCurrentBufferIdx = nBufferNumber - 1;
+            debugMessage("Selected buffer #%d", nBufferNumber);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandAllocBuffers(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   buffers {numberOfBuffers|show} [lock|unlock] - allocate N buffers (lock: keep all in RAM)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandAllocBuffers with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 < 1 || argc - 1 > 2) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 == 2 && stricmp(argv[2], "lock") != 0 && stricmp(argv[2], "unlock") != 0) {
+        errorMessage("bad param [%s] - expected lock or unlock", argv[2]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nBuffers = atoi(argv[1]);
+        //debugMessage("alloc %d buffers...",nBuffers);
+        if(stricmp(argv[1], "show") == 0) {
+            showFrameArena();
+        }
+        else if(nBuffers > 0) {
+            // ensure requested number of buffers are allocated
+            allocBuffers(nBuffers);
+        }
+        else {
+            errorMessage("[CODE]: bad call - param value [converts as 0: %s]", argv[1]);
+        }
+        if(argc - 1 == 2) {
+            lockFrameArena(stricmp(argv[2], "lock") == 0);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandFreeBuffers(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   freebuffers - release all buffers but buffer 1 (which is cleared)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandFreeBuffers with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 0) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        // render threads and layer stacks hold pointers into the frames we'd unmap
+        int nClockBuffer = clockBufferNumber();
+        int nTickerBuffer = tickerBufferNumber();
+        int nLayerBuffer = highestLayerBufferNumber();
+        if(nClockBuffer > 1) {
+            errorMessage("Clock draws into buffer %d, stop it before 'freebuffers'", nClockBuffer);
+        }
+        else if(nTickerBuffer > 1) {
+            errorMessage("Ticker scrolls through buffer %d, stop it before 'freebuffers'", nTickerBuffer);
+        }
+        else if(nLayerBuffer > 1) {
+            errorMessage("Layers use buffer %d, clear them ('layer {output} clear') before 'freebuffers'", nLayerBuffer);
+        }
+        else {
+            freeBuffers();
+            if(s_nCurrentBufferIdx != 0) {
+                s_nCurrentBufferIdx = 0;
+                infoMessage("buffer 1 now selected");
+            }
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandLoadBmpFile(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   loadbmpfile {bmpFileName} - load 24-bit bitmap into current buffer
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandLoadBmpFile with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 1) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        const char *fileSpec = argv[1];
+        if(!stringHasSuffix(fileSpec, ".bmp")) {
+            warningMessage("Invalid filetype [%s], expected [.bmp]", fileSpec);
+            bValidCommand = 0;
+        }
+        if(bValidCommand && !fileExists(fileSpec)) {
+            errorMessage("File [%s], NOT found!", fileSpec);
+            bValidCommand = 0;
+        }
+        if(bValidCommand) {
+            int nImageSize;
+            int nBufferSize = frameBufferSizeInBytes();
+            int nScreenSize = SCREEN_WIDTH * SCREEN_HEIGHT * BYTES_PER_LED;
+            if(loadImageFromFile(fileSpec, &nImageSize) == NULL) {
+                errorMessage("File [%s], failed to load!", fileSpec);
+            }
+            else if(nImageSize != nScreenSize) {
+                warningMessage("Filesize (%d bytes) incorrect for %dx%d matrix (%d bytes), display aborted!", nImageSize, SCREEN_WIDTH, SCREEN_HEIGHT, nScreenSize);
+            }
+            else {
+                uint8_t *pCurrBuffer = (uint8_t *)ptrBuffer(s_nCurrentBufferIdx + 1);
+                xlateLoadedImageIntoBuffer(pCurrBuffer, nBufferSize);
+                markBufferAllDirty(s_nCurrentBufferIdx + 1);
+            }
+        }
+    }
+
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandLayout(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   layout {default|show|layoutFileName} - set panel layout (size, rotation, wiring, lanes) of screen
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandLayout with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 1) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        const char *layoutSpec = argv[1];
+        if(stricmp(layoutSpec, "show") == 0) {
+            showPanelLayout();
+        }
+        else if(stricmp(layoutSpec, "default") == 0) {
+            stopLayoutRenderers();
+            restoreDefaultPanelLayout();
+            setFrameFormat(screenLayout.eFrameFormat);
+            clearBuffers();
+            showPanelLayout();
+        }
+        else if(!stringHasSuffix(layoutSpec, ".layout")) {
+            warningMessage("Invalid filetype [%s], expected [.layout]", layoutSpec);
+        }
+        else if(!fileExists(layoutSpec)) {
+            errorMessage("File [%s], NOT found!", layoutSpec);
+        }
+        else {
+            stopLayoutRenderers();
+            if(loadPanelLayoutFile(layoutSpec) == 0) {
+                // old pixel positions mean nothing in new layout
+                setFrameFormat(screenLayout.eFrameFormat);
+                clearBuffers();
+                showPanelLayout();
+            }
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandFont(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   font {fontName|fontFileName|list|stats} - select font for strings (load .bdf/.psf font file first if given), stats: glyph/layout cache hits
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandFont with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc - 1 != 1) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        const char *fontSpec = argv[1];
+        if(stricmp(fontSpec, "list") == 0) {
+            showFonts();
+        }
+        else if(stricmp(fontSpec, "stats") == 0) {
+            // caches are per thread, these are the ones our commands draw through
+            uint32_t nHits;
+            uint32_t nMisses;
+            getGlyphCacheStats(&nHits, &nMisses);
+            infoMessage("Glyph cache: %u hits, %u misses", nHits, nMisses);
+            getLayoutCacheStats(&nHits, &nMisses);
+            infoMessage("Layout cache: %u hits, %u misses", nHits, nMisses);
+        }
+        else if(stringHasSuffix(fontSpec, ".bdf") || stringHasSuffix(fontSpec, ".psf")) {
+            if(!fileExists(fontSpec)) {
+                errorMessage("File [%s], NOT found!", fontSpec);
+            }
+            else {
+                const struct _Font *pFont = loadFontFile(fontSpec);
+                if(pFont != NULL) {
+                    setDefaultFont(pFont->name);
+                }
+            }
+        }
+        else {
+            setDefaultFont(fontSpec);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+#define FADE_FRAME_PERIOD_MSEC 25   // a bit more than the 23 mSec to send 768 LEDs
+
+int commandFadeToBuffer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   fade {bufferNumber} {durationMsec} [linear|gamma] - crossfade from screen to buffer (default gamma)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandFadeToBuffer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if(argc < 3 || argc > 4) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        int nDurationMsec = atoi(argv[2]);
+        int bGammaAware = 1;
+        if(argc > 3) {
+            if(stricmp(argv[3], "linear") == 0) {
+                bGammaAware = 0;
+            }
+            else if(stricmp(argv[3], "gamma") != 0) {
+                errorMessage("fade type [%s] unknown: [must be linear or gamma]", argv[3]);
+                bValidCommand = 0;
+            }
+        }
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        }
+        else if(nDurationMsec < 0 || nDurationMsec > MAX_FADE_FRAMES * FADE_FRAME_PERIOD_MSEC) {
+           errorMessage("Duration (%d) out-of-range: [must be 0 >= N <= %d mSec]", nDurationMsec, MAX_FADE_FRAMES * FADE_FRAME_PERIOD_MSEC);
+        }
+        else if(bValidCommand) {
+            int nFadeFrames = nDurationMsec / FADE_FRAME_PERIOD_MSEC;
+            if(nFadeFrames < 1) {
+                nFadeFrames = 1;
+            }
+            showBufferFadeAt((uint8_t *)ptrBuffer(bufferSpec->fmBufferNumber), frameBufferSizeInBytes(), 0, nFadeFrames, FADE_FRAME_PERIOD_MSEC * 1000000, bGammaAware);
+        }
+        free(bufferSpec);
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandCanvas(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   canvas {canvasNumber|show} [{width} {height}|free|{bmpFileName} [{x} {y}]] - create/free canvas, or load bitmap into it (created at image size if needed)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandCanvas with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 1 || (argc - 1) > 4) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nCanvasNumber = atoi(argv[1]);
+        if(stricmp(argv[1], "show") == 0) {
+            showCanvases();
+        }
+        else if(nCanvasNumber < 1 || nCanvasNumber > CANVAS_MAX_CANVASES) {
+            errorMessage("Canvas (%d) out-of-range: [must be 1 >= N <= %d]", nCanvasNumber, CANVAS_MAX_CANVASES);
+        }
+        else if((argc - 1) == 1) {
+            warningMessage("canvas %d: expected {width} {height}, free or {bmpFileName}", nCanvasNumber);
+        }
+        else if(stricmp(argv[2], "free") == 0) {
+            freeCanvas(nCanvasNumber);
+        }
+        else if(stringHasSuffix(argv[2], ".bmp")) {
+            const char *fileSpec = argv[2];
+            int nLocX = ((argc - 1) > 2) ? atoi(argv[3]) : 0;
+            int nLocY = ((argc - 1) > 3) ? atoi(argv[4]) : 0;
+            if(!fileExists(fileSpec)) {
+                errorMessage("File [%s], NOT found!", fileSpec);
+            }
+            else if(loadImageFromFile(fileSpec, NULL) == NULL) {
+                errorMessage("File [%s], failed to load!", fileSpec);
+            }
+            else {
+                struct _Canvas *pCanvas = ptrCanvas(nCanvasNumber);
+                if(pCanvas == NULL) {
+                    int nImageWidth;
+                    int nImageHeight;
+                    getLoadedImageSize(&nImageWidth, &nImageHeight);
+                    pCanvas = createCanvas(nCanvasNumber, nLocX + nImageWidth, nLocY + nImageHeight);
+                }
+                if(pCanvas != NULL) {
+                    xlateLoadedImageIntoCanvas(pCanvas, nLocX, nLocY);
+                }
+            }
+        }
+        else if((argc - 1) == 3) {
+            createCanvas(nCanvasNumber, atoi(argv[2]), atoi(argv[3]));
+        }
+        else {
+            warningMessage("canvas %d: expected {width} {height}, free or {bmpFileName}", nCanvasNumber);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandCanvasDraw(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   canvasstring {canvasNumber} {x} {y} {string} {lineColor} - write string into canvas (current font)
+    //   canvaspaste {canvasNumber} {x} {y} - copy current buffer into canvas with its top-left at X,Y
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandCanvasDraw with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < commands[s_nCurrentCmdIdx].minParamCount || (argc - 1) > commands[s_nCurrentCmdIdx].maxParamCount) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nCanvasNumber = atoi(argv[1]);
+        int nLocX = atoi(argv[2]);
+        int nLocY = atoi(argv[3]);
+        struct _Canvas *pCanvas = NULL;
+        if(nCanvasNumber < 1 || nCanvasNumber > CANVAS_MAX_CANVASES) {
+            errorMessage("Canvas (%d) out-of-range: [must be 1 >= N <= %d]", nCanvasNumber, CANVAS_MAX_CANVASES);
+        }
+        else if((pCanvas = ptrCanvas(nCanvasNumber)) == NULL) {
+            errorMessage("Canvas (%d) not created: [use canvas %d {width} {height} first]", nCanvasNumber, nCanvasNumber);
+        }
+        else if(stricmp(argv[0], "canvaspaste") == 0) {
+            pasteBufferIntoCanvas(pCanvas, s_nCurrentBufferIdx+1, nLocX, nLocY);
+        }
+        else {
+            uint32_t nLineColor = getValueOfColorSpec(argv[5]);
+            const char *cString = argv[4];
+            int nStringLen = strlen(cString);
+            char *rwString = xstrdup((char *)cString);
+            if(nStringLen > 2 && rwString[0] == '"' && rwString[nStringLen-1] == '"') {
+                rwString[nStringLen-1] = 0x00;
+                drawStringInCanvas(pCanvas, getDefaultFont(), &rwString[1], nLocX, nLocY, nLineColor);
+            }
+            else {
+                drawStringInCanvas(pCanvas, getDefaultFont(), rwString, nLocX, nLocY, nLineColor);
+            }
+            free(rwString);
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandViewport(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   viewport {canvasNumber} {x} {y} [{toX} {toY} {durationMsec}] - show canvas window at X,Y via current buffer (or pan window to toX,toY)
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandViewport with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) != 3 && (argc - 1) != 6) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nCanvasNumber = atoi(argv[1]);
+        int nFromX = atoi(argv[2]);
+        int nFromY = atoi(argv[3]);
+        int nToX = nFromX;
+        int nToY = nFromY;
+        int nDurationMsec = 0;
+        if((argc - 1) == 6) {
+            nToX = atoi(argv[4]);
+            nToY = atoi(argv[5]);
+            nDurationMsec = atoi(argv[6]);
+        }
+        const struct _Canvas *pCanvas = NULL;
+        if(nCanvasNumber < 1 || nCanvasNumber > CANVAS_MAX_CANVASES) {
+            errorMessage("Canvas (%d) out-of-range: [must be 1 >= N <= %d]", nCanvasNumber, CANVAS_MAX_CANVASES);
+        }
+        else if((pCanvas = ptrCanvas(nCanvasNumber)) == NULL) {
+            errorMessage("Canvas (%d) not created: [use canvas %d {width} {height} first]", nCanvasNumber, nCanvasNumber);
+        }
+        else if(nDurationMsec < 0 || nDurationMsec > MAX_FADE_FRAMES * FADE_FRAME_PERIOD_MSEC) {
+           errorMessage("Duration (%d) out-of-range: [must be 0 >= N <= %d mSec]", nDurationMsec, MAX_FADE_FRAMES * FADE_FRAME_PERIOD_MSEC);
+        }
+        else {
+            // each pan frame is queued one frame period ahead of when it is shown
+            uint16_t nBufferNumber = s_nCurrentBufferIdx + 1;
+            uint8_t *pBuffer = (uint8_t *)ptrBuffer(nBufferNumber);
+            int nBufferSize = frameBufferSizeInBytes();
+            int nPanFrames = nDurationMsec / FADE_FRAME_PERIOD_MSEC;
+            uint64_t nFramePeriodNsec = FADE_FRAME_PERIOD_MSEC * 1000000ULL;
+            uint64_t presentAtNsec = monotonicTimeNsec() + nFramePeriodNsec;
+            for(int nFrame = (nPanFrames > 0) ? 1 : 0; nFrame <= nPanFrames; nFrame++) {
+                int nLocX = nToX;
+                int nLocY = nToY;
+                if(nFrame < nPanFrames) {
+                    nLocX = nFromX + (((nToX - nFromX) * nFrame) / nPanFrames);
+                    nLocY = nFromY + (((nToY - nFromY) * nFrame) / nPanFrames);
+                }
+                copyCanvasToBuffer(pCanvas, nLocX, nLocY, nBufferNumber);
+                if(nPanFrames == 0) {
+                    showBuffer(pBuffer, nBufferSize);
+                    break;
+                }
+                showBufferAt(pBuffer, nBufferSize, presentAtNsec);
+                struct timespec tsWakeAt = { .tv_sec = (presentAtNsec / 1000000000ULL), .tv_nsec = (presentAtNsec % 1000000000ULL) };
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tsWakeAt, NULL);
+                presentAtNsec += nFramePeriodNsec;
+            }
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandIndexedBuffers(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   ibuffers {numberOfIndexedBuffers|show} - allocate N indexed (palette) buffers
+    //   iconvert {bufferNumber} {indexedBufferNumber} - index colors of buffer (max 256) into indexed buffer
+    //   iwrite {indexedBufferNumber} - expand indexed buffer through its palette to screen
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandIndexedBuffers with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < commands[s_nCurrentCmdIdx].minParamCount || (argc - 1) > commands[s_nCurrentCmdIdx].maxParamCount) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        if(stricmp(argv[0], "ibuffers") == 0) {
+            if(stricmp(argv[1], "show") == 0) {
+                showIndexedBuffers();
+            }
+            else {
+                allocIndexedBuffers(atoi(argv[1]));
+            }
+        }
+        else if(stricmp(argv[0], "iconvert") == 0) {
+            struct _IndexedBuffer *pIndexed = ptrIndexedBuffer(atoi(argv[2]));
+            if(pIndexed != NULL) {
+                indexBufferColors(atoi(argv[1]), pIndexed);
+            }
+        }
+        else {
+            const struct _IndexedBuffer *pIndexed = ptrIndexedBuffer(atoi(argv[1]));
+            if(pIndexed != NULL) {
+                showIndexedBufferAt(pIndexed, 0);
+            }
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandPalette(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   palette {indexedBufferNumber} {entry} {color} - set palette entry [0-255]
+    //   palette {indexedBufferNumber} cycle {firstEntry} {lastEntry} {stepMsec} {steps} - rotate entries one step each stepMsec, showing each step
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandPalette with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) != 3 && (argc - 1) != 6) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        struct _IndexedBuffer *pIndexed = ptrIndexedBuffer(atoi(argv[1]));
+        if(pIndexed == NULL) {
+            // already reported
+        }
+        else if(stricmp(argv[2], "cycle") != 0) {
+            int nEntry = atoi(argv[2]);
+            if(nEntry < 0 || nEntry >= PALETTE_ENTRIES || (argc - 1) != 3) {
+                errorMessage("Palette entry (%d) out-of-range: [must be 0 >= N <= %d]", nEntry, PALETTE_ENTRIES - 1);
+            }
+            else {
+                setPaletteEntry(pIndexed, nEntry, getValueOfColorSpec(argv[3]));
+            }
+        }
+        else if((argc - 1) != 6) {
+            errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        }
+        else {
+            int nFirstEntry = atoi(argv[3]);
+            int nLastEntry = atoi(argv[4]);
+            int nStepMsec = atoi(argv[5]);
+            int nSteps = atoi(argv[6]);
+            if(nFirstEntry < 0 || nLastEntry >= PALETTE_ENTRIES || nLastEntry <= nFirstEntry) {
+                errorMessage("Palette entries (%d-%d) out-of-range: [must be 0 >= first < last <= %d]", nFirstEntry, nLastEntry, PALETTE_ENTRIES - 1);
+            }
+            else if(nStepMsec < 1 || nSteps < 1) {
+                errorMessage("Cycle (%d mSec x %d steps) out-of-range: [must be 1 >= N]", nStepMsec, nSteps);
+            }
+            else {
+                // each step is one palette rotate (no redraw), queued one step ahead of when it is shown
+                uint64_t nStepNsec = nStepMsec * 1000000ULL;
+                uint64_t presentAtNsec = monotonicTimeNsec() + nStepNsec;
+                for(int nStep = 0; nStep < nSteps; nStep++) {
+                    rotatePalette(pIndexed, nFirstEntry, nLastEntry, 1);
+                    showIndexedBufferAt(pIndexed, presentAtNsec);
+                    struct timespec tsWakeAt = { .tv_sec = (presentAtNsec / 1000000000ULL), .tv_nsec = (presentAtNsec % 1000000000ULL) };
+                    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tsWakeAt, NULL);
+                    presentAtNsec += nStepNsec;
+                }
+            }
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandDeepBuffers(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   dbuffers {numberOfDeepBuffers|show} - allocate N deep (16 bit per channel) buffers
+    //   dload {bufferNumber} {deepBufferNumber} - copy buffer into deep buffer
+    //   dwrite {deepBufferNumber} [{dither}] - show deep buffer, dither is [none, ordered, temporal] (default temporal)
+    //   dfade {deepBufferNumber} {fromPercent} {toPercent} {durationMsec} [{dither}] - show deep buffer fading in brightness
+    //   dfill {deepBufferNumber} {fillColor} [{x} {y} {width} {height}] - fill deep buffer (or rect), color is [red, 0xffffff, 0xRRRRGGGGBBBB]
+    //   dmix {destDeepBufferNumber} {fromDeepBufferNumber} {toDeepBufferNumber} {percent} - dest = from blended toward to by percent
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandClearBuffer with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandDeepBuffers with command [%s]", argv[0]);
         bValidCommand = 0;
     }
-    else if((argc - 1) < 1 || (argc - 1) > 3) {
+    else if((argc - 1) < commands[s_nCurrentCmdIdx].minParamCount || (argc - 1) > commands[s_nCurrentCmdIdx].maxParamCount) {
         errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
         bValidCommand = 0;
     }
     if(bValidCommand) {
-        // which type of clock?
-        eClockFaceTypes clockType = CFT_Unknown;
-        if(stricmp(argv[1], "binary") == 0) {
-            clockType = CFT_BINARY;
+        if(stricmp(argv[0], "dbuffers") == 0) {
+            if(stricmp(argv[1], "show") == 0) {
+                showDeepBuffers();
+            }
+            else {
+                allocDeepBuffers(atoi(argv[1]));
+            }
         }
-        else if(stricmp(argv[1], "digital") == 0) {
-             clockType = CFT_DIGITAL;
+        else if(stricmp(argv[0], "dload") == 0) {
+            struct _DeepBuffer *pDeep = ptrDeepBuffer(atoi(argv[2]));
+            if(pDeep != NULL) {
+                loadDeepBufferFromBuffer(pDeep, atoi(argv[1]));
+            }
         }
-        else if(stricmp(argv[1], "stop") == 0) {
-            clockType = CFT_NO_CLOCK;  // stop it if running
+        else if(stricmp(argv[0], "dfill") == 0) {
+            struct _DeepBuffer *pDeep = ptrDeepBuffer(atoi(argv[1]));
+            uint64_t nColorRGB48;
+            const char *colorSpec = argv[2];
+            if(stringHasPrefix(colorSpec, "0x") && strlen(colorSpec) == 14 && isHexDigitsString(&colorSpec[2])) {
+                // full 16 bits per channel
+                nColorRGB48 = strtoull(&colorSpec[2], NULL, 16);
+            }
+            else {
+                // 8 bits per channel: 0xff -> 0xffff
+                uint32_t nColorRGB = getValueOfColorSpec(colorSpec);
+                nColorRGB48 = ((uint64_t)((nColorRGB >> 16) & 0xff) * 0x0101) << 32 |
+                              ((uint64_t)((nColorRGB >> 8) & 0xff) * 0x0101) << 16 |
+                              ((uint64_t)(nColorRGB & 0xff) * 0x0101);
+            }
+            if(argc - 1 != 2 && argc - 1 != 6) {
+                errorMessage("Expected {x} {y} {width} {height} after color, or none for whole screen");
+            }
+            else if(pDeep != NULL) {
+                if(argc - 1 == 6) {
+                    fillDeepRect(pDeep, atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]), nColorRGB48);
+                }
+                else {
+                    fillDeepRect(pDeep, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, nColorRGB48);
+                }
+            }
         }
-        if(clockType == CFT_Unknown) {
-            errorMessage("Must specify type of clock face [digital|binary]");
+        else if(stricmp(argv[0], "dmix") == 0) {
+            struct _DeepBuffer *pDest = ptrDeepBuffer(atoi(argv[1]));
+            struct _DeepBuffer *pFrom = ptrDeepBuffer(atoi(argv[2]));
+            struct _DeepBuffer *pTo = ptrDeepBuffer(atoi(argv[3]));
+            double fPercent = atof(argv[4]);
+            if(fPercent < 0.0 || fPercent > 100.0) {
+                errorMessage("Percent (%.2f) out-of-range: [must be 0 >= N <= 100]", fPercent);
+            }
+            else if(pDest != NULL && pFrom != NULL && pTo != NULL) {
+                mixDeepBuffers(pDest, pFrom, pTo, (uint32_t)((fPercent * DEEP_LEVEL_FULL) / 100.0));
+            }
         }
-        else if(clockType == CFT_NO_CLOCK) {
-            // user just wants to stop the clock
-            if(isClockRunning()) {
-                stopClock();
+        else {
+            struct _DeepBuffer *pDeep = ptrDeepBuffer(atoi(argv[1]));
+            int nDitherArgIdx = (stricmp(argv[0], "dwrite") == 0) ? 2 : 5;
+            eDitherMode eDither = DM_TEMPORAL;
+            if(argc > nDitherArgIdx) {
+                if(stricmp(argv[nDitherArgIdx], "none") == 0) {
+                    eDither = DM_NONE;
+                }
+                else if(stricmp(argv[nDitherArgIdx], "ordered") == 0) {
+                    eDither = DM_ORDERED;
+                }
+                else if(stricmp(argv[nDitherArgIdx], "temporal") != 0) {
+                    errorMessage("dither [%s] unknown: [must be none, ordered or temporal]", argv[nDitherArgIdx]);
+                    bValidCommand = 0;
+                }
+            }
+            if(pDeep == NULL || !bValidCommand) {
+                // already reported
+            }
+            else if(nDitherArgIdx == 2) {
+                showDeepBufferAt(pDeep, DEEP_LEVEL_FULL, eDither, 0);
+            }
+            else {
+                double fFromPercent = atof(argv[2]);
+                double fToPercent = atof(argv[3]);
+                int nDurationMsec = atoi(argv[4]);
+                if(fFromPercent < 0.0 || fFromPercent > 100.0 || fToPercent < 0.0 || fToPercent > 100.0) {
+                    errorMessage("Brightness (%.2f-%.2f%%) out-of-range: [must be 0 >= N <= 100]", fFromPercent, fToPercent);
+                }
+                else if(nDurationMsec < 0 || nDurationMsec > MAX_FADE_FRAMES * FADE_FRAME_PERIOD_MSEC) {
+                    errorMessage("Duration (%d) out-of-range: [must be 0 >= N <= %d mSec]", nDurationMsec, MAX_FADE_FRAMES * FADE_FRAME_PERIOD_MSEC);
+                }
+                else {
+                    // each frame is scaled and dithered from the deep buffer, queued one frame period ahead of when it is shown
+                    int nFadeFrames = nDurationMsec / FADE_FRAME_PERIOD_MSEC;
+                    if(nFadeFrames < 1) {
+                        nFadeFrames = 1;
+                    }
+                    uint64_t nFramePeriodNsec = FADE_FRAME_PERIOD_MSEC * 1000000ULL;
+                    uint64_t presentAtNsec = monotonicTimeNsec() + nFramePeriodNsec;
+                    for(int nFrame = 1; nFrame <= nFadeFrames; nFrame++) {
+                        double fPercent = fFromPercent + (((fToPercent - fFromPercent) * nFrame) / nFadeFrames);
+                        showDeepBufferAt(pDeep, (uint32_t)((fPercent * DEEP_LEVEL_FULL) / 100.0), eDither, presentAtNsec);
+                        struct timespec tsWakeAt = { .tv_sec = (presentAtNsec / 1000000000ULL), .tv_nsec = (presentAtNsec % 1000000000ULL) };
+                        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tsWakeAt, NULL);
+                        presentAtNsec += nFramePeriodNsec;
+                    }
+                }
             }
         }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandLayer(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   layer {outputBufferNumber} {layerBufferNumber|show|clear} [{blend|remove} {opacityPercent} {maskBufferNumber|self}] - stack layer on output, blend is [over, add, multiply]
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandLayer with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 2 || (argc - 1) > 5) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        int nOutputBufferNumber = atoi(argv[1]);
+        int nLayerBufferNumber = atoi(argv[2]);
+        if(stricmp(argv[2], "show") == 0) {
+            showLayers(nOutputBufferNumber);
+        }
+        else if(stricmp(argv[2], "clear") == 0) {
+            clearLayers(nOutputBufferNumber);
+        }
+        else if((argc - 1) > 2 && stricmp(argv[3], "remove") == 0) {
+            removeLayer(nOutputBufferNumber, nLayerBufferNumber);
+        }
         else {
-            int nFaceColor = 0x808080;	// grey unless spec'd
-    	    if((argc - 1) > 1) {
-                nFaceColor = getValueOfColorSpec(argv[2]);
-    	    }
-            debugMessage("nFaceColor=(0x%.6X) clockType=[%s]",nFaceColor, argv[1]);
-            int nPanelNumber = 0;   // 0 = all panels
+            eBlendMode eBlend = BM_OVER;
+            int nOpacityPercent = 100;
+            int nMaskBufferNumber = 0;
             if((argc - 1) > 2) {
-                nPanelNumber = getPanelNumberFromPanelSpec(argv[3]);
+                if(stricmp(argv[3], "add") == 0) {
+                    eBlend = BM_ADD;
+                }
+                else if(stricmp(argv[3], "multiply") == 0) {
+                    eBlend = BM_MULTIPLY;
+                }
+                else if(stricmp(argv[3], "over") != 0) {
+                    errorMessage("blend [%s] unknown: [must be over, add or multiply]", argv[3]);
+                    bValidCommand = 0;
+                }
             }
-            debugMessage("nPanelNumber=(%d)",nPanelNumber);
-            // stop clock if already running
-            if(isClockRunning()) {
-                stopClock();
+            if((argc - 1) > 3) {
+                nOpacityPercent = atoi(argv[4]);
+            }
+            if((argc - 1) > 4) {
+                nMaskBufferNumber = (stricmp(argv[5], "self") == 0) ? nLayerBufferNumber : atoi(argv[5]);
+            }
+            if(nOpacityPercent < 0 || nOpacityPercent > 100) {
+                errorMessage("Opacity (%d%%) out-of-range: [must be 0 >= N <= 100]", nOpacityPercent);
+            }
+            else if(bValidCommand) {
+                setLayer(nOutputBufferNumber, nLayerBufferNumber, eBlend, ((nOpacityPercent * 255) + 50) / 100, nMaskBufferNumber);
             }
-            // run latest version selected
-            runClock(clockType, nFaceColor, s_nCurrentBufferIdx+1, nPanelNumber);
         }
     }
     return CMD_RET_SUCCESS;   // no errors
 }
 
-int commandClearBuffer(int argc, const char *argv[])
+int commandComposite(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   clear {selectedBuffers} - where selected is [N, N-M, ., all]
+    //   composite {outputBufferNumber} - rebuild changed parts of output from its layers and show it
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandClearBuffer with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandComposite with command [%s]", argv[0]);
         bValidCommand = 0;
     }
     else if(argc - 1 != 1) {
@@ -572,124 +1740,249 @@ int commandClearBuffer(int argc, const char *argv[])
         bValidCommand = 0;
     }
     if(bValidCommand) {
-        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
-        if(bufferSpec->fmBufferNumber < 1) {
-           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        int nOutputBufferNumber = atoi(argv[1]);
+        int nLedsRebuilt = compositeLayers(nOutputBufferNumber);
+        if(nLedsRebuilt >= 0) {
+            debugMessage("composite buffer %d: %d LEDs rebuilt", nOutputBufferNumber, nLedsRebuilt);
+            showBuffer((uint8_t *)ptrBuffer(nOutputBufferNumber), frameBufferSizeInBytes());
+        }
+    }
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandPower(int argc, const char *argv[])
+{
+    int bValidCommand = 1;
+
+    // IMPLEMENT:
+    //   power {budgetMilliAmps|off|show|reset} [{milliAmpsPerChannel} {idleMicroAmpsPerLed} {volts}] - dim frames that would draw more than budget, show estimated watts
+    if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
+        errorMessage("[CODE]: bad call commandPower with command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    else if((argc - 1) < 1 || (argc - 1) > 4) {
+        errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        bValidCommand = 0;
+    }
+    if(bValidCommand) {
+        if(stricmp(argv[1], "show") == 0) {
+            showPresentStats();
+        }
+        else if(stricmp(argv[1], "reset") == 0) {
+            resetPresentStats();
         }
         else {
-            int nFillColor = 0; // always clear to black
-            debugMessage("nFillColor=(0x%.6X)",nFillColor);
-            // now set fill color to selected buffer
-            // FIXME: UNDONE - Handle range of buffers case
-            fillBufferWithColorRGB(bufferSpec->fmBufferNumber, nFillColor);
+            struct _PowerConfig config;
+            getPowerConfig(&config);
+            int nBudgetMilliAmps = (stricmp(argv[1], "off") == 0) ? 0 : atoi(argv[1]);
+            // signed until checked, negative values must not wrap into huge unsigned settings
+            int nMilliAmpsPerChannel = ((argc - 1) > 1) ? atoi(argv[2]) : (int)config.nMilliAmpsPerChannel;
+            int nIdleMicroAmpsPerLed = ((argc - 1) > 2) ? atoi(argv[3]) : (int)config.nIdleMicroAmpsPerLed;
+            double fVolts = ((argc - 1) > 3) ? atof(argv[4]) : config.nMilliVolts / 1000.0;
+            if(nBudgetMilliAmps < 0 || (nBudgetMilliAmps == 0 && stricmp(argv[1], "off") != 0)) {
+                errorMessage("Budget [%s] out-of-range: [must be mA > 0, or off]", argv[1]);
+            }
+            else if(nMilliAmpsPerChannel < 1 || nMilliAmpsPerChannel > POWER_MAX_MILLIAMPS_PER_CHANNEL) {
+                errorMessage("mA per channel (%d) out-of-range: [must be 1 >= N <= %d]", nMilliAmpsPerChannel, POWER_MAX_MILLIAMPS_PER_CHANNEL);
+            }
+            else if(nIdleMicroAmpsPerLed < 0 || nIdleMicroAmpsPerLed > POWER_MAX_IDLE_MICROAMPS_PER_LED) {
+                errorMessage("Idle uA per LED (%d) out-of-range: [must be 0 >= N <= %d]", nIdleMicroAmpsPerLed, POWER_MAX_IDLE_MICROAMPS_PER_LED);
+            }
+            else if(fVolts < 0.001 || fVolts > POWER_MAX_MILLIVOLTS / 1000.0) {
+                errorMessage("Volts (%.2f) out-of-range: [must be 0.0 < N <= %.1f]", fVolts, POWER_MAX_MILLIVOLTS / 1000.0);
+            }
+            else {
+                config.nMilliAmpsPerChannel = nMilliAmpsPerChannel;
+                config.nIdleMicroAmpsPerLed = nIdleMicroAmpsPerLed;
+                config.nMilliVolts = (uint32_t)((fVolts * 1000.0) + 0.5);
+                config.nBudgetMilliAmps = nBudgetMilliAmps;
+                setPowerConfig(&config);
+                showPresentStats();
+            }
         }
-        free(bufferSpec);
     }
     return CMD_RET_SUCCESS;   // no errors
 }
 
-int commandWriteBuffer(int argc, const char *argv[])
+int commandCalibrate(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   write {selectedBuffers} {loopYN} {rate} - where selected is [N, N-M, ., all]
+    //   calibrate {laneNumber|all|gamma|show} [{calibrationFileName|reset|gammaValue}] - per lane color calibration applied as frames are sent
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandWriteBuffer with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandCalibrate with command [%s]", argv[0]);
         bValidCommand = 0;
     }
-    else if(argc < 2 || argc > 4) {
+    else if((argc - 1) < 1 || (argc - 1) > 2) {
         errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
         bValidCommand = 0;
     }
     if(bValidCommand) {
-        // FIXME: UNDONE PARMS argv[2] and argv[3] are NOT YET IMPLEMENTED
-        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
-        if(bufferSpec->fmBufferNumber < 1) {
-           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        if(stricmp(argv[1], "show") == 0) {
+            showCalibration();
+        }
+        else if((argc - 1) != 2) {
+            errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
+        }
+        else if(stricmp(argv[1], "gamma") == 0) {
+            double fGamma = atof(argv[2]);
+            if(fGamma < 0.25 || fGamma > 4.0) {
+                errorMessage("Gamma (%.2f) out-of-range: [must be 0.25 >= N <= 4.0]", fGamma);
+            }
+            else {
+                setPresentGamma(fGamma);
+            }
         }
         else {
-            // now write buffer N contents to matrix itself
-            // FIXME: UNDONE - Handle range of buffers case
-            int nBufferSize = frameBufferSizeInBytes();
-            uint8_t *pCurrBuffer = (uint8_t *)ptrBuffer(bufferSpec->fmBufferNumber);
-            showBuffer(pCurrBuffer, nBufferSize);
+            int nFirstLane = 0;
+            int nLastLane = LAYOUT_MAX_LANES - 1;
+            if(stricmp(argv[1], "all") != 0) {
+                nFirstLane = nLastLane = atoi(argv[1]);
+            }
+            if(nFirstLane < 0 || nLastLane >= LAYOUT_MAX_LANES || (nFirstLane == 0 && stricmp(argv[1], "all") != 0 && strcmp(argv[1], "0") != 0)) {
+                errorMessage("Lane [%s] out-of-range: [must be 0 >= N <= %d, or all]", argv[1], LAYOUT_MAX_LANES - 1);
+            }
+            else if(stricmp(argv[2], "reset") == 0) {
+                for(int nLane = nFirstLane; nLane <= nLastLane; nLane++) {
+                    resetCalibration(nLane);
+                }
+            }
+            else if(!fileExists(argv[2])) {
+                errorMessage("File [%s], NOT found!", argv[2]);
+            }
+            else if(isScrollProgramRunning()) {
+                // marquee frame was loaded uncalibrated and driver scrolls it across lanes
+                errorMessage("Lane calibration can't follow a driver marquee across lanes (use 'stopprogram' first)");
+            }
+            else {
+                for(int nLane = nFirstLane; nLane <= nLastLane; nLane++) {
+                    if(loadCalibrationFile(nLane, argv[2]) != 0) {
+                        break;
+                    }
+                }
+            }
         }
-        free(bufferSpec);
     }
     return CMD_RET_SUCCESS;   // no errors
 }
 
-int commandFillBuffer(int argc, const char *argv[])
+int commandMarquee(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   fill {selectedBuffers} {fillColor} - where selected is [N, N-M, ., all] and color is [red, 0xffffff, all]
+    //   marquee {bufferNumber} {stepMsec} [{columnsPerStep}] - driver scrolls buffer forever (+left, -right, default 1)
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandFillBuffer with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandMarquee with command [%s]", argv[0]);
         bValidCommand = 0;
     }
-    else if(argc - 1 != 2) {
+    else if(argc < 3 || argc > 4) {
         errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
         bValidCommand = 0;
     }
     if(bValidCommand) {
         struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        int nStepMsec = atoi(argv[2]);
+        int nColumnsPerStep = (argc > 3) ? atoi(argv[3]) : 1;
         if(bufferSpec->fmBufferNumber < 1) {
            errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
         }
+        else if(bufferSpec->toBufferNumber != bufferSpec->fmBufferNumber) {
+           errorMessage("Marquee scrolls a single buffer, not [%s]", argv[1]);
+        }
+        else if(nStepMsec < 1 || nStepMsec > 60000) {
+           errorMessage("Step (%d) out-of-range: [must be 1 >= N <= 60000 mSec]", nStepMsec);
+        }
+        else if(nColumnsPerStep <= -32 || nColumnsPerStep >= 32) {
+           errorMessage("Columns (%d) out-of-range: [must be -32 < N < 32]", nColumnsPerStep);
+        }
+        else if(!layoutSupportsDriverScroll()) {
+           errorMessage("Driver scroll needs our default 3 x (32x8) panel wiring, not the loaded layout (use 'layout default')");
+        }
+        else if(isLaneCalibrated()) {
+           // lane LUTs are baked into the frame but driver scrolls its pixels onto other lanes
+           errorMessage("Driver scroll moves pixels across lanes, lane calibration can't follow them (use 'calibrate all reset')");
+        }
         else {
-            int nFillColor = getValueOfColorSpec(argv[2]);
-            debugMessage("nFillColor=(0x%.6X)",nFillColor);
-            // now set fill color to selected buffer
-            // FIXME: UNDONE - Handle range of buffers case
-            fillBufferWithColorRGB(bufferSpec->fmBufferNumber, nFillColor);
+            // driver won't reload frames under a running program
+            stopProgram();
+            if(loadProgramFrame(0, (uint8_t *)ptrBuffer(bufferSpec->fmBufferNumber), frameBufferSizeInBytes()) == 0) {
+                runMarqueeProgram(nStepMsec, nColumnsPerStep);
+            }
         }
         free(bufferSpec);
     }
     return CMD_RET_SUCCESS;   // no errors
 }
 
-
-int commandSelectBuffer(int argc, const char *argv[])
+int commandScene(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   buffer {bufferNumber} - select buffer for next actions
+    //   scene {selectedBuffers} {frameMsec} - driver loops buffers N-M (max 8) forever
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandAllocBuffers with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandScene with command [%s]", argv[0]);
         bValidCommand = 0;
     }
-    else if(argc - 1 != 1) {
+    else if(argc - 1 != 2) {
         errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
         bValidCommand = 0;
     }
     if(bValidCommand) {
-        int nBufferNumber = atoi(argv[1]);
-        int nMaxBuffers = numberBuffers();
-        //debugMessage("alloc %d buffers...",nBuffers);
-        if(nBufferNumber < 1 || nBufferNumber > nMaxBuffers) {
-           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", nMaxBuffers);
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        int nFrameMsec = atoi(argv[2]);
+        int nFrameCount = bufferSpec->toBufferNumber - bufferSpec->fmBufferNumber + 1;
+        // spec parser falls back to just N for a backwards N-M, scene must get all it asked for
+        const char *rangeEnd = strchr(argv[1], '-');
+        int nRequestedCount = (rangeEnd != NULL) ? atoi(&rangeEnd[1]) - atoi(argv[1]) + 1 : nFrameCount;
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
+        }
+        else if(nFrameCount != nRequestedCount) {
+           errorMessage("Buffers [%s] don't make a scene: [must be N-M with N <= M]", argv[1]);
+        }
+        else if(nFrameCount < 1 || nFrameCount > MAX_PROGRAM_FRAMES) {
+           errorMessage("Buffer count (%d) out-of-range: [must be 1 >= N <= %d]", nFrameCount, MAX_PROGRAM_FRAMES);
+        }
+        else if(nFrameMsec < 1 || nFrameMsec > 60000) {
+           errorMessage("Frame time (%d) out-of-range: [must be 1 >= N <= 60000 mSec]", nFrameMsec);
         }
         else {
-            // set new current buffer for use by later commands
-            s_nCurrentBufferIdx = nBufferNumber - 1;
-            debugMessage("Selected buffer #%d", nBufferNumber);
+            // driver won't reload frames under a running program
+            stopProgram();
+            int nFrameIdx;
+            for(nFrameIdx = 0; nFrameIdx < nFrameCount; nFrameIdx++) {
+                if(loadProgramFrame(nFrameIdx, (uint8_t *)ptrBuffer(bufferSpec->fmBufferNumber + nFrameIdx), frameBufferSizeInBytes()) != 0) {
+                    break;
+                }
+            }
+            if(nFrameIdx == nFrameCount) {
+                runSceneProgram(nFrameCount, nFrameMsec);
+            }
         }
+        free(bufferSpec);
     }
     return CMD_RET_SUCCESS;   // no errors
 }
 
-int commandAllocBuffers(int argc, const char *argv[])
+int commandStopProgram(int argc, const char *argv[])
+{
+    // IMPLEMENT:
+    //   stopprogram - stop driver marquee/scene
+    stopProgram();
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandScreenshot(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   buffers {numberOfBuffers} - allocate N buffers
+    //   screenshot {bufferNumber} - copy frame currently on screen into buffer
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandAllocBuffers with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandScreenshot with command [%s]", argv[0]);
         bValidCommand = 0;
     }
     else if(argc - 1 != 1) {
@@ -697,57 +1990,83 @@ int commandAllocBuffers(int argc, const char *argv[])
         bValidCommand = 0;
     }
     if(bValidCommand) {
-        int nBuffers = atoi(argv[1]);
-        //debugMessage("alloc %d buffers...",nBuffers);
-        if(nBuffers > 0) {
-            // ensure requested number of buffers are allocated
-            allocBuffers(nBuffers);
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        uint32_t nFrameSequence;
+        uint64_t nTransmitNsec;
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
         }
-        else {
-            errorMessage("[CODE]: bad call - param value [converts as 0: %s]", argv[1]);
+        else if(bufferSpec->toBufferNumber != bufferSpec->fmBufferNumber) {
+           errorMessage("Screenshot goes into a single buffer, not [%s]", argv[1]);
         }
+        else if(getShownFrame((uint8_t *)ptrBuffer(bufferSpec->fmBufferNumber), frameBufferSizeInBytes(), &nFrameSequence, &nTransmitNsec) == 0) {
+            markBufferAllDirty(bufferSpec->fmBufferNumber);
+            if(nFrameSequence == 0) {
+                warningMessage("screenshot: driver has not sent a frame yet");
+            }
+            else {
+                infoMessage("screenshot: frame #%u sent %.3f mSec ago", nFrameSequence, (double)(monotonicTimeNsec() - nTransmitNsec) / 1000000.0);
+            }
+        }
+        free(bufferSpec);
     }
     return CMD_RET_SUCCESS;   // no errors
 }
 
-int commandLoadBmpFile(int argc, const char *argv[])
+int commandFrameStats(int argc, const char *argv[])
+{
+    // IMPLEMENT:
+    //   framestats - show driver on-time/late/skipped counts for timed (queued) frames
+    showFrameStats();
+    return CMD_RET_SUCCESS;   // no errors
+}
+
+int commandDirty(int argc, const char *argv[])
 {
     int bValidCommand = 1;
 
     // IMPLEMENT:
-    //   loadbmpfile {bmpFileName} - load 24-bit bitmap into current buffer
+    //   dirty {selectedBuffers} [reset] - show area of buffers changed since last reset
     if(stricmp(argv[0], commands[s_nCurrentCmdIdx].name) != 0) {
-        errorMessage("[CODE]: bad call commandLoadBmpFile with command [%s]", argv[0]);
+        errorMessage("[CODE]: bad call commandDirty with command [%s]", argv[0]);
         bValidCommand = 0;
     }
-    else if(argc - 1 != 1) {
+    else if((argc - 1) < 1 || (argc - 1) > 2) {
         errorMessage("[CODE]: bad call - param count err for command [%s]", argv[0]);
         bValidCommand = 0;
     }
+    else if((argc - 1) == 2 && stricmp(argv[2], "reset") != 0) {
+        errorMessage("dirty: expected [reset] not [%s]", argv[2]);
+        bValidCommand = 0;
+    }
     if(bValidCommand) {
-        const char *fileSpec = argv[1];
-        if(!stringHasSuffix(fileSpec, ".bmp")) {
-            warningMessage("Invalid filetype [%s], expected [.bmp]", fileSpec);
-            bValidCommand = 0;
-        }
-        if(bValidCommand && !fileExists(fileSpec)) {
-            errorMessage("File [%s], NOT found!", fileSpec);
-            bValidCommand = 0;
+        struct _bufferSpec *bufferSpec = getBufferNumbersFromBufferSpec(argv[1]);
+        struct _DirtyRegion region;
+        const struct _DirtyRegion *pRegion = &region;
+        if(bufferSpec->fmBufferNumber < 1) {
+           errorMessage("Buffer (%d) out-of-range: [must be 1 >= N <= %d]", bufferSpec->fmBufferNumber, bufferSpec->nMaxBuffers);
         }
-        if(bValidCommand) {
-            int nImageSize;
-            loadImageFromFile(fileSpec, &nImageSize);
-            int nBufferSize = frameBufferSizeInBytes();
-            if(nImageSize != nBufferSize) {
-                warningMessage("Filesize (%d bytes) incorrect for 32x24 matrix (%d bytes), display aborted!", nImageSize, nBufferSize);
-            }
-            else {
-                uint8_t *pCurrBuffer = (uint8_t *)ptrBuffer(s_nCurrentBufferIdx + 1);
-                xlateLoadedImageIntoBuffer(pCurrBuffer, nBufferSize);
+        else {
+            // report on each selected buffer (N, N-M, ., all)
+            for(int nBufferNumber = bufferSpec->fmBufferNumber; nBufferNumber <= bufferSpec->toBufferNumber; nBufferNumber++) {
+                if(getBufferDirtyRegion(nBufferNumber, &region, (argc - 1) == 2) != 0) {
+                    continue;
+                }
+                if(!IS_REGION_DIRTY(pRegion)) {
+                    infoMessage("buffer %d: clean", nBufferNumber);
+                }
+                else {
+                    infoMessage("buffer %d: dirty (%d,%d)-(%d,%d)", nBufferNumber, pRegion->nMinX, pRegion->nMinY, pRegion->nMaxX, pRegion->nMaxY);
+                    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+                        if(pRegion->nLaneMaxLed[nLane] >= pRegion->nLaneMinLed[nLane]) {
+                            infoMessage(" - lane %d: LEDs %d-%d", nLane, pRegion->nLaneMinLed[nLane], pRegion->nLaneMaxLed[nLane]);
+                        }
+                    }
+                }
             }
         }
+        free(bufferSpec);
     }
-
     return CMD_RET_SUCCESS;   // no errors
 }
 
@@ -899,12 +2218,12 @@ struct _bufferSpec *getBufferNumbersFromBufferSpec(const char *bufferSpec)
     struct _bufferSpec *returnSpec = xmalloc(sizeof(struct _bufferSpec));
     returnSpec->nMaxBuffers = nMaxBuffers;
 
-    if(stricmp(bufferSpec, ".")) {
+    if(stricmp(bufferSpec, ".") == 0) {
         // return list of just the current buffer
         returnSpec->fmBufferNumber = s_nCurrentBufferIdx + 1;
         returnSpec->toBufferNumber = returnSpec->fmBufferNumber;
     }
-    else if(stricmp(bufferSpec, "all")) {
+    else if(stricmp(bufferSpec, "all") == 0) {
         // return list of all buffers
         returnSpec->fmBufferNumber = 1;
         returnSpec->toBufferNumber = nMaxBuffers;
@@ -925,11 +2244,6 @@ struct _bufferSpec *getBufferNumbersFromBufferSpec(const char *bufferSpec)
         returnSpec->toBufferNumber = returnSpec->fmBufferNumber;
     }
 
-    // NOTE: code not implemented yet...
-    if(returnSpec->fmBufferNumber != returnSpec->toBufferNumber) {
-       errorMessage("[CODE] Buffer(from,to)=(%d,%d) 'Range of buffers' is NOT YET SUPPORTED", returnSpec->fmBufferNumber, returnSpec->toBufferNumber);
-    }
-
     // validate results
     if(returnSpec->fmBufferNumber < 1 || returnSpec->fmBufferNumber > nMaxBuffers) {
         errorMessage("Buffer(from) (%d) out-of-range: [must be 1 >= N <= %d]", returnSpec->fmBufferNumber, nMaxBuffers);
@@ -979,6 +2293,20 @@ int getPanelNumberFromPanelSpec(const char *panelSpec)
 }
 
 
+struct _DrawContext *drawContextForCurrentBuffer(void)
+{
+    // our draw commands share one pen and default colors, always drawing into current buffer
+    if(!s_bDrawContextReady) {
+        initDrawContext(&s_drawContext, s_nCurrentBufferIdx + 1);
+        s_bDrawContextReady = 1;
+    }
+    else {
+        setDrawContextBuffer(&s_drawContext, s_nCurrentBufferIdx + 1);
+    }
+    return &s_drawContext;
+}
+
+
 int getValueOfColorSpec(const char *colorSpec)
 {
     int desiredValue = 0;
@@ -1055,6 +2383,19 @@ int isHexDigitsString(const char *posHexDigits)
     return hexStatus;
 }
 
+void stopLayoutRenderers(void)
+{
+    // clock and ticker threads map every pixel through the layout table we're about to replace
+    if(isClockRunning()) {
+        stopClock();
+        infoMessage("Clock stopped for layout change");
+    }
+    if(isTickerRunning()) {
+        stopTicker();
+        infoMessage("Ticker stopped for layout change");
+    }
+}
+
 // ----------------------------------------------------------------------------
 //  Missing Functions
 //
@@ -0,0 +1,423 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <pthread.h>
+#include <string.h>
+
+#include "compositor.h"
+#include "matrixDriver.h"
+#include "debug.h"
+
+//  The compositor builds an output buffer from a stack of layer buffers, so e.g. the
+//  clock draws into its own buffer over a background another thread animates, and
+//  neither redraws the other's pixels.  Black ("nothing there") shows through only
+//  where blend mode, opacity or a mask say so:
+//
+//    over      out = below + (layer - below) * alpha
+//    add       out = below + layer * alpha                 (clamped at 255)
+//    multiply  out = below + (below * layer - below) * alpha
+//
+//    alpha = opacity * mask       (mask is brightest channel of mask buffer LED)
+//
+//  Each layer buffer already tracks what was drawn into it (dirty region), so a
+//  composite only rebuilds the LEDs some layer or mask touched since last time.  The
+//  rebuild runs along LED strings (dirty LED range of each lane), layer by layer:
+//  the run is set black then every layer is blended into it, all straight through
+//  memory with no screen X,Y lookups.
+
+#define MIN(a,b) ((a < b) ? a : b)
+#define MAX(a,b) ((a > b) ? a : b)
+
+static struct _LayerStack s_stackAr[COMPOSITOR_MAX_OUTPUTS];
+static pthread_mutex_t s_compositorMutex = PTHREAD_MUTEX_INITIALIZER;  // clock, ticker threads show through here
+
+// -----------------------
+// forward declarations
+//
+static struct _LayerStack *stackForOutput(uint16_t nOutputBufferNumber, int bCreate);
+static struct _LayerStack *stackForLayer(uint16_t nLayerBufferNumber);
+static int compositeStack(struct _LayerStack *pStack);
+static void addBufferRegion(struct _DirtyRegion *pChanged, uint16_t nBufferNumber);
+static void blendLedRun(struct _LedPixel *pOutput, const struct _Layer *pLayer, int nFirstLed, int nStep, int nCount);
+static inline void blendByteRun(eBlendMode eBlend, uint8_t *restrict pDest, const uint8_t *restrict pSource, int nBytes, uint32_t nAlpha256);
+static inline void blendStridedRun(eBlendMode eBlend, uint8_t *pDest, const uint8_t *pSource, const uint8_t *pMask, int nFirstLed, int nStep, int nCount, uint32_t nOpacity256);
+static inline uint8_t blendChannel(eBlendMode eBlend, uint32_t nBelow, uint32_t nLayer, uint32_t nAlpha256);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+int setLayer(uint16_t nOutputBufferNumber, uint16_t nLayerBufferNumber, eBlendMode eBlend, uint8_t nOpacity, uint16_t nMaskBufferNumber)
+{
+    if(nLayerBufferNumber == nOutputBufferNumber || (nMaskBufferNumber == nOutputBufferNumber)) {
+        errorMessage("Buffer %d can't be layer (or mask) of itself", nOutputBufferNumber);
+        return -1;  // FAILURE
+    }
+    if(ptrBuffer(nOutputBufferNumber) == NULL || ptrBuffer(nLayerBufferNumber) == NULL || (nMaskBufferNumber != 0 && ptrBuffer(nMaskBufferNumber) == NULL)) {
+        return -1;  // FAILURE (already reported)
+    }
+    int nStatus = 0;    // SUCCESS
+    pthread_mutex_lock(&s_compositorMutex);
+    struct _LayerStack *pOtherStack = stackForLayer(nLayerBufferNumber);
+    struct _LayerStack *pStack = stackForOutput(nOutputBufferNumber, 1);
+    if(stackForLayer(nOutputBufferNumber) != NULL) {
+        errorMessage("Buffer %d is a layer, can't also be an output", nOutputBufferNumber);
+        nStatus = -1;   // FAILURE
+    }
+    else if(pOtherStack != NULL && pOtherStack != pStack) {
+        errorMessage("Buffer %d is already a layer of buffer %d", nLayerBufferNumber, pOtherStack->nOutputBufferNumber);
+        nStatus = -1;   // FAILURE
+    }
+    else if(pStack == NULL) {
+        errorMessage("No more than %d composited outputs", COMPOSITOR_MAX_OUTPUTS);
+        nStatus = -1;   // FAILURE
+    }
+    else {
+        int nLayerIdx;
+        for(nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+            if(pStack->layers[nLayerIdx].nBufferNumber == nLayerBufferNumber) {
+                break;
+            }
+        }
+        if(nLayerIdx == COMPOSITOR_MAX_LAYERS) {
+            errorMessage("No more than %d layers per output", COMPOSITOR_MAX_LAYERS);
+            nStatus = -1;   // FAILURE
+        }
+        else {
+            struct _Layer *pLayer = &pStack->layers[nLayerIdx];
+            pLayer->nBufferNumber = nLayerBufferNumber;
+            pLayer->eBlend = eBlend;
+            pLayer->nOpacity = nOpacity;
+            pLayer->nMaskBufferNumber = nMaskBufferNumber;
+            pStack->nLayers = MAX(pStack->nLayers, nLayerIdx + 1);
+            pStack->bRebuildAll = 1;
+        }
+    }
+    if(pStack != NULL && pStack->nLayers == 0) {
+        pStack->nOutputBufferNumber = 0;
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+    return nStatus;
+}
+
+void removeLayer(uint16_t nOutputBufferNumber, uint16_t nLayerBufferNumber)
+{
+    pthread_mutex_lock(&s_compositorMutex);
+    struct _LayerStack *pStack = stackForOutput(nOutputBufferNumber, 0);
+    if(pStack != NULL) {
+        for(int nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+            if(pStack->layers[nLayerIdx].nBufferNumber == nLayerBufferNumber) {
+                memmove(&pStack->layers[nLayerIdx], &pStack->layers[nLayerIdx + 1], (pStack->nLayers - nLayerIdx - 1) * sizeof(struct _Layer));
+                pStack->nLayers--;
+                pStack->bRebuildAll = 1;
+                break;
+            }
+        }
+        if(pStack->nLayers == 0) {
+            pStack->nOutputBufferNumber = 0;
+        }
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+}
+
+void clearLayers(uint16_t nOutputBufferNumber)
+{
+    pthread_mutex_lock(&s_compositorMutex);
+    struct _LayerStack *pStack = stackForOutput(nOutputBufferNumber, 0);
+    if(pStack != NULL) {
+        memset(pStack, 0, sizeof(struct _LayerStack));
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+}
+
+void showLayers(uint16_t nOutputBufferNumber)
+{
+    static const char *blendNameAr[] = { "over", "add", "multiply" };
+    pthread_mutex_lock(&s_compositorMutex);
+    struct _LayerStack *pStack = stackForOutput(nOutputBufferNumber, 0);
+    if(pStack == NULL) {
+        infoMessage("Buffer %d: no layers", nOutputBufferNumber);
+    }
+    else {
+        infoMessage("Buffer %d: %d layers (bottom first)", nOutputBufferNumber, pStack->nLayers);
+        for(int nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+            const struct _Layer *pLayer = &pStack->layers[nLayerIdx];
+            if(pLayer->nMaskBufferNumber != 0) {
+                infoMessage("  %d: buffer %d %s opacity %d%% mask buffer %d", nLayerIdx + 1, pLayer->nBufferNumber, blendNameAr[pLayer->eBlend], (pLayer->nOpacity * 100) / 255, pLayer->nMaskBufferNumber);
+            }
+            else {
+                infoMessage("  %d: buffer %d %s opacity %d%%", nLayerIdx + 1, pLayer->nBufferNumber, blendNameAr[pLayer->eBlend], (pLayer->nOpacity * 100) / 255);
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+}
+
+uint16_t highestLayerBufferNumber(void)
+{
+    uint16_t nHighest = 0;
+    pthread_mutex_lock(&s_compositorMutex);
+    for(int nStackIdx = 0; nStackIdx < COMPOSITOR_MAX_OUTPUTS; nStackIdx++) {
+        const struct _LayerStack *pStack = &s_stackAr[nStackIdx];
+        nHighest = MAX(nHighest, pStack->nOutputBufferNumber);
+        for(int nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+            nHighest = MAX(nHighest, pStack->layers[nLayerIdx].nBufferNumber);
+            nHighest = MAX(nHighest, pStack->layers[nLayerIdx].nMaskBufferNumber);
+        }
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+    return nHighest;
+}
+
+int compositeLayers(uint16_t nOutputBufferNumber)
+{
+    int nLedsRebuilt = -1;  // FAILURE
+    pthread_mutex_lock(&s_compositorMutex);
+    struct _LayerStack *pStack = stackForOutput(nOutputBufferNumber, 0);
+    if(pStack == NULL) {
+        warningMessage("Buffer %d has no layers to composite", nOutputBufferNumber);
+    }
+    else {
+        nLedsRebuilt = compositeStack(pStack);
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+    return nLedsRebuilt;
+}
+
+void showLayerBufferAt(uint16_t nBufferNumber, uint64_t presentAtNsec)
+{
+    pthread_mutex_lock(&s_compositorMutex);
+    struct _LayerStack *pStack = stackForLayer(nBufferNumber);
+    if(pStack != NULL && compositeStack(pStack) >= 0) {
+        nBufferNumber = pStack->nOutputBufferNumber;
+    }
+    uint8_t *pBuffer = (uint8_t *)ptrBuffer(nBufferNumber);
+    if(pBuffer != NULL) {
+        if(presentAtNsec == 0) {
+            showBuffer(pBuffer, frameBufferSizeInBytes());
+        }
+        else {
+            showBufferAt(pBuffer, frameBufferSizeInBytes(), presentAtNsec);
+        }
+    }
+    pthread_mutex_unlock(&s_compositorMutex);
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static struct _LayerStack *stackForOutput(uint16_t nOutputBufferNumber, int bCreate)
+{
+    struct _LayerStack *pFreeStack = NULL;
+    for(int nStackIdx = 0; nStackIdx < COMPOSITOR_MAX_OUTPUTS; nStackIdx++) {
+        if(s_stackAr[nStackIdx].nOutputBufferNumber == nOutputBufferNumber) {
+            return &s_stackAr[nStackIdx];
+        }
+        if(pFreeStack == NULL && s_stackAr[nStackIdx].nOutputBufferNumber == 0) {
+            pFreeStack = &s_stackAr[nStackIdx];
+        }
+    }
+    if(!bCreate || pFreeStack == NULL) {
+        return NULL;
+    }
+    memset(pFreeStack, 0, sizeof(struct _LayerStack));
+    pFreeStack->nOutputBufferNumber = nOutputBufferNumber;
+    return pFreeStack;
+}
+
+static struct _LayerStack *stackForLayer(uint16_t nLayerBufferNumber)
+{
+    for(int nStackIdx = 0; nStackIdx < COMPOSITOR_MAX_OUTPUTS; nStackIdx++) {
+        struct _LayerStack *pStack = &s_stackAr[nStackIdx];
+        for(int nLayerIdx = 0; pStack->nOutputBufferNumber != 0 && nLayerIdx < pStack->nLayers; nLayerIdx++) {
+            if(pStack->layers[nLayerIdx].nBufferNumber == nLayerBufferNumber) {
+                return pStack;
+            }
+        }
+    }
+    return NULL;
+}
+
+static int compositeStack(struct _LayerStack *pStack)
+{
+    // every buffer must (still) be there
+    struct _LedPixel *pOutput = ptrBuffer(pStack->nOutputBufferNumber);
+    if(pOutput == NULL) {
+        return -1;  // FAILURE
+    }
+    for(int nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+        const struct _Layer *pLayer = &pStack->layers[nLayerIdx];
+        if(ptrBuffer(pLayer->nBufferNumber) == NULL || (pLayer->nMaskBufferNumber != 0 && ptrBuffer(pLayer->nMaskBufferNumber) == NULL)) {
+            return -1;  // FAILURE
+        }
+    }
+
+    // what changed, union of layer and mask dirty regions
+    struct _DirtyRegion changed = { INT16_MAX, INT16_MAX, -1, -1, { 0 }, { 0 } };
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        changed.nLaneMinLed[nLane] = INT16_MAX;
+        changed.nLaneMaxLed[nLane] = -1;
+    }
+    if(pStack->bRebuildAll) {
+        changed.nMinX = 0;
+        changed.nMinY = 0;
+        changed.nMaxX = SCREEN_WIDTH - 1;
+        changed.nMaxY = SCREEN_HEIGHT - 1;
+        for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+            changed.nLaneMinLed[nLane] = 0;
+            changed.nLaneMaxLed[nLane] = LAYOUT_LEDS_PER_LANE - 1;
+        }
+        pStack->bRebuildAll = 0;
+    }
+    for(int nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+        const struct _Layer *pLayer = &pStack->layers[nLayerIdx];
+        addBufferRegion(&changed, pLayer->nBufferNumber);
+        if(pLayer->nMaskBufferNumber != 0) {
+            addBufferRegion(&changed, pLayer->nMaskBufferNumber);
+        }
+    }
+    if(!IS_REGION_DIRTY(&changed)) {
+        return 0;   // nothing to do
+    }
+
+    // rebuild dirty LEDs of each lane, from black up
+    int nStep = (screenLayout.eFrameFormat == FF_LANE_INTERLEAVED) ? LAYOUT_MAX_LANES : 1;
+    int nLedsRebuilt = 0;
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        if(changed.nLaneMaxLed[nLane] < changed.nLaneMinLed[nLane]) {
+            continue;
+        }
+        int nFirstLed = ledIndexForLane(screenLayout.eFrameFormat, nLane, changed.nLaneMinLed[nLane]);
+        int nCount = changed.nLaneMaxLed[nLane] - changed.nLaneMinLed[nLane] + 1;
+        for(int nLedIdx = 0; nLedIdx < nCount; nLedIdx++) {
+            memset(&pOutput[nFirstLed + (nLedIdx * nStep)], 0, sizeof(struct _LedPixel));
+        }
+        for(int nLayerIdx = 0; nLayerIdx < pStack->nLayers; nLayerIdx++) {
+            blendLedRun(pOutput, &pStack->layers[nLayerIdx], nFirstLed, nStep, nCount);
+        }
+        nLedsRebuilt += nCount;
+    }
+    markBufferDirtyRect(pStack->nOutputBufferNumber, changed.nMinX, changed.nMinY, changed.nMaxX - changed.nMinX + 1, changed.nMaxY - changed.nMinY + 1);
+    return nLedsRebuilt;
+}
+
+static void addBufferRegion(struct _DirtyRegion *pChanged, uint16_t nBufferNumber)
+{
+    // take and reset in one step: drawing threads may be marking this buffer right now
+    //  (so compositing consumes layer regions, 'dirty' on a layer shows changes since last composite)
+    struct _DirtyRegion region;
+    const struct _DirtyRegion *pRegion = &region;
+    if(getBufferDirtyRegion(nBufferNumber, &region, 1) != 0 || !IS_REGION_DIRTY(pRegion)) {
+        return;
+    }
+    pChanged->nMinX = MIN(pChanged->nMinX, pRegion->nMinX);
+    pChanged->nMinY = MIN(pChanged->nMinY, pRegion->nMinY);
+    pChanged->nMaxX = MAX(pChanged->nMaxX, pRegion->nMaxX);
+    pChanged->nMaxY = MAX(pChanged->nMaxY, pRegion->nMaxY);
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        pChanged->nLaneMinLed[nLane] = MIN(pChanged->nLaneMinLed[nLane], pRegion->nLaneMinLed[nLane]);
+        pChanged->nLaneMaxLed[nLane] = MAX(pChanged->nLaneMaxLed[nLane], pRegion->nLaneMaxLed[nLane]);
+    }
+}
+
+static void blendLedRun(struct _LedPixel *pOutput, const struct _Layer *pLayer, int nFirstLed, int nStep, int nCount)
+{
+    const uint8_t *pSource = (const uint8_t *)ptrBuffer(pLayer->nBufferNumber);
+    const uint8_t *pMask = (pLayer->nMaskBufferNumber != 0) ? (const uint8_t *)ptrBuffer(pLayer->nMaskBufferNumber) : NULL;
+    uint8_t *pDest = (uint8_t *)pOutput;
+    // alpha in [0 - 256] so blends are shifts not divides
+    uint32_t nOpacity256 = pLayer->nOpacity + (pLayer->nOpacity >> 7);
+    if(nOpacity256 == 0) {
+        return;
+    }
+    // mode picked once per run, each case below is its own loop with the blend folded in
+    if(pMask == NULL && nStep == 1) {
+        // lane-sequential run, one alpha: its LEDs are one flat run of bytes, a loop the compiler vectorizes
+        int nFirstByte = nFirstLed * sizeof(struct _LedPixel);
+        int nBytes = nCount * sizeof(struct _LedPixel);
+        switch(pLayer->eBlend) {
+            case BM_ADD:
+                blendByteRun(BM_ADD, &pDest[nFirstByte], &pSource[nFirstByte], nBytes, nOpacity256);
+                break;
+            case BM_MULTIPLY:
+                blendByteRun(BM_MULTIPLY, &pDest[nFirstByte], &pSource[nFirstByte], nBytes, nOpacity256);
+                break;
+            default:
+                blendByteRun(BM_OVER, &pDest[nFirstByte], &pSource[nFirstByte], nBytes, nOpacity256);
+                break;
+        }
+        return;
+    }
+    switch(pLayer->eBlend) {
+        case BM_ADD:
+            blendStridedRun(BM_ADD, pDest, pSource, pMask, nFirstLed, nStep, nCount, nOpacity256);
+            break;
+        case BM_MULTIPLY:
+            blendStridedRun(BM_MULTIPLY, pDest, pSource, pMask, nFirstLed, nStep, nCount, nOpacity256);
+            break;
+        default:
+            blendStridedRun(BM_OVER, pDest, pSource, pMask, nFirstLed, nStep, nCount, nOpacity256);
+            break;
+    }
+}
+
+static inline void blendByteRun(eBlendMode eBlend, uint8_t *restrict pDest, const uint8_t *restrict pSource, int nBytes, uint32_t nAlpha256)
+{
+    // called with constant eBlend: inlined, blendChannel() reduces to one mode's math
+    //  (layer is never its own output, setLayer() refuses, so the buffers can't overlap)
+    for(int nByteIdx = 0; nByteIdx < nBytes; nByteIdx++) {
+        pDest[nByteIdx] = blendChannel(eBlend, pDest[nByteIdx], pSource[nByteIdx], nAlpha256);
+    }
+}
+
+static inline void blendStridedRun(eBlendMode eBlend, uint8_t *pDest, const uint8_t *pSource, const uint8_t *pMask, int nFirstLed, int nStep, int nCount, uint32_t nOpacity256)
+{
+    // interleaved lanes (LEDs nStep apart) or masked (alpha per LED)
+    for(int nLedIdx = 0; nLedIdx < nCount; nLedIdx++) {
+        int nOffset = (nFirstLed + (nLedIdx * nStep)) * sizeof(struct _LedPixel);
+        uint32_t nAlpha256 = nOpacity256;
+        if(pMask != NULL) {
+            uint32_t nMaskGR = MAX(pMask[nOffset + 0], pMask[nOffset + 1]);
+            uint32_t nMask = MAX(nMaskGR, pMask[nOffset + 2]);
+            nAlpha256 = (nAlpha256 * (nMask + (nMask >> 7))) >> 8;
+        }
+        pDest[nOffset + 0] = blendChannel(eBlend, pDest[nOffset + 0], pSource[nOffset + 0], nAlpha256);
+        pDest[nOffset + 1] = blendChannel(eBlend, pDest[nOffset + 1], pSource[nOffset + 1], nAlpha256);
+        pDest[nOffset + 2] = blendChannel(eBlend, pDest[nOffset + 2], pSource[nOffset + 2], nAlpha256);
+    }
+}
+
+static inline uint8_t blendChannel(eBlendMode eBlend, uint32_t nBelow, uint32_t nLayer, uint32_t nAlpha256)
+{
+    uint32_t nBlended;
+    if(eBlend == BM_ADD) {
+        nBlended = nBelow + ((nLayer * nAlpha256) >> 8);
+        return MIN(nBlended, 255);
+    }
+    if(eBlend == BM_MULTIPLY) {
+        // below * layer / 255, rounded
+        uint32_t nProduct = (nBelow * nLayer) + 128;
+        nLayer = (nProduct + (nProduct >> 8)) >> 8;
+    }
+    nBlended = (nBelow * (256 - nAlpha256)) + (nLayer * nAlpha256);
+    return nBlended >> 8;
+}
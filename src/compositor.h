@@ -0,0 +1,68 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+#define COMPOSITOR_MAX_OUTPUTS 4
+#define COMPOSITOR_MAX_LAYERS 8
+
+typedef enum _eBlendMode {
+    BM_OVER = 0,    // layer replaces what is below (by opacity and mask)
+    BM_ADD,         // layer light added to what is below (black adds nothing)
+    BM_MULTIPLY,    // what is below is darkened by layer (white changes nothing)
+} eBlendMode;
+
+struct _Layer {
+    uint16_t nBufferNumber;
+    uint8_t eBlend;             // eBlendMode value
+    uint8_t nOpacity;           // [0 - 255]
+    uint16_t nMaskBufferNumber; // 0 = none, else brightest channel of each mask LED scales opacity (may be layer buffer itself)
+};
+
+// output buffer is rebuilt from black up through its layers (first is bottom), a buffer is a layer of one output only
+struct _LayerStack {
+    uint16_t nOutputBufferNumber;   // 0 = stack not in use
+    uint8_t nLayers;
+    uint8_t bRebuildAll;            // T/F stack changed, next composite does whole screen
+    struct _Layer layers[COMPOSITOR_MAX_LAYERS];
+};
+
+// add layer on top of output's stack (or change its settings where it already is), 0 on success
+int setLayer(uint16_t nOutputBufferNumber, uint16_t nLayerBufferNumber, eBlendMode eBlend, uint8_t nOpacity, uint16_t nMaskBufferNumber);
+void removeLayer(uint16_t nOutputBufferNumber, uint16_t nLayerBufferNumber);
+void clearLayers(uint16_t nOutputBufferNumber);
+void showLayers(uint16_t nOutputBufferNumber);
+// highest buffer any stack outputs to, layers or masks with, 0 when no layers are set
+uint16_t highestLayerBufferNumber(void);
+
+// rebuild only what changed in layers (and masks) since last composite, LEDs rebuilt or -1 on error
+//  NOTE: consumes (resets) layer and mask dirty regions, so afterwards they hold only changes made since this composite
+int compositeLayers(uint16_t nOutputBufferNumber);
+
+// show buffer, or when it is a layer the composite of its output (safe from any thread), 0 = now
+void showLayerBufferAt(uint16_t nBufferNumber, uint64_t presentAtNsec);
+
+#endif /* COMPOSITOR_H */
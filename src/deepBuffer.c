@@ -0,0 +1,249 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdlib.h>     // free()
+#include <string.h>
+
+#include "deepBuffer.h"
+#include "matrixDriver.h"
+#include "xmalloc.h"
+#include "debug.h"
+
+//  Deep buffers hold 16 bits per channel so fades, mixes and dim colors are worked out
+//  without losing precision, and only the present step goes down to the 8 bits our
+//  LEDs take.  Done naively, a slow fade of a dim color steps visibly (8 bit value 3,
+//  then 2, then 1...).  Dithering hides the steps:
+//
+//    ordered  - add a fixed per-pixel threshold (4x4 Bayer on screen X,Y) before
+//               dropping the low 8 bits, neighboring pixels round differently
+//    temporal - keep the low 8 bits each LED lost and add them into its next frame,
+//               so over a few frames each LED averages to its exact 16 bit value
+//
+//  Channels are kept in the same LED and green/red/blue order as frame buffers so
+//  present is one flat loop over 2304 channels:
+//
+//    x   = (channel * level) >> 16           (brightness, fused into same pass)
+//    x  -= x >> 8                            (0-65535 -> 0-65280, 257 * N -> 256 * N)
+//    out = (x + threshold) >> 8              (threshold 128 / Bayer / carried error)
+//
+//  which never exceeds 255 so needs no clamping, and being branch free the compiler
+//  can vectorize it.  8 bit frames loaded in (N * 257) come back out unchanged.
+
+#define DEEP_BUFFER_ALIGN 64    // each deep buffer's channels start on own cache line
+#define CHANNELS_PER_LED 3
+
+static uint16_t *s_pDeepChannels;   // all deep buffers' channels back-to-back
+static uint8_t *s_pDeepCarry;
+static size_t s_nDeepChannelStride;   // in channels
+static struct _DeepBuffer *s_pDeepAr;
+static uint16_t s_nDeepBuffers;
+
+// per channel ordered dither thresholds, built for layout generation
+static uint8_t s_nThresholdAr[(LAYOUT_NO_LED_IDX + 1) * CHANNELS_PER_LED];
+static uint32_t s_nThresholdGeneration;
+
+static const uint8_t s_nBayer4x4[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+// -----------------------
+// forward declarations
+//
+static void buildOrderedThresholds(void);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+int allocDeepBuffers(int nDesiredBuffers)
+{
+    if(nDesiredBuffers < 1 || nDesiredBuffers > DEEP_MAX_BUFFERS) {
+        warningMessage("deep buffer %d out-of-range: [1-%d]", nDesiredBuffers, DEEP_MAX_BUFFERS);
+        return -1;  // FAILURE
+    }
+    if(nDesiredBuffers > s_nDeepBuffers) {
+        size_t nChannelsPerAlign = DEEP_BUFFER_ALIGN / sizeof(uint16_t);
+        s_nDeepChannelStride = ((((maxLedsInBuffer() + 1) * CHANNELS_PER_LED) + nChannelsPerAlign - 1) / nChannelsPerAlign) * nChannelsPerAlign;
+        s_pDeepChannels = xrealloc(s_pDeepChannels, nDesiredBuffers * s_nDeepChannelStride * sizeof(uint16_t));
+        s_pDeepCarry = xrealloc(s_pDeepCarry, nDesiredBuffers * s_nDeepChannelStride);
+        s_pDeepAr = xrealloc(s_pDeepAr, nDesiredBuffers * sizeof(struct _DeepBuffer));
+        memset(s_pDeepChannels + (s_nDeepBuffers * s_nDeepChannelStride), 0, (nDesiredBuffers - s_nDeepBuffers) * s_nDeepChannelStride * sizeof(uint16_t));
+        memset(s_pDeepCarry + (s_nDeepBuffers * s_nDeepChannelStride), 0, (nDesiredBuffers - s_nDeepBuffers) * s_nDeepChannelStride);
+        // buffers may have moved
+        for(int nDeepIdx = 0; nDeepIdx < nDesiredBuffers; nDeepIdx++) {
+            s_pDeepAr[nDeepIdx].pChannels = s_pDeepChannels + (nDeepIdx * s_nDeepChannelStride);
+            s_pDeepAr[nDeepIdx].pCarry = s_pDeepCarry + (nDeepIdx * s_nDeepChannelStride);
+        }
+        debugMessage("Alloc %d additional deep buffers", nDesiredBuffers - s_nDeepBuffers);
+        s_nDeepBuffers = nDesiredBuffers;
+    }
+    return 0;   // SUCCESS
+}
+
+void freeDeepBuffers(void)
+{
+    free(s_pDeepChannels);
+    free(s_pDeepCarry);
+    free(s_pDeepAr);
+    s_pDeepChannels = NULL;
+    s_pDeepCarry = NULL;
+    s_pDeepAr = NULL;
+    s_nDeepBuffers = 0;
+}
+
+uint16_t numberDeepBuffers(void)
+{
+    return s_nDeepBuffers;
+}
+
+struct _DeepBuffer *ptrDeepBuffer(uint16_t nDeepNumber)
+{
+    if(nDeepNumber < 1 || nDeepNumber > s_nDeepBuffers) {
+        warningMessage("deep buffer %d NOT yet Allocated. Use 'dbuffers %d' to allocate it", nDeepNumber, nDeepNumber);
+        return NULL;
+    }
+    return &s_pDeepAr[nDeepNumber - 1];
+}
+
+void showDeepBuffers(void)
+{
+    size_t nBytesPerBuffer = s_nDeepChannelStride * (sizeof(uint16_t) + sizeof(uint8_t));
+    infoMessage("%d deep buffers: %lu bytes (%lu per buffer incl. dither carry)", s_nDeepBuffers,
+        (unsigned long)(s_nDeepBuffers * nBytesPerBuffer), (unsigned long)nBytesPerBuffer);
+}
+
+void fillDeepRect(struct _DeepBuffer *pDeep, int locX, int locY, int nWidth, int nHeight, uint64_t nColorRGB48)
+{
+    uint16_t nRed = (nColorRGB48 >> 32) & 0xffff;
+    uint16_t nGreen = (nColorRGB48 >> 16) & 0xffff;
+    uint16_t nBlue = (nColorRGB48 >> 0) & 0xffff;
+    int nMinX = (locX < 0) ? 0 : locX;
+    int nMinY = (locY < 0) ? 0 : locY;
+    int nMaxX = locX + nWidth - 1;
+    int nMaxY = locY + nHeight - 1;
+    if(nMaxX >= SCREEN_WIDTH) {
+        nMaxX = SCREEN_WIDTH - 1;
+    }
+    if(nMaxY >= SCREEN_HEIGHT) {
+        nMaxY = SCREEN_HEIGHT - 1;
+    }
+    for(int nY = nMinY; nY <= nMaxY; nY++) {
+        for(int nX = nMinX; nX <= nMaxX; nX++) {
+            uint16_t *pLED = &pDeep->pChannels[ledIndexForXY(nX, nY) * CHANNELS_PER_LED];
+            pLED[0] = nGreen;
+            pLED[1] = nRed;
+            pLED[2] = nBlue;
+        }
+    }
+}
+
+int loadDeepBufferFromBuffer(struct _DeepBuffer *pDeep, uint16_t nBufferNumber)
+{
+    const uint8_t *pSource = (const uint8_t *)ptrBuffer(nBufferNumber);
+    if(pSource == NULL) {
+        return -1;  // FAILURE
+    }
+    int nChannels = maxLedsInBuffer() * CHANNELS_PER_LED;
+    for(int nChannelIdx = 0; nChannelIdx < nChannels; nChannelIdx++) {
+        pDeep->pChannels[nChannelIdx] = pSource[nChannelIdx] * 257;
+    }
+    return 0;   // SUCCESS
+}
+
+void mixDeepBuffers(struct _DeepBuffer *pDest, const struct _DeepBuffer *pFrom, const struct _DeepBuffer *pTo, uint32_t nLevel)
+{
+    if(nLevel > DEEP_LEVEL_FULL) {
+        nLevel = DEEP_LEVEL_FULL;
+    }
+    uint32_t nFromLevel = DEEP_LEVEL_FULL - nLevel;
+    int nChannels = maxLedsInBuffer() * CHANNELS_PER_LED;
+    for(int nChannelIdx = 0; nChannelIdx < nChannels; nChannelIdx++) {
+        // at most 65535 * 65536, fits
+        pDest->pChannels[nChannelIdx] = ((pFrom->pChannels[nChannelIdx] * nFromLevel) + (pTo->pChannels[nChannelIdx] * nLevel)) >> 16;
+    }
+}
+
+void quantizeDeepBuffer(struct _DeepBuffer *pDeep, uint32_t nLevel, eDitherMode eDither, struct _LedPixel *pFrame)
+{
+    const uint16_t *pChannels = pDeep->pChannels;
+    uint8_t *pDest = (uint8_t *)pFrame;
+    int nChannels = maxLedsInBuffer() * CHANNELS_PER_LED;
+    if(nLevel > DEEP_LEVEL_FULL) {
+        nLevel = DEEP_LEVEL_FULL;
+    }
+    if(eDither == DM_TEMPORAL) {
+        uint8_t *pCarry = pDeep->pCarry;
+        for(int nChannelIdx = 0; nChannelIdx < nChannels; nChannelIdx++) {
+            uint32_t nValue = (pChannels[nChannelIdx] * nLevel) >> 16;
+            nValue = nValue - (nValue >> 8) + pCarry[nChannelIdx];
+            pDest[nChannelIdx] = nValue >> 8;
+            pCarry[nChannelIdx] = nValue & 0xff;
+        }
+    }
+    else if(eDither == DM_ORDERED) {
+        if(s_nThresholdGeneration != screenLayout.nGeneration) {
+            buildOrderedThresholds();
+        }
+        for(int nChannelIdx = 0; nChannelIdx < nChannels; nChannelIdx++) {
+            uint32_t nValue = (pChannels[nChannelIdx] * nLevel) >> 16;
+            pDest[nChannelIdx] = (nValue - (nValue >> 8) + s_nThresholdAr[nChannelIdx]) >> 8;
+        }
+    }
+    else {
+        for(int nChannelIdx = 0; nChannelIdx < nChannels; nChannelIdx++) {
+            uint32_t nValue = (pChannels[nChannelIdx] * nLevel) >> 16;
+            pDest[nChannelIdx] = (nValue - (nValue >> 8) + 128) >> 8;
+        }
+    }
+}
+
+void showDeepBufferAt(struct _DeepBuffer *pDeep, uint32_t nLevel, eDitherMode eDither, uint64_t presentAtNsec)
+{
+    struct _LedPixel frameAr[LAYOUT_NO_LED_IDX + 1];
+    quantizeDeepBuffer(pDeep, nLevel, eDither, frameAr);
+    if(presentAtNsec == 0) {
+        showBuffer((uint8_t *)frameAr, frameBufferSizeInBytes());
+    }
+    else {
+        showBufferAt((uint8_t *)frameAr, frameBufferSizeInBytes(), presentAtNsec);
+    }
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static void buildOrderedThresholds(void)
+{
+    // LEDs not on screen get the plain rounding threshold
+    memset(s_nThresholdAr, 128, sizeof(s_nThresholdAr));
+    for(int nY = 0; nY < SCREEN_HEIGHT; nY++) {
+        for(int nX = 0; nX < SCREEN_WIDTH; nX++) {
+            uint16_t nLedIdx = ledIndexForXY(nX, nY);
+            uint8_t nThreshold = (s_nBayer4x4[nY & 3][nX & 3] * 16) + 8;
+            memset(&s_nThresholdAr[nLedIdx * CHANNELS_PER_LED], nThreshold, CHANNELS_PER_LED);
+        }
+    }
+    s_nThresholdGeneration = screenLayout.nGeneration;
+}
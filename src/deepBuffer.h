@@ -0,0 +1,61 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef DEEP_BUFFER_H
+#define DEEP_BUFFER_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+#define DEEP_MAX_BUFFERS 256
+#define DEEP_LEVEL_FULL 65536       // level (brightness scale) of 1.0
+
+typedef enum _eDitherMode {
+    DM_NONE = 0,        // round to nearest
+    DM_ORDERED,         // 4x4 Bayer pattern on screen X,Y (steady, no flicker)
+    DM_TEMPORAL,        // each LED carries what it lost to rounding into its next frame
+} eDitherMode;
+
+// high precision working buffer: 16 bits per channel, same LED and green/red/blue order as frame buffers
+struct _DeepBuffer {
+    uint16_t *pChannels;    // [(maxLedsInBuffer() + 1) * 3] (last LED is the LAYOUT_NO_LED_IDX spare)
+    uint8_t *pCarry;        // [maxLedsInBuffer() * 3] DM_TEMPORAL error carried to next frame
+};
+
+// deep buffers are numbered [1 - numberDeepBuffers()], new ones are black
+int allocDeepBuffers(int nDesiredBuffers);
+void freeDeepBuffers(void);
+uint16_t numberDeepBuffers(void);
+struct _DeepBuffer *ptrDeepBuffer(uint16_t nDeepNumber);    // NULL (with warning) if no such buffer
+void showDeepBuffers(void);
+
+// drawing: colors are 0xRRRRGGGGBBBB (16 bits each), fill clipped to screen
+void fillDeepRect(struct _DeepBuffer *pDeep, int locX, int locY, int nWidth, int nHeight, uint64_t nColorRGB48);
+int loadDeepBufferFromBuffer(struct _DeepBuffer *pDeep, uint16_t nBufferNumber);     // 8 -> 16 bits, 0 on success
+// pDest = pFrom + (pTo - pFrom) * nLevel, nLevel [0 - DEEP_LEVEL_FULL] (pDest may be pFrom or pTo)
+void mixDeepBuffers(struct _DeepBuffer *pDest, const struct _DeepBuffer *pFrom, const struct _DeepBuffer *pTo, uint32_t nLevel);
+
+// present: scale by nLevel [0 - DEEP_LEVEL_FULL] and dither down to 8 bits in one pass into frame / straight to screen
+void quantizeDeepBuffer(struct _DeepBuffer *pDeep, uint32_t nLevel, eDitherMode eDither, struct _LedPixel *pFrame);
+void showDeepBufferAt(struct _DeepBuffer *pDeep, uint32_t nLevel, eDitherMode eDither, uint64_t presentAtNsec);  // 0 = now
+
+#endif /* DEEP_BUFFER_H */
@@ -0,0 +1,212 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdlib.h>     // abs()
+#include <string.h>
+
+#include "drawContext.h"
+#include "debug.h"
+#include "pixelFill.h"
+#include "rasterizer.h"
+
+#define MIN(a,b) ((a < b) ? a : b)
+#define MAX(a,b) ((a > b) ? a : b)
+
+// -----------------------
+// forward declarations
+//
+static void markContextDirtyRect(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+int initDrawContext(struct _DrawContext *pContext, uint16_t nBufferNumber)
+{
+    memset(pContext, 0, sizeof(struct _DrawContext));
+    pContext->nLineColor = 0xffffff;
+    pContext->nFillColor = 0x000000;
+    pContext->nLineWidth = 1;
+    pContext->bFill = 0;
+    resetDrawContextClip(pContext);
+    return setDrawContextBuffer(pContext, nBufferNumber);
+}
+
+int setDrawContextBuffer(struct _DrawContext *pContext, uint16_t nBufferNumber)
+{
+    // buffers never move once allocated so address stays good until buffers are freed
+    pContext->nBufferNumber = nBufferNumber;
+    pContext->pBuffer = ptrBuffer(nBufferNumber);
+    return (pContext->pBuffer != NULL) ? 0 : -1;
+}
+
+void setDrawContextClip(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight)
+{
+    pContext->clip.nMinX = MAX(locX, 0);
+    pContext->clip.nMinY = MAX(locY, 0);
+    pContext->clip.nMaxX = MIN(locX + nWidth, SCREEN_WIDTH) - 1;
+    pContext->clip.nMaxY = MIN(locY + nHeight, SCREEN_HEIGHT) - 1;
+}
+
+void resetDrawContextClip(struct _DrawContext *pContext)
+{
+    setDrawContextClip(pContext, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+void moveToInContext(struct _DrawContext *pContext, int locX, int locY)
+{
+    debugMessage("moveTo() bfr #%d rc=(%d, %d)", pContext->nBufferNumber, locX, locY);
+    pContext->nPenX = locX;
+    pContext->nPenY = locY;
+}
+
+void lineToInContext(struct _DrawContext *pContext, int locX, int locY)
+{
+    int nPenX = pContext->nPenX;
+    int nPenY = pContext->nPenY;
+    int nLineWidth = MAX(pContext->nLineWidth, 1);
+    int nLineWidthAdjust = (nLineWidth - 1);
+    uint32_t nLineColor = pContext->nLineColor;
+    debugMessage("lineTo() bfr #%d fmRC=(%d, %d), toRC=(%d, %d), w=%d, c=0x%.06X", pContext->nBufferNumber, nPenX, nPenY, locX, locY, nLineWidth, nLineColor);
+    if(pContext->pBuffer == NULL) {
+        errorMessage("lineToInContext() No Buffer at #%d", pContext->nBufferNumber);
+        return;
+    }
+    if(nPenX == locX) {
+        // draw vertical line (width grows to the right)
+        int nMinIdxY = MIN(nPenY, locY);
+        int nMaxIdxY = MAX(nPenY, locY);
+        // adjust if nLineWidth past right of clip area
+        if((nPenX + nLineWidthAdjust) > pContext->clip.nMaxX) {
+            nPenX -= nLineWidthAdjust;
+        }
+        fillClippedRectInBuffer(pContext->pBuffer, &pContext->clip, nPenX, nMinIdxY, nLineWidth, (nMaxIdxY - nMinIdxY) + 1, nLineColor);
+        markContextDirtyRect(pContext, nPenX, nMinIdxY, nLineWidth, (nMaxIdxY - nMinIdxY) + 1);
+    }
+    else if(nPenY == locY) {
+        // draw horizontal line (width grows downward)
+        int nMinIdxX = MIN(nPenX, locX);
+        int nMaxIdxX = MAX(nPenX, locX);
+        // adjust if nLineWidth past bottom of clip area
+        if((nPenY + nLineWidthAdjust) > pContext->clip.nMaxY) {
+            nPenY -= nLineWidthAdjust;
+        }
+        fillClippedRectInBuffer(pContext->pBuffer, &pContext->clip, nMinIdxX, nPenY, (nMaxIdxX - nMinIdxX) + 1, nLineWidth, nLineColor);
+        markContextDirtyRect(pContext, nMinIdxX, nPenY, (nMaxIdxX - nMinIdxX) + 1, nLineWidth);
+    }
+    else {
+        // draw sloped line (width centered on line)
+        int nBrushOffset = nLineWidthAdjust / 2;
+        rasterLine(pContext->pBuffer, &pContext->clip, nPenX, nPenY, locX, locY, nLineWidth, nLineColor);
+        markContextDirtyRect(pContext, MIN(nPenX, locX) - nBrushOffset, MIN(nPenY, locY) - nBrushOffset,
+            abs(locX - nPenX) + nLineWidth, abs(locY - nPenY) + nLineWidth);
+    }
+    pContext->nPenX = locX;
+    pContext->nPenY = locY;
+}
+
+void lineToInContextAA(struct _DrawContext *pContext, int locX, int locY)
+{
+    int nPenX = pContext->nPenX;
+    int nPenY = pContext->nPenY;
+    debugMessage("lineToAA() bfr #%d fmRC=(%d, %d), toRC=(%d, %d), c=0x%.06X", pContext->nBufferNumber, nPenX, nPenY, locX, locY, pContext->nLineColor);
+    if(pContext->pBuffer == NULL) {
+        errorMessage("lineToInContextAA() No Buffer at #%d", pContext->nBufferNumber);
+        return;
+    }
+    rasterLineAA(pContext->pBuffer, &pContext->clip, nPenX, nPenY, locX, locY, pContext->nLineColor);
+    // blended pixels can fall one row/column past the line
+    markContextDirtyRect(pContext, MIN(nPenX, locX), MIN(nPenY, locY), abs(locX - nPenX) + 2, abs(locY - nPenY) + 2);
+    pContext->nPenX = locX;
+    pContext->nPenY = locY;
+}
+
+void drawRectInContext(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight)
+{
+    if(pContext->pBuffer == NULL) {
+        errorMessage("drawRectInContext() No Buffer at #%d", pContext->nBufferNumber);
+        return;
+    }
+    rasterRect(pContext->pBuffer, &pContext->clip, locX, locY, nWidth, nHeight, pContext->nLineWidth, pContext->nLineColor, pContext->bFill, pContext->nFillColor);
+    markContextDirtyRect(pContext, locX, locY, nWidth, nHeight);
+}
+
+void drawCircleInContext(struct _DrawContext *pContext, int nCenterX, int nCenterY, int nRadius)
+{
+    if(pContext->pBuffer == NULL) {
+        errorMessage("drawCircleInContext() No Buffer at #%d", pContext->nBufferNumber);
+        return;
+    }
+    rasterCircle(pContext->pBuffer, &pContext->clip, nCenterX, nCenterY, nRadius, pContext->nLineWidth, pContext->nLineColor, pContext->bFill, pContext->nFillColor);
+    markContextDirtyRect(pContext, nCenterX - nRadius, nCenterY - nRadius, (2 * nRadius) + 1, (2 * nRadius) + 1);
+}
+
+void drawPolygonInContext(struct _DrawContext *pContext, const int16_t *pPointsXY, int nPoints)
+{
+    if(pContext->pBuffer == NULL) {
+        errorMessage("drawPolygonInContext() No Buffer at #%d", pContext->nBufferNumber);
+    }
+    else if(nPoints < 3 || nPoints > RASTER_MAX_POLYGON_POINTS) {
+        errorMessage("drawPolygonInContext() %d points out-of-range: [3-%d]", nPoints, RASTER_MAX_POLYGON_POINTS);
+    }
+    else {
+        rasterPolygon(pContext->pBuffer, &pContext->clip, pPointsXY, nPoints, pContext->nLineWidth, pContext->nLineColor, pContext->bFill, pContext->nFillColor);
+        // bounding box grown by half the (centered) edge width
+        int nMinX = pPointsXY[0];
+        int nMinY = pPointsXY[1];
+        int nMaxX = nMinX;
+        int nMaxY = nMinY;
+        for(int nPointIdx = 1; nPointIdx < nPoints; nPointIdx++) {
+            nMinX = MIN(nMinX, pPointsXY[nPointIdx * 2]);
+            nMaxX = MAX(nMaxX, pPointsXY[nPointIdx * 2]);
+            nMinY = MIN(nMinY, pPointsXY[(nPointIdx * 2) + 1]);
+            nMaxY = MAX(nMaxY, pPointsXY[(nPointIdx * 2) + 1]);
+        }
+        int nEdgeGrowth = (pContext->nLineWidth > 0) ? (pContext->nLineWidth / 2) + 1 : 0;
+        markContextDirtyRect(pContext, nMinX - nEdgeGrowth, nMinY - nEdgeGrowth, (nMaxX - nMinX) + 1 + (2 * nEdgeGrowth), (nMaxY - nMinY) + 1 + (2 * nEdgeGrowth));
+    }
+}
+
+void fillRectInContext(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight)
+{
+    if(pContext->pBuffer == NULL) {
+        errorMessage("fillRectInContext() No Buffer at #%d", pContext->nBufferNumber);
+        return;
+    }
+    fillClippedRectInBuffer(pContext->pBuffer, &pContext->clip, locX, locY, nWidth, nHeight, pContext->nFillColor);
+    markContextDirtyRect(pContext, locX, locY, nWidth, nHeight);
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static void markContextDirtyRect(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight)
+{
+    // only what survived the clip
+    int nMinX = MAX(locX, pContext->clip.nMinX);
+    int nMinY = MAX(locY, pContext->clip.nMinY);
+    int nMaxX = MIN(locX + nWidth - 1, pContext->clip.nMaxX);
+    int nMaxY = MIN(locY + nHeight - 1, pContext->clip.nMaxY);
+    if(nMaxX >= nMinX && nMaxY >= nMinY) {
+        markBufferDirtyRect(pContext->nBufferNumber, nMinX, nMinY, (nMaxX - nMinX) + 1, (nMaxY - nMinY) + 1);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef DRAW_CONTEXT_H
+#define DRAW_CONTEXT_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+// all the state one renderer needs to draw into a buffer: give each thread its
+//  own context and threads drawing into different buffers never share anything
+struct _DrawContext {
+    uint16_t nBufferNumber;     // target buffer
+    struct _LedPixel *pBuffer;  // its address, NULL if buffer not allocated
+    int nPenX;                  // where moveTo/lineTo left off
+    int nPenY;
+    struct _ClipRect clip;      // nothing is drawn outside this (always within screen)
+    uint32_t nLineColor;        // lines and shape borders
+    uint32_t nFillColor;        // shape interiors (when bFill)
+    uint8_t nLineWidth;         // line width, shape border width (0 = no border)
+    uint8_t bFill;              // T/F shapes are filled
+};
+
+// pen at 0,0, clip to whole screen, 1 pixel white lines, no fill; 0 on success
+int initDrawContext(struct _DrawContext *pContext, uint16_t nBufferNumber);
+
+// retarget context (pen, clip and colors kept), 0 on success
+int setDrawContextBuffer(struct _DrawContext *pContext, uint16_t nBufferNumber);
+
+// limit drawing to rectangle (clipped to screen), or to whole screen
+void setDrawContextClip(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight);
+void resetDrawContextClip(struct _DrawContext *pContext);
+
+// pen drawing, lines end with pen at new X,Y
+void moveToInContext(struct _DrawContext *pContext, int locX, int locY);
+void lineToInContext(struct _DrawContext *pContext, int locX, int locY);
+void lineToInContextAA(struct _DrawContext *pContext, int locX, int locY);   // anti-aliased, 1 pixel wide
+
+// shapes: border nLineWidth of nLineColor, filled with nFillColor if bFill
+void drawRectInContext(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight);
+void drawCircleInContext(struct _DrawContext *pContext, int nCenterX, int nCenterY, int nRadius);
+void drawPolygonInContext(struct _DrawContext *pContext, const int16_t *pPointsXY, int nPoints);
+
+// solid rectangle of nFillColor (no border)
+void fillRectInContext(struct _DrawContext *pContext, int locX, int locY, int nWidth, int nHeight);
+
+#endif /* DRAW_CONTEXT_H */
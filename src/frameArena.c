@@ -0,0 +1,188 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "frameArena.h"
+#include "debug.h"
+
+//  All frame buffers live in a single anonymous mapping.  At startup we reserve
+//  address space for the most frames we will ever hold (PROT_NONE, costs no RAM)
+//  and then open it up (mprotect) a page at a time as frames are allocated:
+//
+//    - frame N is always at base + N * stride, so lookup is one multiply
+//    - frames never move when we grow, pointers handed out stay good
+//    - the whole set is one region to mlock(), madvise() or hand to another process
+//
+//  The stride is rounded up to a cache line so every frame starts aligned for
+//  the wide stores in pixelFill.c.
+
+#define FRAME_ALIGN_BYTES 64
+
+struct _FrameArena frameArena;
+
+// -----------------------
+// forward declarations
+//
+static size_t roundUpTo(size_t nValue, size_t nMultiple);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+int initFrameArena(size_t nFrameBytes, uint16_t nMaxFrames)
+{
+    if(frameArena.pBase != NULL) {
+        errorMessage("[CODE] initFrameArena() arena already set up");
+        return -1;  // FAILURE
+    }
+    size_t nPageBytes = sysconf(_SC_PAGESIZE);
+    size_t nFrameStride = roundUpTo(nFrameBytes, FRAME_ALIGN_BYTES);
+    size_t nReservedBytes = roundUpTo(nFrameStride * nMaxFrames, nPageBytes);
+
+    void *pBase = mmap(NULL, nReservedBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(pBase == MAP_FAILED) {
+        perrorMessage("mmap() of %lu byte frame arena failed", (unsigned long)nReservedBytes);
+        return -1;  // FAILURE
+    }
+#ifdef MADV_HUGEPAGE
+    // best effort: fewer TLB misses when walking many frames, ignored where THP is off
+    if(madvise(pBase, nReservedBytes, MADV_HUGEPAGE) != 0) {
+        debugMessage("frame arena: transparent hugepages not available");
+    }
+#endif
+    frameArena.pBase = pBase;
+    frameArena.nFrameStride = nFrameStride;
+    frameArena.nReservedBytes = nReservedBytes;
+    frameArena.nCommittedBytes = 0;
+    frameArena.nMaxFrames = nMaxFrames;
+    frameArena.nFrames = 0;
+    frameArena.bLocked = 0;
+    debugMessage("- Reserved frame arena@%p:[%d frames max][%lu bytes/frame][%lu bytes]", pBase, nMaxFrames, (unsigned long)nFrameStride, (unsigned long)nReservedBytes);
+    return 0;   // SUCCESS
+}
+
+int growFrameArena(uint16_t nFrames)
+{
+    if(frameArena.pBase == NULL) {
+        errorMessage("[CODE] growFrameArena() before initFrameArena()");
+        return -1;  // FAILURE
+    }
+    if(nFrames > frameArena.nMaxFrames) {
+        warningMessage("buffer %d out-of-range: MAX %d supported", nFrames, frameArena.nMaxFrames);
+        return -1;  // FAILURE
+    }
+    if(nFrames <= frameArena.nFrames) {
+        return 0;   // SUCCESS, already have them
+    }
+    size_t nPageBytes = sysconf(_SC_PAGESIZE);
+    size_t nNeededBytes = roundUpTo(nFrames * frameArena.nFrameStride, nPageBytes);
+    if(nNeededBytes > frameArena.nCommittedBytes) {
+        uint8_t *pNewPages = frameArena.pBase + frameArena.nCommittedBytes;
+        size_t nNewBytes = nNeededBytes - frameArena.nCommittedBytes;
+        if(mprotect(pNewPages, nNewBytes, PROT_READ | PROT_WRITE) != 0) {
+            perrorMessage("mprotect() failed to open %lu bytes of frame arena", (unsigned long)nNewBytes);
+            return -1;  // FAILURE
+        }
+        if(frameArena.bLocked && mlock(pNewPages, nNewBytes) != 0) {
+            perrorMessage("mlock() of new frames failed, frames not locked");
+        }
+        frameArena.nCommittedBytes = nNeededBytes;
+    }
+    // frames freed earlier may have left data in a page we kept
+    uint8_t *pFirstNewFrame = ptrFrameInArena(frameArena.nFrames);
+    memset(pFirstNewFrame, 0, (nFrames - frameArena.nFrames) * frameArena.nFrameStride);
+    debugMessage("frame arena: %d -> %d frames (%lu bytes committed)", frameArena.nFrames, nFrames, (unsigned long)frameArena.nCommittedBytes);
+    frameArena.nFrames = nFrames;
+    return 0;   // SUCCESS
+}
+
+void shrinkFrameArena(uint16_t nFrames)
+{
+    if(frameArena.pBase == NULL || nFrames >= frameArena.nFrames) {
+        return;
+    }
+    size_t nPageBytes = sysconf(_SC_PAGESIZE);
+    size_t nKeepBytes = roundUpTo(nFrames * frameArena.nFrameStride, nPageBytes);
+    if(nKeepBytes < frameArena.nCommittedBytes) {
+        uint8_t *pFreePages = frameArena.pBase + nKeepBytes;
+        size_t nFreeBytes = frameArena.nCommittedBytes - nKeepBytes;
+        if(frameArena.bLocked) {
+            munlock(pFreePages, nFreeBytes);
+        }
+        // drop the RAM then close the range again so stray pointers fault
+        if(madvise(pFreePages, nFreeBytes, MADV_DONTNEED) != 0) {
+            perrorMessage("madvise() failed to release frame arena pages");
+        }
+        if(mprotect(pFreePages, nFreeBytes, PROT_NONE) != 0) {
+            perrorMessage("mprotect() failed to close frame arena pages");
+        }
+        frameArena.nCommittedBytes = nKeepBytes;
+    }
+    debugMessage("frame arena: %d -> %d frames (%lu bytes committed)", frameArena.nFrames, nFrames, (unsigned long)frameArena.nCommittedBytes);
+    frameArena.nFrames = nFrames;
+}
+
+int lockFrameArena(int bLock)
+{
+    int nStatus = 0;    // SUCCESS
+
+    if(frameArena.pBase == NULL) {
+        errorMessage("[CODE] lockFrameArena() before initFrameArena()");
+        return -1;  // FAILURE
+    }
+    if(bLock && !frameArena.bLocked) {
+        if(frameArena.nCommittedBytes > 0 && mlock(frameArena.pBase, frameArena.nCommittedBytes) != 0) {
+            perrorMessage("mlock() of %lu byte frame arena failed (see ulimit -l)", (unsigned long)frameArena.nCommittedBytes);
+            nStatus = -1;   // FAILURE
+        }
+        else {
+            frameArena.bLocked = 1;
+        }
+    }
+    else if(!bLock && frameArena.bLocked) {
+        if(frameArena.nCommittedBytes > 0) {
+            munlock(frameArena.pBase, frameArena.nCommittedBytes);
+        }
+        frameArena.bLocked = 0;
+    }
+    return nStatus;
+}
+
+void showFrameArena(void)
+{
+    infoMessage("Frame arena @%p: %d of %d frames, %lu bytes/frame, %lu of %lu bytes committed%s",
+        frameArena.pBase, frameArena.nFrames, frameArena.nMaxFrames,
+        (unsigned long)frameArena.nFrameStride,
+        (unsigned long)frameArena.nCommittedBytes, (unsigned long)frameArena.nReservedBytes,
+        (frameArena.bLocked) ? ", locked in RAM" : "");
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static size_t roundUpTo(size_t nValue, size_t nMultiple)
+{
+    return ((nValue + nMultiple - 1) / nMultiple) * nMultiple;
+}
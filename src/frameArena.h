@@ -0,0 +1,61 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// one contiguous mapping holding every frame buffer back-to-back
+struct _FrameArena {
+    uint8_t *pBase;         // page aligned, NULL until initFrameArena()
+    size_t nFrameStride;    // bytes from one frame to the next (frame size rounded up to cache line)
+    size_t nReservedBytes;  // address space held for nMaxFrames
+    size_t nCommittedBytes; // leading part of reservation which is readable/writable
+    uint16_t nMaxFrames;
+    uint16_t nFrames;       // frames in use
+    uint8_t bLocked;        // T/F committed frames are mlock()ed
+};
+
+extern struct _FrameArena frameArena;
+
+// reserve (but do not yet commit) room for nMaxFrames frames of nFrameBytes each, 0 on success
+int initFrameArena(size_t nFrameBytes, uint16_t nMaxFrames);
+
+// ensure first nFrames frames are usable, newly added frames are zero filled, 0 on success
+int growFrameArena(uint16_t nFrames);
+
+// give frames past the first nFrames back to the system (contents discarded)
+void shrinkFrameArena(uint16_t nFrames);
+
+// T/F pin committed (and later grown) frames into RAM, 0 on success
+int lockFrameArena(int bLock);
+
+void showFrameArena(void);
+
+// frame N (0-based) - NO checks, nFrameIdx must be < frameArena.nFrames
+static inline uint8_t *ptrFrameInArena(uint16_t nFrameIdx)
+{
+    return frameArena.pBase + ((size_t)nFrameIdx * frameArena.nFrameStride);
+}
+
+#endif /* FRAME_ARENA_H */
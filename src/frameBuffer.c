@@ -20,43 +20,73 @@ Inc., 59    Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 */
 
 #include <stdio.h>
+#include <stdlib.h>     // abs()
 #include <string.h>
+#include <pthread.h>
 
 #include "frameBuffer.h"
-#include "xmalloc.h"
 #include "debug.h"
-#include "charSet.h"
+#include "glyphCache.h"
+#include "bitmapFont.h"
+#include "pixelFill.h"
+#include "rasterizer.h"
+#include "frameArena.h"
+#include "drawContext.h"
 
-#define MAX_BUFFER_POINTERS 50
-// setup our master frame buffer
-static struct _LedPixel *pFrameBufferAr[MAX_BUFFER_POINTERS + 1];
-static int nNumberAllocatedBuffers;
+#define MIN(a,b) ((a < b) ? a : b)
+#define MAX(a,b) ((a > b) ? a : b)
+
+// our frame buffers all live in the frame arena, buffer N is arena frame N-1
+#define MAX_BUFFERS 4096
 
 static int nLenPanel;
 static int nLenFrameBuffer;
 
+static struct _DirtyRegion s_dirtyRegionAr[MAX_BUFFERS];
+static pthread_mutex_t s_allocMutex = PTHREAD_MUTEX_INITIALIZER;   // render threads may alloc/free while others draw
+static pthread_mutex_t s_dirtyMutex = PTHREAD_MUTEX_INITIALIZER;   // marks from any thread vs. compositor read-and-reset
+
+// -----------------------
+// forward declarations
+//
+static uint16_t allocatedBufferCount(void);
+static void setRegionClean(struct _DirtyRegion *pRegion);
+static void mergeIntoBufferRegion(uint16_t nBufferNumber, const struct _DirtyRegion *pAdded);
+static void addRectToRegion(struct _DirtyRegion *pRegion, int nMinX, int nMinY, int nMaxX, int nMaxY);
+static void addLaneRunToRegion(struct _DirtyRegion *pRegion, uint8_t nLane, int nFirstLed, int nLastLed);
+static void copyLedRun(struct _LedPixel *pDstBuffer, uint16_t nDstLedIdx, int nDstStep, const struct _LedPixel *pSrcBuffer, uint16_t nSrcLedIdx, int nSrcStep, int nLedCount);
+static int initShapeContext(struct _DrawContext *pContext, uint16_t nBufferNumber, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+static void writeStringLineToBuffer(uint16_t nBufferNumber, const struct _Font *pFont, const char *cString, int nBytes, int locX, int locY, uint32_t nColorRGB);
+
 void initBuffers(void)
 {
     nLenPanel = (sizeof(struct _LedPixel) * LEDS_PER_PANEL);
     nLenFrameBuffer = (nLenPanel * NUMBER_OF_PANELS);
-    nNumberAllocatedBuffers = 0;
 
-    // alloc our frame buffers and init to black
-    if(pFrameBufferAr[0] == NULL) {
-        pFrameBufferAr[0] = xmalloc(nLenFrameBuffer);
-        pFrameBufferAr[1] = NULL; // we always have a null pointer at end of list of buffer pointers
-        nNumberAllocatedBuffers = 1;
-        debugMessage("- Allocated frameBuffer@%p:[%d buffers][%d panels][%d LEDs][%d bytes]\n", pFrameBufferAr[0], 1, NUMBER_OF_PANELS, LEDS_PER_PANEL, sizeof(struct _LedPixel));
+    initPanelLayout();
+    initFonts();
+
+    // reserve room for all buffers we could ever have then alloc our first, init to black
+    if(frameArena.pBase == NULL) {
+        if(initFrameArena(nLenFrameBuffer + sizeof(struct _LedPixel), MAX_BUFFERS) != 0) {   // + LAYOUT_NO_LED_IDX spare
+            errorMessage("[CODE] failed to reserve frame buffer arena");
+            return;
+        }
+        if(growFrameArena(1) == 0) {
+            markBufferAllDirty(1);
+            debugMessage("- Allocated frameBuffer@%p:[%d buffers][%d panels][%d LEDs][%d bytes]\n", ptrFrameInArena(0), 1, NUMBER_OF_PANELS, LEDS_PER_PANEL, sizeof(struct _LedPixel));
+        }
     }
 }
 
 void clearBuffers(void)
 {
-    for(int nBffrIdx = 0; nBffrIdx < nNumberAllocatedBuffers; nBffrIdx++) {
+    for(int nBffrIdx = 0; nBffrIdx < frameArena.nFrames; nBffrIdx++) {
         // write zeros to our entire set of buffers
-        memset(pFrameBufferAr[nBffrIdx], 0, nLenFrameBuffer);
+        memset(ptrFrameInArena(nBffrIdx), 0, nLenFrameBuffer);
+        markBufferAllDirty(nBffrIdx + 1);
     }
-    debugMessage("clearBuffers() - %d Buffers reset to zero", nNumberAllocatedBuffers);
+    debugMessage("clearBuffers() - %d Buffers reset to zero", frameArena.nFrames);
 }
 
 int allocBuffers(int nDesiredBuffers)
@@ -64,32 +94,42 @@ int allocBuffers(int nDesiredBuffers)
     int allocStatus = 0;    // SUCCESS
 
     //debugMessage("allocBuffers(%d) - ENTRY", nDesiredBuffers);
-    if(nDesiredBuffers > MAX_BUFFER_POINTERS) {
-        warningMessage("buffer %d out-of-range: MAX %d supported", nDesiredBuffers, MAX_BUFFER_POINTERS);
-    }
-    else if(nDesiredBuffers > nNumberAllocatedBuffers) {
-        debugMessage("Alloc %d additional buffers", nDesiredBuffers - nNumberAllocatedBuffers);
-        for(int nBffrIdx = nNumberAllocatedBuffers; nBffrIdx < nDesiredBuffers; nBffrIdx++) {
-            pFrameBufferAr[nBffrIdx] = xmalloc(nLenFrameBuffer);
-            if(pFrameBufferAr[nBffrIdx] == NULL) {
-                errorMessage("[CODE] failed to allocate buffer %d (of %d), Aborted", nBffrIdx, nDesiredBuffers);
-                allocStatus = -1; // FAILURE
-                break;
-            }
-            else {
-                debugMessage("allocated buffer[%d] @%p", nBffrIdx,pFrameBufferAr[nBffrIdx]);
-                nNumberAllocatedBuffers++;
+    pthread_mutex_lock(&s_allocMutex);
+    if(nDesiredBuffers > MAX_BUFFERS) {
+        warningMessage("buffer %d out-of-range: MAX %d supported", nDesiredBuffers, MAX_BUFFERS);
+    }
+    else if(nDesiredBuffers > frameArena.nFrames) {
+        int nFirstNewBuffer = frameArena.nFrames + 1;
+        debugMessage("Alloc %d additional buffers", nDesiredBuffers - frameArena.nFrames);
+        if(growFrameArena(nDesiredBuffers) != 0) {
+            errorMessage("[CODE] failed to allocate buffers %d-%d, Aborted", nFirstNewBuffer, nDesiredBuffers);
+            allocStatus = -1; // FAILURE
+        }
+        else {
+            for(int nBufferNumber = nFirstNewBuffer; nBufferNumber <= nDesiredBuffers; nBufferNumber++) {
+                markBufferAllDirty(nBufferNumber);
             }
         }
-        pFrameBufferAr[nDesiredBuffers] = NULL; // place trailing NULL at end of list
     }
+    pthread_mutex_unlock(&s_allocMutex);
     //debugMessage("allocBuffers() - EXIT");
     return allocStatus;
 }
 
-uint8_t numberBuffers(void)
+void freeBuffers(void)
 {
-    return nNumberAllocatedBuffers;
+    // we always keep buffer 1
+    pthread_mutex_lock(&s_allocMutex);
+    shrinkFrameArena(1);
+    memset(ptrFrameInArena(0), 0, nLenFrameBuffer);
+    markBufferAllDirty(1);
+    pthread_mutex_unlock(&s_allocMutex);
+    debugMessage("freeBuffers() - back to 1 buffer");
+}
+
+uint16_t numberBuffers(void)
+{
+    return allocatedBufferCount();
 }
 
 uint8_t numberPanels(void)
@@ -112,16 +152,16 @@ uint16_t frameBufferSizeInBytes(void)
     return nLenFrameBuffer;
 }
 
-struct _LedPixel *ptrBuffer(uint8_t nBufferNumber)
+struct _LedPixel *ptrBuffer(uint16_t nBufferNumber)
 {
     struct _LedPixel *desiredAddr = NULL;
 
-    if(nBufferNumber > 0 && nBufferNumber <= nNumberAllocatedBuffers) {
-        desiredAddr = (struct _LedPixel *)pFrameBufferAr[nBufferNumber - 1];
+    if(nBufferNumber > 0 && nBufferNumber <= allocatedBufferCount()) {
+        desiredAddr = (struct _LedPixel *)ptrFrameInArena(nBufferNumber - 1);
     }
     else {
-        if(nBufferNumber < 1 || nBufferNumber > MAX_BUFFER_POINTERS) {
-            warningMessage("buffer %d out-of-range: [1-%d]", nBufferNumber, MAX_BUFFER_POINTERS);
+        if(nBufferNumber < 1 || nBufferNumber > MAX_BUFFERS) {
+            warningMessage("buffer %d out-of-range: [1-%d]", nBufferNumber, MAX_BUFFERS);
         }
         else {
             warningMessage("buffer %d NOT yet Allocated. Use 'buffers %d' to allocate it", nBufferNumber, nBufferNumber);
@@ -134,7 +174,11 @@ struct _LedPixel *ptrPanel(struct _LedPixel *pBuffer, uint8_t nPanel)
 {
     struct _LedPixel *desiredAddr = NULL;
 
-    if(pBuffer != NULL && nPanel < NUMBER_OF_PANELS) {
+    if(screenLayout.eFrameFormat != FF_LANE_SEQUENTIAL) {
+        // panel LEDs are spread across the buffer, use ledIndexForLane()
+        errorMessage("[CODE] ptrPanel() panels are not contiguous in lane-interleaved buffers");
+    }
+    else if(pBuffer != NULL && nPanel < NUMBER_OF_PANELS) {
         desiredAddr = &pBuffer[nPanel * LEDS_PER_PANEL];
     }
     else if(nPanel < NUMBER_OF_PANELS) {
@@ -146,83 +190,183 @@ struct _LedPixel *ptrPanel(struct _LedPixel *pBuffer, uint8_t nPanel)
     return desiredAddr;
 }
 
-void fillBufferWithColorRGB(uint8_t nBufferNumber, uint32_t nColorRGB)
+void fillBufferWithColorRGB(uint16_t nBufferNumber, uint32_t nColorRGB)
 {
     struct _LedPixel *pSelectedBuffer = ptrBuffer(nBufferNumber);
     if(pSelectedBuffer != NULL) {
-        int nMaxLEDs = maxLedsInBuffer();
-        uint8_t red = (nColorRGB >> 16) & 0xff;
-        uint8_t green = (nColorRGB >> 8) & 0xff;
-        uint8_t blue = (nColorRGB >> 0) & 0xff;
-        for(int nLedIdx = 0; nLedIdx < nMaxLEDs; nLedIdx++) {
-            pSelectedBuffer[nLedIdx].red = red;
-            pSelectedBuffer[nLedIdx].green = green;
-            pSelectedBuffer[nLedIdx].blue = blue;
-        }
+        fillLedRun(pSelectedBuffer, maxLedsInBuffer(), nColorRGB);
+        markBufferAllDirty(nBufferNumber);
     }
     else {
         errorMessage("fillBufferWithColorRGB() No Buffer at #%d", nBufferNumber);
     }
 }
 
-void fillBufferPanelWithColorRGB(uint8_t nBufferNumber, uint8_t nPanelNumber, uint32_t nColorRGB)
+void fillBufferPanelWithColorRGB(uint16_t nBufferNumber, uint8_t nPanelNumber, uint32_t nColorRGB)
 {
     // We handle panel spec of 12 and 23 !!
-    int nLedsPerPanel = LEDS_PER_PANEL;
+    int nPanelCount = 1;
     if(nPanelNumber == 12) {
         // our "panel" is BOTH panels 1 & 2
         nPanelNumber = 1;
-        nLedsPerPanel = 2 * LEDS_PER_PANEL;
+        nPanelCount = 2;
     }
     else if(nPanelNumber == 23) {
         // our "panel" is BOTH panels 2 & 3
         nPanelNumber = 2;
-        nLedsPerPanel = 2 * LEDS_PER_PANEL;
+        nPanelCount = 2;
     }
     struct _LedPixel *pSelectedBuffer = ptrBuffer(nBufferNumber);
     if(pSelectedBuffer != NULL && nPanelNumber >= 1 && nPanelNumber <= NUMBER_OF_PANELS) {
-        uint16_t nOffsetToPanel = (nPanelNumber - 1) * nLedsPerPanel;
-        struct _LedPixel *pSelectedBufferPanel = &pSelectedBuffer[nOffsetToPanel];
-        uint8_t red = (nColorRGB >> 16) & 0xff;
-        uint8_t green = (nColorRGB >> 8) & 0xff;
-        uint8_t blue = (nColorRGB >> 0) & 0xff;
-        for(int nLedIdx = 0; nLedIdx < LEDS_PER_PANEL; nLedIdx++) {
-            pSelectedBufferPanel[nLedIdx].red = red;
-            pSelectedBufferPanel[nLedIdx].green = green;
-            pSelectedBufferPanel[nLedIdx].blue = blue;
+        // a panel is one lane of the driver frame
+        int nLaneStride = ledIndexForLane(screenLayout.eFrameFormat, 0, 1);
+        struct _DirtyRegion filled;
+        struct _DirtyRegion *pRegion = &filled;
+        setRegionClean(pRegion);
+        for(int nLane = nPanelNumber - 1; nLane < nPanelNumber - 1 + nPanelCount; nLane++) {
+            struct _LedPixel *pFirstLed = &pSelectedBuffer[ledIndexForLane(screenLayout.eFrameFormat, nLane, 0)];
+            fillLedStride(pFirstLed, LEDS_PER_PANEL, nLaneStride, nColorRGB);
+            // screen area is wherever layout put this lane's panels
+            addLaneRunToRegion(pRegion, nLane, 0, LEDS_PER_PANEL - 1);
+            for(int nPanelIdx = 0; nPanelIdx < screenLayout.nPanels; nPanelIdx++) {
+                const struct _PanelSpec *pPanel = &screenLayout.panels[nPanelIdx];
+                if(pPanel->nLane == nLane) {
+                    int bIsSideways = (pPanel->nRotation == 90 || pPanel->nRotation == 270);
+                    int nOnScreenWidth = (bIsSideways) ? pPanel->nRows : pPanel->nColumns;
+                    int nOnScreenHeight = (bIsSideways) ? pPanel->nColumns : pPanel->nRows;
+                    addRectToRegion(pRegion, pPanel->nOriginX, pPanel->nOriginY, pPanel->nOriginX + nOnScreenWidth - 1, pPanel->nOriginY + nOnScreenHeight - 1);
+                }
+            }
         }
+        mergeIntoBufferRegion(nBufferNumber, pRegion);
     }
     else {
         errorMessage("fillBufferPanelWithColorRGB() No Buffer at #%d, panel-#%d", nBufferNumber, nPanelNumber);
     }
 }
 
-void setBufferLEDColor(uint8_t nBufferNumber, uint32_t nColorRGB, uint8_t locX, uint8_t locY)
+void fillBufferRectWithColorRGB(uint16_t nBufferNumber, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB)
 {
     struct _LedPixel *pSelectedBuffer = ptrBuffer(nBufferNumber);
     if(pSelectedBuffer != NULL) {
-        // do we have bottom to top numbered column
-        int bGoesUpPanelY = (locX & 0x01) == 1;
-        uint8_t nPanelIdx = (locY / 8);
-        uint8_t nPanelY = (locY % 8);
-        uint16_t nColumnLEDidx = ((32 - 1) - locX) * 8;
-        uint16_t nOffsetToPanel = nPanelIdx * LEDS_PER_PANEL;
-        uint16_t nLEDIdx = (bGoesUpPanelY == 0) ? nColumnLEDidx + nPanelY : nColumnLEDidx + (7 - nPanelY);
-        nLEDIdx += nOffsetToPanel;
-
-        uint8_t red = (nColorRGB >> 16) & 0xff;
-        uint8_t green = (nColorRGB >> 8) & 0xff;
-        uint8_t blue = (nColorRGB >> 0) & 0xff;
-        pSelectedBuffer[nLEDIdx].red = red;
-        pSelectedBuffer[nLEDIdx].green = green;
-        pSelectedBuffer[nLEDIdx].blue = blue;
+        // off-screen part is clipped
+        fillRectInBuffer(pSelectedBuffer, locX, locY, nWidth, nHeight, nColorRGB);
+        markBufferDirtyRect(nBufferNumber, locX, locY, nWidth, nHeight);
+    }
+    else {
+        errorMessage("fillBufferRectWithColorRGB() No Buffer at #%d", nBufferNumber);
+    }
+}
+
+//  Copy works a line at a time along the direction the LED strings run (columns on
+//  our serpentine panels).  Neighboring pixels whose source and destination LEDs are
+//  both consecutive become one run: a memcpy when both run the same way (e.g. a
+//  column moved an even number of columns), reversed LED by LED when they don't.
+//
+void copyBufferWithShift(uint16_t nSrcBufferNumber, uint16_t nDstBufferNumber, int nShiftDown, int nShiftRight, eShiftEdge eEdge, uint32_t nFillColorRGB)
+{
+    const struct _LedPixel *pSrcBuffer = ptrBuffer(nSrcBufferNumber);
+    struct _LedPixel *pDstBuffer = ptrBuffer(nDstBufferNumber);
+    struct _LedPixel scratchAr[LAYOUT_NO_LED_IDX + 1];    // source snapshot when copying buffer onto itself (on stack, so reentrant)
+    if(pSrcBuffer == NULL || pDstBuffer == NULL) {
+        errorMessage("copyBufferWithShift() No Buffer at #%d or #%d", nSrcBufferNumber, nDstBufferNumber);
+        return;
+    }
+    if(pSrcBuffer == pDstBuffer) {
+        memcpy(scratchAr, pSrcBuffer, sizeof(scratchAr));
+        pSrcBuffer = scratchAr;
+    }
+
+    // work in (across, along) where along is the direction LED strings run
+    int bAlongColumns = isLayoutColumnMajor();
+    int nAcrossCount = (bAlongColumns) ? SCREEN_WIDTH : SCREEN_HEIGHT;
+    int nAlongCount = (bAlongColumns) ? SCREEN_HEIGHT : SCREEN_WIDTH;
+    int nAcrossShift = (bAlongColumns) ? nShiftRight : nShiftDown;
+    int nAlongShift = (bAlongColumns) ? nShiftDown : nShiftRight;
+    int nAlongStride = (bAlongColumns) ? SCREEN_WIDTH : 1;
+    int nAcrossStride = (bAlongColumns) ? 1 : SCREEN_WIDTH;
+    const uint16_t *pTable = screenLayout.pXlateTable;
+
+    if(eEdge == SE_WRAP) {
+        nAcrossShift %= nAcrossCount;
+        nAlongShift %= nAlongCount;
+    }
+    else {
+        // shifted-in area is filled first, copy then overwrites the rest
+        int nCoveredMinX = MAX(0, nShiftRight);
+        int nCoveredMaxX = MIN(SCREEN_WIDTH, SCREEN_WIDTH + nShiftRight) - 1;
+        int nCoveredMinY = MAX(0, nShiftDown);
+        int nCoveredMaxY = MIN(SCREEN_HEIGHT, SCREEN_HEIGHT + nShiftDown) - 1;
+        if(nCoveredMaxX < nCoveredMinX || nCoveredMaxY < nCoveredMinY) {
+            fillRectInBuffer(pDstBuffer, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, nFillColorRGB);
+            markBufferAllDirty(nDstBufferNumber);
+            return;
+        }
+        fillRectInBuffer(pDstBuffer, 0, 0, SCREEN_WIDTH, nCoveredMinY, nFillColorRGB);
+        fillRectInBuffer(pDstBuffer, 0, nCoveredMaxY + 1, SCREEN_WIDTH, SCREEN_HEIGHT - (nCoveredMaxY + 1), nFillColorRGB);
+        fillRectInBuffer(pDstBuffer, 0, nCoveredMinY, nCoveredMinX, (nCoveredMaxY - nCoveredMinY) + 1, nFillColorRGB);
+        fillRectInBuffer(pDstBuffer, nCoveredMaxX + 1, nCoveredMinY, SCREEN_WIDTH - (nCoveredMaxX + 1), (nCoveredMaxY - nCoveredMinY) + 1, nFillColorRGB);
+    }
+
+    for(int nDstAcross = 0; nDstAcross < nAcrossCount; nDstAcross++) {
+        int nSrcAcross = nDstAcross - nAcrossShift;
+        if(nSrcAcross < 0 || nSrcAcross >= nAcrossCount) {
+            if(eEdge != SE_WRAP) {
+                continue;   // filled above
+            }
+            nSrcAcross = (nSrcAcross + nAcrossCount) % nAcrossCount;
+        }
+        const uint16_t *pDstLine = &pTable[nDstAcross * nAcrossStride];
+        const uint16_t *pSrcLine = &pTable[nSrcAcross * nAcrossStride];
+        int nDstAlong = 0;
+        while(nDstAlong < nAlongCount) {
+            int nSrcAlong = nDstAlong - nAlongShift;
+            if(nSrcAlong < 0 || nSrcAlong >= nAlongCount) {
+                if(eEdge != SE_WRAP) {
+                    nDstAlong++;    // filled above
+                    continue;
+                }
+                nSrcAlong = (nSrcAlong + nAlongCount) % nAlongCount;
+            }
+            uint16_t nDstLedIdx = pDstLine[nDstAlong * nAlongStride];
+            uint16_t nSrcLedIdx = pSrcLine[nSrcAlong * nAlongStride];
+            int nDstStep = 0;
+            int nSrcStep = 0;
+            int nRunLength = 1;
+            if(nDstAlong + 1 < nAlongCount && nSrcAlong + 1 < nAlongCount) {
+                nDstStep = pDstLine[(nDstAlong + 1) * nAlongStride] - nDstLedIdx;
+                nSrcStep = pSrcLine[(nSrcAlong + 1) * nAlongStride] - nSrcLedIdx;
+                if((nDstStep == 1 || nDstStep == -1) && (nSrcStep == 1 || nSrcStep == -1)) {
+                    while(nDstAlong + nRunLength < nAlongCount && nSrcAlong + nRunLength < nAlongCount &&
+                          pDstLine[(nDstAlong + nRunLength) * nAlongStride] == nDstLedIdx + (nRunLength * nDstStep) &&
+                          pSrcLine[(nSrcAlong + nRunLength) * nAlongStride] == nSrcLedIdx + (nRunLength * nSrcStep)) {
+                        nRunLength++;
+                    }
+                }
+            }
+            copyLedRun(pDstBuffer, nDstLedIdx, nDstStep, pSrcBuffer, nSrcLedIdx, nSrcStep, nRunLength);
+            nDstAlong += nRunLength;
+        }
+    }
+    markBufferAllDirty(nDstBufferNumber);
+}
+
+void setBufferLEDColor(uint16_t nBufferNumber, uint32_t nColorRGB, uint8_t locX, uint8_t locY)
+{
+    struct _LedPixel *pSelectedBuffer = ptrBuffer(nBufferNumber);
+    if(pSelectedBuffer != NULL) {
+        // off-screen pixels are clipped
+        if(IS_ON_SCREEN(locX, locY)) {
+            setLEDColorInBuffer(pSelectedBuffer, nColorRGB, locX, locY);
+            markBufferDirtyRect(nBufferNumber, locX, locY, 1, 1);
+        }
     }
     else {
         errorMessage("setBufferLEDColor() No Buffer at #%d", nBufferNumber);
     }
 }
 
-void drawSquareInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY, uint8_t nPanelNumber, uint8_t nWidth, uint8_t nHeight, uint8_t nLineWidth, uint32_t nLineColor)
+void drawSquareInBuffer(uint16_t nBufferNumber, uint8_t locX, uint8_t locY, uint8_t nPanelNumber, uint8_t nWidth, uint8_t nHeight, uint8_t nLineWidth, uint32_t nLineColor)
 {
     // We handle panel spec of 12 and 23 !!
     int nRowsPerPanel = 8;
@@ -242,76 +386,56 @@ void drawSquareInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY, uint8
         nHeight = nRowsPerPanel;
     }
 
-    moveToInBuffer(nBufferNumber, locX, locY);
-
-    lineToInBuffer(nBufferNumber, locX + nWidth - 1, locY, nLineWidth, nLineColor, nRowsPerPanel);
-    lineToInBuffer(nBufferNumber, locX + nWidth - 1, locY + nHeight -1, nLineWidth, nLineColor, nRowsPerPanel);
-    lineToInBuffer(nBufferNumber, locX, locY + nHeight -1, nLineWidth, nLineColor, nRowsPerPanel);
-    lineToInBuffer(nBufferNumber, locX, locY, nLineWidth, nLineColor, nRowsPerPanel);
+    // border lines are kept inside the square
+    drawRectInBuffer(nBufferNumber, locX, locY, nWidth, nHeight, nLineWidth, nLineColor, 0, 0x000000);
 }
 
-static int nPenX;
-static int nPenY;
+void drawRectInBuffer(uint16_t nBufferNumber, int locX, int locY, int nWidth, int nHeight, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    struct _DrawContext context;
+    if(initShapeContext(&context, nBufferNumber, nBorderWidth, nBorderColor, bFill, nFillColor) != 0) {
+        errorMessage("drawRectInBuffer() No Buffer at #%d", nBufferNumber);
+    }
+    else {
+        drawRectInContext(&context, locX, locY, nWidth, nHeight);
+    }
+}
 
-void moveToInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY)
+void drawCircleInBuffer(uint16_t nBufferNumber, int nCenterX, int nCenterY, int nRadius, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
 {
-    debugMessage("moveTo() bfr #%d rc=(%d, %d)", nBufferNumber, locX, locY);
-    nPenX = locX;
-    nPenY = locY;
+    struct _DrawContext context;
+    if(initShapeContext(&context, nBufferNumber, nBorderWidth, nBorderColor, bFill, nFillColor) != 0) {
+        errorMessage("drawCircleInBuffer() No Buffer at #%d", nBufferNumber);
+    }
+    else {
+        drawCircleInContext(&context, nCenterX, nCenterY, nRadius);
+    }
 }
 
-#define MIN(a,b) ((a < b) ? a : b)
-#define MAX(a,b) ((a > b) ? a : b)
+void drawTriangleInBuffer(uint16_t nBufferNumber, int nApexX, int nApexY, int nBaseWidth, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    // isosceles, apex at top, sides at 45 degrees so base must be odd to center on apex
+    int nHalfBase = (nBaseWidth - 1) / 2;
+    int16_t pointsAr[3 * 2] = {
+        nApexX, nApexY,
+        nApexX + nHalfBase, nApexY + nHalfBase,
+        nApexX - nHalfBase, nApexY + nHalfBase
+    };
+    drawPolygonInBuffer(nBufferNumber, pointsAr, 3, nBorderWidth, nBorderColor, bFill, nFillColor);
+}
 
-void lineToInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY, uint8_t nLineWidth, uint32_t nLineColor, uint8_t nAreaHeight)
-{
-    debugMessage("lineTo() bfr #%d fmRC=(%d, %d), toRC=(%d, %d), w=%d, c=0x%.06X", nBufferNumber, nPenX, nPenY, locX, locY, nLineWidth, nLineColor);
-    int nLineWidthAdjust = (nLineWidth - 1);
-    int bIsHorzOrVertLine = (nPenX == locX) || (nPenY == locY);
-    if(bIsHorzOrVertLine) {
-        if(nPenX == locX) {
-            // draw vertical line
-            int nMinIdxY = MIN(nPenY, locY);
-            int nMaxIdxY = MAX(nPenY, locY);
-            // adjust if nLineWidth offscreen to right
-            if((nPenX + nLineWidthAdjust) > 31) {
-                nPenX -= nLineWidthAdjust;
-            }
-            for(int yIdx = nMinIdxY; yIdx <= nMaxIdxY; yIdx++) {
-                setBufferLEDColor(nBufferNumber, nLineColor, nPenX, yIdx);
-                if(nLineWidth > 1) {
-                    for(int nLineCt = 0; nLineCt < nLineWidth - 1; nLineCt++) {
-                        setBufferLEDColor(nBufferNumber, nLineColor, nPenX + nLineCt + 1, yIdx);
-                    }
-                }
-            }
-            nPenY = locY;
-        }
-        else {
-            // draw horizontal line
-            int nMinIdxX = MIN(nPenX, locX);
-            int nMaxIdxX = MAX(nPenX, locX);
-            // adjust if nLineWidth offscreen to bottom
-            if((nPenY + nLineWidthAdjust) > nAreaHeight - 1) {
-                nPenY -= nLineWidthAdjust;
-            }
-            for(int xIdx = nMinIdxX; xIdx <= nMaxIdxX; xIdx++) {
-                setBufferLEDColor(nBufferNumber, nLineColor, xIdx, nPenY);
-                if(nLineWidth > 1) {
-                    for(int nLineCt = 0; nLineCt < nLineWidth - 1; nLineCt++) {
-                        setBufferLEDColor(nBufferNumber, nLineColor, xIdx, nPenY + nLineCt + 1);
-                    }
-                }
-            }
-            nPenX = locX;
-        }
+void drawPolygonInBuffer(uint16_t nBufferNumber, const int16_t *pPointsXY, int nPoints, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    struct _DrawContext context;
+    if(initShapeContext(&context, nBufferNumber, nBorderWidth, nBorderColor, bFill, nFillColor) != 0) {
+        errorMessage("drawPolygonInBuffer() No Buffer at #%d", nBufferNumber);
     }
     else {
-        warningMessage("- lineToInBuffer() sloped line NOT YET implemented, draw skipped.");
+        drawPolygonInContext(&context, pPointsXY, nPoints);
     }
 }
 
-void writeStringToBufferWithColorRGB(uint8_t nBufferNumber, const char *cString, uint32_t nColorRGB)
+void writeStringToBufferWithColorRGB(uint16_t nBufferNumber, const char *cString, uint32_t nColorRGB)
 {
     int strLen = strlen(cString);
     char *rwCString = (char *)cString;
@@ -321,26 +445,26 @@ void writeStringToBufferWithColorRGB(uint8_t nBufferNumber, const char *cString,
         strLen -= 2;
     }
 
-    writeStringToBufferPanelWithColorRGB(nBufferNumber, &cString[0], 1, nColorRGB);
-    const char *pWord2 = &cString[5];
-    while(*pWord2 == ' ') {
-        pWord2++;
-    }
-    if(*pWord2 != 0x00) {
-        writeStringToBufferPanelWithColorRGB(nBufferNumber, pWord2, 2, nColorRGB);
-        if(strlen(pWord2) >= 5) {
-            const char *pWord3 = &pWord2[5];
-            while(*pWord3 == ' ') {
-                pWord3++;
-            }
-            if(*pWord3 != 0x00) {
-                writeStringToBufferPanelWithColorRGB(nBufferNumber, pWord3, 3, nColorRGB);
+    // as many chars as fit across the screen per line, one line per panel row (or per font height if taller)
+    const struct _Font *pFont = getDefaultFont();
+    int nLinePitch = MAX(ROWS_PER_PANEL, pFont->nHeight);
+    const char *pLine = cString;
+    for(int locY = 0; locY + pFont->nHeight <= SCREEN_HEIGHT && *pLine != 0x00; locY += nLinePitch) {
+        if(pLine != cString) {
+            while(*pLine == ' ') {
+                pLine++;
             }
         }
+        int nBytes = bytesFittingWidth(pFont, pLine, SCREEN_WIDTH - 1);
+        if(nBytes == 0) {
+            break;
+        }
+        writeStringLineToBuffer(nBufferNumber, pFont, pLine, nBytes, 1, locY, nColorRGB);
+        pLine += nBytes;
     }
 }
 
-void writeStringToBufferPanelWithColorRGB(uint8_t nBufferNumber, const char *cString, uint8_t nPanelNumber, uint32_t nColorRGB)
+void writeStringToBufferPanelWithColorRGB(uint16_t nBufferNumber, const char *cString, uint8_t nPanelNumber, uint32_t nColorRGB)
 {
     // we support panel spec of 12 and 23 !! (these place us into middle of panel pair! - centered within the two panels)
     float fPanelNumber = nPanelNumber;
@@ -354,39 +478,205 @@ void writeStringToBufferPanelWithColorRGB(uint8_t nBufferNumber, const char *cSt
         bCenterString = 1;
     }
     int locY = ((fPanelNumber - 1) * ROWS_PER_PANEL);
-    int strLenInPx = (strlen(cString) * 6); // chars * nbrPx/Char
+    const struct _Font *pFont = getDefaultFont();
+    int strLenInPx = stringWidthInFont(pFont, cString);
     int locX = 1;
-    if(bCenterString && strLenInPx < 30) {
-        locX = (32 - strLenInPx) / 2;
-    }
-    for(int nCharIdx = 0; nCharIdx < strlen(cString); nCharIdx++) {
-        locX = setCharToBuffer(nBufferNumber, cString[nCharIdx], locX, locY,nColorRGB);
-        locX += 1; // add gap between chars
-        if(locX + 5 > 31) {
-            break;
-        }
+    if(bCenterString && strLenInPx < SCREEN_WIDTH - 2) {
+        locX = (SCREEN_WIDTH - strLenInPx) / 2;
     }
+    writeStringLineToBuffer(nBufferNumber, pFont, cString, bytesFittingWidth(pFont, cString, SCREEN_WIDTH - locX), locX, locY, nColorRGB);
 }
 
-int setCharToBuffer(uint8_t nBufferNumber, char cChar, uint8_t locX, uint8_t locY, uint32_t nColorRGB)
+int setCharToBuffer(uint16_t nBufferNumber, char cChar, uint8_t locX, uint8_t locY, uint32_t nColorRGB)
 {
     // place 5 bytes of LED on/off info into buffer starting at top left corner X,Y
     // returns next X addres after;
-    uint8_t nextLocX;
-    const uint8_t *charRom5Bytes = getCharBitsAddr(cChar);
-    for(int nRomIdx = 0; nRomIdx < 5; nRomIdx++) {
-        nextLocX = locX + nRomIdx;
-        uint8_t nRomByte = charRom5Bytes[nRomIdx];
-        // now place LED bits ON with color if bit is set (bit0 is top, bit6 is bottom)
-        for(int nBitIdx = 0; nBitIdx < 7; nBitIdx++) {
-            if((nRomByte & (1 << nBitIdx)) != 0) {
-                setBufferLEDColor(nBufferNumber, nColorRGB, nextLocX, locY + nBitIdx);
+    uint8_t nextLocX = locX + GLYPH_WIDTH;
+    struct _LedPixel *pSelectedBuffer = ptrBuffer(nBufferNumber);
+    if(pSelectedBuffer == NULL) {
+        errorMessage("setCharToBuffer() No Buffer at #%d", nBufferNumber);
+    }
+    else {
+        // cached glyph, already colored and in LED order
+        drawGlyphInBuffer(pSelectedBuffer, (uint8_t)cChar, locX, locY, nColorRGB);
+        markBufferDirtyRect(nBufferNumber, locX, locY, GLYPH_WIDTH, GLYPH_HEIGHT);
+    }
+    return nextLocX;
+}
+
+void markBufferDirtyRect(uint16_t nBufferNumber, int locX, int locY, int nWidth, int nHeight)
+{
+    if(nBufferNumber < 1 || nBufferNumber > allocatedBufferCount()) {
+        return;
+    }
+    // clip to screen
+    int nMinX = MAX(locX, 0);
+    int nMinY = MAX(locY, 0);
+    int nMaxX = MIN(locX + nWidth, SCREEN_WIDTH) - 1;
+    int nMaxY = MIN(locY + nHeight, SCREEN_HEIGHT) - 1;
+    if(nMaxX < nMinX || nMaxY < nMinY) {
+        return;
+    }
+    if(nMinX == 0 && nMinY == 0 && nMaxX == SCREEN_WIDTH - 1 && nMaxY == SCREEN_HEIGHT - 1) {
+        markBufferAllDirty(nBufferNumber);
+        return;
+    }
+    // build our marks aside, then merge them in one short locked step
+    struct _DirtyRegion marked;
+    struct _DirtyRegion *pRegion = &marked;
+    setRegionClean(pRegion);
+    addRectToRegion(pRegion, nMinX, nMinY, nMaxX, nMaxY);
+    // and which LEDs along each lane these pixels are
+    for(int nY = nMinY; nY <= nMaxY; nY++) {
+        for(int nX = nMinX; nX <= nMaxX; nX++) {
+            uint16_t nLedIdx = ledIndexForXY(nX, nY);
+            if(nLedIdx == LAYOUT_NO_LED_IDX) {
+                continue;
+            }
+            uint8_t nLane;
+            uint16_t nLedInLane;
+            if(screenLayout.eFrameFormat == FF_LANE_INTERLEAVED) {
+                nLane = nLedIdx % LAYOUT_MAX_LANES;
+                nLedInLane = nLedIdx / LAYOUT_MAX_LANES;
             }
             else {
-                setBufferLEDColor(nBufferNumber, 0x000000, nextLocX, locY + nBitIdx);
+                nLane = nLedIdx / LAYOUT_LEDS_PER_LANE;
+                nLedInLane = nLedIdx % LAYOUT_LEDS_PER_LANE;
             }
+            addLaneRunToRegion(pRegion, nLane, nLedInLane, nLedInLane);
         }
     }
-    nextLocX += 1;
-    return nextLocX;
+    mergeIntoBufferRegion(nBufferNumber, pRegion);
+}
+
+void markBufferAllDirty(uint16_t nBufferNumber)
+{
+    if(nBufferNumber < 1 || nBufferNumber > frameArena.nFrames) {
+        return;
+    }
+    pthread_mutex_lock(&s_dirtyMutex);
+    struct _DirtyRegion *pRegion = &s_dirtyRegionAr[nBufferNumber - 1];
+    pRegion->nMinX = 0;
+    pRegion->nMinY = 0;
+    pRegion->nMaxX = SCREEN_WIDTH - 1;
+    pRegion->nMaxY = SCREEN_HEIGHT - 1;
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        pRegion->nLaneMinLed[nLane] = 0;
+        pRegion->nLaneMaxLed[nLane] = LAYOUT_LEDS_PER_LANE - 1;
+    }
+    pthread_mutex_unlock(&s_dirtyMutex);
+}
+
+int getBufferDirtyRegion(uint16_t nBufferNumber, struct _DirtyRegion *pRegion, int bReset)
+{
+    if(nBufferNumber < 1 || nBufferNumber > allocatedBufferCount()) {
+        warningMessage("buffer %d NOT allocated, no dirty region", nBufferNumber);
+        return -1;  // FAILURE
+    }
+    // copy and reset in one step so a mark made meanwhile lands in this copy or stays for the next
+    pthread_mutex_lock(&s_dirtyMutex);
+    *pRegion = s_dirtyRegionAr[nBufferNumber - 1];
+    if(bReset) {
+        setRegionClean(&s_dirtyRegionAr[nBufferNumber - 1]);
+    }
+    pthread_mutex_unlock(&s_dirtyMutex);
+    return 0;   // SUCCESS
+}
+
+void resetBufferDirtyRegion(uint16_t nBufferNumber)
+{
+    if(nBufferNumber > 0 && nBufferNumber <= allocatedBufferCount()) {
+        pthread_mutex_lock(&s_dirtyMutex);
+        setRegionClean(&s_dirtyRegionAr[nBufferNumber - 1]);
+        pthread_mutex_unlock(&s_dirtyMutex);
+    }
+}
+
+static uint16_t allocatedBufferCount(void)
+{
+    // render threads ask while the command thread may be growing or shrinking the arena
+    pthread_mutex_lock(&s_allocMutex);
+    uint16_t nFrames = frameArena.nFrames;
+    pthread_mutex_unlock(&s_allocMutex);
+    return nFrames;
+}
+
+static void mergeIntoBufferRegion(uint16_t nBufferNumber, const struct _DirtyRegion *pAdded)
+{
+    pthread_mutex_lock(&s_dirtyMutex);
+    struct _DirtyRegion *pRegion = &s_dirtyRegionAr[nBufferNumber - 1];
+    if(IS_REGION_DIRTY(pAdded)) {
+        addRectToRegion(pRegion, pAdded->nMinX, pAdded->nMinY, pAdded->nMaxX, pAdded->nMaxY);
+    }
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        if(pAdded->nLaneMaxLed[nLane] >= pAdded->nLaneMinLed[nLane]) {
+            addLaneRunToRegion(pRegion, nLane, pAdded->nLaneMinLed[nLane], pAdded->nLaneMaxLed[nLane]);
+        }
+    }
+    pthread_mutex_unlock(&s_dirtyMutex);
+}
+
+static void setRegionClean(struct _DirtyRegion *pRegion)
+{
+    pRegion->nMinX = INT16_MAX;
+    pRegion->nMinY = INT16_MAX;
+    pRegion->nMaxX = -1;
+    pRegion->nMaxY = -1;
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        pRegion->nLaneMinLed[nLane] = INT16_MAX;
+        pRegion->nLaneMaxLed[nLane] = -1;
+    }
+}
+
+static void addRectToRegion(struct _DirtyRegion *pRegion, int nMinX, int nMinY, int nMaxX, int nMaxY)
+{
+    pRegion->nMinX = MIN(pRegion->nMinX, nMinX);
+    pRegion->nMinY = MIN(pRegion->nMinY, nMinY);
+    pRegion->nMaxX = MAX(pRegion->nMaxX, nMaxX);
+    pRegion->nMaxY = MAX(pRegion->nMaxY, nMaxY);
+}
+
+static void addLaneRunToRegion(struct _DirtyRegion *pRegion, uint8_t nLane, int nFirstLed, int nLastLed)
+{
+    pRegion->nLaneMinLed[nLane] = MIN(pRegion->nLaneMinLed[nLane], nFirstLed);
+    pRegion->nLaneMaxLed[nLane] = MAX(pRegion->nLaneMaxLed[nLane], nLastLed);
+}
+
+static void copyLedRun(struct _LedPixel *pDstBuffer, uint16_t nDstLedIdx, int nDstStep, const struct _LedPixel *pSrcBuffer, uint16_t nSrcLedIdx, int nSrcStep, int nLedCount)
+{
+    if(nLedCount == 1) {
+        pDstBuffer[nDstLedIdx] = pSrcBuffer[nSrcLedIdx];
+    }
+    else if(nDstStep == nSrcStep) {
+        // both run same way, copy from lowest LED of each
+        int nLowOffset = (nDstStep < 0) ? nLedCount - 1 : 0;
+        memcpy(&pDstBuffer[nDstLedIdx - nLowOffset], &pSrcBuffer[nSrcLedIdx - nLowOffset], nLedCount * sizeof(struct _LedPixel));
+    }
+    else {
+        for(int nLedIdx = 0; nLedIdx < nLedCount; nLedIdx++) {
+            pDstBuffer[nDstLedIdx + (nLedIdx * nDstStep)] = pSrcBuffer[nSrcLedIdx + (nLedIdx * nSrcStep)];
+        }
+    }
+}
+
+static int initShapeContext(struct _DrawContext *pContext, uint16_t nBufferNumber, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    // one-shot context for callers drawing by buffer number
+    int nStatus = initDrawContext(pContext, nBufferNumber);
+    pContext->nLineWidth = nBorderWidth;
+    pContext->nLineColor = nBorderColor;
+    pContext->bFill = (bFill != 0);
+    pContext->nFillColor = nFillColor;
+    return nStatus;
+}
+
+static void writeStringLineToBuffer(uint16_t nBufferNumber, const struct _Font *pFont, const char *cString, int nBytes, int locX, int locY, uint32_t nColorRGB)
+{
+    struct _LedPixel *pSelectedBuffer = ptrBuffer(nBufferNumber);
+    if(pSelectedBuffer == NULL) {
+        errorMessage("writeStringLineToBuffer() No Buffer at #%d", nBufferNumber);
+        return;
+    }
+    int nEndX = drawStringInBuffer(pSelectedBuffer, pFont, cString, nBytes, locX, locY, nColorRGB);
+    markBufferDirtyRect(nBufferNumber, locX, locY, nEndX - locX, pFont->nHeight);
 }
@@ -24,6 +24,8 @@
 
 #include <stdint.h>
 
+#include "panelLayout.h"
+
 #define BYTES_PER_LED 3
 #define LEDS_PER_PANEL 256
 #define NUMBER_OF_PANELS 3
@@ -31,6 +33,14 @@
 #define ROWS_PER_PANEL 8
 #define COLUMNS_PER_PANEL 32
 
+#if (LAYOUT_MAX_LANES * LAYOUT_LEDS_PER_LANE) != (NUMBER_OF_PANELS * LEDS_PER_PANEL)
+#error "panel layout lanes must fill our frame buffer"
+#endif
+
+// whole screen as described by active panel layout
+#define SCREEN_WIDTH (screenLayout.nWidth)
+#define SCREEN_HEIGHT (screenLayout.nHeight)
+
 struct _LedPixel {
 	uint8_t green;	// sent first to string in order msb to lsb!
 	uint8_t red;
@@ -39,6 +49,49 @@ struct _LedPixel {
 
 //extern _LedPixel *pFrameBuffers; // [NUMBER_OF_BUFFERS][NUMBER_OF_PANELS][LEDS_PER_PANEL];
 
+// negative X,Y wrap to huge unsigned values, so one compare per axis works for signed and unsigned args alike
+#define IS_ON_SCREEN(x, y) ((unsigned int)(int)(x) < (unsigned int)SCREEN_WIDTH && (unsigned int)(int)(y) < (unsigned int)SCREEN_HEIGHT)
+
+// fast paths for drawing loops: NO checks! pBuffer from ptrBuffer() (not NULL) and X,Y must be on screen
+static inline struct _LedPixel *ptrLEDinBuffer(struct _LedPixel *pBuffer, uint8_t locX, uint8_t locY)
+{
+    return &pBuffer[ledIndexForXY(locX, locY)];
+}
+
+static inline void setLEDColorInBuffer(struct _LedPixel *pBuffer, uint32_t nColorRGB, uint8_t locX, uint8_t locY)
+{
+    struct _LedPixel *pLED = &pBuffer[ledIndexForXY(locX, locY)];
+    pLED->red = (nColorRGB >> 16) & 0xff;
+    pLED->green = (nColorRGB >> 8) & 0xff;
+    pLED->blue = (nColorRGB >> 0) & 0xff;
+}
+
+// what changed in a buffer since its dirty region was last reset
+struct _DirtyRegion {
+    int16_t nMinX;      // screen rectangle touched, empty when nMaxX < nMinX
+    int16_t nMinY;
+    int16_t nMaxX;
+    int16_t nMaxY;
+    int16_t nLaneMinLed[LAYOUT_MAX_LANES];  // LEDs touched along each lane, lane clean when max < min
+    int16_t nLaneMaxLed[LAYOUT_MAX_LANES];
+};
+
+#define IS_REGION_DIRTY(pRegion) ((pRegion)->nMaxX >= (pRegion)->nMinX)
+
+// screen rectangle drawing is limited to (inclusive), empty when nMaxX < nMinX
+struct _ClipRect {
+    int16_t nMinX;
+    int16_t nMinY;
+    int16_t nMaxX;
+    int16_t nMaxY;
+};
+
+// what fills pixels shifted in from outside the source buffer
+typedef enum _eShiftEdge {
+    SE_WRAP = 0,    // pixels shifted off one edge come back in the other
+    SE_FILL,        // pixels shifted in are set to fill color
+} eShiftEdge;
+
 // call to initialize our frame buffer (allocate, set to black, etc.)
 void initBuffers(void);
 
@@ -48,24 +101,40 @@ void clearBuffers(void);
 // alloc requested number of buffers (zero filled)
 int allocBuffers(int nDesiredBuffers);
 
+// release all but buffer 1 (which is cleared)
+void freeBuffers(void);
+
 // object counts
-uint8_t numberBuffers(void);
+uint16_t numberBuffers(void);
 uint8_t numberPanels(void);
 uint16_t maxLedsInBuffer(void);
 uint16_t maxLedsInPanel(void);
 uint16_t frameBufferSizeInBytes(void);
 
 // getting references to objects
-struct _LedPixel *ptrBuffer(uint8_t nBufferNumber);
+struct _LedPixel *ptrBuffer(uint16_t nBufferNumber);
 struct _LedPixel *ptrPanel(struct _LedPixel *pBuffer, uint8_t nPanel);
-void fillBufferWithColorRGB(uint8_t nBufferNumber, uint32_t nColorRGB);
-void fillBufferPanelWithColorRGB(uint8_t nBufferNumber, uint8_t nPanelNumber, uint32_t nColorRGB);
-void setBufferLEDColor(uint8_t nBufferNumber, uint32_t nColor, uint8_t locX, uint8_t locY);
-void drawSquareInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY, uint8_t nPanelNumber, uint8_t nWidth, uint8_t nHeight, uint8_t nLineWidth, uint32_t nColorRGB);
-void moveToInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY);
-void lineToInBuffer(uint8_t nBufferNumber, uint8_t locX, uint8_t locY, uint8_t nLineWidth, uint32_t nColorRGB, uint8_t nAreaHeight);
-void writeStringToBufferWithColorRGB(uint8_t nBufferNumber, const char *cString, uint32_t nColorRGB);
-void writeStringToBufferPanelWithColorRGB(uint8_t nBufferNumber, const char *cString, uint8_t nPanelNumber, uint32_t nColorRGB);
-int setCharToBuffer(uint8_t nBufferNumber, char cChar, uint8_t locX, uint8_t locY, uint32_t nColorRGB);
+void fillBufferWithColorRGB(uint16_t nBufferNumber, uint32_t nColorRGB);
+void fillBufferPanelWithColorRGB(uint16_t nBufferNumber, uint8_t nPanelNumber, uint32_t nColorRGB);
+void fillBufferRectWithColorRGB(uint16_t nBufferNumber, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB);
+// dst(x,y) = src(x - nShiftRight, y - nShiftDown), src and dst may be same buffer
+void copyBufferWithShift(uint16_t nSrcBufferNumber, uint16_t nDstBufferNumber, int nShiftDown, int nShiftRight, eShiftEdge eEdge, uint32_t nFillColorRGB);
+void setBufferLEDColor(uint16_t nBufferNumber, uint32_t nColor, uint8_t locX, uint8_t locY);
+// one-shot shapes by buffer number (keep no state, safe from any thread), pen drawing & clipping: see drawContext.h
+void drawSquareInBuffer(uint16_t nBufferNumber, uint8_t locX, uint8_t locY, uint8_t nPanelNumber, uint8_t nWidth, uint8_t nHeight, uint8_t nLineWidth, uint32_t nColorRGB);
+void drawRectInBuffer(uint16_t nBufferNumber, int locX, int locY, int nWidth, int nHeight, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+void drawCircleInBuffer(uint16_t nBufferNumber, int nCenterX, int nCenterY, int nRadius, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+void drawTriangleInBuffer(uint16_t nBufferNumber, int nApexX, int nApexY, int nBaseWidth, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+void drawPolygonInBuffer(uint16_t nBufferNumber, const int16_t *pPointsXY, int nPoints, uint8_t nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+void writeStringToBufferWithColorRGB(uint16_t nBufferNumber, const char *cString, uint32_t nColorRGB);
+void writeStringToBufferPanelWithColorRGB(uint16_t nBufferNumber, const char *cString, uint8_t nPanelNumber, uint32_t nColorRGB);
+int setCharToBuffer(uint16_t nBufferNumber, char cChar, uint8_t locX, uint8_t locY, uint32_t nColorRGB);
+
+// dirty tracking: primitives above mark what they write, code writing through ptrBuffer() directly must mark too
+void markBufferDirtyRect(uint16_t nBufferNumber, int locX, int locY, int nWidth, int nHeight);
+void markBufferAllDirty(uint16_t nBufferNumber);
+// copy of buffer's dirty region (safe while other threads mark), bReset: reset in same step, 0 on success
+int getBufferDirtyRegion(uint16_t nBufferNumber, struct _DirtyRegion *pRegion, int bReset);
+void resetBufferDirtyRegion(uint16_t nBufferNumber);
 
 #endif /* FRAME_BUFFER_H */
@@ -0,0 +1,208 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <string.h>
+
+#include "glyphCache.h"
+#include "charSet.h"
+#include "pixelFill.h"
+
+//  Text is mostly the same few characters in the same color drawn again and again
+//  (clock digits every second) so we keep each character already colored and laid
+//  out the way the LEDs run.  A glyph column (or row, for row-wired layouts) that
+//  lands on one run of LEDs is then a single small memcpy:
+//
+//    LEDs run down the column  -> copy the top-to-bottom pixels
+//    LEDs run up the column    -> copy the bottom-to-top pixels (serpentine neighbor)
+//    LEDs N apart (interleaved lanes) -> strided copy
+//
+//  Anything else (column split across panels, partly off screen) falls back to
+//  pixel at a time from the same cached colors.
+//
+//  Where the runs start and which way they go depends only on where the glyph is
+//  placed, and text is placed at the same few spots over and over, so placements
+//  are cached too (until the layout changes).
+//
+//  Each thread gets its own small caches so render threads never wait on each other.
+
+#define GLYPH_CACHE_ENTRIES 64     // power of 2
+#define PLACEMENT_CACHE_ENTRIES 64 // power of 2
+#define GLYPH_MAX_LINES GLYPH_HEIGHT    // columns (GLYPH_WIDTH) or rows (GLYPH_HEIGHT)
+
+struct _GlyphEntry {
+    uint8_t bValid;
+    uint8_t bMicrDigits;    // digits came from MICR set
+    uint32_t nCodePoint;
+    uint32_t nColorRGB;
+    struct _LedPixel columnsDown[GLYPH_WIDTH][GLYPH_HEIGHT];   // per column, top to bottom
+    struct _LedPixel columnsUp[GLYPH_WIDTH][GLYPH_HEIGHT];     // per column, bottom to top
+    struct _LedPixel rowsRight[GLYPH_HEIGHT][GLYPH_WIDTH];     // per row, left to right
+    struct _LedPixel rowsLeft[GLYPH_HEIGHT][GLYPH_WIDTH];      // per row, right to left
+};
+
+// LED runs for each glyph column (or row) at one screen location
+struct _GlyphPlacement {
+    uint32_t nLayoutGeneration;     // layout these were computed for, 0 = empty
+    int16_t locX;
+    int16_t locY;
+    uint16_t nFirstLedAr[GLYPH_MAX_LINES];
+    int16_t nStepAr[GLYPH_MAX_LINES];   // LED index step along line, 0 = not one run
+};
+
+static __thread struct _GlyphEntry s_glyphCacheAr[GLYPH_CACHE_ENTRIES];
+static __thread struct _GlyphPlacement s_placementCacheAr[PLACEMENT_CACHE_ENTRIES];
+static __thread uint32_t s_nCacheHits;
+static __thread uint32_t s_nCacheMisses;
+
+// -----------------------
+// forward declarations
+//
+static const struct _GlyphEntry *lookupGlyph(uint32_t nCodePoint, uint32_t nColorRGB);
+static void buildGlyph(struct _GlyphEntry *pGlyph, uint32_t nCodePoint, uint32_t nColorRGB);
+static const struct _GlyphPlacement *lookupPlacement(int locX, int locY, int bColumns);
+static void copyGlyphLine(struct _LedPixel *pBuffer, const uint16_t *pEntry, int nEntryStride, int nCount, uint16_t nFirstLedIdx, int nStep, const struct _LedPixel *pForward, const struct _LedPixel *pBackward);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+void drawGlyphInBuffer(struct _LedPixel *pBuffer, uint32_t nCodePoint, int locX, int locY, uint32_t nColorRGB)
+{
+    const struct _GlyphEntry *pGlyph = lookupGlyph(nCodePoint, nColorRGB);
+    const uint16_t *pTable = screenLayout.pXlateTable;
+
+    if(!IS_ON_SCREEN(locX, locY) || !IS_ON_SCREEN(locX + GLYPH_WIDTH - 1, locY + GLYPH_HEIGHT - 1)) {
+        // partly (or wholly) off screen, pixel at a time
+        for(int nCol = 0; nCol < GLYPH_WIDTH; nCol++) {
+            for(int nRow = 0; nRow < GLYPH_HEIGHT; nRow++) {
+                if(IS_ON_SCREEN(locX + nCol, locY + nRow)) {
+                    *ptrLEDinBuffer(pBuffer, locX + nCol, locY + nRow) = pGlyph->columnsDown[nCol][nRow];
+                }
+            }
+        }
+    }
+    else if(isLayoutColumnMajor()) {
+        const struct _GlyphPlacement *pPlacement = lookupPlacement(locX, locY, 1);
+        for(int nCol = 0; nCol < GLYPH_WIDTH; nCol++) {
+            copyGlyphLine(pBuffer, &pTable[(locY * SCREEN_WIDTH) + locX + nCol], SCREEN_WIDTH, GLYPH_HEIGHT,
+                pPlacement->nFirstLedAr[nCol], pPlacement->nStepAr[nCol], pGlyph->columnsDown[nCol], pGlyph->columnsUp[nCol]);
+        }
+    }
+    else {
+        const struct _GlyphPlacement *pPlacement = lookupPlacement(locX, locY, 0);
+        for(int nRow = 0; nRow < GLYPH_HEIGHT; nRow++) {
+            copyGlyphLine(pBuffer, &pTable[((locY + nRow) * SCREEN_WIDTH) + locX], 1, GLYPH_WIDTH,
+                pPlacement->nFirstLedAr[nRow], pPlacement->nStepAr[nRow], pGlyph->rowsRight[nRow], pGlyph->rowsLeft[nRow]);
+        }
+    }
+}
+
+void getGlyphCacheStats(uint32_t *pHits, uint32_t *pMisses)
+{
+    *pHits = s_nCacheHits;
+    *pMisses = s_nCacheMisses;
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static const struct _GlyphEntry *lookupGlyph(uint32_t nCodePoint, uint32_t nColorRGB)
+{
+    uint8_t bMicrDigits = (isUsingMicrNumbers() && nCodePoint >= '0' && nCodePoint <= '9');
+    uint32_t nHash = (nCodePoint * 31) ^ nColorRGB ^ (nColorRGB >> 11) ^ (nColorRGB >> 19);
+    struct _GlyphEntry *pGlyph = &s_glyphCacheAr[nHash & (GLYPH_CACHE_ENTRIES - 1)];
+
+    if(pGlyph->bValid && pGlyph->nCodePoint == nCodePoint && pGlyph->nColorRGB == nColorRGB && pGlyph->bMicrDigits == bMicrDigits) {
+        s_nCacheHits++;
+    }
+    else {
+        // miss (or slot holds another glyph), rebuild in place
+        s_nCacheMisses++;
+        buildGlyph(pGlyph, nCodePoint, nColorRGB);
+        pGlyph->bMicrDigits = bMicrDigits;
+    }
+    return pGlyph;
+}
+
+static void buildGlyph(struct _GlyphEntry *pGlyph, uint32_t nCodePoint, uint32_t nColorRGB)
+{
+    const uint8_t *charRom5Bytes = getCodePointBitsAddr(nCodePoint);
+    struct _LedPixel onLED = { .green = (nColorRGB >> 8) & 0xff, .red = (nColorRGB >> 16) & 0xff, .blue = nColorRGB & 0xff };
+    struct _LedPixel offLED = { 0, 0, 0 };
+
+    for(int nCol = 0; nCol < GLYPH_WIDTH; nCol++) {
+        uint8_t nRomByte = charRom5Bytes[nCol];
+        // bit0 is top, bit6 is bottom
+        for(int nRow = 0; nRow < GLYPH_HEIGHT; nRow++) {
+            struct _LedPixel pixel = ((nRomByte & (1 << nRow)) != 0) ? onLED : offLED;
+            pGlyph->columnsDown[nCol][nRow] = pixel;
+            pGlyph->columnsUp[nCol][(GLYPH_HEIGHT - 1) - nRow] = pixel;
+            pGlyph->rowsRight[nRow][nCol] = pixel;
+            pGlyph->rowsLeft[nRow][(GLYPH_WIDTH - 1) - nCol] = pixel;
+        }
+    }
+    pGlyph->nCodePoint = nCodePoint;
+    pGlyph->nColorRGB = nColorRGB;
+    pGlyph->bValid = 1;
+}
+
+static const struct _GlyphPlacement *lookupPlacement(int locX, int locY, int bColumns)
+{
+    // X,Y on screen with whole glyph on screen
+    struct _GlyphPlacement *pPlacement = &s_placementCacheAr[((locY * 7) + locX) & (PLACEMENT_CACHE_ENTRIES - 1)];
+
+    if(pPlacement->nLayoutGeneration != screenLayout.nGeneration || pPlacement->locX != locX || pPlacement->locY != locY) {
+        const uint16_t *pTable = screenLayout.pXlateTable;
+        int nLines = (bColumns) ? GLYPH_WIDTH : GLYPH_HEIGHT;
+        for(int nLineIdx = 0; nLineIdx < nLines; nLineIdx++) {
+            const uint16_t *pEntry = (bColumns) ? &pTable[(locY * SCREEN_WIDTH) + locX + nLineIdx] : &pTable[((locY + nLineIdx) * SCREEN_WIDTH) + locX];
+            int nEntryStride = (bColumns) ? SCREEN_WIDTH : 1;
+            pPlacement->nFirstLedAr[nLineIdx] = pEntry[0];
+            pPlacement->nStepAr[nLineIdx] = ledRunStep(pEntry, nEntryStride, (bColumns) ? GLYPH_HEIGHT : GLYPH_WIDTH);
+        }
+        pPlacement->locX = locX;
+        pPlacement->locY = locY;
+        pPlacement->nLayoutGeneration = screenLayout.nGeneration;
+    }
+    return pPlacement;
+}
+
+static void copyGlyphLine(struct _LedPixel *pBuffer, const uint16_t *pEntry, int nEntryStride, int nCount, uint16_t nFirstLedIdx, int nStep, const struct _LedPixel *pForward, const struct _LedPixel *pBackward)
+{
+    if(nStep == 1) {
+        memcpy(&pBuffer[nFirstLedIdx], pForward, nCount * sizeof(struct _LedPixel));
+    }
+    else if(nStep == -1) {
+        memcpy(&pBuffer[nFirstLedIdx - (nCount - 1)], pBackward, nCount * sizeof(struct _LedPixel));
+    }
+    else if(nStep != 0) {
+        for(int nPixelIdx = 0; nPixelIdx < nCount; nPixelIdx++) {
+            pBuffer[nFirstLedIdx + (nPixelIdx * nStep)] = pForward[nPixelIdx];
+        }
+    }
+    else {
+        // not one run, LED by LED (gap pixels land on the spare LED)
+        for(int nPixelIdx = 0; nPixelIdx < nCount; nPixelIdx++) {
+            pBuffer[pEntry[nPixelIdx * nEntryStride]] = pForward[nPixelIdx];
+        }
+    }
+}
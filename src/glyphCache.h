@@ -0,0 +1,38 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+
+// place character (off bits black) with top-left at X,Y, clipped to screen ([] if charSet has no such code point)
+void drawGlyphInBuffer(struct _LedPixel *pBuffer, uint32_t nCodePoint, int locX, int locY, uint32_t nColorRGB);
+
+// lookups since thread started: hits are glyphs we did not have to rebuild
+void getGlyphCacheStats(uint32_t *pHits, uint32_t *pMisses);
+
+#endif /* GLYPH_CACHE_H */
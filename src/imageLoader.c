@@ -22,11 +22,13 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include <sys/stat.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h> // free()
 #include <string.h> // for memxxx() and strxxx()
 
 
 #include "imageLoader.h"
 #include "frameBuffer.h"
+#include "canvas.h"
 #include "xmalloc.h"
 #include "debug.h"
 
@@ -62,20 +64,7 @@ static char *fileBuffer;
 static int nRows;
 static int nColumns;
 static int nImageSizeInBytes;
-
-static uint8_t *pOffsetCheckTable;
-static int nImageBytesNeeded;
-
-static int bIsXlateSetup = 0;
-
-static uint16_t fileXlateMatrix[NUMBER_OF_PANELS * LEDS_PER_PANEL * BYTES_PER_LED];
-
-
-// -----------------------
-// forward declarations
-//
-void initLoadTranslation(void);
-void initFileXlateMatrix(void);
+static int nRowStrideInBytes;   // each file row is padded to a multiple of 4 bytes
 
 
 // -----------------------
@@ -103,12 +92,11 @@ struct _BMPColorValue *getPixelAddressForRowColumn(uint8_t nRow, uint8_t nColumn
     int nRowIndex = (nRows - 1) - nRow;
     // Column is normal in file...
     int nColumnIndex = nColumn;
-    // now offset is simple (
-    int nOffset = (nRowIndex * nColumns) + nColumnIndex;
+    // now offset is simple (rows are padded)
+    int nOffset = (nRowIndex * nRowStrideInBytes) + (nColumnIndex * sizeof(struct _BMPColorValue));
     //printf("- Offset=%d, RC=(%d,%d)\n", nOffset, nRow, nColumn);
-    struct _BMPColorValue *rgbArray = (struct _BMPColorValue *)fileBuffer;
 
-    return &rgbArray[nOffset];
+    return (struct _BMPColorValue *)&fileBuffer[nOffset];
 }
 
 void showPixelAtRC(uint8_t nRow, uint8_t nColumn)
@@ -154,16 +142,29 @@ struct _BMPColorValue *loadImageFromFile(const char *fileSpec, int *lengthOut)
         perrorMessage("fopen() failure");
         return NULL;
     }
-    fread(&bmpHeaderData, sizeof(struct _BMPHeader), 1, fpTestFile);
-
-    nRows = bmpHeaderData.height_px;
-    nColumns = bmpHeaderData.width_px;
+    if(fread(&bmpHeaderData, sizeof(struct _BMPHeader), 1, fpTestFile) != 1 || bmpHeaderData.type != 0x4d42 ||
+       bmpHeaderData.bits_per_pixel != 24 || bmpHeaderData.width_px < 1 || bmpHeaderData.height_px < 1) {
+        errorMessage("File %s: not a bottom-up 24-bit bitmap", fileSpec);
+        fclose(fpTestFile);
+        return NULL;
+    }
+    if(bmpHeaderData.width_px > CANVAS_MAX_SIZE || bmpHeaderData.height_px > CANVAS_MAX_SIZE) {
+        errorMessage("File %s: image %dx%d too big: [must be <= %d x %d]", fileSpec, bmpHeaderData.width_px, bmpHeaderData.height_px, CANVAS_MAX_SIZE, CANVAS_MAX_SIZE);
+        fclose(fpTestFile);
+        return NULL;
+    }
 
-    int nImageBytesNeeded = bmpHeaderData.width_px * bmpHeaderData.height_px * 3;
-    nImageSizeInBytes = nImageBytesNeeded;
-    int nRowPadByteCount = (bmpHeaderData.height_px * 3) % 4;
+    // sizes bounded above, but keep the math in size_t anyway
+    size_t nRowBytes = (size_t)bmpHeaderData.width_px * 3;
+    size_t nRowStride = (nRowBytes + 3) & ~(size_t)3;
+    if(nRowStride > SIZE_MAX / (size_t)bmpHeaderData.height_px) {
+        errorMessage("File %s: image %dx%d too big", fileSpec, bmpHeaderData.width_px, bmpHeaderData.height_px);
+        fclose(fpTestFile);
+        return NULL;
+    }
+    size_t nImageBytesNeeded = nRowStride * (size_t)bmpHeaderData.height_px;
 
-    debugMessage("File %s: sz=%u, IMAGE h/w=(%d,%d) size=%u bytesNeeded=%d rowPad=%d", fileSpec, bmpHeaderData.size, bmpHeaderData.height_px, bmpHeaderData.width_px, bmpHeaderData.image_size_bytes, nImageBytesNeeded, nRowPadByteCount);
+    debugMessage("File %s: sz=%u, IMAGE h/w=(%d,%d) size=%u bytesNeeded=%zu rowPad=%zu", fileSpec, bmpHeaderData.size, bmpHeaderData.height_px, bmpHeaderData.width_px, bmpHeaderData.image_size_bytes, nImageBytesNeeded, nRowStride - nRowBytes);
 
     #ifdef SHOW_EXTRA_DEBUG
     hexDump("BMP Header", &bmpHeaderData, sizeof(struct _BMPHeader));
@@ -177,199 +178,83 @@ struct _BMPColorValue *loadImageFromFile(const char *fileSpec, int *lengthOut)
     printf("- Addr image data: %p\n", &pBuffer[bmpHeaderData.offset]);
     #endif
 
-    fileBuffer = xmalloc(nImageBytesNeeded);
-
-    // move to start of image bytes
-    fseek(fpTestFile, bmpHeaderData.offset, SEEK_SET);
+    // move to start of image bytes, then read the image data into a new buffer
+    char *pImageBytes = xmalloc(nImageBytesNeeded);
+    if(fseek(fpTestFile, bmpHeaderData.offset, SEEK_SET) != 0 || fread(pImageBytes, nImageBytesNeeded, 1, fpTestFile) != 1) {
+        errorMessage("File %s: truncated, image data needs %zu bytes at offset %u", fileSpec, nImageBytesNeeded, bmpHeaderData.offset);
+        free(pImageBytes);
+        fclose(fpTestFile);
+        return NULL;
+    }
+    fclose(fpTestFile);
 
-    // read the image data into our buffer
-    fread(fileBuffer, nImageBytesNeeded, 1, fpTestFile);
+    // only now replace the previous image
+    free(fileBuffer);
+    fileBuffer = pImageBytes;
+    nRows = bmpHeaderData.height_px;
+    nColumns = bmpHeaderData.width_px;
+    nImageSizeInBytes = (int)(nRowBytes * (size_t)bmpHeaderData.height_px);
+    nRowStrideInBytes = (int)nRowStride;
 
     #ifdef SHOW_EXTRA_DEBUG
     hexDump("Image bytes", fileBuffer, nImageBytesNeeded);
     #endif
 
-    fclose(fpTestFile);
-
     if(lengthOut != NULL) {
         *lengthOut = getImageSizeInBytes();
     }
 
-    if(!bIsXlateSetup) {
-        initLoadTranslation();
-        bIsXlateSetup = 1;    // we did this!
-    }
-
     return getBufferBaseAddress();
 }
 
 void xlateLoadedImageIntoBuffer(uint8_t *buffer, size_t length)
 {
     //debugMessage("xlateLoadedImageIntoBuffer(0x%p, %d) - ENTRY", buffer, length);
-    size_t nImageSizeInBytes = getImageSizeInBytes();
-    uint8_t *pImageBuffer = (uint8_t *)getBufferBaseAddress();
-
-    if(length != nImageSizeInBytes) {
-        errorMessage("xlateLoadedImageIntoBuffer() - bad buffer size (%d), NOT image size (%d)", length, nImageSizeInBytes);
+    // image must be our screen size, each image X,Y goes to LED the panel layout says
+    if(nColumns != SCREEN_WIDTH || nRows != SCREEN_HEIGHT) {
+        errorMessage("xlateLoadedImageIntoBuffer() - image %dx%d, NOT screen size %dx%d", nColumns, nRows, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    else if(length != frameBufferSizeInBytes()) {
+        errorMessage("xlateLoadedImageIntoBuffer() - bad buffer size (%d), NOT frame size (%d)", length, frameBufferSizeInBytes());
     }
     else {
-        for(int nByteIdx = 0; nByteIdx < length; nByteIdx++) {
-            int nBufferOffset = fileXlateMatrix[nByteIdx];
-            buffer[nByteIdx] = pImageBuffer[nBufferOffset];
+        struct _LedPixel *pBuffer = (struct _LedPixel *)buffer;
+        for(int nRow = 0; nRow < nRows; nRow++) {
+            for(int nColumn = 0; nColumn < nColumns; nColumn++) {
+                struct _BMPColorValue *pFilePixel = getPixelAddressForRowColumn(nRow, nColumn);
+                struct _LedPixel *pLED = ptrLEDinBuffer(pBuffer, nColumn, nRow);
+                pLED->green = pFilePixel->green;
+                pLED->red = pFilePixel->red;
+                pLED->blue = pFilePixel->blue;
+            }
         }
     }
     //debugMessage("xlateLoadedImageIntoBuffer() - EXIT");
 }
 
-
-// -----------------------
-//  PRIVATE Methods
-//
-void initLoadTranslation(void)
+void getLoadedImageSize(int *pWidth, int *pHeight)
 {
-    // fill translation buffer with not-set value
-    memset(&fileXlateMatrix, 0xFF, sizeof(fileXlateMatrix));
-
-    nImageBytesNeeded = getImageSizeInBytes();
-    pOffsetCheckTable = (uint8_t *)xmalloc(nImageBytesNeeded);
-    // fill offset-used buffer with not-set value
-    memset(pOffsetCheckTable, 0x00, nImageBytesNeeded);
-
-    // populate our fileBuffer indices
-    initFileXlateMatrix();
+    *pWidth = nColumns;
+    *pHeight = nRows;
 }
 
-void initFileXlateMatrix(void)
+void xlateLoadedImageIntoCanvas(struct _Canvas *pCanvas, int locX, int locY)
 {
-    //debugMessage("initFileXlateMatrix() - ENTRY");
-    #ifdef TEST_OUTPUT_NEEDED
-    // quick test of get routine (seeing issues)
-    uint8_t *pCurrFilePixel = (uint8_t *)getPixelAddressForRowColumn(16, 4);
-    printf("- TEST 16,4 = %p\n", pCurrFilePixel);
-    pCurrFilePixel = (uint8_t *)getPixelAddressForRowColumn(8, 4);
-    printf("- TEST 8,4 = %p\n", pCurrFilePixel);
-    pCurrFilePixel = (uint8_t *)getPixelAddressForRowColumn(0, 4);
-    printf("- TEST 0,4 = %p\n\n\n", pCurrFilePixel);
-    #endif
-
-
-    // panels are arranged in columns 8-pixels tall by 32 pixels wide
-    //
-    // column pixels are numbered bottom to top on right edge and every other column from there
-    //  rest of columns are numbered top to bottom on the in-between columns.
-    //
-    //  Numbering: //
-    // COL:00  01         28   29   30   31
-    //   248  247   ...  024  023  008  007
-    //   249  246   ...  025  022  009  006
-    //   250  245   ...  026  021  010  005
-    //   251  244   ...  027  020  011  004
-    //   252  243   ...  028  019  012  003
-    //   253  242   ...  029  018  013  002
-    //   254  241   ...  030  017  014  001
-    //   255  240   ...  031  016  015  000
-    //
-    //  effectively we think of the panel as one long string of pixels (256 of them.)
-    //
-    // the file buffer has an access routine to provide ptr to RGB tuple for X,Y in width,height space
-    //  so call this routine to get pointer to location and also add in minor offset to R or G or B of color value too...
-    //
-    //  The file buffer is 32w x 24h so each panel is a third of the height but full width!
-    //
-    // get base address of our file buffer so we can calculate offsets
-    uint8_t *pFileBufferBaseAddress = (uint8_t *)getBufferBaseAddress();
-
-    for(int nPanelIndex = 0; nPanelIndex < NUMBER_OF_PANELS; nPanelIndex++) {   // [0-2] where 0 is top panel.
-        int nPanelOffsetIndex = (nPanelIndex * (COLUMNS_PER_PANEL * ROWS_PER_PANEL * BYTES_PER_LED));
-        for(int nByteOfColorIndex = 0; nByteOfColorIndex < (LEDS_PER_PANEL * BYTES_PER_LED); nByteOfColorIndex++) { // [0-767]
-            int nColorIndex = nByteOfColorIndex % BYTES_PER_LED;    // [0-2]
-            int nPixelIndex = nByteOfColorIndex / BYTES_PER_LED;    // [0-255]
-
-            // FILE column index is inverted
-            int nColumnIndex = nByteOfColorIndex / (ROWS_PER_PANEL * BYTES_PER_LED);    // [0-31]
-            // - invert file column value
-            nColumnIndex = (COLUMNS_PER_PANEL - 1) - nColumnIndex;
-
-            // panel columns are inverted from file columns
-            int nPanelColumnIndex = (COLUMNS_PER_PANEL - 1) - nColumnIndex; // [0-31]
-            // panel rows alternate being 0->7 or 7->0!
-            int nPanelRowIndex = (nColumnIndex & 1 == 1) ? nPixelIndex % ROWS_PER_PANEL : (ROWS_PER_PANEL - 1) - (nPixelIndex % ROWS_PER_PANEL);    // [0-7]
-
-            // FILE row index (rows within panel are inverted)
-            int nRowIndex = (nPanelIndex * ROWS_PER_PANEL) + ((ROWS_PER_PANEL - 1) - nPanelRowIndex);
-
-            struct _BMPColorValue *pCurrFilePixel;
-            // at the beginning of each color do...
-            if(nColorIndex == 0) {
-                //printf("\n----------------\n");
-                pCurrFilePixel = getPixelAddressForRowColumn(nRowIndex, nColumnIndex);
-            }
-
-            uint8_t *pFileColorAddress;
-            uint8_t *pFilePixelAddress = (uint8_t *)pCurrFilePixel;
-            switch(nColorIndex) {
-                case 0: // string wants GREEN here
-                    pFileColorAddress = &pCurrFilePixel->green;
-                    break;
-                case 1: // string wants RED here
-                    pFileColorAddress = &pCurrFilePixel->red;
-                    break;
-                case 2: // string wants BLUE here
-                    pFileColorAddress = &pCurrFilePixel->blue;
-                    break;
-                default:
-                    printf("\n- ERROR Bad color index (%d) NOT [0-2]\n", nColorIndex);
-                    break;
-            }
-            int nColorOffset = pFileColorAddress - pFilePixelAddress;
-            int nFilePixelOffset = pFilePixelAddress - pFileBufferBaseAddress;
-            int nFileOffsetValue = nFilePixelOffset + nColorOffset;
-            // load matrix location with file offset
-            int nXlateOffset = nPanelOffsetIndex + nByteOfColorIndex;
-            fileXlateMatrix[nXlateOffset] = nFileOffsetValue;
-#ifdef NEEDED
-            printf("- File RC={%d,%d} - Panel[#%d, RC={%d,%d} px:%d color:%d byte:%d]",
-            nRowIndex,
-            nColumnIndex,
-            nPanelIndex,
-            nPanelRowIndex,
-            nPanelColumnIndex,
-            nPixelIndex,
-            nColorIndex,
-            nByteOfColorIndex);
-            printf("  -- MATRIX[%d] = (%d); FILE [px:%d + clr:%d] @%p\n", nXlateOffset, nFileOffsetValue, nFilePixelOffset, nColorOffset, pCurrFilePixel);
-#endif
-
-            // detect if offset used more than once. Should NEVER be!!
-            if(nFileOffsetValue >= nImageBytesNeeded) {
-                printf("\n- ERROR file-offset %d OUT OF RANGE: [0-%d]!\n", nFileOffsetValue, nImageBytesNeeded);
-            }
-            else {
-                if(pOffsetCheckTable[nFileOffsetValue] != 0) {
-                    printf("\n- ERROR file-offset %d used more than once!\n", nFileOffsetValue);
-                }
-                else {
-                    pOffsetCheckTable[nFileOffsetValue] = 1;    // mark this as used
-                }
-            }
-        }
-    }
-    //  check to see that all offsets are used
-    for(int nFileOffsetValue = 0; nFileOffsetValue < nImageBytesNeeded; nFileOffsetValue++) {   // [0-2] where 0 is top panel.
-        // each of these bytes if set are now 1 vs. 0
-        // if NOT let's warn!
-        if(pOffsetCheckTable[nFileOffsetValue] == 0) {
-            printf("- ERROR file-offset[%d] not used!\n",  nFileOffsetValue);
+    // rows are inverted and padded in file, image may be far bigger than screen (so no uint8_t row/column helpers)
+    for(int nRow = 0; nRow < nRows; nRow++) {
+        int nCanvasY = locY + nRow;
+        if(nCanvasY < 0 || nCanvasY >= pCanvas->nHeight) {
+            continue;
         }
-    }
-    // lastly check to see that all matrix locations are filled
-    for(int nXlateOffset = 0; nXlateOffset < nImageBytesNeeded; nXlateOffset++) {   // [0-2] where 0 is top panel.
-        // each of these bytes if set are now 1 vs. 0
-        // if NOT let's warn!
-        int nFileOffsetValue = fileXlateMatrix[nXlateOffset];
-        if(nFileOffsetValue > nImageBytesNeeded || nFileOffsetValue < 0) {
-            printf("- ERROR xlate[%d] not filled! -> has %d\n",  nXlateOffset, nFileOffsetValue);
+        const struct _BMPColorValue *pFileRow = (const struct _BMPColorValue *)&fileBuffer[((nRows - 1) - nRow) * nRowStrideInBytes];
+        for(int nColumn = 0; nColumn < nColumns; nColumn++) {
+            int nCanvasX = locX + nColumn;
+            if(nCanvasX >= 0 && nCanvasX < pCanvas->nWidth) {
+                struct _LedPixel *pPixel = ptrPixelInCanvas(pCanvas, nCanvasX, nCanvasY);
+                pPixel->green = pFileRow[nColumn].green;
+                pPixel->red = pFileRow[nColumn].red;
+                pPixel->blue = pFileRow[nColumn].blue;
+            }
         }
     }
-    //debugMessage("initFileXlateMatrix() - EXIT");
 }
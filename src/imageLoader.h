@@ -41,4 +41,9 @@ struct _BMPColorValue *getBufferBaseAddress(void);
 struct _BMPColorValue *getPixelAddressForRowColumn(uint8_t nRow, uint8_t nColumn);
 void xlateLoadedImageIntoBuffer(uint8_t *buffer, size_t length);
 
+struct _Canvas;
+void getLoadedImageSize(int *pWidth, int *pHeight);
+// loaded image (any size) with its top-left at canvas X,Y, clipped to canvas
+void xlateLoadedImageIntoCanvas(struct _Canvas *pCanvas, int locX, int locY);
+
 #endif /* IMAGE_LOADER_H */
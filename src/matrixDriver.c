@@ -23,10 +23,14 @@
 #include <fcntl.h>      // for open()
 #include <unistd.h>     // for close()
 #include <string.h>     // for strxxx()
+#include <errno.h>
+#include <time.h>       // for clock_gettime()
 
 #include <LEDfifoLKM/LEDfifoConfigureIOCtl.h>
 
 #include "matrixDriver.h"
+#include "panelLayout.h"
+#include "present.h"
 #include "debug.h"
 
 // forward declarations
@@ -36,6 +40,7 @@ int identifyPiModel(int fd);
 void resetToWS2812bValues(int fd);
 void clearToColor(int fd, uint32_t color);
 int setIOBaseAddress(int fd, uint32_t baeeAddress);
+static void writeFrame(const uint8_t *pFrame, size_t bufferLen);
 
 void testSetPins(int fd);
 
@@ -46,6 +51,10 @@ static int s_fdDriver;
 
 static int s_nPinsAr[3] = { 17, 27, 22 };
 
+static int s_bDriverHasTimedFrames = 1; // cleared if driver rejects CMD_QUEUE_TIMED_FRAME
+static int s_bDriverHasFadeFrames = 1;  // cleared if driver rejects CMD_QUEUE_FADE_FRAME
+static int s_bScrollProgramRunning;     // T/F driver marquee moving frame 0 across lanes
+
 int openMatrix(void)
 {
     int errorValue = -1; // success
@@ -65,6 +74,9 @@ int openMatrix(void)
             // and set our pins
             setPins(s_fdDriver, &s_nPinsAr[0], sizeof(s_nPinsAr)/sizeof(int));
 
+            // driver keeps format of prior run, match our layout
+            setFrameFormat(screenLayout.eFrameFormat);
+
             // reset all pixels to off (black)
             clearToColor(s_fdDriver, 0x000000);
         }
@@ -151,20 +163,236 @@ void showBuffer(uint8_t *buffer, size_t bufferLen)
 {
     // write our buffer to the LED matrix for display
     //debugMessage("showBuffer() %p(%ld) - ENTRY", buffer, bufferLen);
-    ssize_t numberBytesWritten = write(s_fdDriver, buffer, bufferLen);
-    if(numberBytesWritten == -1) {
-        perrorMessage("write() failed");
+    const uint8_t *pFrame = beginPresent(buffer, bufferLen);
+    writeFrame(pFrame, bufferLen);
+    endPresent();
+    //debugMessage("showBuffer() - EXIT");
+}
+
+void showBufferAt(uint8_t *buffer, size_t bufferLen, uint64_t presentAtNsec)
+{
+    // hand our buffer to the driver which holds it until its presentation time
+    timed_frame_arg_t timedFrame;
+
+    if(!s_bDriverHasTimedFrames) {
+        // older driver, just show it now
+        showBuffer(buffer, bufferLen);
+        return;
     }
-    else if(numberBytesWritten != bufferLen) {
-        warningMessage("showBuffer() ONLY write %d of %d bytes!", numberBytesWritten, bufferLen);
+    const uint8_t *pFrame = beginPresent(buffer, bufferLen);
+    timedFrame.frameData = pFrame;
+    timedFrame.frameLength = bufferLen;
+    timedFrame.presentAtNsec = presentAtNsec;
+    if (ioctl(s_fdDriver, CMD_QUEUE_TIMED_FRAME, &timedFrame) == -1)
+    {
+        if(errno == ENOTTY) {
+            warningMessage("showBufferAt() driver lacks timed frames, showing immediately from now on");
+            s_bDriverHasTimedFrames = 0;
+            writeFrame(pFrame, bufferLen);
+        }
+        else if(errno == EBUSY) {
+            warningMessage("showBufferAt() driver frame queue full, frame dropped");
+        }
+        else {
+            perrorMessage("showBufferAt() ioctl queue frame");
+        }
+    }
+    endPresent();
+}
+
+void showBufferFadeAt(uint8_t *buffer, size_t bufferLen, uint64_t presentAtNsec, uint16_t nFadeFrames, uint32_t nFramePeriodNsec, int bGammaAware)
+{
+    // driver generates the in-between frames so we only send the end frame
+    fade_frame_arg_t fadeFrame;
+
+    if(!s_bDriverHasTimedFrames || !s_bDriverHasFadeFrames) {
+        // older driver, no fade just show it now
+        showBuffer(buffer, bufferLen);
+        return;
+    }
+    const uint8_t *pFrame = beginPresent(buffer, bufferLen);
+    fadeFrame.frame.frameData = pFrame;
+    fadeFrame.frame.frameLength = bufferLen;
+    fadeFrame.frame.presentAtNsec = presentAtNsec;
+    fadeFrame.fadeType = (bGammaAware) ? FIFO_FADE_GAMMA : FIFO_FADE_LINEAR;
+    fadeFrame.fadeFrameCount = nFadeFrames;
+    fadeFrame.fadeFramePeriodNsec = nFramePeriodNsec;
+    if (ioctl(s_fdDriver, CMD_QUEUE_FADE_FRAME, &fadeFrame) == -1)
+    {
+        if(errno == ENOTTY) {
+            warningMessage("showBufferFadeAt() driver lacks fades, showing immediately");
+            s_bDriverHasFadeFrames = 0;
+            writeFrame(pFrame, bufferLen);
+        }
+        else if(errno == EBUSY) {
+            warningMessage("showBufferFadeAt() driver frame queue full, frame dropped");
+        }
+        else {
+            perrorMessage("showBufferFadeAt() ioctl queue fade frame");
+        }
+    }
+    endPresent();
+}
+
+uint64_t monotonicTimeNsec(void)
+{
+    // same clock the driver uses for presentation deadlines
+    struct timespec tsNow;
+    clock_gettime(CLOCK_MONOTONIC, &tsNow);
+    return ((uint64_t)tsNow.tv_sec * 1000000000ULL) + tsNow.tv_nsec;
+}
+
+int loadProgramFrame(uint8_t nFrameIdx, uint8_t *buffer, size_t bufferLen)
+{
+    program_frame_arg_t programFrame;
+
+    // driver replays program frames itself so each is held to power budget as loaded
+    int nStatus = 0;
+    programFrame.frameIdx = nFrameIdx;
+    programFrame.frameData = beginPresentProgramFrame(buffer, bufferLen);
+    programFrame.frameLength = bufferLen;
+    if (ioctl(s_fdDriver, CMD_LOAD_PROGRAM_FRAME, &programFrame) == -1)
+    {
+        perrorMessage("loadProgramFrame() ioctl load frame");
+        nStatus = -1;
+    }
+    endPresent();
+    return nStatus;
+}
+
+static int runProgram(display_op_t *pOps, uint8_t nOpCount)
+{
+    display_program_arg_t displayProgram;
+
+    displayProgram.ops = pOps;
+    displayProgram.opCount = nOpCount;
+    if (ioctl(s_fdDriver, CMD_RUN_PROGRAM, &displayProgram) == -1)
+    {
+        perrorMessage("runProgram() ioctl run program");
+        return -1;
+    }
+    return 0;
+}
+
+int runMarqueeProgram(uint16_t nStepMsec, int nColumnsPerStep)
+{
+    // show frame 0 then scroll it forever
+    display_op_t marqueeOps[4];
+
+    memset(marqueeOps, 0, sizeof(marqueeOps));
+    marqueeOps[0].opCode = FIFO_OP_SHOW;
+    marqueeOps[0].frameIdx = 0;
+    marqueeOps[1].opCode = FIFO_OP_DELAY;
+    marqueeOps[1].value = nStepMsec;
+    marqueeOps[2].opCode = FIFO_OP_SCROLL;
+    marqueeOps[2].value = nColumnsPerStep;
+    marqueeOps[3].opCode = FIFO_OP_LOOP;
+    marqueeOps[3].value = 1;
+    marqueeOps[3].count = 0;    // forever
+    if(runProgram(marqueeOps, 4) != 0) {
+        return -1;
+    }
+    s_bScrollProgramRunning = 1;
+    return 0;
+}
+
+int runSceneProgram(uint8_t nFrameCount, uint16_t nFrameMsec)
+{
+    // show frames 0 to N-1 in turn, forever
+    display_op_t sceneOps[(2 * MAX_PROGRAM_FRAMES) + 1];
+    uint8_t nFrameIdx;
+    uint8_t nOpCount = 0;
+
+    if(nFrameCount < 1 || nFrameCount > MAX_PROGRAM_FRAMES) {
+        errorMessage("runSceneProgram() frame count (%d) out-of-range: [must be 1 >= N <= %d]", nFrameCount, MAX_PROGRAM_FRAMES);
+        return -1;
+    }
+    memset(sceneOps, 0, sizeof(sceneOps));
+    for(nFrameIdx = 0; nFrameIdx < nFrameCount; nFrameIdx++) {
+        sceneOps[nOpCount].opCode = FIFO_OP_SHOW;
+        sceneOps[nOpCount++].frameIdx = nFrameIdx;
+        sceneOps[nOpCount].opCode = FIFO_OP_DELAY;
+        sceneOps[nOpCount++].value = nFrameMsec;
+    }
+    sceneOps[nOpCount].opCode = FIFO_OP_LOOP;
+    sceneOps[nOpCount++].value = 0;
+    return runProgram(sceneOps, nOpCount);
+}
+
+void stopProgram(void)
+{
+    s_bScrollProgramRunning = 0;
+    if (ioctl(s_fdDriver, CMD_STOP_PROGRAM) == -1)
+    {
+        perrorMessage("stopProgram() ioctl stop program");
+    }
+}
+
+int isScrollProgramRunning(void)
+{
+    return s_bScrollProgramRunning;
+}
+
+int setFrameFormat(uint8_t eFrameFormat)
+{
+    if (ioctl(s_fdDriver, CMD_SET_FRAME_FORMAT, eFrameFormat) == -1)
+    {
+        if(errno == EBUSY) {
+            errorMessage("setFrameFormat() driver busy with queued frames or program, use 'stopprogram' then reload layout");
+        }
+        else {
+            perrorMessage("setFrameFormat() ioctl set frame format");
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int getShownFrame(uint8_t *buffer, size_t bufferLen, uint32_t *pFrameSequence, uint64_t *pTransmitNsec)
+{
+    shown_frame_arg_t shownFrame;
+
+    shownFrame.frameData = buffer;
+    shownFrame.frameLength = bufferLen;
+    if (ioctl(s_fdDriver, CMD_GET_SHOWN_FRAME, &shownFrame) == -1)
+    {
+        perrorMessage("getShownFrame() ioctl get shown frame");
+        return -1;
+    }
+    *pFrameSequence = shownFrame.frameSequence;
+    *pTransmitNsec = shownFrame.transmitNsec;
+    return 0;
+}
+
+void showFrameStats(void)
+{
+    frame_stats_arg_t frameStats;
+
+    if (ioctl(s_fdDriver, CMD_GET_FRAME_STATS, &frameStats) == -1)
+    {
+        perrorMessage("showFrameStats() ioctl get stats");
+    }
+    else
+    {
+        infoMessage("Timed Frames: %u on-time, %u late, %u skipped, %u pending (late when > %u nSec)", frameStats.framesOnTime, frameStats.framesLate, frameStats.framesSkipped, frameStats.framesPending, frameStats.lateToleranceNsec);
     }
-    //debugMessage("showBuffer() - EXIT");
 }
 
 
 // ============================================================================
 //  file-static routines (used this file only)
 //
+static void writeFrame(const uint8_t *pFrame, size_t bufferLen)
+{
+    ssize_t numberBytesWritten = write(s_fdDriver, pFrame, bufferLen);
+    if(numberBytesWritten == -1) {
+        perrorMessage("write() failed");
+    }
+    else if(numberBytesWritten != bufferLen) {
+        warningMessage("showBuffer() ONLY write %d of %d bytes!", numberBytesWritten, bufferLen);
+    }
+}
+
 void show_vars(int fd)
 {
     configure_arg_t deviceValues;
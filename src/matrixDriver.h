@@ -28,5 +28,26 @@ int openMatrix(void);
 int closeMatrix(void);
 void showBuffer(uint8_t *buffer, size_t bufferLen);
 
+// queue buffer for display at absolute CLOCK_MONOTONIC time (0 = asap)
+void showBufferAt(uint8_t *buffer, size_t bufferLen, uint64_t presentAtNsec);
+#define MAX_FADE_FRAMES 1024    // same as driver FIFO_MAX_FADE_FRAMES
+
+// crossfade from what is on screen to buffer over N frames (done in driver, bGammaAware blends in linear light)
+void showBufferFadeAt(uint8_t *buffer, size_t bufferLen, uint64_t presentAtNsec, uint16_t nFadeFrames, uint32_t nFramePeriodNsec, int bGammaAware);
+uint64_t monotonicTimeNsec(void);
+
+// display programs run by driver (no userspace CPU once started)
+#define MAX_PROGRAM_FRAMES 8    // same as driver FIFO_MAX_PROGRAM_FRAMES
+int loadProgramFrame(uint8_t nFrameIdx, uint8_t *buffer, size_t bufferLen);
+int runMarqueeProgram(uint16_t nStepMsec, int nColumnsPerStep);
+int runSceneProgram(uint8_t nFrameCount, uint16_t nFrameMsec);
+void stopProgram(void);
+int isScrollProgramRunning(void);      // T/F marquee running (its frame moves across lanes)
+void showFrameStats(void);
+// order of LEDs in frames we send (FF_LANE_* value, see panelLayout.h), 0 on success
+int setFrameFormat(uint8_t eFrameFormat);
+// copy of last frame driver fully transmitted (seq 0 = nothing sent yet)
+int getShownFrame(uint8_t *buffer, size_t bufferLen, uint32_t *pFrameSequence, uint64_t *pTransmitNsec);
+
 
 #endif /* MATRIX_DRIVER_H */
@@ -0,0 +1,224 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdlib.h>     // free()
+#include <string.h>
+
+#include "paletteBuffer.h"
+#include "matrixDriver.h"
+#include "xmalloc.h"
+#include "debug.h"
+
+//  Indexed buffers keep one byte per LED, in the same LED order as our frame buffers,
+//  and a 256 entry palette.  Drawing and animation work on the small index frame
+//  (768 bytes vs 2304) and only the present step turns it into green/red/blue:
+//
+//    frame LED N = palette[index N]
+//
+//  Palette entries are pre-packed 4 byte words laid out exactly as an LED lands in the
+//  frame (green, red, blue, pad).  Expansion then is one table load and one unaligned
+//  4 byte store per LED, each store's pad byte being overwritten by the next LED, with
+//  no per-channel shifting.  Recoloring (palette cycling, flashing) rewrites palette
+//  entries only; the index frame is untouched.
+
+#define INDEX_FRAME_ALIGN 64    // each index frame starts on its own cache line
+#define COLOR_HASH_SIZE 1024    // open addressing, > 2x the most colors we accept
+
+static uint8_t *s_pIndexFrames;     // all index frames back-to-back
+static size_t s_nIndexFrameStride;
+static struct _IndexedBuffer *s_pIndexedAr;
+static uint16_t s_nIndexedBuffers;
+
+// -----------------------
+// forward declarations
+//
+static uint32_t packedGRBforRGB(uint32_t nColorRGB);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+int allocIndexedBuffers(int nDesiredBuffers)
+{
+    if(nDesiredBuffers < 1 || nDesiredBuffers > PALETTE_MAX_BUFFERS) {
+        warningMessage("indexed buffer %d out-of-range: [1-%d]", nDesiredBuffers, PALETTE_MAX_BUFFERS);
+        return -1;  // FAILURE
+    }
+    if(nDesiredBuffers > s_nIndexedBuffers) {
+        s_nIndexFrameStride = ((maxLedsInBuffer() + 1 + INDEX_FRAME_ALIGN - 1) / INDEX_FRAME_ALIGN) * INDEX_FRAME_ALIGN;
+        s_pIndexFrames = xrealloc(s_pIndexFrames, nDesiredBuffers * s_nIndexFrameStride);
+        s_pIndexedAr = xrealloc(s_pIndexedAr, nDesiredBuffers * sizeof(struct _IndexedBuffer));
+        memset(s_pIndexFrames + (s_nIndexedBuffers * s_nIndexFrameStride), 0, (nDesiredBuffers - s_nIndexedBuffers) * s_nIndexFrameStride);
+        memset(&s_pIndexedAr[s_nIndexedBuffers], 0, (nDesiredBuffers - s_nIndexedBuffers) * sizeof(struct _IndexedBuffer));
+        // frames may have moved
+        for(int nIndexedIdx = 0; nIndexedIdx < nDesiredBuffers; nIndexedIdx++) {
+            s_pIndexedAr[nIndexedIdx].pIndices = s_pIndexFrames + (nIndexedIdx * s_nIndexFrameStride);
+        }
+        debugMessage("Alloc %d additional indexed buffers", nDesiredBuffers - s_nIndexedBuffers);
+        s_nIndexedBuffers = nDesiredBuffers;
+    }
+    return 0;   // SUCCESS
+}
+
+void freeIndexedBuffers(void)
+{
+    free(s_pIndexFrames);
+    free(s_pIndexedAr);
+    s_pIndexFrames = NULL;
+    s_pIndexedAr = NULL;
+    s_nIndexedBuffers = 0;
+}
+
+uint16_t numberIndexedBuffers(void)
+{
+    return s_nIndexedBuffers;
+}
+
+struct _IndexedBuffer *ptrIndexedBuffer(uint16_t nIndexedNumber)
+{
+    if(nIndexedNumber < 1 || nIndexedNumber > s_nIndexedBuffers) {
+        warningMessage("indexed buffer %d NOT yet Allocated. Use 'ibuffers %d' to allocate it", nIndexedNumber, nIndexedNumber);
+        return NULL;
+    }
+    return &s_pIndexedAr[nIndexedNumber - 1];
+}
+
+void showIndexedBuffers(void)
+{
+    size_t nPaletteBytes = s_nIndexedBuffers * sizeof(((struct _IndexedBuffer *)0)->nPaletteGRB);
+    infoMessage("%d indexed buffers: %lu bytes of indices (%lu per buffer), %lu bytes of palettes", s_nIndexedBuffers,
+        (unsigned long)(s_nIndexedBuffers * s_nIndexFrameStride), (unsigned long)s_nIndexFrameStride, (unsigned long)nPaletteBytes);
+}
+
+void setPaletteEntry(struct _IndexedBuffer *pIndexed, uint8_t nIndex, uint32_t nColorRGB)
+{
+    pIndexed->nPaletteGRB[nIndex] = packedGRBforRGB(nColorRGB);
+}
+
+uint32_t getPaletteEntry(const struct _IndexedBuffer *pIndexed, uint8_t nIndex)
+{
+    uint8_t grbBytes[4];
+    memcpy(grbBytes, &pIndexed->nPaletteGRB[nIndex], sizeof(grbBytes));
+    return (grbBytes[1] << 16) | (grbBytes[0] << 8) | grbBytes[2];
+}
+
+void rotatePalette(struct _IndexedBuffer *pIndexed, uint8_t nFirst, uint8_t nLast, int nSteps)
+{
+    uint32_t rotatedAr[PALETTE_ENTRIES];
+    if(nLast <= nFirst) {
+        return;
+    }
+    int nEntries = nLast - nFirst + 1;
+    int nShift = ((nSteps % nEntries) + nEntries) % nEntries;
+    for(int nEntryIdx = 0; nEntryIdx < nEntries; nEntryIdx++) {
+        rotatedAr[(nEntryIdx + nShift) % nEntries] = pIndexed->nPaletteGRB[nFirst + nEntryIdx];
+    }
+    memcpy(&pIndexed->nPaletteGRB[nFirst], rotatedAr, nEntries * sizeof(uint32_t));
+}
+
+int indexBufferColors(uint16_t nBufferNumber, struct _IndexedBuffer *pIndexed)
+{
+    const struct _LedPixel *pBuffer = ptrBuffer(nBufferNumber);
+    if(pBuffer == NULL) {
+        return -1;  // FAILURE
+    }
+    // hash of colors seen so far: entry is (color + 1) so 0 means empty, index alongside
+    uint32_t colorHashAr[COLOR_HASH_SIZE];
+    uint8_t indexHashAr[COLOR_HASH_SIZE];
+    uint32_t paletteAr[PALETTE_ENTRIES];
+    uint8_t *pIndices = xmalloc(maxLedsInBuffer());
+    int nColors = 0;
+    memset(colorHashAr, 0, sizeof(colorHashAr));
+    for(int nLedIdx = 0; nLedIdx < maxLedsInBuffer(); nLedIdx++) {
+        const struct _LedPixel *pLED = &pBuffer[nLedIdx];
+        uint32_t nColorRGB = (pLED->red << 16) | (pLED->green << 8) | pLED->blue;
+        uint32_t nSlot = ((nColorRGB * 2654435761u) >> 22) % COLOR_HASH_SIZE;
+        while(colorHashAr[nSlot] != 0 && colorHashAr[nSlot] != nColorRGB + 1) {
+            nSlot = (nSlot + 1) % COLOR_HASH_SIZE;
+        }
+        if(colorHashAr[nSlot] == 0) {
+            if(nColors == PALETTE_ENTRIES) {
+                warningMessage("buffer %d has more than %d colors, not indexed", nBufferNumber, PALETTE_ENTRIES);
+                free(pIndices);
+                return -1;  // FAILURE
+            }
+            colorHashAr[nSlot] = nColorRGB + 1;
+            indexHashAr[nSlot] = nColors;
+            paletteAr[nColors++] = packedGRBforRGB(nColorRGB);
+        }
+        pIndices[nLedIdx] = indexHashAr[nSlot];
+    }
+    memcpy(pIndexed->pIndices, pIndices, maxLedsInBuffer());
+    memcpy(pIndexed->nPaletteGRB, paletteAr, nColors * sizeof(uint32_t));
+    memset(&pIndexed->nPaletteGRB[nColors], 0, (PALETTE_ENTRIES - nColors) * sizeof(uint32_t));
+    free(pIndices);
+    debugMessage("indexBufferColors() buffer %d: %d colors", nBufferNumber, nColors);
+    return 0;   // SUCCESS
+}
+
+void expandIndexedBuffer(const struct _IndexedBuffer *pIndexed, struct _LedPixel *pFrame)
+{
+    const uint8_t *pIndices = pIndexed->pIndices;
+    const uint32_t *pPalette = pIndexed->nPaletteGRB;
+    uint8_t *pDest = (uint8_t *)pFrame;
+    int nLeds = maxLedsInBuffer();
+    int nLedIdx = 0;
+    // 4 LEDs a pass, each 4 byte store's pad byte lands on next LED (last one on spare LED)
+    for(; nLedIdx + 4 <= nLeds; nLedIdx += 4) {
+        uint32_t nLed0 = pPalette[pIndices[nLedIdx + 0]];
+        uint32_t nLed1 = pPalette[pIndices[nLedIdx + 1]];
+        uint32_t nLed2 = pPalette[pIndices[nLedIdx + 2]];
+        uint32_t nLed3 = pPalette[pIndices[nLedIdx + 3]];
+        memcpy(pDest + 0, &nLed0, sizeof(uint32_t));
+        memcpy(pDest + 3, &nLed1, sizeof(uint32_t));
+        memcpy(pDest + 6, &nLed2, sizeof(uint32_t));
+        memcpy(pDest + 9, &nLed3, sizeof(uint32_t));
+        pDest += 4 * sizeof(struct _LedPixel);
+    }
+    for(; nLedIdx < nLeds; nLedIdx++) {
+        memcpy(pDest, &pPalette[pIndices[nLedIdx]], sizeof(struct _LedPixel));
+        pDest += sizeof(struct _LedPixel);
+    }
+}
+
+void showIndexedBufferAt(const struct _IndexedBuffer *pIndexed, uint64_t presentAtNsec)
+{
+    struct _LedPixel frameAr[LAYOUT_NO_LED_IDX + 1];
+    expandIndexedBuffer(pIndexed, frameAr);
+    if(presentAtNsec == 0) {
+        showBuffer((uint8_t *)frameAr, frameBufferSizeInBytes());
+    }
+    else {
+        showBufferAt((uint8_t *)frameAr, frameBufferSizeInBytes(), presentAtNsec);
+    }
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static uint32_t packedGRBforRGB(uint32_t nColorRGB)
+{
+    uint8_t grbBytes[4] = { (nColorRGB >> 8) & 0xff, (nColorRGB >> 16) & 0xff, (nColorRGB >> 0) & 0xff, 0 };
+    uint32_t nPackedGRB;
+    memcpy(&nPackedGRB, grbBytes, sizeof(nPackedGRB));
+    return nPackedGRB;
+}
@@ -0,0 +1,65 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef PALETTE_BUFFER_H
+#define PALETTE_BUFFER_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+#define PALETTE_MAX_BUFFERS 1024
+#define PALETTE_ENTRIES 256
+
+// indexed buffer: one palette index byte per LED (same LED order as frame buffers) plus its own palette
+//  1/3 the memory of a frame buffer, recolored (e.g. palette cycling) by changing palette only
+struct _IndexedBuffer {
+    uint8_t *pIndices;                      // [maxLedsInBuffer() + 1] (last is the LAYOUT_NO_LED_IDX spare)
+    uint32_t nPaletteGRB[PALETTE_ENTRIES];  // entry as it lands in frame: green, red, blue, pad byte in memory order
+};
+
+// indexed buffers are numbered [1 - numberIndexedBuffers()], new ones are all index 0 with black palette
+int allocIndexedBuffers(int nDesiredBuffers);
+void freeIndexedBuffers(void);
+uint16_t numberIndexedBuffers(void);
+struct _IndexedBuffer *ptrIndexedBuffer(uint16_t nIndexedNumber);  // NULL (with warning) if no such buffer
+void showIndexedBuffers(void);
+
+// screen X,Y - NO checks, X,Y must be on screen
+static inline void setIndexInBuffer(struct _IndexedBuffer *pIndexed, uint8_t nIndex, uint16_t locX, uint16_t locY)
+{
+    pIndexed->pIndices[ledIndexForXY(locX, locY)] = nIndex;
+}
+
+// palette
+void setPaletteEntry(struct _IndexedBuffer *pIndexed, uint8_t nIndex, uint32_t nColorRGB);
+uint32_t getPaletteEntry(const struct _IndexedBuffer *pIndexed, uint8_t nIndex);
+// entries [nFirst - nLast] move nSteps up (wrapping within range, negative moves down)
+void rotatePalette(struct _IndexedBuffer *pIndexed, uint8_t nFirst, uint8_t nLast, int nSteps);
+
+// frame buffer -> indexed buffer, palette built from colors used, -1 (indexed unchanged) if more than 256 colors
+int indexBufferColors(uint16_t nBufferNumber, struct _IndexedBuffer *pIndexed);
+
+// present: expand indices through palette into frame (frameBufferSizeInBytes() + spare LED) / straight to screen
+void expandIndexedBuffer(const struct _IndexedBuffer *pIndexed, struct _LedPixel *pFrame);
+void showIndexedBufferAt(const struct _IndexedBuffer *pIndexed, uint64_t presentAtNsec);  // 0 = now
+
+#endif /* PALETTE_BUFFER_H */
@@ -0,0 +1,394 @@
+/*
+matrix - interactive LED Matrix console
+
+Copyright (C) 2019 Stephen M Moraco
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "panelLayout.h"
+#include "xmalloc.h"
+#include "debug.h"
+
+//  Layout description file (.layout), one item per line, '#' starts a comment:
+//
+//    screen {width} {height}
+//    format {sequential|interleaved}        (optional, default sequential)
+//    panel {x} {y} {columns} {rows} {rotation} {wiring} {lane} [{laneOffset}]
+//
+//  where rotation is [0, 90, 180, 270] clockwise, and wiring names the axis LEDs
+//  run along, the corner (of the unrotated panel) holding LED 0, and optionally
+//  "prog" when every column/row runs the same way (default is serpentine):
+//
+//    {cols|rows}-{tl|tr|bl|br}[-prog]     e.g. cols-br (our 32x8 panels)
+//
+//  format picks how lanes are stored in the frame buffer: 'sequential' keeps each
+//  lane's LEDs together, 'interleaved' stores LED N of every lane side by side,
+//  the order the driver sends them, so it needs no reshaping per frame.
+//
+//  Example (our original screen):
+//    screen 32 24
+//    panel 0 0  32 8 0 cols-br 0
+//    panel 0 8  32 8 0 cols-br 1
+//    panel 0 16 32 8 0 cols-br 2
+//
+
+#define DEFAULT_PANEL_COLUMNS 32
+#define DEFAULT_PANEL_ROWS 8
+
+struct _PanelLayout screenLayout;
+
+// -----------------------
+// forward declarations
+//
+static int buildXlateTable(struct _PanelLayout *pLayout);
+static uint16_t panelLedIndex(const struct _PanelSpec *pPanel, uint16_t nPanelX, uint16_t nPanelY);
+static int parseWiring(const char *wiringSpec, struct _PanelSpec *pPanel);
+static void setDefaultLayout(struct _PanelLayout *pLayout);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+void initPanelLayout(void)
+{
+    restoreDefaultPanelLayout();
+}
+
+void restoreDefaultPanelLayout(void)
+{
+    struct _PanelLayout newLayout;
+
+    setDefaultLayout(&newLayout);
+    if(buildXlateTable(&newLayout) == 0) {
+        free(screenLayout.pXlateTable);
+        newLayout.nGeneration = screenLayout.nGeneration + 1;
+        screenLayout = newLayout;
+    }
+}
+
+int loadPanelLayoutFile(const char *fileSpec)
+{
+    struct _PanelLayout newLayout;
+    char lineBuffer[256];
+    char wiringSpec[32];
+    char *pComment;
+    int nLineNbr = 0;
+    int loadStatus = 0;    // SUCCESS
+
+    FILE *fpLayoutFile = fopen(fileSpec, "r");
+    if(fpLayoutFile == NULL) {
+        perrorMessage("fopen() failure");
+        return -1;
+    }
+
+    memset(&newLayout, 0, sizeof(newLayout));
+    while(loadStatus == 0 && fgets(lineBuffer, sizeof(lineBuffer), fpLayoutFile) != NULL) {
+        nLineNbr++;
+        if((pComment = strchr(lineBuffer, '#')) != NULL) {
+            *pComment = 0x00;
+        }
+        int nWidth;
+        int nHeight;
+        int nX, nY, nColumns, nRows, nRotation, nLane;
+        int nLaneOffset = 0;
+        char formatName[16];
+        if(sscanf(lineBuffer, " format %15s", formatName) == 1) {
+            if(strcmp(formatName, "sequential") == 0) {
+                newLayout.eFrameFormat = FF_LANE_SEQUENTIAL;
+            }
+            else if(strcmp(formatName, "interleaved") == 0) {
+                newLayout.eFrameFormat = FF_LANE_INTERLEAVED;
+            }
+            else {
+                errorMessage("%s:%d format [%s] must be [sequential, interleaved]", fileSpec, nLineNbr, formatName);
+                loadStatus = -1;
+            }
+        }
+        else if(sscanf(lineBuffer, " screen %d %d", &nWidth, &nHeight) == 2) {
+            if(nWidth < 1 || nWidth > LAYOUT_MAX_WIDTH || nHeight < 1 || nHeight > LAYOUT_MAX_HEIGHT) {
+                errorMessage("%s:%d screen %dx%d out-of-range: [max %dx%d]", fileSpec, nLineNbr, nWidth, nHeight, LAYOUT_MAX_WIDTH, LAYOUT_MAX_HEIGHT);
+                loadStatus = -1;
+            }
+            newLayout.nWidth = nWidth;
+            newLayout.nHeight = nHeight;
+        }
+        else if(sscanf(lineBuffer, " panel %d %d %d %d %d %31s %d %d", &nX, &nY, &nColumns, &nRows, &nRotation, wiringSpec, &nLane, &nLaneOffset) >= 7) {
+            if(newLayout.nPanels >= LAYOUT_MAX_PANELS) {
+                errorMessage("%s:%d too many panels: [max %d]", fileSpec, nLineNbr, LAYOUT_MAX_PANELS);
+                loadStatus = -1;
+                break;
+            }
+            struct _PanelSpec *pPanel = &newLayout.panels[newLayout.nPanels];
+            if(nX < 0 || nY < 0 || nColumns < 1 || nColumns > 255 || nRows < 1 || nRows > 255) {
+                errorMessage("%s:%d bad panel position/size", fileSpec, nLineNbr);
+                loadStatus = -1;
+            }
+            else if(nRotation != 0 && nRotation != 90 && nRotation != 180 && nRotation != 270) {
+                errorMessage("%s:%d rotation (%d) must be [0, 90, 180, 270]", fileSpec, nLineNbr, nRotation);
+                loadStatus = -1;
+            }
+            else if(nLane < 0 || nLane >= LAYOUT_MAX_LANES) {
+                errorMessage("%s:%d lane (%d) out-of-range: [0-%d]", fileSpec, nLineNbr, nLane, LAYOUT_MAX_LANES - 1);
+                loadStatus = -1;
+            }
+            else if(nLaneOffset < 0 || nLaneOffset + (nColumns * nRows) > LAYOUT_LEDS_PER_LANE) {
+                errorMessage("%s:%d panel LEDs [%d-%d] don't fit lane: [0-%d]", fileSpec, nLineNbr, nLaneOffset, nLaneOffset + (nColumns * nRows) - 1, LAYOUT_LEDS_PER_LANE - 1);
+                loadStatus = -1;
+            }
+            else if(parseWiring(wiringSpec, pPanel) != 0) {
+                errorMessage("%s:%d bad wiring [%s] expected {cols|rows}-{tl|tr|bl|br}[-prog]", fileSpec, nLineNbr, wiringSpec);
+                loadStatus = -1;
+            }
+            else {
+                pPanel->nOriginX = nX;
+                pPanel->nOriginY = nY;
+                pPanel->nColumns = nColumns;
+                pPanel->nRows = nRows;
+                pPanel->nRotation = nRotation;
+                pPanel->nLane = nLane;
+                pPanel->nLaneOffset = nLaneOffset;
+                newLayout.nPanels++;
+            }
+        }
+        else if(strspn(lineBuffer, " \t\r\n") != strlen(lineBuffer)) {
+            errorMessage("%s:%d unknown layout line [%s]", fileSpec, nLineNbr, lineBuffer);
+            loadStatus = -1;
+        }
+    }
+    fclose(fpLayoutFile);
+
+    if(loadStatus == 0 && (newLayout.nWidth == 0 || newLayout.nPanels == 0)) {
+        errorMessage("%s: layout needs a screen line and at least one panel", fileSpec);
+        loadStatus = -1;
+    }
+    if(loadStatus == 0) {
+        loadStatus = buildXlateTable(&newLayout);
+    }
+    if(loadStatus == 0) {
+        free(screenLayout.pXlateTable);
+        newLayout.nGeneration = screenLayout.nGeneration + 1;
+        screenLayout = newLayout;
+        infoMessage("Layout %s loaded: %dx%d screen, %d panels", fileSpec, screenLayout.nWidth, screenLayout.nHeight, screenLayout.nPanels);
+    }
+    else {
+        free(newLayout.pXlateTable);
+    }
+    return loadStatus;
+}
+
+void showPanelLayout(void)
+{
+    static const char *cornerNames[] = { "tl", "tr", "bl", "br" };
+
+    infoMessage("Layout: %dx%d screen, %d panels, lane-%s frame format", screenLayout.nWidth, screenLayout.nHeight, screenLayout.nPanels,
+        (screenLayout.eFrameFormat == FF_LANE_INTERLEAVED) ? "interleaved" : "sequential");
+    for(int nPanelIdx = 0; nPanelIdx < screenLayout.nPanels; nPanelIdx++) {
+        struct _PanelSpec *pPanel = &screenLayout.panels[nPanelIdx];
+        infoMessage(" - panel %d @(%d,%d) %dx%d rot %d wiring %s-%s%s lane %d offset %d", nPanelIdx + 1,
+            pPanel->nOriginX, pPanel->nOriginY, pPanel->nColumns, pPanel->nRows, pPanel->nRotation,
+            (pPanel->eAxis == WA_COLUMNS) ? "cols" : "rows", cornerNames[pPanel->eCorner], (pPanel->bSerpentine) ? "" : "-prog",
+            pPanel->nLane, pPanel->nLaneOffset);
+    }
+}
+
+int layoutSupportsDriverScroll(void)
+{
+    // driver moves whole columns of each lane's string, it knows nothing of our layout
+    uint8_t nLanesSeen = 0;
+
+    if(screenLayout.nWidth != DEFAULT_PANEL_COLUMNS || screenLayout.nPanels != LAYOUT_MAX_LANES) {
+        return 0;
+    }
+    for(int nPanelIdx = 0; nPanelIdx < screenLayout.nPanels; nPanelIdx++) {
+        const struct _PanelSpec *pPanel = &screenLayout.panels[nPanelIdx];
+        if(pPanel->nOriginX != 0 || pPanel->nColumns != DEFAULT_PANEL_COLUMNS || pPanel->nRows != DEFAULT_PANEL_ROWS ||
+           pPanel->nRotation != 0 || pPanel->eAxis != WA_COLUMNS || pPanel->eCorner != WC_BOTTOM_RIGHT ||
+           !pPanel->bSerpentine || pPanel->nLaneOffset != 0 || (nLanesSeen & (1 << pPanel->nLane))) {
+            return 0;
+        }
+        nLanesSeen |= (1 << pPanel->nLane);
+    }
+    return 1;
+}
+
+int ledRunStep(const uint16_t *pEntry, int nEntryStride, int nCount)
+{
+    // constant LED index step between neighboring pixels, 0 when they are not one run
+    int nStep = pEntry[nEntryStride] - pEntry[0];
+    if(nStep == 0 || pEntry[0] == LAYOUT_NO_LED_IDX) {
+        return 0;
+    }
+    for(int nEntryIdx = 2; nEntryIdx < nCount; nEntryIdx++) {
+        if(pEntry[nEntryIdx * nEntryStride] - pEntry[(nEntryIdx - 1) * nEntryStride] != nStep) {
+            return 0;
+        }
+    }
+    return nStep;
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static void setDefaultLayout(struct _PanelLayout *pLayout)
+{
+    // 3 panels of 32x8 stacked top to bottom, one per lane, LED 0 at bottom right then up/down columns
+    memset(pLayout, 0, sizeof(struct _PanelLayout));
+    pLayout->nWidth = DEFAULT_PANEL_COLUMNS;
+    pLayout->nHeight = DEFAULT_PANEL_ROWS * LAYOUT_MAX_LANES;
+    pLayout->nPanels = LAYOUT_MAX_LANES;
+    for(int nPanelIdx = 0; nPanelIdx < LAYOUT_MAX_LANES; nPanelIdx++) {
+        struct _PanelSpec *pPanel = &pLayout->panels[nPanelIdx];
+        pPanel->nOriginX = 0;
+        pPanel->nOriginY = nPanelIdx * DEFAULT_PANEL_ROWS;
+        pPanel->nColumns = DEFAULT_PANEL_COLUMNS;
+        pPanel->nRows = DEFAULT_PANEL_ROWS;
+        pPanel->nRotation = 0;
+        pPanel->eAxis = WA_COLUMNS;
+        pPanel->eCorner = WC_BOTTOM_RIGHT;
+        pPanel->bSerpentine = 1;
+        pPanel->nLane = nPanelIdx;
+        pPanel->nLaneOffset = 0;
+    }
+}
+
+static int parseWiring(const char *wiringSpec, struct _PanelSpec *pPanel)
+{
+    static const char *cornerNames[] = { "tl", "tr", "bl", "br" };
+
+    if(strncmp(wiringSpec, "cols-", 5) == 0) {
+        pPanel->eAxis = WA_COLUMNS;
+    }
+    else if(strncmp(wiringSpec, "rows-", 5) == 0) {
+        pPanel->eAxis = WA_ROWS;
+    }
+    else {
+        return -1;
+    }
+    for(int nCornerIdx = 0; nCornerIdx < 4; nCornerIdx++) {
+        if(strncmp(&wiringSpec[5], cornerNames[nCornerIdx], 2) == 0) {
+            pPanel->eCorner = nCornerIdx;
+            if(wiringSpec[7] == 0x00) {
+                pPanel->bSerpentine = 1;
+                return 0;
+            }
+            if(strcmp(&wiringSpec[7], "-prog") == 0) {
+                pPanel->bSerpentine = 0;
+                return 0;
+            }
+            return -1;
+        }
+    }
+    return -1;
+}
+
+static uint16_t panelLedIndex(const struct _PanelSpec *pPanel, uint16_t nPanelX, uint16_t nPanelY)
+{
+    // LED index along panel's string for unrotated panel X,Y
+    int bStartsRight = (pPanel->eCorner == WC_TOP_RIGHT || pPanel->eCorner == WC_BOTTOM_RIGHT);
+    int bStartsBottom = (pPanel->eCorner == WC_BOTTOM_LEFT || pPanel->eCorner == WC_BOTTOM_RIGHT);
+    uint16_t nLineIdx;
+    uint16_t nPosInLine;
+    int bLineReversed;
+
+    if(pPanel->eAxis == WA_COLUMNS) {
+        nLineIdx = (bStartsRight) ? (pPanel->nColumns - 1) - nPanelX : nPanelX;
+        bLineReversed = pPanel->bSerpentine && (nLineIdx & 0x01) == 1;
+        nPosInLine = (bStartsBottom != bLineReversed) ? (pPanel->nRows - 1) - nPanelY : nPanelY;
+        return (nLineIdx * pPanel->nRows) + nPosInLine;
+    }
+    nLineIdx = (bStartsBottom) ? (pPanel->nRows - 1) - nPanelY : nPanelY;
+    bLineReversed = pPanel->bSerpentine && (nLineIdx & 0x01) == 1;
+    nPosInLine = (bStartsRight != bLineReversed) ? (pPanel->nColumns - 1) - nPanelX : nPanelX;
+    return (nLineIdx * pPanel->nColumns) + nPosInLine;
+}
+
+static int buildXlateTable(struct _PanelLayout *pLayout)
+{
+    int nTableEntries = pLayout->nWidth * pLayout->nHeight;
+    uint8_t *pLedUsed;
+    int buildStatus = 0;    // SUCCESS
+
+    pLayout->pXlateTable = xmalloc(nTableEntries * sizeof(uint16_t));
+    pLedUsed = xmalloc(LAYOUT_NO_LED_IDX);
+    for(int nEntryIdx = 0; nEntryIdx < nTableEntries; nEntryIdx++) {
+        pLayout->pXlateTable[nEntryIdx] = LAYOUT_NO_LED_IDX;
+    }
+    memset(pLedUsed, 0, LAYOUT_NO_LED_IDX);
+
+    for(int nPanelIdx = 0; nPanelIdx < pLayout->nPanels && buildStatus == 0; nPanelIdx++) {
+        struct _PanelSpec *pPanel = &pLayout->panels[nPanelIdx];
+        int bIsSideways = (pPanel->nRotation == 90 || pPanel->nRotation == 270);
+        int nOnScreenWidth = (bIsSideways) ? pPanel->nRows : pPanel->nColumns;
+        int nOnScreenHeight = (bIsSideways) ? pPanel->nColumns : pPanel->nRows;
+        if(pPanel->nOriginX + nOnScreenWidth > pLayout->nWidth || pPanel->nOriginY + nOnScreenHeight > pLayout->nHeight) {
+            errorMessage("Layout panel %d (%dx%d @%d,%d) extends off %dx%d screen", nPanelIdx + 1, nOnScreenWidth, nOnScreenHeight, pPanel->nOriginX, pPanel->nOriginY, pLayout->nWidth, pLayout->nHeight);
+            buildStatus = -1;
+            break;
+        }
+        for(int nRelY = 0; nRelY < nOnScreenHeight && buildStatus == 0; nRelY++) {
+            for(int nRelX = 0; nRelX < nOnScreenWidth; nRelX++) {
+                // undo rotation to find X,Y on panel as wired
+                int nPanelX;
+                int nPanelY;
+                switch(pPanel->nRotation) {
+                    case 90:
+                        nPanelX = nRelY;
+                        nPanelY = (pPanel->nRows - 1) - nRelX;
+                        break;
+                    case 180:
+                        nPanelX = (pPanel->nColumns - 1) - nRelX;
+                        nPanelY = (pPanel->nRows - 1) - nRelY;
+                        break;
+                    case 270:
+                        nPanelX = (pPanel->nColumns - 1) - nRelY;
+                        nPanelY = nRelX;
+                        break;
+                    default:
+                        nPanelX = nRelX;
+                        nPanelY = nRelY;
+                        break;
+                }
+                uint16_t nLedInLane = pPanel->nLaneOffset + panelLedIndex(pPanel, nPanelX, nPanelY);
+                uint16_t nLedIdx = ledIndexForLane(pLayout->eFrameFormat, pPanel->nLane, nLedInLane);
+                int nEntryIdx = ((pPanel->nOriginY + nRelY) * pLayout->nWidth) + pPanel->nOriginX + nRelX;
+                if(pLayout->pXlateTable[nEntryIdx] != LAYOUT_NO_LED_IDX) {
+                    errorMessage("Layout panel %d overlaps another panel at (%d,%d)", nPanelIdx + 1, pPanel->nOriginX + nRelX, pPanel->nOriginY + nRelY);
+                    buildStatus = -1;
+                    break;
+                }
+                if(pLedUsed[nLedIdx]) {
+                    errorMessage("Layout panel %d reuses lane %d LED %d", nPanelIdx + 1, pPanel->nLane, nLedInLane);
+                    buildStatus = -1;
+                    break;
+                }
+                pLedUsed[nLedIdx] = 1;
+                pLayout->pXlateTable[nEntryIdx] = nLedIdx;
+            }
+        }
+    }
+    free(pLedUsed);
+    if(buildStatus != 0) {
+        free(pLayout->pXlateTable);
+        pLayout->pXlateTable = NULL;
+    }
+    return buildStatus;
+}
@@ -0,0 +1,111 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef PANEL_LAYOUT_H
+#define PANEL_LAYOUT_H
+
+#include <stdint.h>
+
+// driver frame: one string of LEDs per lane (GPIO pin)
+#define LAYOUT_MAX_LANES 3
+#define LAYOUT_LEDS_PER_LANE 256
+
+// screen pixels not covered by a panel map here: one spare LED after the frame, never sent
+#define LAYOUT_NO_LED_IDX (LAYOUT_MAX_LANES * LAYOUT_LEDS_PER_LANE)
+
+#define LAYOUT_MAX_PANELS 16
+#define LAYOUT_MAX_WIDTH 256
+#define LAYOUT_MAX_HEIGHT 256
+
+typedef enum _eFrameFormat {
+    FF_LANE_SEQUENTIAL = 0, // lane 0 LEDs, then lane 1 LEDs, ...  (same values as driver FIFO_FORMAT_*)
+    FF_LANE_INTERLEAVED,    // LED 0 of every lane, then LED 1 of every lane, ... (order driver transmits)
+} eFrameFormat;
+
+typedef enum _eWiringAxis {
+    WA_COLUMNS = 0,     // LEDs run up/down a column then on to next column
+    WA_ROWS,            // LEDs run across a row then on to next row
+} eWiringAxis;
+
+typedef enum _eWiringCorner {
+    WC_TOP_LEFT = 0,    // corner of (unrotated) panel where LED 0 is
+    WC_TOP_RIGHT,
+    WC_BOTTOM_LEFT,
+    WC_BOTTOM_RIGHT,
+} eWiringCorner;
+
+struct _PanelSpec {
+    uint16_t nOriginX;      // top-left of panel on screen
+    uint16_t nOriginY;
+    uint8_t nColumns;       // panel size as wired (before rotation)
+    uint8_t nRows;
+    uint16_t nRotation;     // clockwise [0, 90, 180, 270]
+    uint8_t eAxis;          // eWiringAxis value
+    uint8_t eCorner;        // eWiringCorner value
+    uint8_t bSerpentine;    // 1 = every other column/row runs backwards, 0 = all run same way
+    uint8_t nLane;          // [0 - (LAYOUT_MAX_LANES-1)]
+    uint16_t nLaneOffset;   // index along lane of panel's LED 0
+};
+
+struct _PanelLayout {
+    uint16_t nWidth;        // screen pixels
+    uint16_t nHeight;
+    uint8_t eFrameFormat;   // eFrameFormat value, order of LEDs within frame buffer
+    uint16_t *pXlateTable;  // [nHeight][nWidth] LED index within buffer for each X,Y
+    uint32_t nGeneration;   // bumped each time active layout is replaced (first is 1), for caches of layout-derived data
+    uint8_t nPanels;
+    struct _PanelSpec panels[LAYOUT_MAX_PANELS];
+};
+
+// the active layout, every drawing/image/text path maps through this
+extern struct _PanelLayout screenLayout;
+
+// build our original 3 x (32x8) layout
+void initPanelLayout(void);
+
+// replace active layout from description file, 0 on success (active layout unchanged on error)
+//  frees the old xlate table: clock and ticker threads must be stopped first
+int loadPanelLayoutFile(const char *fileSpec);
+void restoreDefaultPanelLayout(void);
+void showPanelLayout(void);
+
+// 1 when every lane is one full-width 32x8 cols-br serpentine panel, the only geometry the driver's scroll op knows
+int layoutSupportsDriverScroll(void);
+
+// LED index within buffer of LED N along lane, for buffer in eFrameFormat order
+static inline uint16_t ledIndexForLane(uint8_t eFrameFormat, uint8_t nLane, uint16_t nLedInLane)
+{
+    if(eFrameFormat == FF_LANE_INTERLEAVED) {
+        return (nLedInLane * LAYOUT_MAX_LANES) + nLane;
+    }
+    return (nLane * LAYOUT_LEDS_PER_LANE) + nLedInLane;
+}
+
+// LED index for screen X,Y - NO checks, X,Y must be on screen
+static inline uint16_t ledIndexForXY(uint16_t locX, uint16_t locY)
+{
+    return screenLayout.pXlateTable[(locY * screenLayout.nWidth) + locX];
+}
+
+// constant LED index step along nCount xlate table entries nEntryStride apart, 0 when they are not one run of LEDs
+int ledRunStep(const uint16_t *pEntry, int nEntryStride, int nCount);
+
+#endif /* PANEL_LAYOUT_H */
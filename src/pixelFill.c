@@ -0,0 +1,226 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "pixelFill.h"
+
+//  Our LEDs are 3 bytes (GRB) so a solid color is a pattern repeating every 3 bytes,
+//  which no power-of-two store lines up with.  We build one least-common-multiple
+//  sized pattern (3 vector registers = 16 or 32 LEDs) and store it over and over:
+//
+//    NEON (RPi):   vst3q_u8() interleaves G,R,B registers itself, 16 LEDs per store
+//    AVX (host):   96-byte pattern, 32 LEDs per 3 stores
+//    SSE2 (host):  48-byte pattern, 16 LEDs per 3 stores
+//    otherwise:    12-byte pattern, 4 LEDs per 3 32-bit stores
+//
+//  whatever is left over is finished an LED at a time.
+
+#define WORD_PATTERN_LEDS 4     // 4 LEDs = 12 bytes = 3 x uint32_t
+#if defined(__AVX__)
+#define VECTOR_PATTERN_LEDS 32  // 96 bytes = 3 x __m256i
+#else
+#define VECTOR_PATTERN_LEDS 16  // 48 bytes = 3 x __m128i (or uint8x16_t)
+#endif
+
+// -----------------------
+// forward declarations
+//
+static void fillTableLine(struct _LedPixel *pBuffer, const uint16_t *pEntry, int nEntryStride, int nCount, uint32_t nColorRGB);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+void fillLedRun(struct _LedPixel *pLeds, int nLedCount, uint32_t nColorRGB)
+{
+    uint8_t *pBytes = (uint8_t *)pLeds;
+    uint8_t red = (nColorRGB >> 16) & 0xff;
+    uint8_t green = (nColorRGB >> 8) & 0xff;
+    uint8_t blue = (nColorRGB >> 0) & 0xff;
+    int nLedIdx = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if(nLedCount >= VECTOR_PATTERN_LEDS) {
+        uint8x16x3_t pixels16;
+        pixels16.val[0] = vdupq_n_u8(green);
+        pixels16.val[1] = vdupq_n_u8(red);
+        pixels16.val[2] = vdupq_n_u8(blue);
+        for(; nLedIdx + VECTOR_PATTERN_LEDS <= nLedCount; nLedIdx += VECTOR_PATTERN_LEDS) {
+            vst3q_u8(&pBytes[nLedIdx * BYTES_PER_LED], pixels16);
+        }
+    }
+#elif defined(__AVX__) || defined(__SSE2__)
+    if(nLedCount >= VECTOR_PATTERN_LEDS) {
+        uint8_t patternAr[VECTOR_PATTERN_LEDS * BYTES_PER_LED];
+        for(int nPatternIdx = 0; nPatternIdx < VECTOR_PATTERN_LEDS * BYTES_PER_LED; nPatternIdx += BYTES_PER_LED) {
+            patternAr[nPatternIdx + 0] = green;
+            patternAr[nPatternIdx + 1] = red;
+            patternAr[nPatternIdx + 2] = blue;
+        }
+#if defined(__AVX__)
+        __m256i pattern0 = _mm256_loadu_si256((const __m256i *)&patternAr[0]);
+        __m256i pattern1 = _mm256_loadu_si256((const __m256i *)&patternAr[32]);
+        __m256i pattern2 = _mm256_loadu_si256((const __m256i *)&patternAr[64]);
+        for(; nLedIdx + VECTOR_PATTERN_LEDS <= nLedCount; nLedIdx += VECTOR_PATTERN_LEDS) {
+            uint8_t *pDest = &pBytes[nLedIdx * BYTES_PER_LED];
+            _mm256_storeu_si256((__m256i *)&pDest[0], pattern0);
+            _mm256_storeu_si256((__m256i *)&pDest[32], pattern1);
+            _mm256_storeu_si256((__m256i *)&pDest[64], pattern2);
+        }
+#else
+        __m128i pattern0 = _mm_loadu_si128((const __m128i *)&patternAr[0]);
+        __m128i pattern1 = _mm_loadu_si128((const __m128i *)&patternAr[16]);
+        __m128i pattern2 = _mm_loadu_si128((const __m128i *)&patternAr[32]);
+        for(; nLedIdx + VECTOR_PATTERN_LEDS <= nLedCount; nLedIdx += VECTOR_PATTERN_LEDS) {
+            uint8_t *pDest = &pBytes[nLedIdx * BYTES_PER_LED];
+            _mm_storeu_si128((__m128i *)&pDest[0], pattern0);
+            _mm_storeu_si128((__m128i *)&pDest[16], pattern1);
+            _mm_storeu_si128((__m128i *)&pDest[32], pattern2);
+        }
+#endif
+    }
+#endif
+
+    if(nLedCount - nLedIdx >= WORD_PATTERN_LEDS) {
+        uint32_t patternAr[BYTES_PER_LED];  // 4 LEDs
+        uint8_t *pPatternBytes = (uint8_t *)patternAr;
+        for(int nPatternIdx = 0; nPatternIdx < WORD_PATTERN_LEDS * BYTES_PER_LED; nPatternIdx += BYTES_PER_LED) {
+            pPatternBytes[nPatternIdx + 0] = green;
+            pPatternBytes[nPatternIdx + 1] = red;
+            pPatternBytes[nPatternIdx + 2] = blue;
+        }
+        for(; nLedIdx + WORD_PATTERN_LEDS <= nLedCount; nLedIdx += WORD_PATTERN_LEDS) {
+            // memcpy() of fixed size compiles to (unaligned-safe) word stores
+            memcpy(&pBytes[nLedIdx * BYTES_PER_LED], patternAr, sizeof(patternAr));
+        }
+    }
+
+    for(; nLedIdx < nLedCount; nLedIdx++) {
+        pLeds[nLedIdx].green = green;
+        pLeds[nLedIdx].red = red;
+        pLeds[nLedIdx].blue = blue;
+    }
+}
+
+void fillLedStride(struct _LedPixel *pLeds, int nLedCount, int nStride, uint32_t nColorRGB)
+{
+    if(nStride == 1) {
+        fillLedRun(pLeds, nLedCount, nColorRGB);
+        return;
+    }
+    uint8_t red = (nColorRGB >> 16) & 0xff;
+    uint8_t green = (nColorRGB >> 8) & 0xff;
+    uint8_t blue = (nColorRGB >> 0) & 0xff;
+    for(int nLedIdx = 0; nLedIdx < nLedCount; nLedIdx++) {
+        struct _LedPixel *pLed = &pLeds[nLedIdx * nStride];
+        pLed->green = green;
+        pLed->red = red;
+        pLed->blue = blue;
+    }
+}
+
+int isLayoutColumnMajor(void)
+{
+    const struct _PanelSpec *pPanel = &screenLayout.panels[0];
+    int bIsSideways = (pPanel->nRotation == 90 || pPanel->nRotation == 270);
+    return ((pPanel->eAxis == WA_COLUMNS) != bIsSideways);
+}
+
+void fillRectInBuffer(struct _LedPixel *pBuffer, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB)
+{
+    fillClippedRectInBuffer(pBuffer, NULL, locX, locY, nWidth, nHeight, nColorRGB);
+}
+
+void fillClippedRectInBuffer(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB)
+{
+    // clip to clip rectangle (which is within screen) or to screen
+    int nClipMinX = (pClip != NULL) ? pClip->nMinX : 0;
+    int nClipMinY = (pClip != NULL) ? pClip->nMinY : 0;
+    int nClipMaxX = (pClip != NULL) ? pClip->nMaxX : SCREEN_WIDTH - 1;
+    int nClipMaxY = (pClip != NULL) ? pClip->nMaxY : SCREEN_HEIGHT - 1;
+    if(locX < nClipMinX) {
+        nWidth -= nClipMinX - locX;
+        locX = nClipMinX;
+    }
+    if(locY < nClipMinY) {
+        nHeight -= nClipMinY - locY;
+        locY = nClipMinY;
+    }
+    if(locX + nWidth > nClipMaxX + 1) {
+        nWidth = (nClipMaxX + 1) - locX;
+    }
+    if(locY + nHeight > nClipMaxY + 1) {
+        nHeight = (nClipMaxY + 1) - locY;
+    }
+    if(nWidth <= 0 || nHeight <= 0) {
+        return;
+    }
+
+    // walk the screen direction the LED strings run so neighbors land in long runs
+    const uint16_t *pTable = screenLayout.pXlateTable;
+    if(isLayoutColumnMajor()) {
+        for(int nX = locX; nX < locX + nWidth; nX++) {
+            fillTableLine(pBuffer, &pTable[(locY * SCREEN_WIDTH) + nX], SCREEN_WIDTH, nHeight, nColorRGB);
+        }
+    }
+    else {
+        for(int nY = locY; nY < locY + nHeight; nY++) {
+            fillTableLine(pBuffer, &pTable[(nY * SCREEN_WIDTH) + locX], 1, nWidth, nColorRGB);
+        }
+    }
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static void fillTableLine(struct _LedPixel *pBuffer, const uint16_t *pEntry, int nEntryStride, int nCount, uint32_t nColorRGB)
+{
+    // group neighboring pixels whose LEDs are consecutive (either direction) into one run
+    int nEntryIdx = 0;
+    while(nEntryIdx < nCount) {
+        uint16_t nFirstLedIdx = pEntry[nEntryIdx * nEntryStride];
+        int nRunLength = 1;
+        int nStep = 0;
+        if(nEntryIdx + 1 < nCount) {
+            int nDelta = pEntry[(nEntryIdx + 1) * nEntryStride] - nFirstLedIdx;
+            if(nDelta == 1 || nDelta == -1) {
+                nStep = nDelta;
+            }
+        }
+        if(nStep != 0) {
+            while(nEntryIdx + nRunLength < nCount &&
+                  pEntry[(nEntryIdx + nRunLength) * nEntryStride] == nFirstLedIdx + (nRunLength * nStep)) {
+                nRunLength++;
+            }
+        }
+        uint16_t nLowestLedIdx = (nStep < 0) ? nFirstLedIdx - (nRunLength - 1) : nFirstLedIdx;
+        fillLedRun(&pBuffer[nLowestLedIdx], nRunLength, nColorRGB);
+        nEntryIdx += nRunLength;
+    }
+}
@@ -0,0 +1,43 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef PIXEL_FILL_H
+#define PIXEL_FILL_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+// fill N consecutive LEDs with one color (wide stores where the CPU has them)
+void fillLedRun(struct _LedPixel *pLeds, int nLedCount, uint32_t nColorRGB);
+
+// fill N LEDs each nStride LEDs apart (e.g. one lane of a lane-interleaved buffer)
+void fillLedStride(struct _LedPixel *pLeds, int nLedCount, int nStride, uint32_t nColorRGB);
+
+// T/F where T means LED strings run up/down screen columns, so vertical spans fill fastest
+int isLayoutColumnMajor(void);
+
+// fill screen rectangle through panel layout, clipped to screen
+void fillRectInBuffer(struct _LedPixel *pBuffer, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB);
+// same, clipped to pClip (must lie within screen, NULL = screen)
+void fillClippedRectInBuffer(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int locX, int locY, int nWidth, int nHeight, uint32_t nColorRGB);
+
+#endif /* PIXEL_FILL_H */
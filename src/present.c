@@ -0,0 +1,508 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>     // strtol(), strtod()
+#include <string.h>
+#include <math.h>       // pow()
+
+#include "present.h"
+#include "panelLayout.h"
+#include "debug.h"
+
+//  Every frame passes through here on its way to the driver (see matrixDriver.c), the
+//  one place that sees exactly what will light up.  All 768 LEDs at full white draw
+//  far more current than our supplies give, so frames are held to a current budget:
+//
+//    1. sum all channel bytes (one read of frame, the compiler vectorizes the sum)
+//    2. estimated mA = idle mA + sum * mA-per-channel / 255
+//    3. over budget: brightness scale = what fits / what frame wants
+//    4. scale < 1.0: copy frame scaled (second pass, only while limiting)
+//
+//  The scale drops at once when a frame needs less (the supply must never be
+//  overdrawn) but comes back up over several frames, so content that hovers around
+//  the budget doesn't flicker between limited and unlimited brightness.
+//
+//  Color calibration (panels from different batches don't match) rides the same
+//  pass.  Gamma, each lane's LUTs and white balance gain are combined ahead of time
+//  into one table per lane per channel, so when calibrating step 1 becomes:
+//
+//    1. out = lane LUT[ (matrix *) in ], summing out as it goes (one read, one write)
+//
+//  and the limiter (step 4) then rescales that still-in-cache copy.  With no
+//  calibration set frames go to the driver as drawn (no copy) unless limited.
+
+#define SCALE_FULL 65536
+#define RELEASE_SHIFT 3         // scale recovers 1/8 of its way back up each frame
+#define FRAME_BYTES_MAX (LAYOUT_MAX_LANES * LAYOUT_LEDS_PER_LANE * 3)
+
+static struct _PowerConfig s_powerConfig = { 0, POWER_DEFAULT_MILLIAMPS_PER_CHANNEL, POWER_DEFAULT_IDLE_MICROAMPS_PER_LED, POWER_DEFAULT_MILLIVOLTS };
+static struct _PresentStats s_presentStats = { 0, 0, 0, 0, 0, SCALE_FULL };
+static uint8_t s_presentFrameAr[FRAME_BYTES_MAX];
+static pthread_mutex_t s_presentMutex = PTHREAD_MUTEX_INITIALIZER;  // clock, ticker, command threads all present
+
+// calibration as loaded, red/green/blue order
+struct _CalibrationFile {
+    uint8_t bLoaded;
+    char fileName[64];
+    uint8_t nLutAr[3][256];
+    double fGainAr[3];
+    uint8_t bHasMatrix;
+    double fMatrixAr[3][3];
+};
+
+static struct _CalibrationFile s_calibrationFileAr[LAYOUT_MAX_LANES];
+static struct _LaneCalibration s_laneCalibrationAr[LAYOUT_MAX_LANES];     // what present uses
+static double s_fGamma = 1.0;
+static int s_bCalibrating;          // T/F any lane calibrated or gamma not 1.0
+
+// red, green, blue -> position in frame (green, red, blue)
+static const uint8_t s_nFrameByteForRGB[3] = { 1, 0, 2 };
+
+// -----------------------
+// forward declarations
+//
+static uint32_t milliAmpsForChannelSum(uint32_t nChannelSum, size_t nLeds);
+static const uint8_t *presentFrame(const uint8_t *buffer, size_t bufferLen, int bProgramFrame);
+static uint32_t limiterTargetScale(uint32_t nChannelSum, size_t nLeds);
+static uint32_t limiterScaleFor(uint32_t nChannelSum, size_t nLeds);
+static uint32_t calibrateFrame(const uint8_t *buffer, size_t bufferLen, uint8_t *pOutput);
+static uint32_t calibrateLedRun(const uint8_t *pInput, uint8_t *pOutput, size_t nLeds, size_t nStepBytes, const struct _LaneCalibration *pCalibration);
+static void resetCalibrationFile(struct _CalibrationFile *pFile);
+static void rebuildCalibration(void);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+void setPowerConfig(const struct _PowerConfig *pConfig)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    s_powerConfig = *pConfig;
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+void getPowerConfig(struct _PowerConfig *pConfig)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    *pConfig = s_powerConfig;
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+void getPresentStats(struct _PresentStats *pStats)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    *pStats = s_presentStats;
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+void resetPresentStats(void)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    s_presentStats.nFrames = 0;
+    s_presentStats.nLimitedFrames = 0;
+    s_presentStats.nPeakSentMilliAmps = 0;
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+void showPresentStats(void)
+{
+    struct _PowerConfig config;
+    struct _PresentStats stats;
+    getPowerConfig(&config);
+    getPresentStats(&stats);
+    double fVolts = config.nMilliVolts / 1000.0;
+    if(config.nBudgetMilliAmps == 0) {
+        infoMessage("Power: no limit (%u mA per channel, %u uA idle per LED, %.2f V)", config.nMilliAmpsPerChannel, config.nIdleMicroAmpsPerLed, fVolts);
+    }
+    else {
+        infoMessage("Power: limit %u mA = %.2f W (%u mA per channel, %u uA idle per LED, %.2f V)", config.nBudgetMilliAmps, (config.nBudgetMilliAmps * fVolts) / 1000.0,
+            config.nMilliAmpsPerChannel, config.nIdleMicroAmpsPerLed, fVolts);
+    }
+    infoMessage("Last frame: drawn %u mA = %.2f W, sent %u mA = %.2f W (brightness %.1f%%)", stats.nLastDrawnMilliAmps, (stats.nLastDrawnMilliAmps * fVolts) / 1000.0,
+        stats.nLastSentMilliAmps, (stats.nLastSentMilliAmps * fVolts) / 1000.0, (stats.nLimiterScale * 100.0) / SCALE_FULL);
+    infoMessage("%u frames, %u limited, peak sent %u mA = %.2f W", stats.nFrames, stats.nLimitedFrames, stats.nPeakSentMilliAmps, (stats.nPeakSentMilliAmps * fVolts) / 1000.0);
+}
+
+int loadCalibrationFile(uint8_t nLane, const char *fileSpec)
+{
+    struct _CalibrationFile newFile;
+    static const char *channelNames[] = { "red", "green", "blue" };
+    char lineBuffer[1024];
+    char keyword[16];
+    char *pComment;
+    int nLineNbr = 0;
+    int loadStatus = 0;    // SUCCESS
+
+    if(nLane >= LAYOUT_MAX_LANES) {
+        errorMessage("lane (%d) out-of-range: [0-%d]", nLane, LAYOUT_MAX_LANES - 1);
+        return -1;
+    }
+    FILE *fpCalibrationFile = fopen(fileSpec, "r");
+    if(fpCalibrationFile == NULL) {
+        perrorMessage("fopen() failure");
+        return -1;
+    }
+
+    resetCalibrationFile(&newFile);
+    while(loadStatus == 0 && fgets(lineBuffer, sizeof(lineBuffer), fpCalibrationFile) != NULL) {
+        nLineNbr++;
+        if((pComment = strchr(lineBuffer, '#')) != NULL) {
+            *pComment = 0x00;
+        }
+        int nKeywordLen = 0;
+        double fGainAr[3];
+        double fMatrixAr[9];
+        if(sscanf(lineBuffer, " %15s %n", keyword, &nKeywordLen) != 1) {
+            continue;   // blank line
+        }
+        int nChannel;
+        for(nChannel = 0; nChannel < 3; nChannel++) {
+            if(strcmp(keyword, channelNames[nChannel]) == 0) {
+                break;
+            }
+        }
+        if(nChannel < 3) {
+            // {firstIndex} {value} [{value} ...]
+            char *pNext = &lineBuffer[nKeywordLen];
+            char *pEnd;
+            long nIndex = strtol(pNext, &pEnd, 0);
+            int nValues = 0;
+            if(pEnd == pNext || nIndex < 0 || nIndex > 255) {
+                errorMessage("%s:%d %s first index missing or out-of-range: [0-255]", fileSpec, nLineNbr, keyword);
+                loadStatus = -1;
+            }
+            for(pNext = pEnd; loadStatus == 0; pNext = pEnd) {
+                long nValue = strtol(pNext, &pEnd, 0);
+                if(pEnd == pNext) {
+                    break;
+                }
+                if(nValue < 0 || nValue > 255 || nIndex + nValues > 255) {
+                    errorMessage("%s:%d %s entry %ld (%ld) out-of-range: [0-255]", fileSpec, nLineNbr, keyword, nIndex + nValues, nValue);
+                    loadStatus = -1;
+                }
+                else {
+                    newFile.nLutAr[nChannel][nIndex + nValues++] = nValue;
+                }
+            }
+            if(loadStatus == 0 && (nValues == 0 || strspn(pNext, " \t\r\n") != strlen(pNext))) {
+                errorMessage("%s:%d bad %s values [%s]", fileSpec, nLineNbr, keyword, pNext);
+                loadStatus = -1;
+            }
+        }
+        else if(strcmp(keyword, "gain") == 0 && sscanf(lineBuffer, " gain %lf %lf %lf", &fGainAr[0], &fGainAr[1], &fGainAr[2]) == 3) {
+            for(nChannel = 0; nChannel < 3; nChannel++) {
+                if(fGainAr[nChannel] < 0.0 || fGainAr[nChannel] > 1.0) {
+                    errorMessage("%s:%d gain (%.3f) out-of-range: [0.0-1.0]", fileSpec, nLineNbr, fGainAr[nChannel]);
+                    loadStatus = -1;
+                }
+                newFile.fGainAr[nChannel] = fGainAr[nChannel];
+            }
+        }
+        else if(strcmp(keyword, "matrix") == 0 && sscanf(lineBuffer, " matrix %lf %lf %lf %lf %lf %lf %lf %lf %lf", &fMatrixAr[0], &fMatrixAr[1], &fMatrixAr[2],
+                    &fMatrixAr[3], &fMatrixAr[4], &fMatrixAr[5], &fMatrixAr[6], &fMatrixAr[7], &fMatrixAr[8]) == 9) {
+            for(int nTermIdx = 0; nTermIdx < 9; nTermIdx++) {
+                if(fMatrixAr[nTermIdx] < -4.0 || fMatrixAr[nTermIdx] > 4.0) {
+                    errorMessage("%s:%d matrix term (%.3f) out-of-range: [-4.0-4.0]", fileSpec, nLineNbr, fMatrixAr[nTermIdx]);
+                    loadStatus = -1;
+                }
+                newFile.fMatrixAr[nTermIdx / 3][nTermIdx % 3] = fMatrixAr[nTermIdx];
+            }
+            newFile.bHasMatrix = 1;
+        }
+        else {
+            errorMessage("%s:%d unknown calibration line [%s]", fileSpec, nLineNbr, lineBuffer);
+            loadStatus = -1;
+        }
+    }
+    fclose(fpCalibrationFile);
+
+    if(loadStatus == 0) {
+        newFile.bLoaded = 1;
+        const char *pBaseName = strrchr(fileSpec, '/');
+        snprintf(newFile.fileName, sizeof(newFile.fileName), "%s", (pBaseName != NULL) ? pBaseName + 1 : fileSpec);
+        pthread_mutex_lock(&s_presentMutex);
+        s_calibrationFileAr[nLane] = newFile;
+        rebuildCalibration();
+        pthread_mutex_unlock(&s_presentMutex);
+        infoMessage("Calibration %s loaded for lane %d", fileSpec, nLane);
+    }
+    return loadStatus;
+}
+
+void resetCalibration(uint8_t nLane)
+{
+    if(nLane < LAYOUT_MAX_LANES) {
+        pthread_mutex_lock(&s_presentMutex);
+        resetCalibrationFile(&s_calibrationFileAr[nLane]);
+        rebuildCalibration();
+        pthread_mutex_unlock(&s_presentMutex);
+    }
+}
+
+void setPresentGamma(double fGamma)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    s_fGamma = fGamma;
+    rebuildCalibration();
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+int isLaneCalibrated(void)
+{
+    int bLaneCalibrated = 0;
+    pthread_mutex_lock(&s_presentMutex);
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        if(s_calibrationFileAr[nLane].bLoaded) {
+            bLaneCalibrated = 1;
+        }
+    }
+    pthread_mutex_unlock(&s_presentMutex);
+    return bLaneCalibrated;
+}
+
+void showCalibration(void)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    infoMessage("Calibration: gamma %.2f, %s", s_fGamma, (s_bCalibrating) ? "applied to every frame" : "off (frames sent as drawn)");
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        const struct _CalibrationFile *pFile = &s_calibrationFileAr[nLane];
+        if(pFile->bLoaded) {
+            infoMessage(" - lane %d: %s gain %.3f %.3f %.3f%s", nLane, pFile->fileName, pFile->fGainAr[0], pFile->fGainAr[1], pFile->fGainAr[2], (pFile->bHasMatrix) ? " + matrix" : "");
+        }
+        else {
+            infoMessage(" - lane %d: none", nLane);
+        }
+    }
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+const uint8_t *beginPresent(const uint8_t *buffer, size_t bufferLen)
+{
+    return presentFrame(buffer, bufferLen, 0);
+}
+
+const uint8_t *beginPresentProgramFrame(const uint8_t *buffer, size_t bufferLen)
+{
+    return presentFrame(buffer, bufferLen, 1);
+}
+
+void endPresent(void)
+{
+    pthread_mutex_unlock(&s_presentMutex);
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static const uint8_t *presentFrame(const uint8_t *buffer, size_t bufferLen, int bProgramFrame)
+{
+    pthread_mutex_lock(&s_presentMutex);
+    if(bufferLen > FRAME_BYTES_MAX) {
+        return buffer;  // not a frame we know, send as is
+    }
+    size_t nLeds = bufferLen / 3;
+    const uint8_t *pSendFrame = buffer;
+    uint32_t nChannelSum = 0;
+    if(s_bCalibrating) {
+        nChannelSum = calibrateFrame(buffer, bufferLen, s_presentFrameAr);
+        pSendFrame = s_presentFrameAr;
+    }
+    else {
+        for(size_t nByteIdx = 0; nByteIdx < bufferLen; nByteIdx++) {
+            nChannelSum += buffer[nByteIdx];
+        }
+    }
+    // program frames are replayed by the driver on its own schedule: each is held to budget by
+    //  itself and leaves limiter and stats for the live frames
+    uint32_t nScale = bProgramFrame ? limiterTargetScale(nChannelSum, nLeds) : limiterScaleFor(nChannelSum, nLeds);
+    uint32_t nSentSum = nChannelSum;
+    if(nScale < SCALE_FULL) {
+        // calibrated frame is rescaled in place
+        const uint8_t *pUnscaled = pSendFrame;
+        nSentSum = 0;
+        for(size_t nByteIdx = 0; nByteIdx < bufferLen; nByteIdx++) {
+            uint8_t nValue = (pUnscaled[nByteIdx] * nScale) >> 16;
+            s_presentFrameAr[nByteIdx] = nValue;
+            nSentSum += nValue;
+        }
+        pSendFrame = s_presentFrameAr;
+    }
+    if(bProgramFrame) {
+        return pSendFrame;
+    }
+    if(nScale < SCALE_FULL) {
+        s_presentStats.nLimitedFrames++;
+    }
+    s_presentStats.nFrames++;
+    s_presentStats.nLastDrawnMilliAmps = milliAmpsForChannelSum(nChannelSum, nLeds);
+    s_presentStats.nLastSentMilliAmps = milliAmpsForChannelSum(nSentSum, nLeds);
+    if(s_presentStats.nLastSentMilliAmps > s_presentStats.nPeakSentMilliAmps) {
+        s_presentStats.nPeakSentMilliAmps = s_presentStats.nLastSentMilliAmps;
+    }
+    verboseMessage("present: frame %u drawn %u mA, sent %u mA (%.2f W)", s_presentStats.nFrames, s_presentStats.nLastDrawnMilliAmps, s_presentStats.nLastSentMilliAmps,
+        (s_presentStats.nLastSentMilliAmps * (double)s_powerConfig.nMilliVolts) / 1000000.0);
+    return pSendFrame;
+}
+
+static uint32_t milliAmpsForChannelSum(uint32_t nChannelSum, size_t nLeds)
+{
+    uint64_t nMicroAmps = (nLeds * (uint64_t)s_powerConfig.nIdleMicroAmpsPerLed) + (((uint64_t)nChannelSum * s_powerConfig.nMilliAmpsPerChannel * 1000) / 255);
+    return nMicroAmps / 1000;
+}
+
+static uint32_t limiterTargetScale(uint32_t nChannelSum, size_t nLeds)
+{
+    // scale that would put this frame right at budget
+    uint32_t nTargetScale = SCALE_FULL;
+    if(s_powerConfig.nBudgetMilliAmps != 0 && nChannelSum != 0) {
+        uint64_t nIdleMicroAmps = nLeds * (uint64_t)s_powerConfig.nIdleMicroAmpsPerLed;
+        uint64_t nBudgetMicroAmps = s_powerConfig.nBudgetMilliAmps * 1000ULL;
+        uint64_t nChannelMicroAmps = ((uint64_t)nChannelSum * s_powerConfig.nMilliAmpsPerChannel * 1000) / 255;
+        if(nBudgetMicroAmps <= nIdleMicroAmps) {
+            nTargetScale = 0;
+        }
+        else if(nChannelMicroAmps > nBudgetMicroAmps - nIdleMicroAmps) {
+            nTargetScale = ((nBudgetMicroAmps - nIdleMicroAmps) * SCALE_FULL) / nChannelMicroAmps;
+        }
+    }
+    return nTargetScale;
+}
+
+static uint32_t limiterScaleFor(uint32_t nChannelSum, size_t nLeds)
+{
+    uint32_t nTargetScale = limiterTargetScale(nChannelSum, nLeds);
+    // down at once, back up gradually
+    uint32_t nScale = s_presentStats.nLimiterScale;
+    if(nTargetScale <= nScale) {
+        nScale = nTargetScale;
+    }
+    else {
+        uint32_t nStep = (nTargetScale - nScale) >> RELEASE_SHIFT;
+        nScale = (nStep == 0) ? nTargetScale : nScale + nStep;
+    }
+    s_presentStats.nLimiterScale = nScale;
+    return nScale;
+}
+
+static uint32_t calibrateFrame(const uint8_t *buffer, size_t bufferLen, uint8_t *pOutput)
+{
+    // each lane's LEDs through its own tables
+    size_t nLeds = bufferLen / 3;
+    uint32_t nChannelSum = 0;
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        size_t nFirstLed = ledIndexForLane(screenLayout.eFrameFormat, nLane, 0);
+        size_t nStepLeds = (screenLayout.eFrameFormat == FF_LANE_INTERLEAVED) ? LAYOUT_MAX_LANES : 1;
+        if(nFirstLed >= nLeds) {
+            continue;
+        }
+        size_t nLaneLeds = (nLeds - nFirstLed + nStepLeds - 1) / nStepLeds;
+        if(nLaneLeds > LAYOUT_LEDS_PER_LANE) {
+            nLaneLeds = LAYOUT_LEDS_PER_LANE;
+        }
+        nChannelSum += calibrateLedRun(&buffer[nFirstLed * 3], &pOutput[nFirstLed * 3], nLaneLeds, nStepLeds * 3, &s_laneCalibrationAr[nLane]);
+    }
+    return nChannelSum;
+}
+
+static uint32_t calibrateLedRun(const uint8_t *pInput, uint8_t *pOutput, size_t nLeds, size_t nStepBytes, const struct _LaneCalibration *pCalibration)
+{
+    const uint8_t *pLutG = pCalibration->nLutAr[0];
+    const uint8_t *pLutR = pCalibration->nLutAr[1];
+    const uint8_t *pLutB = pCalibration->nLutAr[2];
+    uint32_t nChannelSum = 0;
+    if(!pCalibration->bHasMatrix) {
+        for(size_t nLedIdx = 0; nLedIdx < nLeds; nLedIdx++) {
+            size_t nOffset = nLedIdx * nStepBytes;
+            uint8_t nGreen = pLutG[pInput[nOffset + 0]];
+            uint8_t nRed = pLutR[pInput[nOffset + 1]];
+            uint8_t nBlue = pLutB[pInput[nOffset + 2]];
+            pOutput[nOffset + 0] = nGreen;
+            pOutput[nOffset + 1] = nRed;
+            pOutput[nOffset + 2] = nBlue;
+            nChannelSum += nGreen + nRed + nBlue;
+        }
+        return nChannelSum;
+    }
+    for(size_t nLedIdx = 0; nLedIdx < nLeds; nLedIdx++) {
+        size_t nOffset = nLedIdx * nStepBytes;
+        int32_t nMixedAr[3];
+        for(int nOut = 0; nOut < 3; nOut++) {
+            const int16_t *pRow = pCalibration->nMatrixAr[nOut];
+            int32_t nMixed = ((pRow[0] * pInput[nOffset + 0]) + (pRow[1] * pInput[nOffset + 1]) + (pRow[2] * pInput[nOffset + 2]) + 2048) >> 12;
+            nMixedAr[nOut] = (nMixed < 0) ? 0 : (nMixed > 255) ? 255 : nMixed;
+        }
+        uint8_t nGreen = pLutG[nMixedAr[0]];
+        uint8_t nRed = pLutR[nMixedAr[1]];
+        uint8_t nBlue = pLutB[nMixedAr[2]];
+        pOutput[nOffset + 0] = nGreen;
+        pOutput[nOffset + 1] = nRed;
+        pOutput[nOffset + 2] = nBlue;
+        nChannelSum += nGreen + nRed + nBlue;
+    }
+    return nChannelSum;
+}
+
+static void resetCalibrationFile(struct _CalibrationFile *pFile)
+{
+    memset(pFile, 0, sizeof(struct _CalibrationFile));
+    for(int nChannel = 0; nChannel < 3; nChannel++) {
+        for(int nValue = 0; nValue < 256; nValue++) {
+            pFile->nLutAr[nChannel][nValue] = nValue;
+        }
+        pFile->fGainAr[nChannel] = 1.0;
+        pFile->fMatrixAr[nChannel][nChannel] = 1.0;
+    }
+}
+
+static void rebuildCalibration(void)
+{
+    // caller holds s_presentMutex
+    s_bCalibrating = (s_fGamma != 1.0);
+    for(int nLane = 0; nLane < LAYOUT_MAX_LANES; nLane++) {
+        struct _CalibrationFile *pFile = &s_calibrationFileAr[nLane];
+        struct _LaneCalibration *pCalibration = &s_laneCalibrationAr[nLane];
+        if(pFile->bLoaded) {
+            s_bCalibrating = 1;
+        }
+        else {
+            resetCalibrationFile(pFile);    // 1:1
+        }
+        // tables: gamma, then file LUT, then gain
+        for(int nChannel = 0; nChannel < 3; nChannel++) {
+            uint8_t *pLut = pCalibration->nLutAr[s_nFrameByteForRGB[nChannel]];
+            for(int nValue = 0; nValue < 256; nValue++) {
+                int nGammaValue = (int)((pow(nValue / 255.0, s_fGamma) * 255.0) + 0.5);
+                pLut[nValue] = (uint8_t)((pFile->nLutAr[nChannel][nGammaValue] * pFile->fGainAr[nChannel]) + 0.5);
+            }
+        }
+        // matrix, rows/columns moved to frame byte order
+        pCalibration->bHasMatrix = pFile->bHasMatrix;
+        for(int nOut = 0; nOut < 3; nOut++) {
+            for(int nIn = 0; nIn < 3; nIn++) {
+                double fTerm = pFile->fMatrixAr[nOut][nIn] * 4096.0;
+                pCalibration->nMatrixAr[s_nFrameByteForRGB[nOut]][s_nFrameByteForRGB[nIn]] = (int16_t)((fTerm < 0.0) ? fTerm - 0.5 : fTerm + 0.5);
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// WS2812B-ish defaults for estimating current drawn by a frame
+#define POWER_DEFAULT_MILLIAMPS_PER_CHANNEL 20  // one color channel at 255
+#define POWER_DEFAULT_IDLE_MICROAMPS_PER_LED 1000
+#define POWER_DEFAULT_MILLIVOLTS 5000
+#define POWER_MAX_MILLIAMPS_PER_CHANNEL 100     // sane limits for power command values
+#define POWER_MAX_IDLE_MICROAMPS_PER_LED 10000
+#define POWER_MAX_MILLIVOLTS 48000
+
+struct _PowerConfig {
+    uint32_t nBudgetMilliAmps;          // 0 = no limit
+    uint32_t nMilliAmpsPerChannel;
+    uint32_t nIdleMicroAmpsPerLed;
+    uint32_t nMilliVolts;
+};
+
+struct _PresentStats {
+    uint32_t nFrames;                   // presented since stats reset
+    uint32_t nLimitedFrames;            // of those, dimmed to stay in budget
+    uint32_t nLastDrawnMilliAmps;       // estimate of last frame as drawn
+    uint32_t nLastSentMilliAmps;        // and as sent (after limiting)
+    uint32_t nPeakSentMilliAmps;
+    uint32_t nLimiterScale;             // current brightness scale, 65536 = 1.0
+};
+
+// per lane (panels sharing a GPIO pin) color calibration, frame byte order [green, red, blue]
+//  gamma, file LUT and white balance gain pre-combined, so each channel is one table lookup
+struct _LaneCalibration {
+    uint8_t nLutAr[3][256];
+    int16_t nMatrixAr[3][3];            // [out][in] 4096 = 1.0, mixes channels before LUT
+    uint8_t bHasMatrix;
+};
+
+void setPowerConfig(const struct _PowerConfig *pConfig);
+void getPowerConfig(struct _PowerConfig *pConfig);
+void getPresentStats(struct _PresentStats *pStats);
+void resetPresentStats(void);
+void showPresentStats(void);
+
+// calibration file (lane unchanged on error, 0 on success) lines of:
+//   red|green|blue {firstIndex} {value} [{value} ...]   - LUT entries from firstIndex on (rest stay 1:1)
+//   gain {red} {green} {blue}                           - white balance, scales LUT output [0.0 - 1.0]
+//   matrix {rr} {rg} {rb} {gr} {gg} {gb} {br} {bg} {bb}  - color correction, out red = rr*red + rg*green + rb*blue ...
+int loadCalibrationFile(uint8_t nLane, const char *fileSpec);
+void resetCalibration(uint8_t nLane);
+void setPresentGamma(double fGamma);    // 1.0 = none, applied ahead of calibration LUTs
+void showCalibration(void);
+int isLaneCalibrated(void);             // T/F any lane has a calibration file loaded
+
+// every frame on its way to the driver: returns frame to actually send (buffer itself or
+//  present stage's copy), which stays valid and unchanged until endPresent()
+const uint8_t *beginPresent(const uint8_t *buffer, size_t bufferLen);
+// same for a display program frame: held to budget on its own, limiter state and stats untouched
+const uint8_t *beginPresentProgramFrame(const uint8_t *buffer, size_t bufferLen);
+void endPresent(void);
+
+#endif /* PRESENT_H */
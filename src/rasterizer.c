@@ -0,0 +1,307 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdlib.h>     // abs(), qsort()
+#include <math.h>       // ceilf(), floorf()
+
+#include "rasterizer.h"
+#include "pixelFill.h"
+
+//  Everything here is drawn as spans: runs of pixels along one row or column that
+//  are filled through the layout table in one go (see fillClippedRectInBuffer()).  Spans
+//  run the way the LED strings do (columns on our panels) so a span is mostly one
+//  run of consecutive LEDs.  Shape code works in (along, across) coordinates and
+//  fillSpan() turns them back into X,Y.
+//
+//  Lines are walked with Bresenham's algorithm collecting each row/column into a
+//  span.  Thick lines paint a square brush at each span (the span grows by width-1
+//  and covers width rows/columns).  Anti-aliased lines use Wu's algorithm in 16.16
+//  fixed point and blend each pixel with the buffer.
+//
+//  Circles are spans from x*x + y*y <= r*r + r (rounder than r*r on small radii),
+//  polygons are scan converted (even-odd) one row/column at a time, sampled at
+//  pixel centers, with the edges drawn on top so fills include their outline pixels.
+//
+//  Nothing here keeps state between calls: the caller's clip rectangle (NULL means
+//  whole screen) is passed all the way down, so threads drawing into different
+//  buffers can rasterize at the same time.
+
+// -----------------------
+// forward declarations
+//
+static void blendPixel(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int locX, int locY, uint32_t nColorRGB, uint8_t nAlpha);
+static void fillSpan(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int bAlongColumns, int nAcross, int nFrom, int nTo, int nThickness, uint32_t nColorRGB);
+static int circleHalfSpan(int nRadius, int nOffset);
+static int compareFloats(const void *pLeft, const void *pRight);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+void rasterLine(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int fmX, int fmY, int toX, int toY, int nLineWidth, uint32_t nColorRGB)
+{
+    int bAlongColumns = isLayoutColumnMajor();
+    int nSwap;
+
+    // X is along span, Y across spans
+    if(bAlongColumns) {
+        nSwap = fmX; fmX = fmY; fmY = nSwap;
+        nSwap = toX; toX = toY; toY = nSwap;
+    }
+    int nDeltaX = abs(toX - fmX);
+    int nDeltaY = -abs(toY - fmY);
+    int nStepX = (fmX < toX) ? 1 : -1;
+    int nStepY = (fmY < toY) ? 1 : -1;
+    int nError = nDeltaX + nDeltaY;
+    int nBrushOffset = (nLineWidth - 1) / 2;
+    int nX = fmX;
+    int nY = fmY;
+    int nSpanStartX = fmX;
+
+    if(nLineWidth < 1) {
+        nLineWidth = 1;
+        nBrushOffset = 0;
+    }
+    while(1) {
+        int bAtEnd = (nX == toX && nY == toY);
+        int nNextX = nX;
+        int nNextY = nY;
+        if(!bAtEnd) {
+            int nError2 = 2 * nError;
+            if(nError2 >= nDeltaY) {
+                nError += nDeltaY;
+                nNextX += nStepX;
+            }
+            if(nError2 <= nDeltaX) {
+                nError += nDeltaX;
+                nNextY += nStepY;
+            }
+        }
+        if(bAtEnd || nNextY != nY) {
+            // row (column) finished, emit its span
+            int nSpanMinX = (nSpanStartX < nX) ? nSpanStartX : nX;
+            int nSpanMaxX = (nSpanStartX < nX) ? nX : nSpanStartX;
+            fillSpan(pBuffer, pClip, bAlongColumns, nY - nBrushOffset, nSpanMinX - nBrushOffset, nSpanMaxX - nBrushOffset + nLineWidth - 1, nLineWidth, nColorRGB);
+            nSpanStartX = nNextX;
+        }
+        if(bAtEnd) {
+            break;
+        }
+        nX = nNextX;
+        nY = nNextY;
+    }
+}
+
+void rasterLineAA(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int fmX, int fmY, int toX, int toY, uint32_t nColorRGB)
+{
+    int bIsSteep = abs(toY - fmY) > abs(toX - fmX);
+    int nSwap;
+
+    // walk along the major axis, left to right
+    if(bIsSteep) {
+        nSwap = fmX; fmX = fmY; fmY = nSwap;
+        nSwap = toX; toX = toY; toY = nSwap;
+    }
+    if(fmX > toX) {
+        nSwap = fmX; fmX = toX; toX = nSwap;
+        nSwap = fmY; fmY = toY; toY = nSwap;
+    }
+    int nDeltaX = toX - fmX;
+    int nDeltaY = toY - fmY;
+    int32_t nGradient = (nDeltaX == 0) ? 0 : (nDeltaY * 65536) / nDeltaX;
+    int32_t nIntersectY = fmY * 65536;     // 16.16, endpoints land on pixel centers
+
+    for(int nMajor = fmX; nMajor <= toX; nMajor++) {
+        int nMinor = nIntersectY >> 16;
+        uint8_t nFraction = (nIntersectY >> 8) & 0xff;
+        // split coverage between the two pixels the ideal line passes between
+        if(bIsSteep) {
+            blendPixel(pBuffer, pClip, nMinor, nMajor, nColorRGB, 255 - nFraction);
+            blendPixel(pBuffer, pClip, nMinor + 1, nMajor, nColorRGB, nFraction);
+        }
+        else {
+            blendPixel(pBuffer, pClip, nMajor, nMinor, nColorRGB, 255 - nFraction);
+            blendPixel(pBuffer, pClip, nMajor, nMinor + 1, nColorRGB, nFraction);
+        }
+        nIntersectY += nGradient;
+    }
+}
+
+void rasterRect(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int locX, int locY, int nWidth, int nHeight, int nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    if(nWidth < 1 || nHeight < 1) {
+        return;
+    }
+    if(nBorderWidth * 2 >= nWidth || nBorderWidth * 2 >= nHeight) {
+        // all border
+        fillClippedRectInBuffer(pBuffer, pClip, locX, locY, nWidth, nHeight, nBorderColor);
+        return;
+    }
+    if(bFill) {
+        fillClippedRectInBuffer(pBuffer, pClip, locX + nBorderWidth, locY + nBorderWidth, nWidth - (2 * nBorderWidth), nHeight - (2 * nBorderWidth), nFillColor);
+    }
+    if(nBorderWidth > 0) {
+        // top, bottom full width; left, right between them
+        fillClippedRectInBuffer(pBuffer, pClip, locX, locY, nWidth, nBorderWidth, nBorderColor);
+        fillClippedRectInBuffer(pBuffer, pClip, locX, locY + nHeight - nBorderWidth, nWidth, nBorderWidth, nBorderColor);
+        fillClippedRectInBuffer(pBuffer, pClip, locX, locY + nBorderWidth, nBorderWidth, nHeight - (2 * nBorderWidth), nBorderColor);
+        fillClippedRectInBuffer(pBuffer, pClip, locX + nWidth - nBorderWidth, locY + nBorderWidth, nBorderWidth, nHeight - (2 * nBorderWidth), nBorderColor);
+    }
+}
+
+void rasterCircle(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int nCenterX, int nCenterY, int nRadius, int nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    int bAlongColumns = isLayoutColumnMajor();
+    int nCenterAlong = (bAlongColumns) ? nCenterY : nCenterX;
+    int nCenterAcross = (bAlongColumns) ? nCenterX : nCenterY;
+    int nInnerRadius = nRadius - nBorderWidth;
+
+    if(nRadius < 0) {
+        return;
+    }
+    for(int nOffset = -nRadius; nOffset <= nRadius; nOffset++) {
+        int nOuterHalf = circleHalfSpan(nRadius, nOffset);
+        int nInnerHalf = (nInnerRadius >= 0 && abs(nOffset) <= nInnerRadius) ? circleHalfSpan(nInnerRadius, nOffset) : -1;
+        int nAcross = nCenterAcross + nOffset;
+        if(nBorderWidth <= 0) {
+            if(bFill) {
+                fillSpan(pBuffer, pClip, bAlongColumns, nAcross, nCenterAlong - nOuterHalf, nCenterAlong + nOuterHalf, 1, nFillColor);
+            }
+            continue;
+        }
+        if(nInnerHalf < 0) {
+            // ring is solid here
+            fillSpan(pBuffer, pClip, bAlongColumns, nAcross, nCenterAlong - nOuterHalf, nCenterAlong + nOuterHalf, 1, nBorderColor);
+            continue;
+        }
+        fillSpan(pBuffer, pClip, bAlongColumns, nAcross, nCenterAlong - nOuterHalf, nCenterAlong - nInnerHalf - 1, 1, nBorderColor);
+        fillSpan(pBuffer, pClip, bAlongColumns, nAcross, nCenterAlong + nInnerHalf + 1, nCenterAlong + nOuterHalf, 1, nBorderColor);
+        if(bFill) {
+            fillSpan(pBuffer, pClip, bAlongColumns, nAcross, nCenterAlong - nInnerHalf, nCenterAlong + nInnerHalf, 1, nFillColor);
+        }
+    }
+}
+
+void rasterPolygon(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, const int16_t *pPointsXY, int nPoints, int nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor)
+{
+    int bAlongColumns = isLayoutColumnMajor();
+
+    if(nPoints < 3 || nPoints > RASTER_MAX_POLYGON_POINTS) {
+        return;
+    }
+    if(bFill) {
+        int nAlongIdx = (bAlongColumns) ? 1 : 0;    // index of along coord within each X,Y pair
+        int nAcrossIdx = 1 - nAlongIdx;
+        int nMinAcross = pPointsXY[nAcrossIdx];
+        int nMaxAcross = pPointsXY[nAcrossIdx];
+        float crossingsAr[RASTER_MAX_POLYGON_POINTS];
+        for(int nPointIdx = 1; nPointIdx < nPoints; nPointIdx++) {
+            int nAcross = pPointsXY[(nPointIdx * 2) + nAcrossIdx];
+            nMinAcross = (nAcross < nMinAcross) ? nAcross : nMinAcross;
+            nMaxAcross = (nAcross > nMaxAcross) ? nAcross : nMaxAcross;
+        }
+        for(int nAcross = nMinAcross; nAcross <= nMaxAcross; nAcross++) {
+            // where does this row (column) cross each edge? (edge includes its low end only)
+            int nCrossings = 0;
+            for(int nPointIdx = 0; nPointIdx < nPoints; nPointIdx++) {
+                const int16_t *pFm = &pPointsXY[nPointIdx * 2];
+                const int16_t *pTo = &pPointsXY[((nPointIdx + 1) % nPoints) * 2];
+                int nFmAcross = pFm[nAcrossIdx];
+                int nToAcross = pTo[nAcrossIdx];
+                if((nFmAcross <= nAcross && nAcross < nToAcross) || (nToAcross <= nAcross && nAcross < nFmAcross)) {
+                    float fraction = (float)(nAcross - nFmAcross) / (float)(nToAcross - nFmAcross);
+                    crossingsAr[nCrossings++] = pFm[nAlongIdx] + (fraction * (pTo[nAlongIdx] - pFm[nAlongIdx]));
+                }
+            }
+            qsort(crossingsAr, nCrossings, sizeof(float), compareFloats);
+            for(int nCrossIdx = 0; nCrossIdx + 1 < nCrossings; nCrossIdx += 2) {
+                int nFrom = (int)ceilf(crossingsAr[nCrossIdx]);
+                int nTo = (int)floorf(crossingsAr[nCrossIdx + 1]);
+                if(nFrom <= nTo) {
+                    fillSpan(pBuffer, pClip, bAlongColumns, nAcross, nFrom, nTo, 1, nFillColor);
+                }
+            }
+        }
+    }
+    // edges: the border, or (no border) the fill's own outline
+    int nEdgeWidth = (nBorderWidth > 0) ? nBorderWidth : 1;
+    uint32_t nEdgeColor = (nBorderWidth > 0) ? nBorderColor : nFillColor;
+    if(nBorderWidth > 0 || bFill) {
+        for(int nPointIdx = 0; nPointIdx < nPoints; nPointIdx++) {
+            const int16_t *pFm = &pPointsXY[nPointIdx * 2];
+            const int16_t *pTo = &pPointsXY[((nPointIdx + 1) % nPoints) * 2];
+            rasterLine(pBuffer, pClip, pFm[0], pFm[1], pTo[0], pTo[1], nEdgeWidth, nEdgeColor);
+        }
+    }
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static void fillSpan(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int bAlongColumns, int nAcross, int nFrom, int nTo, int nThickness, uint32_t nColorRGB)
+{
+    // span [nFrom-nTo] along a column (or row) nThickness columns (rows) wide starting at nAcross
+    if(nTo < nFrom) {
+        return;
+    }
+    if(bAlongColumns) {
+        fillClippedRectInBuffer(pBuffer, pClip, nAcross, nFrom, nThickness, (nTo - nFrom) + 1, nColorRGB);
+    }
+    else {
+        fillClippedRectInBuffer(pBuffer, pClip, nFrom, nAcross, (nTo - nFrom) + 1, nThickness, nColorRGB);
+    }
+}
+
+static int circleHalfSpan(int nRadius, int nOffset)
+{
+    // largest N where N*N + offset*offset <= r*r + r
+    int nLimit = (nRadius * nRadius) + nRadius - (nOffset * nOffset);
+    int nHalf = 0;
+    while((nHalf + 1) * (nHalf + 1) <= nLimit) {
+        nHalf++;
+    }
+    return nHalf;
+}
+
+static int compareFloats(const void *pLeft, const void *pRight)
+{
+    float left = *(const float *)pLeft;
+    float right = *(const float *)pRight;
+    return (left > right) - (left < right);
+}
+
+static void blendPixel(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int locX, int locY, uint32_t nColorRGB, uint8_t nAlpha)
+{
+    if(nAlpha == 0 || !IS_ON_SCREEN(locX, locY)) {
+        return;
+    }
+    if(pClip != NULL && (locX < pClip->nMinX || locX > pClip->nMaxX || locY < pClip->nMinY || locY > pClip->nMaxY)) {
+        return;
+    }
+    struct _LedPixel *pLED = ptrLEDinBuffer(pBuffer, locX, locY);
+    int nRed = (nColorRGB >> 16) & 0xff;
+    int nGreen = (nColorRGB >> 8) & 0xff;
+    int nBlue = (nColorRGB >> 0) & 0xff;
+    pLED->red += ((nRed - pLED->red) * nAlpha) / 255;
+    pLED->green += ((nGreen - pLED->green) * nAlpha) / 255;
+    pLED->blue += ((nBlue - pLED->blue) * nAlpha) / 255;
+}
@@ -0,0 +1,45 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <stdint.h>
+
+#include "frameBuffer.h"
+
+// all shapes are clipped to pClip (within screen) or, when NULL, to the screen
+
+// line between two points, nLineWidth pixels thick (centered), drawn as horizontal spans
+void rasterLine(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int fmX, int fmY, int toX, int toY, int nLineWidth, uint32_t nColorRGB);
+
+#define RASTER_MAX_POLYGON_POINTS 32
+
+// shapes: border (nBorderWidth > 0, drawn inside rect/circle, centered on polygon edges) and/or fill
+void rasterRect(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int locX, int locY, int nWidth, int nHeight, int nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+void rasterCircle(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int nCenterX, int nCenterY, int nRadius, int nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+// pPointsXY is nPoints X,Y pairs, closed back to first point
+void rasterPolygon(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, const int16_t *pPointsXY, int nPoints, int nBorderWidth, uint32_t nBorderColor, int bFill, uint32_t nFillColor);
+
+// anti-aliased (Wu) 1 pixel line, blended into what is already in buffer
+void rasterLineAA(struct _LedPixel *pBuffer, const struct _ClipRect *pClip, int fmX, int fmY, int toX, int toY, uint32_t nColorRGB);
+
+#endif /* RASTERIZER_H */
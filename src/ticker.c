@@ -0,0 +1,338 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#include <stdlib.h>     // free()
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "ticker.h"
+#include "frameBuffer.h"
+#include "bitmapFont.h"
+#include "matrixDriver.h"
+#include "compositor.h"
+#include "xmalloc.h"
+#include "debug.h"
+
+//  The message is drawn once into a strip: a screen width of blank lead-in (so the
+//  text enters from the right) followed by the text.  The strip is kept column by
+//  column, each column both top-to-bottom and bottom-to-top, so a strip column lands
+//  on a column of LEDs as one memcpy whichever way that column is wired:
+//
+//    frame N shows strip columns [N, N + SCREEN_WIDTH) (wrapping), one copy per screen column
+//
+//  Every frame moves exactly one column and is queued with the driver for its exact
+//  present time (N / columnsPerSec), so speed is not tied to a frame rate and motion
+//  stays even at any speed.  Effects which move with the text (rainbow) are baked into
+//  the strip, effects tied to the screen (edge fade) touch only the edge columns.
+
+#define TICKER_FADE_COLUMNS 4
+
+#define MIN(a,b) ((a < b) ? a : b)
+#define MAX(a,b) ((a > b) ? a : b)
+
+struct _TickerStrip {
+    int nColumns;
+    int nRows;
+    struct _LedPixel *pColumnsDown; // [nColumns][nRows] per column, top to bottom
+    struct _LedPixel *pColumnsUp;   // [nColumns][nRows] per column, bottom to top
+};
+
+// LED run of each screen column within ticker band
+struct _TickerPlacement {
+    uint32_t nLayoutGeneration;     // layout these were computed for
+    uint16_t nFirstLedAr[LAYOUT_MAX_WIDTH];
+    int16_t nStepAr[LAYOUT_MAX_WIDTH];  // LED index step down column, 0 = not one run
+};
+
+static pthread_t s_tickerThread;
+static pthread_mutex_t s_tickerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_tickerWakeCond;    // signaled to stop thread early (CLOCK_MONOTONIC timed waits)
+static int s_bTickerRunning;
+static int s_bStopRequested;    // guarded by s_tickerMutex
+static struct _TickerStrip s_strip;
+static struct _TickerPlacement s_placement;
+static int s_nTickerBufferNumber;
+static int s_nTickerLocY;
+static uint64_t s_nColumnPeriodNsec;
+static eTickerEffect s_eTickerEffect;
+
+// -----------------------
+// forward declarations
+//
+static void *tickerThread(void *pArg);
+static void renderStrip(const struct _Font *pFont, const char *cMessage, uint32_t nColorRGB, eTickerEffect eEffect);
+static uint32_t rainbowColor(int nColumn, uint32_t nColorRGB);
+static void updatePlacement(void);
+static void showTickerWindow(struct _LedPixel *pBuffer, int nWindowColumn);
+
+
+// -----------------------
+//  PUBLIC Methods
+//
+int runTicker(const char *cMessage, uint32_t nColorRGB, int nColumnsPerSec, int nBufferNumber, int nPanelNumber, eTickerEffect eEffect)
+{
+    if(s_bTickerRunning) {
+        warningMessage("runTicker() Skipped, already running (use 'ticker stop' before next start)");
+        return -1;  // FAILURE
+    }
+    if(nColumnsPerSec < 1 || nColumnsPerSec > TICKER_MAX_COLUMNS_PER_SEC) {
+        errorMessage("runTicker() speed (%d) out-of-range: [must be 1 >= N <= %d columns/sec]", nColumnsPerSec, TICKER_MAX_COLUMNS_PER_SEC);
+        return -1;  // FAILURE
+    }
+    if(ptrBuffer(nBufferNumber) == NULL) {
+        errorMessage("runTicker() No Buffer at #%d", nBufferNumber);
+        return -1;  // FAILURE
+    }
+    const struct _Font *pFont = getDefaultFont();
+
+    // same panel placement as panel strings, whole screen = band centered
+    if(nPanelNumber == 0) {
+        s_nTickerLocY = (SCREEN_HEIGHT - pFont->nHeight) / 2;
+    }
+    else if(nPanelNumber == 12 || nPanelNumber == 23) {
+        s_nTickerLocY = ((nPanelNumber == 12) ? 0 : ROWS_PER_PANEL) + (ROWS_PER_PANEL / 2);
+    }
+    else {
+        s_nTickerLocY = (nPanelNumber - 1) * ROWS_PER_PANEL;
+    }
+    if(s_nTickerLocY < 0 || s_nTickerLocY >= SCREEN_HEIGHT) {
+        errorMessage("runTicker() panel (%d) is not on screen", nPanelNumber);
+        return -1;  // FAILURE
+    }
+
+    renderStrip(pFont, cMessage, nColorRGB, eEffect);
+    s_nTickerBufferNumber = nBufferNumber;
+    s_nColumnPeriodNsec = 1000000000ULL / nColumnsPerSec;
+    s_eTickerEffect = eEffect;
+    s_placement.nLayoutGeneration = 0;
+
+    verboseMessage("runTicker() %d strip columns x %d rows, %d columns/sec", s_strip.nColumns, s_strip.nRows, nColumnsPerSec);
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_tickerWakeCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+    s_bStopRequested = 0;
+    int nStatus = pthread_create(&s_tickerThread, NULL, tickerThread, NULL);
+    if(nStatus != 0) {
+        errorMessage("runTicker() pthread_create() failed error(%d)", nStatus);
+        pthread_cond_destroy(&s_tickerWakeCond);
+        free(s_strip.pColumnsDown);
+        free(s_strip.pColumnsUp);
+        memset(&s_strip, 0, sizeof(s_strip));
+        return -1;  // FAILURE
+    }
+    s_bTickerRunning = 1;  // show IS running
+    return 0;   // SUCCESS
+}
+
+void stopTicker(void)
+{
+    verboseMessage("stopTicker() Stop Ticker Thread");
+
+    if(s_bTickerRunning) {
+        pthread_mutex_lock(&s_tickerMutex);
+        s_bStopRequested = 1;
+        pthread_cond_signal(&s_tickerWakeCond);
+        pthread_mutex_unlock(&s_tickerMutex);
+        pthread_join(s_tickerThread, NULL);
+        pthread_cond_destroy(&s_tickerWakeCond);
+        s_bTickerRunning = 0;  // show NOT running
+        free(s_strip.pColumnsDown);
+        free(s_strip.pColumnsUp);
+        memset(&s_strip, 0, sizeof(s_strip));
+    }
+    else {
+        warningMessage("stopTicker() no ticker running!");
+    }
+}
+
+int isTickerRunning(void)
+{
+    return s_bTickerRunning;
+}
+
+int tickerBufferNumber(void)
+{
+    return (s_bTickerRunning) ? s_nTickerBufferNumber : 0;
+}
+
+
+// -----------------------
+//  PRIVATE Methods
+//
+static void *tickerThread(void *pArg)
+{
+    (void)pArg;
+    int nWindowColumn = 0;
+    uint64_t presentAtNsec = monotonicTimeNsec() + s_nColumnPeriodNsec;
+
+    pthread_mutex_lock(&s_tickerMutex);
+    while(!s_bStopRequested) {
+        pthread_mutex_unlock(&s_tickerMutex);
+
+        // build frame one column period ahead of when it is shown
+        struct _LedPixel *pBuffer = ptrBuffer(s_nTickerBufferNumber);
+        if(pBuffer == NULL) {
+            errorMessage("tickerThread() Buffer #%d went away, ticker stopped", s_nTickerBufferNumber);
+            return NULL;
+        }
+        updatePlacement();
+        showTickerWindow(pBuffer, nWindowColumn);
+        markBufferDirtyRect(s_nTickerBufferNumber, 0, s_nTickerLocY, SCREEN_WIDTH, s_strip.nRows);
+        showLayerBufferAt(s_nTickerBufferNumber, presentAtNsec);
+
+        nWindowColumn = (nWindowColumn + 1) % s_strip.nColumns;
+        presentAtNsec += s_nColumnPeriodNsec;
+        uint64_t wakeAtNsec = presentAtNsec - s_nColumnPeriodNsec;
+        struct timespec tsWakeAt = { .tv_sec = wakeAtNsec / 1000000000ULL, .tv_nsec = wakeAtNsec % 1000000000ULL };
+
+        pthread_mutex_lock(&s_tickerMutex);
+        while(!s_bStopRequested && pthread_cond_timedwait(&s_tickerWakeCond, &s_tickerMutex, &tsWakeAt) == 0) {
+            // woken early but not told to stop, wait rest
+        }
+    }
+    pthread_mutex_unlock(&s_tickerMutex);
+    return NULL;
+}
+
+static void renderStrip(const struct _Font *pFont, const char *cMessage, uint32_t nColorRGB, eTickerEffect eEffect)
+{
+    // [screen width blank][message][1 blank column]
+    int nLeadColumns = SCREEN_WIDTH;
+    s_strip.nRows = MIN(pFont->nHeight, SCREEN_HEIGHT - s_nTickerLocY);
+    const struct _TextLayout *pLayout = layoutString(pFont, cMessage, -1);
+    s_strip.nColumns = nLeadColumns + pLayout->nWidth + 1;
+    size_t nStripBytes = (size_t)s_strip.nColumns * s_strip.nRows * sizeof(struct _LedPixel);
+    s_strip.pColumnsDown = xmalloc(nStripBytes);
+    s_strip.pColumnsUp = xmalloc(nStripBytes);
+    memset(s_strip.pColumnsDown, 0, nStripBytes);
+
+    for(int nGlyphIdx = 0; nGlyphIdx < pLayout->nGlyphs; nGlyphIdx++) {
+        const struct _FontGlyph *pGlyph = pLayout->pGlyphs[nGlyphIdx];
+        int nPenX = nLeadColumns + pLayout->pPenX[nGlyphIdx];
+        int nBytesPerColumn = (pGlyph->nHeight + 7) / 8;
+        const uint8_t *pGlyphColumn = &pFont->pAtlas[pGlyph->nAtlasOffset];
+        for(int nCol = 0; nCol < pGlyph->nWidth; nCol++, pGlyphColumn += nBytesPerColumn) {
+            int nStripCol = nPenX + pGlyph->nOffsetX + nCol;
+            if(nStripCol < 0 || nStripCol >= s_strip.nColumns) {
+                continue;
+            }
+            uint32_t nColumnColor = (eEffect == TE_RAINBOW) ? rainbowColor(nStripCol - nLeadColumns, nColorRGB) : nColorRGB;
+            struct _LedPixel *pStripColumn = &s_strip.pColumnsDown[nStripCol * s_strip.nRows];
+            for(int nRow = 0; nRow < pGlyph->nHeight; nRow++) {
+                int nStripRow = pGlyph->nOffsetY + nRow;
+                if((pGlyphColumn[nRow / 8] & (1 << (nRow % 8))) != 0 && nStripRow >= 0 && nStripRow < s_strip.nRows) {
+                    pStripColumn[nStripRow].red = (nColumnColor >> 16) & 0xff;
+                    pStripColumn[nStripRow].green = (nColumnColor >> 8) & 0xff;
+                    pStripColumn[nStripRow].blue = (nColumnColor >> 0) & 0xff;
+                }
+            }
+        }
+    }
+
+    // same columns bottom to top for LEDs running up
+    for(int nStripCol = 0; nStripCol < s_strip.nColumns; nStripCol++) {
+        const struct _LedPixel *pDown = &s_strip.pColumnsDown[nStripCol * s_strip.nRows];
+        struct _LedPixel *pUp = &s_strip.pColumnsUp[nStripCol * s_strip.nRows];
+        for(int nRow = 0; nRow < s_strip.nRows; nRow++) {
+            pUp[nRow] = pDown[(s_strip.nRows - 1) - nRow];
+        }
+    }
+}
+
+static uint32_t rainbowColor(int nColumn, uint32_t nColorRGB)
+{
+    // full saturation hue wheel, one turn per 48 columns, at brightness of requested color
+    uint8_t nColorRed = (nColorRGB >> 16) & 0xff;
+    uint8_t nColorGreen = (nColorRGB >> 8) & 0xff;
+    uint8_t nColorBlue = nColorRGB & 0xff;
+    uint8_t nBright = MAX(nColorRed, MAX(nColorGreen, nColorBlue));
+    int nHue = (nColumn * 6 * 256 / 48) % (6 * 256);
+    int nRamp = (nHue % 256) * nBright / 255;
+    uint8_t nRed, nGreen, nBlue;
+    switch(nHue / 256) {
+        case 0:  nRed = nBright;         nGreen = nRamp;           nBlue = 0;                break;
+        case 1:  nRed = nBright - nRamp; nGreen = nBright;         nBlue = 0;                break;
+        case 2:  nRed = 0;               nGreen = nBright;         nBlue = nRamp;            break;
+        case 3:  nRed = 0;               nGreen = nBright - nRamp; nBlue = nBright;          break;
+        case 4:  nRed = nRamp;           nGreen = 0;               nBlue = nBright;          break;
+        default: nRed = nBright;         nGreen = 0;               nBlue = nBright - nRamp;  break;
+    }
+    return (nRed << 16) | (nGreen << 8) | nBlue;
+}
+
+static void updatePlacement(void)
+{
+    if(s_placement.nLayoutGeneration == screenLayout.nGeneration) {
+        return;
+    }
+    const uint16_t *pTable = screenLayout.pXlateTable;
+    for(int locX = 0; locX < SCREEN_WIDTH; locX++) {
+        const uint16_t *pEntry = &pTable[(s_nTickerLocY * SCREEN_WIDTH) + locX];
+        s_placement.nFirstLedAr[locX] = pEntry[0];
+        s_placement.nStepAr[locX] = (s_strip.nRows > 1) ? ledRunStep(pEntry, SCREEN_WIDTH, s_strip.nRows) : 0;
+    }
+    s_placement.nLayoutGeneration = screenLayout.nGeneration;
+}
+
+static void showTickerWindow(struct _LedPixel *pBuffer, int nWindowColumn)
+{
+    int nRows = s_strip.nRows;
+    int nStripCol = nWindowColumn;
+    for(int locX = 0; locX < SCREEN_WIDTH; locX++, nStripCol++) {
+        if(nStripCol >= s_strip.nColumns) {
+            nStripCol = 0;
+        }
+        const struct _LedPixel *pDown = &s_strip.pColumnsDown[nStripCol * nRows];
+        uint16_t nFirstLedIdx = s_placement.nFirstLedAr[locX];
+        int nStep = s_placement.nStepAr[locX];
+        int nEdgeDistance = MIN(locX, (SCREEN_WIDTH - 1) - locX);
+        if(s_eTickerEffect == TE_FADE_EDGES && nEdgeDistance < TICKER_FADE_COLUMNS) {
+            // dim toward the edges
+            int nScale = ((nEdgeDistance + 1) * 256) / (TICKER_FADE_COLUMNS + 1);
+            for(int nRow = 0; nRow < nRows; nRow++) {
+                struct _LedPixel *pLED = &pBuffer[ledIndexForXY(locX, s_nTickerLocY + nRow)];
+                pLED->red = (pDown[nRow].red * nScale) >> 8;
+                pLED->green = (pDown[nRow].green * nScale) >> 8;
+                pLED->blue = (pDown[nRow].blue * nScale) >> 8;
+            }
+        }
+        else if(nStep == 1) {
+            memcpy(&pBuffer[nFirstLedIdx], pDown, nRows * sizeof(struct _LedPixel));
+        }
+        else if(nStep == -1) {
+            memcpy(&pBuffer[nFirstLedIdx - (nRows - 1)], &s_strip.pColumnsUp[nStripCol * nRows], nRows * sizeof(struct _LedPixel));
+        }
+        else if(nStep != 0) {
+            for(int nRow = 0; nRow < nRows; nRow++) {
+                pBuffer[nFirstLedIdx + (nRow * nStep)] = pDown[nRow];
+            }
+        }
+        else {
+            // not one run, LED by LED (gap pixels land on the spare LED)
+            for(int nRow = 0; nRow < nRows; nRow++) {
+                pBuffer[ledIndexForXY(locX, s_nTickerLocY + nRow)] = pDown[nRow];
+            }
+        }
+    }
+}
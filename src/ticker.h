@@ -0,0 +1,44 @@
+/*
+   matrix - interactive LED Matrix console
+
+   Copyright (C) 2019 Stephen M Moraco
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software Foundation,
+   Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+*/
+
+#ifndef TICKER_H
+#define TICKER_H
+
+#include <stdint.h>
+
+#define TICKER_MAX_COLUMNS_PER_SEC 1000
+
+typedef enum _eTickerEffect {
+    TE_NONE = 0,
+    TE_RAINBOW,     // hue changes along message (moves with text)
+    TE_FADE_EDGES,  // text dims as it nears left/right edge of screen
+} eTickerEffect;
+
+// scroll message right-to-left through band of buffer forever (panel 0 = band centered on screen)
+//  text is rendered once, each frame then only copies a screen-wide window out of it
+int runTicker(const char *cMessage, uint32_t nColorRGB, int nColumnsPerSec, int nBufferNumber, int nPanelNumber, eTickerEffect eEffect);
+
+void stopTicker(void);
+int isTickerRunning(void);
+// buffer ticker scrolls through, 0 when not running
+int tickerBufferNumber(void);
+
+#endif /* TICKER_H */